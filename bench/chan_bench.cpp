@@ -0,0 +1,621 @@
+// ============================================================================
+// 缠论通达信DLL插件 - 分阶段性能基准
+// ============================================================================
+// 按阶段分别计时 ChanCore 的处理流程与各输出函数，Windows 下另加载
+// chan.dll / chan_std.dll 计时全部通达信导出函数：
+//   chan_bench [选项]
+// 数据规模 1K~10M，行情形态：
+//   random_walk  随机游走
+//   trending     单边趋势（带回撤）
+//   choppy       窄幅震荡（包含关系与分型密集）
+//   limit_up     连续涨跌停（一字板，最高=最低）
+//   suspension   长期停牌（价格不变、成交量为0）
+//   staircase    阶梯上行的细密锯齿（顶分型全部无法成笔，成笔的最坏情形）
+// 结果以 JSON 输出（-o），每条记录为 阶段 x 形态 x 规模 的 ns/根K线，
+// 便于跨版本对比
+// ============================================================================
+
+#include "chan_core.h"
+#include "fx_kernel.h"
+#include "logger.h"
+#include "range_extreme.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+#include <functional>
+#include <random>
+#include <string>
+#include <vector>
+
+#ifdef _WIN32
+#include <windows.h>
+#endif
+
+#ifndef CHAN_BENCH_VERSION
+#define CHAN_BENCH_VERSION "unknown"
+#endif
+
+namespace {
+
+// ============================================================================
+// 行情生成
+// ============================================================================
+
+struct BarData {
+    std::vector<float> highs;
+    std::vector<float> lows;
+    std::vector<float> closes;
+    std::vector<float> volumes;
+
+    int Count() const { return (int)highs.size(); }
+};
+
+const char* const kShapes[] = {"random_walk", "trending", "choppy", "limit_up", "suspension",
+                               "staircase"};
+const int kShapeCount = sizeof(kShapes) / sizeof(kShapes[0]);
+
+// 以收盘价序列为基础补出高低价与成交量
+void PushBar(BarData& data, std::mt19937& rng, float prev, float close, float range) {
+    std::uniform_real_distribution<float> u(0.0f, 1.0f);
+    float high = std::max(prev, close) * (1.0f + range * u(rng));
+    float low = std::min(prev, close) * (1.0f - range * u(rng));
+    data.highs.push_back(high);
+    data.lows.push_back(low);
+    data.closes.push_back(close);
+    data.volumes.push_back(1e6f * (0.5f + u(rng)));
+}
+
+// 一字板/停牌：最高=最低=收盘
+void PushFlatBar(BarData& data, float price, float volume) {
+    data.highs.push_back(price);
+    data.lows.push_back(price);
+    data.closes.push_back(price);
+    data.volumes.push_back(volume);
+}
+
+BarData GenerateBars(const std::string& shape, int count, unsigned int seed) {
+    BarData data;
+    data.highs.reserve(count);
+    data.lows.reserve(count);
+    data.closes.reserve(count);
+    data.volumes.reserve(count);
+
+    std::mt19937 rng(seed);
+    std::normal_distribution<float> noise(0.0f, 1.0f);
+    std::uniform_real_distribution<float> u(0.0f, 1.0f);
+    float price = 10.0f;
+
+    // 价格保持在合理区间，避免长序列漂移到极值
+    auto clamp_price = [](float p) { return std::min(std::max(p, 1.0f), 1000.0f); };
+
+    while (data.Count() < count) {
+        float prev = price;
+        if (shape == "staircase") {
+            // 4根一个锯齿、每根抬高半个振幅：顶与底相距不足一笔，
+            // 够一笔距离的底都高于顶，每个顶分型都找不到终点。
+            // 每10万根回到起点，保持 float 精度足以区分锯齿
+            const float tooth[4] = {0.0f, 1.0f, 0.0f, -1.0f};
+            int i = data.Count() % 100000;
+            price = 10.0f + 0.005f * i + 0.01f * tooth[i % 4];
+            data.highs.push_back(price);
+            data.lows.push_back(price - 0.005f);
+            data.closes.push_back(price - 0.0025f);
+            data.volumes.push_back(1e6f);
+        } else if (shape == "trending") {
+            // 每约500根反转一次方向，趋势中带随机回撤
+            float drift = ((data.Count() / 500) % 2 == 0) ? 0.004f : -0.004f;
+            price = clamp_price(price * (1.0f + drift + 0.01f * noise(rng)));
+            PushBar(data, rng, prev, price, 0.005f);
+        } else if (shape == "choppy") {
+            // 围绕中枢价均值回复，振幅大、方向频繁切换
+            price = clamp_price(price + 0.3f * (10.0f - price) + 0.15f * noise(rng));
+            PushBar(data, rng, prev, price, 0.02f);
+        } else if (shape == "limit_up" && u(rng) < 0.01f) {
+            // 连续 3~10 个涨停或跌停一字板
+            int run = 3 + (int)(u(rng) * 8);
+            float step = u(rng) < 0.7f ? 1.1f : 0.9f;
+            for (int k = 0; k < run && data.Count() < count; ++k) {
+                price = clamp_price(price * step);
+                PushFlatBar(data, price, 1e5f);
+            }
+        } else if (shape == "suspension" && u(rng) < 0.005f) {
+            // 停牌 20~200 根，复牌后跳空
+            int run = 20 + (int)(u(rng) * 181);
+            for (int k = 0; k < run && data.Count() < count; ++k) {
+                PushFlatBar(data, price, 0.0f);
+            }
+            price = clamp_price(price * (1.0f + 0.1f * noise(rng)));
+        } else {
+            price = clamp_price(price * (1.0f + 0.02f * noise(rng)));
+            PushBar(data, rng, prev, price, 0.01f);
+        }
+    }
+
+    data.highs.resize(count);
+    data.lows.resize(count);
+    data.closes.resize(count);
+    data.volumes.resize(count);
+    return data;
+}
+
+// ============================================================================
+// 计时与结果
+// ============================================================================
+
+typedef std::chrono::steady_clock Clock;
+
+// 进度表格输出位置（JSON 写到标准输出时改为标准错误）
+FILE* g_table = stdout;
+
+int64_t ElapsedNs(Clock::time_point t0) {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - t0).count();
+}
+
+struct Result {
+    std::string group;      // core / chan.dll / chan_std.dll
+    std::string stage;
+    std::string shape;
+    int bars;
+    int reps;
+    int64_t min_ns;
+    int64_t median_ns;
+};
+
+struct Options {
+    std::vector<int> sizes;
+    std::vector<std::string> shapes;
+    std::string filter;             // 只运行名称包含该子串的阶段
+    double min_time;                // 每个 形态x规模 的最少计时秒数
+    int max_reps;
+    std::string output;
+#ifdef _WIN32
+    std::string dll;
+    std::string std_dll;
+#endif
+
+    Options() : min_time(0.5), max_reps(50), output() {
+        const int default_sizes[] = {1000, 10000, 100000, 1000000, 10000000};
+        sizes.assign(default_sizes, default_sizes + 5);
+        shapes.assign(kShapes, kShapes + kShapeCount);
+#ifdef _WIN32
+        dll = "chan.dll";
+        std_dll = "chan_std.dll";
+#endif
+    }
+};
+
+/// @brief 一组按顺序执行的阶段，每轮依次运行、分别计时
+class StageSet {
+public:
+    StageSet(const std::string& group, const Options& options)
+        : m_group(group), m_options(options) {}
+
+    void Add(const std::string& name, std::function<void()> fn) {
+        // 被过滤的阶段照常执行（后续阶段依赖其结果），只是不记录
+        bool keep = m_options.filter.empty() || name.find(m_options.filter) != std::string::npos;
+        m_stages.push_back(Stage{name, fn, keep, std::vector<int64_t>()});
+    }
+
+    bool Empty() const {
+        for (const Stage& stage : m_stages) {
+            if (stage.keep) return false;
+        }
+        return true;
+    }
+
+    /// @brief 重复整轮直到累计耗时达到 min_time 或轮数达到 max_reps
+    void Run(const std::string& shape, int bars, std::vector<Result>& results) {
+        if (Empty()) {
+            return;
+        }
+        int64_t budget_ns = (int64_t)(m_options.min_time * 1e9);
+        int64_t total_ns = 0;
+        int reps = 0;
+        do {
+            for (Stage& stage : m_stages) {
+                auto t0 = Clock::now();
+                stage.fn();
+                int64_t ns = ElapsedNs(t0);
+                stage.samples.push_back(ns);
+                total_ns += ns;
+            }
+            ++reps;
+        } while (reps < m_options.max_reps && total_ns < budget_ns);
+
+        for (Stage& stage : m_stages) {
+            if (stage.keep) {
+                std::vector<int64_t>& s = stage.samples;
+                std::sort(s.begin(), s.end());
+                results.push_back(Result{m_group, stage.name, shape, bars, reps,
+                                         s.front(), s[s.size() / 2]});
+                PrintResult(results.back());
+            }
+            stage.samples.clear();
+        }
+    }
+
+private:
+    struct Stage {
+        std::string name;
+        std::function<void()> fn;
+        bool keep;
+        std::vector<int64_t> samples;
+    };
+
+    static void PrintResult(const Result& r) {
+        fprintf(g_table, "%-12s %-28s %-12s %9d %5d %12.2f ns/bar\n", r.group.c_str(),
+                r.stage.c_str(), r.shape.c_str(), r.bars, r.reps, (double)r.median_ns / r.bars);
+        fflush(g_table);
+    }
+
+    std::string m_group;
+    const Options& m_options;
+    std::vector<Stage> m_stages;
+};
+
+// ============================================================================
+// 核心阶段
+// ============================================================================
+
+void BenchCore(const BarData& data, const std::string& shape, const Options& options,
+               std::vector<Result>& results) {
+    int n = data.Count();
+    const float* highs = data.highs.data();
+    const float* lows = data.lows.data();
+    const float* closes = data.closes.data();
+    std::vector<float> out(n);
+    float* o = out.data();
+
+    chan::ChanCore core;
+    StageSet set("core", options);
+    // 背驰判断需要 Analyze 计算的MACD，单独准备一份完整分析结果
+    chan::ChanCore analyzed;
+    analyzed.Analyze(highs, lows, closes, nullptr, n);
+
+    // 分析流程（顺序与 Analyze 相同）
+    set.Add("RemoveInclude", [&] { core.RemoveInclude(highs, lows, n); });
+    set.Add("CheckFX", [&] { core.CheckFX(); });
+    set.Add("CheckBI", [&] { core.CheckBI(); });
+    set.Add("CheckDUAN", [&] { core.CheckDUAN(); });
+    set.Add("CheckZS", [&] { core.CheckZS(); });
+    set.Add("CheckPivotLevels", [&] { core.CheckPivotLevels(); });
+    set.Add("ComputeMAData", [&] { core.ComputeMAData(closes, n); });
+    set.Add("BuildBiSequence", [&] { core.BuildBiSequence(n - 1); });
+    set.Add("BuildSignalTable", [&] { core.BuildSignalTable(highs, lows, n); });
+    set.Add("CheckBC", [&] { analyzed.CheckBC(); });
+
+    // 原始K线区间极值索引：构建，及每根K线查询其前250根的最高/最低
+    chan::RangeExtremeIndex range;
+    volatile int sink = 0;
+    set.Add("RangeIndexBuild", [&] { range.Build(highs, lows, n); });
+    set.Add("RangeIndexQuery", [&] {
+        int acc = 0;
+        for (int i = 0; i < n; ++i) {
+            int first = i >= 250 ? i - 250 : 0;
+            acc += range.ArgMax(first, i) + range.ArgMin(first, i);
+        }
+        sink = acc;
+    });
+
+    // 输出函数
+    set.Add("OutputFX", [&] { core.OutputFX(o, n); });
+    set.Add("OutputBI", [&] { core.OutputBI(o, n); });
+    set.Add("OutputDUAN", [&] { core.OutputDUAN(o, n); });
+    set.Add("OutputBC", [&] { analyzed.OutputBC(o, n); });
+    set.Add("OutputZS_H", [&] { core.OutputZS_H(o, n); });
+    set.Add("OutputZS_L", [&] { core.OutputZS_L(o, n); });
+    set.Add("OutputZS_Z", [&] { core.OutputZS_Z(o, n); });
+    set.Add("OutputDirection", [&] { core.OutputDirection(o, n); });
+    set.Add("OutputNewBar", [&] { core.OutputNewBar(o, n); });
+    set.Add("OutputGG", [&] { core.OutputGG(o, n, 1); });
+    set.Add("OutputDD", [&] { core.OutputDD(o, n, 1); });
+    set.Add("OutputHH", [&] { core.OutputHH(o, n, 1); });
+    set.Add("OutputLL", [&] { core.OutputLL(o, n, 1); });
+    set.Add("OutputBuySignal", [&] { core.OutputBuySignal(o, n, lows); });
+    set.Add("OutputSellSignal", [&] { core.OutputSellSignal(o, n, highs); });
+    set.Add("OutputCombinedBuySignal", [&] { core.OutputCombinedBuySignal(o, n, lows); });
+    set.Add("OutputCombinedSellSignal", [&] { core.OutputCombinedSellSignal(o, n, highs); });
+    set.Add("OutputPreBuySignal", [&] { core.OutputPreBuySignal(o, n, lows); });
+    set.Add("OutputPreSellSignal", [&] { core.OutputPreSellSignal(o, n, highs); });
+    set.Add("OutputLikeSecondBuySignal", [&] { core.OutputLikeSecondBuySignal(o, n, lows); });
+    set.Add("OutputLikeSecondSellSignal", [&] { core.OutputLikeSecondSellSignal(o, n, highs); });
+    set.Add("ProjectSignal", [&] {
+        for (int k = 0; k < (int)chan::SignalOutput::COUNT; ++k) {
+            core.ProjectSignal((chan::SignalOutput)k, o, n);
+        }
+    });
+
+    // 完整分析（含断点与尾部状态维护）
+    chan::ChanCore full;
+    set.Add("Analyze", [&] { full.Analyze(highs, lows, closes, data.volumes.data(), n); });
+
+    set.Run(shape, n, results);
+}
+
+// ============================================================================
+// 通达信导出函数（仅Windows，运行时加载DLL）
+// ============================================================================
+
+#ifdef _WIN32
+
+// chan.dll：扩展接口（tdx_interface.h）
+typedef void (__stdcall *ExtCalcFunc)(int nCount, float* pOut, float* pHigh, float* pLow,
+                                       float* pClose, float* pVol, float* pAmount, float* pParam);
+#pragma pack(push, 1)
+struct ExtFuncInfo {
+    WORD nFuncMark;
+    char sName[32];
+    BYTE nParamCount;
+    BYTE nParamType[8];
+    char sParamName[8][32];
+    float fParamMin[8];
+    float fParamMax[8];
+    float fParamDef[8];
+    ExtCalcFunc pCalcFunc;
+};
+#pragma pack(pop)
+typedef void (__stdcall *ExtRegisterFunc)(ExtFuncInfo** ppInfo, int* pCount);
+
+// chan_std.dll：通达信标准接口（tdx_standard.cpp）
+typedef void (*StdCalcFunc)(int DataLen, float* pfOUT, float* pfINa, float* pfINb, float* pfINc);
+#pragma pack(push, 1)
+struct StdFuncInfo {
+    unsigned short nFuncMark;
+    StdCalcFunc pCallFunc;
+};
+#pragma pack(pop)
+typedef BOOL (*StdRegisterFunc)(StdFuncInfo** pFun);
+
+/// @brief 每个导出函数计两项：
+///        cold - 数据每轮变化（首根最高价微调），缓存不命中，含完整分析
+///        warm - 相同数据重复调用，命中缓存，只有输出开销
+void BenchExports(const BarData& data, const std::string& shape, const Options& options,
+                  std::vector<Result>& results) {
+    int n = data.Count();
+    BarData work = data;
+    std::vector<float> out(n);
+    float* o = out.data();
+    float* h = work.highs.data();
+    float* l = work.lows.data();
+    float* c = work.closes.data();
+    float* v = work.volumes.data();
+    float base_high = data.highs[0];
+    auto perturb = [&] { h[0] = std::nextafter(h[0], 1e30f); };
+
+    HMODULE ext = LoadLibraryA(options.dll.c_str());
+    if (ext) {
+        ExtRegisterFunc reg = (ExtRegisterFunc)GetProcAddress(ext, "RegisterTdxFunc");
+        ExtFuncInfo* funcs = nullptr;
+        int count = 0;
+        if (reg) reg(&funcs, &count);
+
+        StageSet set(options.dll, options);
+        for (int i = 0; i < count; ++i) {
+            ExtFuncInfo* info = &funcs[i];
+            float param[2] = {info->fParamDef[0], info->fParamDef[1]};
+            std::string name = std::string(info->sName) + "#" + std::to_string(i);
+            set.Add(name + ".cold", [=]() mutable {
+                perturb();
+                info->pCalcFunc(n, o, h, l, c, v, v, param);
+            });
+            set.Add(name + ".warm", [=]() mutable { info->pCalcFunc(n, o, h, l, c, v, v, param); });
+        }
+        set.Run(shape, n, results);
+        FreeLibrary(ext);
+    } else {
+        fprintf(stderr, "无法加载 %s，跳过\n", options.dll.c_str());
+    }
+    h[0] = base_high;
+
+    HMODULE std_dll = LoadLibraryA(options.std_dll.c_str());
+    if (std_dll) {
+        StdRegisterFunc reg = (StdRegisterFunc)GetProcAddress(std_dll, "RegisterTdxFunc");
+        StdFuncInfo* funcs = nullptr;
+        if (reg) reg(&funcs);
+
+        StageSet set(options.std_dll, options);
+        for (int i = 0; funcs && funcs[i].pCallFunc; ++i) {
+            StdCalcFunc fn = funcs[i].pCallFunc;
+            std::string name = "FUNC" + std::to_string(funcs[i].nFuncMark);
+            set.Add(name + ".cold", [=] { perturb(); fn(n, o, h, l, c); });
+            set.Add(name + ".warm", [=] { fn(n, o, h, l, c); });
+        }
+        set.Run(shape, n, results);
+        FreeLibrary(std_dll);
+    } else {
+        fprintf(stderr, "无法加载 %s，跳过\n", options.std_dll.c_str());
+    }
+}
+
+#endif
+
+// ============================================================================
+// JSON 输出
+// ============================================================================
+
+std::string JsonEscape(const std::string& s) {
+    std::string result;
+    for (char ch : s) {
+        if (ch == '"' || ch == '\\') {
+            result += '\\';
+            result += ch;
+        } else if ((unsigned char)ch < 0x20) {
+            char buf[8];
+            snprintf(buf, sizeof(buf), "\\u%04x", ch);
+            result += buf;
+        } else {
+            result += ch;
+        }
+    }
+    return result;
+}
+
+std::string CompilerName() {
+    char buf[64];
+#if defined(__clang__)
+    snprintf(buf, sizeof(buf), "clang %d.%d.%d", __clang_major__, __clang_minor__, __clang_patchlevel__);
+#elif defined(__GNUC__)
+    snprintf(buf, sizeof(buf), "gcc %d.%d.%d", __GNUC__, __GNUC_MINOR__, __GNUC_PATCHLEVEL__);
+#elif defined(_MSC_VER)
+    snprintf(buf, sizeof(buf), "msvc %d", _MSC_VER);
+#else
+    snprintf(buf, sizeof(buf), "unknown");
+#endif
+    return buf;
+}
+
+bool WriteJson(const std::string& path, const Options& options, const std::vector<Result>& results) {
+    FILE* f = path == "-" ? stdout : fopen(path.c_str(), "w");
+    if (!f) {
+        return false;
+    }
+
+    char timestamp[32];
+    time_t now = time(nullptr);
+    strftime(timestamp, sizeof(timestamp), "%Y-%m-%dT%H:%M:%SZ", gmtime(&now));
+
+    fprintf(f, "{\n");
+    fprintf(f, "  \"benchmark\": \"chan_bench\",\n");
+    fprintf(f, "  \"version\": \"%s\",\n", CHAN_BENCH_VERSION);
+    fprintf(f, "  \"timestamp\": \"%s\",\n", timestamp);
+    fprintf(f, "  \"compiler\": \"%s\",\n", JsonEscape(CompilerName()).c_str());
+    fprintf(f, "  \"simd\": \"%s\",\n", chan::SimdLevelName(chan::GetSimdLevel()));
+    fprintf(f, "  \"pointer_bits\": %d,\n", (int)(sizeof(void*) * 8));
+    fprintf(f, "  \"min_time_s\": %g,\n", options.min_time);
+    fprintf(f, "  \"results\": [\n");
+    for (size_t i = 0; i < results.size(); ++i) {
+        const Result& r = results[i];
+        fprintf(f, "    {\"group\": \"%s\", \"stage\": \"%s\", \"shape\": \"%s\", \"bars\": %d, "
+                   "\"reps\": %d, \"min_ns\": %lld, \"median_ns\": %lld, \"ns_per_bar\": %.4f}%s\n",
+                JsonEscape(r.group).c_str(), JsonEscape(r.stage).c_str(), r.shape.c_str(),
+                r.bars, r.reps, (long long)r.min_ns, (long long)r.median_ns,
+                (double)r.median_ns / r.bars, i + 1 < results.size() ? "," : "");
+    }
+    fprintf(f, "  ]\n}\n");
+
+    if (f != stdout) {
+        fclose(f);
+    }
+    return true;
+}
+
+// ============================================================================
+// 命令行
+// ============================================================================
+
+std::vector<std::string> SplitList(const std::string& s) {
+    std::vector<std::string> items;
+    size_t start = 0;
+    while (start <= s.size()) {
+        size_t comma = s.find(',', start);
+        if (comma == std::string::npos) comma = s.size();
+        if (comma > start) items.push_back(s.substr(start, comma - start));
+        start = comma + 1;
+    }
+    return items;
+}
+
+// 规模支持 K/M 后缀，如 10K、1M
+int ParseSize(const std::string& s) {
+    char* end = nullptr;
+    double value = strtod(s.c_str(), &end);
+    if (end && (*end == 'k' || *end == 'K')) value *= 1e3;
+    if (end && (*end == 'm' || *end == 'M')) value *= 1e6;
+    return (int)value;
+}
+
+void PrintUsage() {
+    fprintf(stderr,
+            "用法: chan_bench [选项]\n"
+            "  -n, --sizes <列表>     K线规模，逗号分隔，支持K/M后缀（默认 1K,10K,100K,1M,10M）\n"
+            "  -s, --shapes <列表>    行情形态（默认全部）：random_walk,trending,choppy,limit_up,\n"
+            "                         suspension,staircase\n"
+            "  -F, --filter <子串>    只记录名称包含子串的阶段\n"
+            "  -t, --min-time <秒>    每个 形态x规模 的最少计时时长（默认 0.5）\n"
+            "  -r, --max-reps <N>     最多重复轮数（默认 50）\n"
+            "  -o, --output <文件>    写出 JSON 结果（- 为标准输出）\n"
+#ifdef _WIN32
+            "      --dll <路径>       扩展接口DLL（默认 chan.dll）\n"
+            "      --std-dll <路径>   标准接口DLL（默认 chan_std.dll）\n"
+#endif
+            "  -h, --help             显示帮助\n");
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    Options options;
+    chan::LogSetLevel(chan::LogLevel::LOG_WARN);
+
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        bool has_value = i + 1 < argc;
+        if ((arg == "-n" || arg == "--sizes") && has_value) {
+            options.sizes.clear();
+            for (const std::string& s : SplitList(argv[++i])) {
+                options.sizes.push_back(ParseSize(s));
+            }
+        } else if ((arg == "-s" || arg == "--shapes") && has_value) {
+            options.shapes = SplitList(argv[++i]);
+        } else if ((arg == "-F" || arg == "--filter") && has_value) {
+            options.filter = argv[++i];
+        } else if ((arg == "-t" || arg == "--min-time") && has_value) {
+            options.min_time = atof(argv[++i]);
+        } else if ((arg == "-r" || arg == "--max-reps") && has_value) {
+            options.max_reps = std::max(1, atoi(argv[++i]));
+        } else if ((arg == "-o" || arg == "--output") && has_value) {
+            options.output = argv[++i];
+#ifdef _WIN32
+        } else if (arg == "--dll" && has_value) {
+            options.dll = argv[++i];
+        } else if (arg == "--std-dll" && has_value) {
+            options.std_dll = argv[++i];
+#endif
+        } else if (arg == "-h" || arg == "--help") {
+            PrintUsage();
+            return 0;
+        } else {
+            fprintf(stderr, "未知选项: %s\n", arg.c_str());
+            PrintUsage();
+            return 2;
+        }
+    }
+
+    for (const std::string& shape : options.shapes) {
+        if (std::find(kShapes, kShapes + kShapeCount, shape) == kShapes + kShapeCount) {
+            fprintf(stderr, "未知行情形态: %s\n", shape.c_str());
+            return 2;
+        }
+    }
+    for (int size : options.sizes) {
+        if (size < 3) {
+            fprintf(stderr, "规模至少为3根K线\n");
+            return 2;
+        }
+    }
+
+    if (options.output == "-") {
+        g_table = stderr;
+    }
+
+    std::vector<Result> results;
+    for (const std::string& shape : options.shapes) {
+        for (int size : options.sizes) {
+            BarData data = GenerateBars(shape, size, 20240101u + (unsigned int)size);
+            BenchCore(data, shape, options, results);
+#ifdef _WIN32
+            BenchExports(data, shape, options, results);
+#endif
+        }
+    }
+
+    if (!options.output.empty() && !WriteJson(options.output, options, results)) {
+        fprintf(stderr, "无法写出结果: %s\n", options.output.c_str());
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,182 @@
+#pragma once
+// ============================================================================
+// 缠论通达信DLL插件 - 分析结果缓存
+// ============================================================================
+// 按 (数据指纹, ChanConfig) 缓存分析会话，LRU 淘汰
+// 切换图表或选股遍历时，同一份数据不再重复完整分析；
+// 同一公式内多个导出函数共享一个会话，序列与信号首次请求时才生成
+// 淘汰的会话留作备用，盘中数据不断变化时复用其容器容量，稳态下不再分配内存
+// ============================================================================
+
+#ifndef ANALYSIS_CACHE_H
+#define ANALYSIS_CACHE_H
+
+#include "chan_core.h"
+#include "float_hash.h"
+#include <cstdint>
+#include <list>
+#include <memory>
+#include <unordered_map>
+#include <vector>
+
+namespace chan {
+
+// ============================================================================
+// 数据指纹
+// ============================================================================
+
+/// @brief K线数据指纹（数量 + 高低价内容哈希）
+struct DataFingerprint {
+    int count;
+    uint64_t hash;
+
+    DataFingerprint() : count(0), hash(0) {}
+
+    bool operator==(const DataFingerprint& other) const {
+        return count == other.count && hash == other.hash;
+    }
+};
+
+/// @brief 计算K线数据指纹（笔/中枢依赖高低价，均线依赖收盘价）
+/// @param closes 收盘价数组，可为nullptr
+DataFingerprint MakeFingerprint(const float* highs, const float* lows, int count,
+                                const float* closes = nullptr);
+
+// ============================================================================
+// 缓存统计
+// ============================================================================
+
+struct CacheStats {
+    uint64_t hits;          // 命中次数
+    uint64_t misses;        // 未命中次数（执行了完整分析）
+    uint64_t evictions;     // 淘汰次数
+    int entries;            // 当前缓存会话数
+    int cached_bars;        // 当前缓存的K线总数
+
+    CacheStats() : hits(0), misses(0), evictions(0), entries(0), cached_bars(0) {}
+};
+
+// ============================================================================
+// 分析会话
+// ============================================================================
+
+/// @brief 会话中延迟生成的信号输出
+typedef SignalOutput SessionSignal;
+
+/// @brief 一份输入数据的分析会话
+/// @note 完整分析只执行一次；递归引用序列和信号位图在首次请求时生成，
+///       各信号输出均由同一位图投影并保留
+class AnalysisSession {
+public:
+    AnalysisSession();
+
+    /// @brief 对新数据执行完整分析（含均线计算），并清除之前延迟生成的结果
+    void Analyze(const float* highs, const float* lows,
+                 const float* closes, const float* volumes, int count,
+                 const ChanConfig& config);
+
+    ChanCore& Core() { return m_core; }
+    const ChanCore& Core() const { return m_core; }
+
+    /// @brief 分析的K线数量
+    int GetCount() const { return m_count; }
+
+    /// @brief 确保递归引用序列（GG/DD/HH/LL/方向）已构建
+    void EnsureBiSequence();
+    bool HasBiSequence() const { return m_bi_sequence_ready; }
+
+    /// @brief 获取信号输出（长度为K线数量），首次请求时计算
+    /// @param highs 最高价数组（卖点判断用）
+    /// @param lows 最低价数组（买点判断用）
+    const std::vector<float>& GetSignal(SessionSignal kind, const float* highs, const float* lows);
+    bool HasSignal(SessionSignal kind) const;
+
+private:
+    ChanCore m_core;
+    int m_count;
+    bool m_bi_sequence_ready;
+    bool m_signal_ready[(int)SessionSignal::COUNT];
+    std::vector<float> m_signals[(int)SessionSignal::COUNT];
+};
+
+// ============================================================================
+// 分析结果缓存
+// ============================================================================
+
+class AnalysisCache {
+public:
+    /// @brief 构造函数
+    /// @param capacity_bars 缓存容量（K线总数，对应 [Performance] CacheSize），<=0 时禁用缓存
+    /// @param max_entries 最多缓存的会话数（对应 [Performance] CacheEntries），<=0 时不限
+    explicit AnalysisCache(int capacity_bars = 500000, int max_entries = 128);
+
+    /// @brief 设置缓存容量（K线总数），超出部分按LRU淘汰
+    void SetCapacity(int capacity_bars);
+    int GetCapacity() const { return m_capacity_bars; }
+
+    /// @brief 设置最多缓存的会话数，超出部分按LRU淘汰
+    void SetMaxEntries(int max_entries);
+    int GetMaxEntries() const { return m_max_entries; }
+
+    /// @brief 获取与数据和配置匹配的分析会话，未命中时执行完整分析
+    /// @return 分析会话（在下次 Acquire/Clear 前有效），参数无效时返回nullptr
+    /// @note 最近使用的会话始终保留，即使其K线数超过容量
+    AnalysisSession* AcquireSession(const float* highs, const float* lows,
+                                    const float* closes, const float* volumes, int count,
+                                    const ChanConfig& config);
+
+    /// @brief 获取与数据和配置匹配的已分析实例（见 AcquireSession）
+    ChanCore* Acquire(const float* highs, const float* lows,
+                      const float* closes, const float* volumes, int count,
+                      const ChanConfig& config);
+
+    /// @brief 最近一次 AcquireSession 是否命中，及其 (数据指纹, 配置) 键
+    /// @note 供调用方统计命中率与检测重复调用
+    bool LastWasHit() const { return m_last_hit; }
+    uint64_t LastKey() const { return m_last_key; }
+
+    /// @brief 清空所有缓存会话（统计保留）
+    void Clear();
+
+    /// @brief 获取统计信息
+    CacheStats GetStats() const;
+
+    /// @brief 清零命中/未命中/淘汰计数
+    void ResetStats();
+
+private:
+    struct Entry {
+        DataFingerprint fp;
+        ChanConfig config;
+        uint64_t key;
+        std::unique_ptr<AnalysisSession> session;
+    };
+
+    typedef std::unordered_map<uint64_t, std::list<Entry>::iterator> IndexMap;
+
+    static uint64_t MakeKey(const DataFingerprint& fp, const ChanConfig& config);
+    static bool SameConfig(const ChanConfig& a, const ChanConfig& b);
+    void EvictToCapacity();
+    void IndexFront(uint64_t key);
+    void RecycleIndexNode(IndexMap::iterator it);
+
+    int m_capacity_bars;
+    int m_max_entries;
+    int m_cached_bars;
+    std::list<Entry> m_entries;     // 头部为最近使用
+    IndexMap m_index;
+    
+    // 备用：淘汰的会话（含链表节点）与索引节点，未命中时复用
+    std::list<Entry> m_spare;
+    std::vector<IndexMap::node_type> m_spare_nodes;
+
+    uint64_t m_hits;
+    uint64_t m_misses;
+    uint64_t m_evictions;
+    uint64_t m_last_key;
+    bool m_last_hit;
+};
+
+} // namespace chan
+
+#endif // ANALYSIS_CACHE_H
@@ -0,0 +1,164 @@
+#pragma once
+// ============================================================================
+// 缠论通达信DLL插件 - 多核批量分析
+// ============================================================================
+// 全市场选股时一次分析成百上千个标的：
+//   - 输入为变长批次：各标的K线首尾相接存放，offsets 划分区间
+//   - 工作线程常驻，每个线程复用自己的 ChanCore（容器容量跨标的保留）
+//   - 标的按K线数均分给各线程，先做完的线程从其它线程队列尾部窃取一半
+//   - 结果写入调用方提供的输出缓冲（与输入同布局），不做额外拷贝
+// ============================================================================
+
+#ifndef BATCH_ANALYZER_H
+#define BATCH_ANALYZER_H
+
+#include "chan_core.h"
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace chan {
+
+// ============================================================================
+// 批量输入输出
+// ============================================================================
+
+/// @brief 变长批量输入
+/// @note 第 s 个标的的K线为 [offsets[s], offsets[s+1])，offsets 共 series_count+1 个且不减
+struct BatchInput {
+    const float* highs;
+    const float* lows;
+    const float* closes;      // 可为nullptr（不输出信号时）
+    const float* volumes;     // 可为nullptr
+    const int* offsets;
+    int series_count;
+
+    BatchInput()
+        : highs(nullptr), lows(nullptr), closes(nullptr), volumes(nullptr)
+        , offsets(nullptr), series_count(0) {}
+};
+
+/// @brief 批量输出缓冲
+/// @note K线级输出与输入同布局（下标即 offsets 区间内的全局下标）；
+///       标的级输出长度为 series_count；不需要的输出传nullptr
+struct BatchOutput {
+    float* fx;                                  // OutputFX
+    float* bi;                                  // OutputBI
+    float* duan;                                // OutputDUAN
+    float* zs_high;                             // OutputZS_H
+    float* zs_low;                              // OutputZS_L
+    float* bc;                                  // OutputBC（需要收盘价）
+    float* signals[(int)SignalOutput::COUNT];   // 买卖点信号（需要收盘价）
+    int* stroke_counts;                         // 每个标的的笔数
+    int* pivot_counts;                          // 每个标的的中枢数
+    std::vector<ChanEvent>* events;             // 每个标的的稀疏事件（CollectEvents）
+    uint32_t event_kinds;                       // 收集的事件种类（EventBit 组合）
+    int event_window;                           // 只收集最后 N 根K线内的事件（<=0 为全部）
+
+    BatchOutput()
+        : fx(nullptr), bi(nullptr), duan(nullptr), zs_high(nullptr), zs_low(nullptr)
+        , bc(nullptr), stroke_counts(nullptr), pivot_counts(nullptr)
+        , events(nullptr), event_kinds(ALL_EVENTS), event_window(0) {
+        for (int k = 0; k < (int)SignalOutput::COUNT; ++k) {
+            signals[k] = nullptr;
+        }
+    }
+
+    /// @brief 是否请求了任一买卖点信号（含买卖点事件）
+    bool HasSignals() const {
+        for (int k = 0; k < (int)SignalOutput::COUNT; ++k) {
+            if (signals[k]) return true;
+        }
+        return events && (event_kinds & EventBit(EventKind::SIGNAL));
+    }
+};
+
+/// @brief 最近一次批量分析的统计
+struct BatchStats {
+    int series;             // 标的数
+    int bars;               // K线总数
+    int threads;            // 参与线程数（含调用线程）
+    uint64_t steals;        // 窃取次数
+    int64_t elapsed_us;     // 耗时（微秒）
+
+    BatchStats() : series(0), bars(0), threads(0), steals(0), elapsed_us(0) {}
+};
+
+// ============================================================================
+// 批量分析器
+// ============================================================================
+
+class ChanBatchAnalyzer {
+public:
+    /// @brief 构造函数
+    /// @param thread_count 线程数（含调用线程），<=0 时使用CPU核数
+    explicit ChanBatchAnalyzer(int thread_count = 0);
+    ~ChanBatchAnalyzer();
+
+    ChanBatchAnalyzer(const ChanBatchAnalyzer&) = delete;
+    ChanBatchAnalyzer& operator=(const ChanBatchAnalyzer&) = delete;
+
+    /// @brief 设置分析参数（下一次 Run 生效）
+    void SetConfig(const ChanConfig& config) { m_config = config; }
+    const ChanConfig& GetConfig() const { return m_config; }
+
+    /// @brief 参与分析的线程数（含调用线程）
+    int GetThreadCount() const { return (int)m_workers.size(); }
+
+    /// @brief 分析一批标的，阻塞至全部完成
+    /// @return 分析的标的数，输入无效返回-1
+    /// @note 同一分析器不可被多个线程同时调用 Run
+    int Run(const BatchInput& input, const BatchOutput& output);
+
+    /// @brief 最近一次 Run 的统计
+    const BatchStats& GetLastStats() const { return m_stats; }
+
+private:
+    // 工作队列：标的下标区间 [begin, end) 打包在一个64位原子量中，
+    // 所属线程从头部取，其它线程从尾部窃取一半
+    struct alignas(64) Worker {
+        std::atomic<uint64_t> range;
+        ChanCore core;                  // 复用的分析状态
+        uint64_t steals;
+        std::thread thread;             // 0号为调用线程，不创建
+
+        Worker() : range(0), steals(0) {}
+    };
+
+    static uint64_t PackRange(int begin, int end) {
+        return ((uint64_t)(uint32_t)begin << 32) | (uint32_t)end;
+    }
+    static int RangeBegin(uint64_t r) { return (int)(r >> 32); }
+    static int RangeEnd(uint64_t r) { return (int)(uint32_t)r; }
+
+    bool PopFront(Worker& worker, int& series);
+    bool StealHalf(int thief);
+    void Work(int id);
+    void AnalyzeSeries(Worker& worker, int series);
+    void ThreadMain(int id);
+
+    ChanConfig m_config;
+    std::vector<std::unique_ptr<Worker>> m_workers;
+    BatchStats m_stats;
+
+    // 当前批次（Run 期间有效）
+    const BatchInput* m_input;
+    const BatchOutput* m_output;
+    std::atomic<int> m_remaining;       // 尚未完成的标的数
+
+    // 线程调度
+    std::mutex m_mutex;
+    std::condition_variable m_start_cv;
+    std::condition_variable m_done_cv;
+    uint64_t m_generation;              // 批次序号，变化时唤醒工作线程
+    int m_active;                       // 尚未结束本批次的工作线程数
+    bool m_stop;
+};
+
+} // namespace chan
+
+#endif // BATCH_ANALYZER_H
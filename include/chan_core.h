@@ -10,9 +10,13 @@
 #define CHAN_CORE_H
 
 #include "chan_types.h"
+#include "range_extreme.h"
 #include <vector>
 #include <algorithm>
 #include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <iterator>
 
 namespace chan {
 
@@ -27,6 +31,12 @@ struct ChanConfig {
     bool strict_bi;           // 严格笔定义（顶底必须有效突破）
     bool enable_like_signals; // 启用类买卖点（类二买等），默认true
     bool enable_pre_signals;  // 启用准买卖点（准一/二/三买等），默认true
+    int ma_short_period;      // 短均线周期（一/三买卖及准买卖点），默认13
+    int ma_long_period;       // 长均线周期（二买卖），默认26
+    int macd_fast;            // MACD快线EMA周期（背驰判断），默认12
+    int macd_slow;            // MACD慢线EMA周期，默认26
+    int macd_signal;          // MACD信号线（DEA）周期，默认9
+    bool range_index;         // 维护原始K线区间极值索引（GetRangeHighIndex等），默认false
     
     ChanConfig() 
         : min_bi_len(5)
@@ -34,7 +44,168 @@ struct ChanConfig {
         , min_zs_bi_count(3)
         , strict_bi(true)
         , enable_like_signals(true)
-        , enable_pre_signals(true) {}
+        , enable_pre_signals(true)
+        , ma_short_period(13)
+        , ma_long_period(26)
+        , macd_fast(12)
+        , macd_slow(26)
+        , macd_signal(9)
+        , range_index(false) {}
+};
+
+// ============================================================================
+// 逐K线信号位图
+// ============================================================================
+// 每根K线一个 uint32_t：低16位为买点，高16位为卖点（卖点字段布局与买点相同）
+// 各字段保存对应 Check* 的返回类型值，0 表示不成立
+
+namespace SignalBits {
+    const int FIRST_SHIFT = 0;          // 一买/一卖类型（2位）
+    const int SECOND_SHIFT = 2;         // 二买/二卖类型（2位）
+    const int THIRD_SHIFT = 4;          // 三买/三卖（1位）
+    const int PRE_FIRST_SHIFT = 5;      // 准一买/准一卖（1位）
+    const int PRE_SECOND_SHIFT = 6;     // 准二买/准二卖（1位）
+    const int PRE_THIRD_SHIFT = 7;      // 准三买/准三卖（1位）
+    const int LIKE_SECOND_SHIFT = 8;    // 类二买/类二卖类型（2位）
+    const int SELL_SHIFT = 16;          // 卖点相对买点的偏移
+    
+    /// @brief 取出字段值
+    inline int Field(uint32_t bits, int shift, int width) {
+        return (int)((bits >> shift) & ((1u << width) - 1u));
+    }
+}
+
+/// @brief 由信号位图投影出的输出
+enum class SignalOutput {
+    BUY = 0,        // OutputBuySignal
+    SELL,           // OutputSellSignal
+    BUYX,           // OutputCombinedBuySignal
+    SELLX,          // OutputCombinedSellSignal
+    PREBUY,         // OutputPreBuySignal
+    PRESELL,        // OutputPreSellSignal
+    LIKE2B,         // OutputLikeSecondBuySignal
+    LIKE2S,         // OutputLikeSecondSellSignal
+    COUNT
+};
+
+// ============================================================================
+// 热路径SoA存储
+// ============================================================================
+// 流水线内部按字段连续存储：分型识别只扫描 high/low 数组，笔只记录分型下标，
+// 减少百万级分钟数据的内存带宽占用，并便于向量化。
+// 对外通过 SoAView 按需还原为 KLine/Fractal/Stroke，原有接口保持不变。
+
+/// @brief 去包含后K线（SoA布局）
+struct MergedKLineSoA {
+    std::vector<float> high;          // 最高价
+    std::vector<float> low;           // 最低价
+    std::vector<int>   merge_start;   // 合并起始原始索引（即 KLine::index）
+    std::vector<int>   merge_end;     // 合并结束原始索引
+    
+    int size() const { return (int)high.size(); }
+    bool empty() const { return high.empty(); }
+    void clear() { high.clear(); low.clear(); merge_start.clear(); merge_end.clear(); }
+    void resize(int n) { high.resize(n); low.resize(n); merge_start.resize(n); merge_end.resize(n); }
+    void reserve(int n) { high.reserve(n); low.reserve(n); merge_start.reserve(n); merge_end.reserve(n); }
+    void push_back(float h, float l, int raw_index) {
+        high.push_back(h);
+        low.push_back(l);
+        merge_start.push_back(raw_index);
+        merge_end.push_back(raw_index);
+    }
+};
+
+/// @brief 分型（SoA布局）
+struct FractalSoA {
+    std::vector<int>         index;       // 分型中间K线的索引（合并后）
+    std::vector<FractalType> type;        // 分型类型
+    std::vector<float>       price;       // 极值价格
+    std::vector<int>         kline_idx;   // 对应原始K线索引
+    
+    int size() const { return (int)index.size(); }
+    bool empty() const { return index.empty(); }
+    void clear() { index.clear(); type.clear(); price.clear(); kline_idx.clear(); }
+    void resize(int n) { index.resize(n); type.resize(n); price.resize(n); kline_idx.resize(n); }
+};
+
+/// @brief 笔（SoA布局），起止分型以分型下标记录
+struct StrokeSoA {
+    std::vector<int>       start_fx;    // 起点分型下标
+    std::vector<int>       end_fx;      // 终点分型下标
+    std::vector<int>       start_idx;   // 起点K线索引
+    std::vector<int>       end_idx;     // 终点K线索引
+    std::vector<float>     high;        // 笔的最高点
+    std::vector<float>     low;         // 笔的最低点
+    std::vector<Direction> direction;   // 方向
+    std::vector<int>       prev_turn;   // 此前最近一根反向笔（-1为无），逐根回溯同向笔 O(1)
+    
+    int size() const { return (int)start_fx.size(); }
+    bool empty() const { return start_fx.empty(); }
+    void clear() {
+        start_fx.clear(); end_fx.clear(); start_idx.clear(); end_idx.clear();
+        high.clear(); low.clear(); direction.clear(); prev_turn.clear();
+    }
+    void resize(int n) {
+        start_fx.resize(n); end_fx.resize(n); start_idx.resize(n); end_idx.resize(n);
+        high.resize(n); low.resize(n); direction.resize(n); prev_turn.resize(n);
+    }
+};
+
+class ChanCore;
+
+/// @brief SoA存储的只读视图，按元素还原为 AoS 结构体（按值返回）
+/// @note 支持 size()/empty()/operator[]/front()/back() 和范围for，
+///       视图在对应 ChanCore 下次修改前有效
+template <typename T>
+class SoAView {
+public:
+    typedef T (ChanCore::*AtFunc)(int) const;
+    
+    class const_iterator {
+    public:
+        typedef std::random_access_iterator_tag iterator_category;
+        typedef T value_type;
+        typedef std::ptrdiff_t difference_type;
+        typedef const T* pointer;
+        typedef T reference;
+        
+        const_iterator(const SoAView* view, int pos) : m_view(view), m_pos(pos) {}
+        T operator*() const { return (*m_view)[m_pos]; }
+        const_iterator& operator++() { ++m_pos; return *this; }
+        const_iterator& operator--() { --m_pos; return *this; }
+        difference_type operator-(const const_iterator& other) const { return m_pos - other.m_pos; }
+        bool operator==(const const_iterator& other) const { return m_pos == other.m_pos; }
+        bool operator!=(const const_iterator& other) const { return m_pos != other.m_pos; }
+        
+    private:
+        const SoAView* m_view;
+        int m_pos;
+    };
+    
+    SoAView(const ChanCore* owner, int size, AtFunc at) : m_owner(owner), m_size(size), m_at(at) {}
+    
+    size_t size() const { return (size_t)m_size; }
+    bool empty() const { return m_size == 0; }
+    T operator[](size_t i) const { return (m_owner->*m_at)((int)i); }
+    T front() const { return (*this)[0]; }
+    T back() const { return (*this)[m_size - 1]; }
+    const_iterator begin() const { return const_iterator(this, 0); }
+    const_iterator end() const { return const_iterator(this, m_size); }
+    
+    /// @brief 还原为完整数组
+    std::vector<T> ToVector() const {
+        std::vector<T> result;
+        result.reserve(m_size);
+        for (int i = 0; i < m_size; ++i) {
+            result.push_back((*this)[i]);
+        }
+        return result;
+    }
+    
+private:
+    const ChanCore* m_owner;
+    int m_size;
+    AtFunc m_at;
 };
 
 // ============================================================================
@@ -65,6 +236,26 @@ public:
     int Analyze(const float* highs, const float* lows, 
                 const float* closes, const float* volumes, int count);
     
+    // ========================================================================
+    // 流式增量分析
+    // ========================================================================
+    
+    /// @brief 追加一根新K线并增量更新去包含/分型/笔/中枢
+    /// @param high 最高价
+    /// @param low 最低价
+    /// @param close 收盘价
+    /// @param volume 成交量
+    /// @return 成功返回0
+    /// @note 只重算不稳定尾部，均摊O(1)；结果与对全部K线调用 Analyze 一致
+    int AppendBar(float high, float low, float close, float volume);
+    
+    /// @brief 修改最后一根K线（盘中刷新）并增量更新
+    /// @return 成功返回0，尚无K线时返回-1
+    int UpdateLastBar(float high, float low, float close, float volume);
+    
+    /// @brief 获取已处理的原始K线数量
+    int GetRawCount() const { return m_raw_count; }
+    
     // ========================================================================
     // 去包含处理 (5.1)
     // ========================================================================
@@ -77,7 +268,24 @@ public:
     int RemoveInclude(const float* highs, const float* lows, int count);
     
     /// @brief 获取去包含后的K线
-    const std::vector<KLine>& GetMergedKLines() const { return m_merged_klines; }
+    SoAView<KLine> GetMergedKLines() const {
+        return SoAView<KLine>(this, m_merged_klines.size(), &ChanCore::MergedKLineAt);
+    }
+    
+    /// @brief 获取去包含后K线的SoA存储（热路径直接访问）
+    const MergedKLineSoA& GetMergedKLineSoA() const { return m_merged_klines; }
+    
+    /// @brief 原始K线 [first, last] 内最高价所在K线（含两端，并列取最早）
+    /// @return 未启用 range_index、索引与K线不同步或区间无效时返回-1
+    /// @note 索引随 RemoveInclude/AppendBar/UpdateLastBar 维护，查询 O(1)；
+    ///       运行中才启用 range_index 时，下次 Analyze 起生效
+    int GetRangeHighIndex(int first, int last) const;
+    
+    /// @brief 原始K线 [first, last] 内最低价所在K线（含两端，并列取最早）
+    int GetRangeLowIndex(int first, int last) const;
+    
+    /// @brief 原始K线区间极值索引（未启用时为空）
+    const RangeExtremeIndex& GetRangeIndex() const { return m_range; }
     
     // ========================================================================
     // 分型识别 (5.2)
@@ -88,7 +296,12 @@ public:
     int CheckFX();
     
     /// @brief 获取分型列表
-    const std::vector<Fractal>& GetFractals() const { return m_fractals; }
+    SoAView<Fractal> GetFractals() const {
+        return SoAView<Fractal>(this, m_fractals.size(), &ChanCore::FractalAt);
+    }
+    
+    /// @brief 获取分型的SoA存储
+    const FractalSoA& GetFractalSoA() const { return m_fractals; }
     
     // ========================================================================
     // 笔识别 (5.3)
@@ -99,7 +312,12 @@ public:
     int CheckBI();
     
     /// @brief 获取笔列表
-    const std::vector<Stroke>& GetStrokes() const { return m_strokes; }
+    SoAView<Stroke> GetStrokes() const {
+        return SoAView<Stroke>(this, m_strokes.size(), &ChanCore::StrokeAt);
+    }
+    
+    /// @brief 获取笔的SoA存储
+    const StrokeSoA& GetStrokeSoA() const { return m_strokes; }
     
     // ========================================================================
     // 中枢识别 (5.4)
@@ -112,12 +330,77 @@ public:
     /// @brief 获取中枢列表
     const std::vector<Pivot>& GetPivots() const { return m_pivots; }
     
+    /// @brief 多级别中枢：线段中枢（级别1），及相邻同级中枢波动区间重叠逐级升级的中枢（级别2+）
+    /// @return 最高中枢级别（0=只有笔中枢）
+    /// @note 需先完成线段识别；每级以下一级为构件，流式更新时各级只从变化的构件续算
+    int CheckPivotLevels();
+    
+    /// @brief 获取指定级别的中枢（0=笔中枢，同 GetPivots()），级别不存在时返回空列表
+    const std::vector<Pivot>& GetPivots(int level) const;
+    
+    /// @brief 已识别中枢的最高级别（0=只有笔中枢）
+    int GetMaxPivotLevel() const;
+    
+    // ========================================================================
+    // 背驰判断（MACD面积）
+    // ========================================================================
+    
+    /// @brief 是否有MACD数据（Analyze 传入收盘价，或从空状态开始流式追加时计算）
+    bool HasMACD() const { return !m_macd.empty(); }
+    
+    /// @brief MACD柱 2*(DIF-DEA)，长度为原始K线数；无收盘价时为空
+    const std::vector<float>& GetMACD() const { return m_macd; }
+    
+    /// @brief 原始K线区间 [start_idx, end_idx] 内的MACD柱面积
+    /// @param dir UP=红柱面积，DOWN=绿柱面积（取绝对值）
+    /// @note 前缀和相减 O(1)；无MACD数据时返回0
+    float GetMACDArea(int start_idx, int end_idx, Direction dir) const;
+    
+    /// @brief 背驰判断：比较中枢进入段（第一个构件之前）与离开段（最后一个构件，同向）
+    /// @return 按K线排序的背驰信号：离开段创新高/新低而MACD面积小于进入段，
+    ///         底背驰为 BUY1、顶背驰为 SELL1，has_divergence=true，
+    ///         strength 1=笔中枢（比较笔），2=线段中枢（比较线段）
+    /// @note 每个中枢 O(1)（线段中枢查找进入/离开段 O(log S)），不再遍历K线
+    std::vector<Signal> CheckBC() const;
+    
+    // ========================================================================
+    // 稀疏结果
+    // ========================================================================
+    
+    /// @brief 收集指定种类的事件，追加到 out 尾部
+    /// @param kinds 事件种类掩码（EventBit 组合，ALL_EVENTS=全部）
+    /// @param highs/lows 买卖点价格（卖点取最高价、买点取最低价），可为nullptr（价格为0）
+    /// @param first_bar 只收集K线索引不小于 first_bar 的事件（选股通常只看最近若干根）
+    /// @return 追加的事件数；追加部分按K线排序，同一K线按种类排序
+    /// @note 买卖点取自信号位图（需先 BuildSignalTable）；
+    ///       复用 out 时容量保留，稳态下不分配内存
+    int CollectEvents(uint32_t kinds, std::vector<ChanEvent>& out,
+                      const float* highs = nullptr, const float* lows = nullptr,
+                      int first_bar = 0) const;
+    
+    // ========================================================================
+    // 线段识别 (5.5)
+    // ========================================================================
+    
+    /// @brief 线段识别（特征序列法），需先完成笔识别
+    /// @return 识别到的线段数量
+    /// @note 单次扫描笔序列，复杂度 O(S)；流式更新时只从最近的确认断点续算
+    int CheckDUAN();
+    
+    /// @brief 获取线段列表
+    /// @note 末段终点仍可能被同向更极端的笔终点替换（与分型取极值相同）
+    SoAView<Segment> GetSegments() const {
+        int count = m_seg_points.empty() ? 0 : (int)m_seg_points.size() - 1;
+        return SoAView<Segment>(this, count, &ChanCore::SegmentAt);
+    }
+    
     // ========================================================================
     // 递归引用系统 (任务2.2)
     // ========================================================================
     
     /// @brief 构建递归引用序列（GG/DD序列）
     /// @param current_bar_idx 当前K线索引范围（构建从0到current_bar_idx的所有序列）
+    /// @note 单次前向扫描，复杂度 O(N+S)，N=K线数，S=笔数
     void BuildBiSequence(int current_bar_idx);
     
     /// @brief 获取指定K线的GG值
@@ -144,6 +427,13 @@ public:
     /// @return 1=下跌趋势后（适合判断买点），-1=上涨趋势后（适合判断卖点），0=震荡
     int GetDirection(int kline_idx) const;
     
+    /// @brief 任意K线时点的状态：方向、GG1-5/DD1-5、HH/LL 与所处笔中枢
+    /// @param kline_idx K线索引（原始K线）
+    /// @return 与 BuildBiSequence 在该K线的结果一致；索引为负时返回空状态
+    /// @note 笔终点递增，二分查找 O(log S)，无需先 BuildBiSequence；
+    ///       图表、回测等随机访问单根K线时使用，避免逐K线重建序列
+    ChanState GetStateAt(int kline_idx) const;
+    
     // ========================================================================
     // 幅度计算 (任务2.4)
     // ========================================================================
@@ -172,6 +462,12 @@ public:
     /// @param count 数组长度
     void SetMAData(const float* ma13, const float* ma26, int count);
     
+    /// @brief 由收盘价计算均线数据（周期取自 ma_short_period/ma_long_period）
+    /// @param closes 收盘价数组
+    /// @param count 数组长度
+    /// @note 一次遍历计算两条均线，结果与 SetMAData 传入的 MA13/MA26 含义相同
+    void ComputeMAData(const float* closes, int count);
+    
     /// @brief 一买判断
     /// @param bar_idx K线索引
     /// @param low 当前K线最低价
@@ -302,6 +598,14 @@ public:
     /// @note 输出值: 端点处为价格，非端点为0
     void OutputBI(float* out, int count) const;
     
+    /// @brief 输出线段端点到数组
+    /// @note 输出值: 端点处为价格，非端点为0
+    void OutputDUAN(float* out, int count) const;
+    
+    /// @brief 输出背驰标记到数组
+    /// @note 输出值: 离开段终点处 1=顶背驰, -1=底背驰, 其余为0
+    void OutputBC(float* out, int count) const;
+    
     /// @brief 输出中枢高点到数组
     void OutputZS_H(float* out, int count) const;
     
@@ -351,6 +655,27 @@ public:
     /// @note 输出: 1=新K线, 0=被合并
     void OutputNewBar(float* out, int count) const;
     
+    // ========================================================================
+    // 信号位图（一次评估，多路输出）
+    // ========================================================================
+    
+    /// @brief 逐K线评估全部买卖点/准买卖点/类二买卖条件，生成信号位图
+    /// @param highs 最高价数组（卖点判断用）
+    /// @param lows 最低价数组（买点判断用）
+    /// @param count K线数量
+    /// @note 需先调用 BuildBiSequence；重建递归序列或更换均线后位图失效
+    void BuildSignalTable(const float* highs, const float* lows, int count);
+    
+    /// @brief 信号位图是否可用
+    bool HasSignalTable() const { return m_signal_table_ready; }
+    
+    /// @brief 获取信号位图（布局见 SignalBits）
+    const std::vector<uint32_t>& GetSignalTable() const { return m_signal_table; }
+    
+    /// @brief 从信号位图投影输出，结果与对应 Output*Signal 相同
+    /// @note 未生成位图时输出全0
+    void ProjectSignal(SignalOutput kind, float* out, int count) const;
+    
     // ========================================================================
     // 辅助函数
     // ========================================================================
@@ -369,9 +694,9 @@ private:
     int m_raw_count;
     
     // 计算结果
-    std::vector<KLine> m_merged_klines;     // 去包含后的K线
-    std::vector<Fractal> m_fractals;        // 分型列表
-    std::vector<Stroke> m_strokes;          // 笔列表
+    MergedKLineSoA m_merged_klines;         // 去包含后的K线
+    FractalSoA m_fractals;                  // 分型列表
+    StrokeSoA m_strokes;                    // 笔列表
     std::vector<Pivot> m_pivots;            // 中枢列表
     std::vector<BiSequenceData> m_bi_sequence; // 递归引用序列
     
@@ -379,19 +704,213 @@ private:
     std::vector<float> m_ma13;
     std::vector<float> m_ma26;
     
+    // MACD：柱值与红/绿柱面积前缀和（长度为K线数+1），
+    // 以及最后一根K线并入前/后的EMA状态，UpdateLastBar 据此重算最后一根
+    struct MacdState {
+        double fast;                    // 快线EMA
+        double slow;                    // 慢线EMA
+        double dea;                     // DIF的EMA
+    };
+    std::vector<float> m_macd;
+    std::vector<double> m_macd_red;
+    std::vector<double> m_macd_green;
+    MacdState m_macd_prev;
+    MacdState m_macd_last;
+    
+    // 信号位图
+    std::vector<uint32_t> m_signal_table;
+    bool m_signal_table_ready;
+    
     // 原始索引到合并索引的映射
     std::vector<int> m_raw_to_merged;
     
+    // 原始K线区间极值索引（config.range_index 启用时与原始K线同步）
+    RangeExtremeIndex m_range;
+    
+    // ------------------------------------------------------------------------
+    // 流式增量状态（AppendBar/UpdateLastBar）
+    // ------------------------------------------------------------------------
+    
+    // 去包含：最后一根原始K线并入前的快照，UpdateLastBar 据此回退
+    Direction m_include_dir;            // 当前包含方向
+    Direction m_snap_include_dir;
+    int m_snap_merged_count;            // 并入前的合并K线数量
+    float m_snap_back_high;             // 并入前的末尾合并K线
+    float m_snap_back_low;
+    int m_snap_back_end;
+    
+    // 分型：已确认前缀（中间K线及其左右K线都不会再变化）
+    int m_fx_next;                      // 下一个待处理的候选中间K线
+    int m_fx_count;                     // 已确认前缀中的分型数量
+    Fractal m_fx_back;                  // 已确认前缀的末尾分型
+    FractalType m_fx_last_type;
+    std::vector<uint32_t> m_fx_top_bits;    // 分型候选位图（ScanFX 复用）
+    std::vector<uint32_t> m_fx_bottom_bits;
+    
+    // 笔：贪心过程中找不到终点而跳过的起点；参数或分型整体变化后需从头重建
+    struct BiSkip {
+        int fx_idx;                     // 被跳过的起点分型
+        int stroke_count;               // 跳过时已有的笔数
+        int checked_until;              // 已确认无法成笔的分型上界
+    };
+    bool m_bi_stale;
+    std::vector<BiSkip> m_bi_skips;
+    
+    // 笔：[p, n) 内反向分型的最极端价格（下标 >= m_bi_reach_from 有效），
+    // 起点在 p 之后能否成笔由此 O(1) 判定
+    std::vector<float> m_bi_min_bottom;     // 底分型最低价
+    std::vector<float> m_bi_max_top;        // 顶分型最高价
+    int m_bi_reach_from;
+    
+    // 中枢：每次判定后的断点（各级中枢共用，构件为笔/线段/下级中枢）
+    // 末尾中枢扩展时每个构件也记录断点，新构件只从扩展断点续算
+    struct ZsBoundary {
+        int stroke_idx;                 // 下一次判定的起始构件（扩展中：下一个待检查的构件）
+        int pivot_count;                // 已识别的中枢数
+        int max_used;                   // 至今判定用到的最大构件下标
+        bool extending;                 // 末尾中枢是否仍在扩展
+        int part_count;                 // 扩展中：末尾中枢的构件数
+        float gg;                       // 扩展中：末尾中枢的最高点
+        float dd;                       // 扩展中：末尾中枢的最低点
+    };
+    std::vector<ZsBoundary> m_zs_boundaries;
+    
+    // 中枢构件：组成中枢的次级别走势（笔/线段/下级中枢）的只读视图与本级参数
+    struct PivotInput {
+        const float* high;              // 构件最高点
+        const float* low;               // 构件最低点
+        const int* start_stroke;        // 构件起止笔（nullptr=构件即笔）
+        const int* end_stroke;
+        const int* start_idx;           // 构件起止K线索引
+        const int* end_idx;
+        const Direction* direction;
+        int count;
+        int min_count;                  // 成中枢的最少构件数
+        int level;
+    };
+    
+    // 级别1及以上的中枢：本级构件（SoA，由下一级结果增量复制）、中枢与判定断点
+    struct PivotLevel {
+        std::vector<float> high;
+        std::vector<float> low;
+        std::vector<int> start_stroke;
+        std::vector<int> end_stroke;
+        std::vector<int> start_idx;
+        std::vector<int> end_idx;
+        std::vector<Direction> direction;
+        std::vector<Pivot> pivots;
+        std::vector<ZsBoundary> boundaries;
+        
+        void ResizeParts(int n) {
+            high.resize(n); low.resize(n); start_stroke.resize(n); end_stroke.resize(n);
+            start_idx.resize(n); end_idx.resize(n); direction.resize(n);
+        }
+        void Reset() {
+            ResizeParts(0);
+            pivots.clear();
+            boundaries.clear();
+        }
+    };
+    // 各级只增不减，停用的级别清空但保留容量，重复分析不再分配内存
+    std::vector<PivotLevel> m_pivot_levels;     // [k] 为级别 k+1
+    int m_pivot_level_count;                    // 有效级别数（之后的级别为空）
+    
+    // 线段：端点序列，相邻两端点之间为一段。末端点之前的端点不再变化，
+    // 末端点可被同向更极端的笔终点替换（上一段延伸）
+    struct SegPoint {
+        int stroke;                     // 端点所在笔（端点为该笔终点；-1=第一笔起点）
+        int kline_idx;                  // 端点K线索引
+        float price;                    // 端点价格
+        FractalType type;               // 顶/底
+        
+        bool operator==(const SegPoint& o) const {
+            return stroke == o.stroke && kline_idx == o.kline_idx && price == o.price && type == o.type;
+        }
+    };
+    std::vector<SegPoint> m_seg_points;
+    
+    // 线段：当前段的特征序列扫描状态
+    // 向下段按价格取反处理，统一为"向上段寻找顶分型"
+    struct SegScan {
+        int next;                       // 下一根待处理的笔
+        int start;                      // 当前段的第一笔
+        int ext;                        // 当前段的极值笔（候选终点），-1=尚无
+        float ext_price;
+        int ext_kline;                  // 极值所在K线
+        bool has_elem2;                 // 极值之后的第一个特征元素（已做包含合并）
+        float elem2_high;
+        float elem2_low;
+        bool gap;                       // 分型第一、二元素之间有缺口
+        bool elem3;                     // 第三元素已出现（分型成立）
+        int rev_count;                  // 缺口情况：新段特征序列（同向笔）的待定元素数
+        float rev_high[2];
+        float rev_low[2];
+        bool rev_fractal;               // 缺口情况：新段特征序列已出现分型
+    };
+    SegScan m_seg_scan;
+    
+    // 线段：每根新笔处理后的断点（max_used = 至今处理到的最大笔下标）
+    struct SegCheckpoint {
+        SegScan scan;
+        int point_count;
+        SegPoint back;
+        int max_used;
+    };
+    std::vector<SegCheckpoint> m_seg_checkpoints;
+    int m_seg_dirty_point;              // 本次续算中最早被改写的端点
+    std::vector<SegPoint> m_seg_old_tail;   // 回退前的末尾端点（复用）
+    
     // 内部辅助函数
     bool HasIncludeRelation(const KLine& k1, const KLine& k2) const;
     void MergeKLine(KLine& target, const KLine& source, Direction dir);
     Direction DetermineDirection(const std::vector<KLine>& klines, int idx) const;
     
+    // SoA视图还原
+    KLine MergedKLineAt(int i) const;
+    Fractal FractalAt(int i) const;
+    Stroke StrokeAt(int i) const;
+    Segment SegmentAt(int i) const;
+    void SetFractal(int i, const Fractal& fx);
+    
+    // 信号位图：评估单侧全部条件（布局见 SignalBits，不含卖点偏移）
+    uint32_t EvaluateBuyBits(int i, float low) const;
+    uint32_t EvaluateSellBits(int i, float high) const;
+    
+    // 流式增量辅助函数：Resume* 从检查点续算，返回下一阶段的首个可能变化下标
+    void PushRawBar(int index, float high, float low);
+    void PushMACD(float close);
+    void PopMACD();
+    void ScanDivergence(std::vector<Signal>* signals, std::vector<ChanEvent>* events,
+                        float* out, int count) const;
+    void ResetFXCheckpoint();
+    void ApplyFXCandidate(int i, FractalType type, FractalType& last_type);
+    void ScanFX(int begin, int end, FractalType& last_type);
+    int ResumeFX();
+    void PushStroke(int start_fx, int end_fx);
+    int FirstLongEnough(int start_fx, int from) const;
+    void PrepareStrokeReach(int from);
+    bool CanReachStroke(int start_fx, int from) const;
+    int ResumeBI(int fx_dirty);
+    void ResumeZS(int stroke_dirty);
+    int ResumePivots(const PivotInput& in, std::vector<Pivot>& pivots,
+                     std::vector<ZsBoundary>& boundaries, int dirty);
+    int ExtendLastPivot(const PivotInput& in, std::vector<Pivot>& pivots,
+                        std::vector<ZsBoundary>& boundaries, int from, int part_count, int& max_used);
+    void ResumePivotLevels(int seg_dirty);
+    void ResetPivotLevels(int from);
+    void ResetSegScan(int start);
+    void ScanSegmentStroke(int i);
+    void CommitSegmentPoint(bool up);
+    void ScanSegments(int n);
+    int ResumeDUAN(int stroke_dirty);
+    void UpdateTail();
+    
     bool IsFXValid(const Fractal& fx) const;
-    bool CanFormStroke(const Fractal& fx1, const Fractal& fx2) const;
+    bool CanFormStroke(int fx1, int fx2) const;  // 参数为分型下标
+    bool IsStrokeLongEnough(int fx1, int fx2) const;
     
     // 阶段二辅助函数
-    int CalculateDirection(int bar_idx) const;
+    int LastStrokeOf(int stroke, Direction dir) const;  // stroke 及之前最近的 dir 方向笔
     
     // 阶段三辅助函数
     bool CheckFiveDownPattern(int bar_idx) const;    // 五段下跌形态
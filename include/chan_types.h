@@ -7,7 +7,7 @@
 #define CHAN_TYPES_H
 
 #include <vector>
-#include <string>
+#include <cstdint>
 
 namespace chan {
 
@@ -201,17 +201,18 @@ struct Stroke {
 // ============================================================================
 
 struct Segment {
-    int              id;            // 线段ID
-    int              start_idx;     // 起点索引
-    int              end_idx;       // 终点索引
-    Direction        direction;     // 方向
-    float            high;          // 最高点
-    float            low;           // 最低点
-    std::vector<int> stroke_ids;    // 包含的笔ID列表
-    int              stroke_count;  // 笔的数量 (>=3)
+    int        id;                // 线段ID
+    int        start_stroke_id;   // 起始笔ID
+    int        end_stroke_id;     // 结束笔ID（含），包含的笔为 [start_stroke_id, end_stroke_id]
+    int        start_idx;         // 起点K线索引
+    int        end_idx;           // 终点K线索引
+    Direction  direction;         // 方向
+    float      high;              // 最高点
+    float      low;               // 最低点
+    int        stroke_count;      // 笔的数量 (>=3)
     
-    Segment() : id(0), start_idx(0), end_idx(0), direction(Direction::NONE),
-                high(0), low(0), stroke_count(0) {}
+    Segment() : id(0), start_stroke_id(0), end_stroke_id(0), start_idx(0), end_idx(0),
+                direction(Direction::NONE), high(0), low(0), stroke_count(0) {}
 };
 
 // ============================================================================
@@ -231,12 +232,12 @@ struct Pivot {
     float      GG;                // 中枢最高点 (波动高点)
     float      DD;                // 中枢最低点 (波动低点)
     
-    int        level;             // 级别 (0=本级, 1=升级...)
+    int        level;             // 级别 (0=笔中枢, 1=线段中枢, 2+=升级中枢)
     int        stroke_count;      // 包含笔数
     Direction  direction;         // 中枢方向 (由进入段决定)
     
-    bool       is_extended;       // 是否扩展
-    bool       is_upgraded;       // 是否升级
+    bool       is_extended;       // 是否扩展（构件数超过成中枢所需）
+    bool       is_upgraded;       // 是否升级（由下级中枢波动区间重叠形成）
     
     Pivot() : id(0), start_stroke_id(0), end_stroke_id(0),
               start_idx(0), end_idx(0), ZG(0), ZD(0), ZZ(0), GG(0), DD(0),
@@ -248,6 +249,31 @@ struct Pivot {
 // 买卖点结构
 // ============================================================================
 
+/// @brief 信号原因码（代替原因字符串，描述由 ReasonText 取得）
+enum class ReasonCode : uint16_t {
+    NONE = 0,
+    STROKE_PIVOT_DIVERGENCE,    // 笔中枢背驰
+    SEGMENT_PIVOT_DIVERGENCE,   // 线段中枢背驰
+    FIRST,                      // 一买/一卖
+    SECOND,                     // 二买/二卖
+    THIRD,                      // 三买/三卖
+    PRE_FIRST,                  // 准一买/准一卖
+    PRE_SECOND,                 // 准二买/准二卖
+    PRE_THIRD,                  // 准三买/准三卖
+    LIKE_SECOND,                // 类二买/类二卖
+    COUNT
+};
+
+/// @brief 原因码的描述（静态字符串）
+inline const char* ReasonText(ReasonCode code) {
+    static const char* const texts[(int)ReasonCode::COUNT] = {
+        "", "笔中枢背驰", "线段中枢背驰", "一类买卖点", "二类买卖点", "三类买卖点",
+        "准一类买卖点", "准二类买卖点", "准三类买卖点", "类二买卖点"
+    };
+    int k = (int)code;
+    return (k >= 0 && k < (int)ReasonCode::COUNT) ? texts[k] : "";
+}
+
 struct Signal {
     int         index;            // K线索引
     SignalType  type;             // 信号类型
@@ -255,11 +281,44 @@ struct Signal {
     int         strength;         // 强度 1-3
     int         pivot_id;         // 关联中枢ID
     bool        has_divergence;   // 是否背驰
-    std::string reason;           // 信号原因描述
+    ReasonCode  reason;           // 信号原因（ReasonText 取描述）
     
     Signal() : index(0), type(SignalType::NONE), price(0),
-               strength(0), pivot_id(0), has_divergence(false) {}
+               strength(0), pivot_id(0), has_divergence(false), reason(ReasonCode::NONE) {}
+};
+
+// ============================================================================
+// 稀疏结果事件
+// ============================================================================
+// Output* 按K线输出稠密数组，绝大多数为0；选股、回测等非通达信调用方
+// 改用事件列表：每个事件16字节，只记录有结果的K线。
+
+/// @brief 事件种类
+enum class EventKind : uint8_t {
+    FRACTAL = 0,    // 分型：code 1=顶 -1=底
+    STROKE,         // 笔端点：code 1=顶 -1=底，ref=以该点结束的笔（首个起点为-1）
+    SEGMENT,        // 线段端点：同笔端点，ref 为线段序号
+    PIVOT_START,    // 中枢起点：price=ZG，code=级别，ref=中枢ID
+    PIVOT_END,      // 中枢终点：price=ZD，code=级别，ref=中枢ID
+    SIGNAL,         // 买卖点：code 正为买、负为卖，绝对值为细分类型，reason 为类别
+    DIVERGENCE,     // 背驰：code 1=顶背驰 -1=底背驰，ref=中枢ID
+    COUNT
+};
+
+/// @brief 事件种类掩码
+inline uint32_t EventBit(EventKind kind) { return 1u << (int)kind; }
+const uint32_t ALL_EVENTS = (1u << (int)EventKind::COUNT) - 1u;
+
+/// @brief 稀疏结果事件（POD）
+struct ChanEvent {
+    int32_t    index;             // K线索引
+    EventKind  kind;
+    int8_t     code;              // 类型码（含义见 EventKind）
+    ReasonCode reason;            // 原因码（信号与背驰）
+    float      price;             // 价格
+    int32_t    ref;               // 关联序号（含义见 EventKind，无关联为-1）
 };
+static_assert(sizeof(ChanEvent) == 16, "ChanEvent 应为16字节");
 
 // ============================================================================
 // 递归引用结构 - 用于存储GG/DD序列
@@ -295,6 +354,16 @@ struct BiSequenceData {
     }
 };
 
+/// @brief 任意K线时点的分析状态（ChanCore::GetStateAt）
+struct ChanState {
+    BiSequenceData seq;     // GG1-5/DD1-5/HH/LL 与方向，同 BuildBiSequence 在该K线的结果
+    int  stroke;            // 截至该K线最后完成的笔（终点不晚于该K线），无为-1
+    int  pivot;             // 截至该K线已形成的最后一个笔中枢，无为-1
+    bool in_pivot;          // 最后完成的笔仍属于该中枢（尚未离开）
+    
+    ChanState() : stroke(-1), pivot(-1), in_pivot(false) {}
+};
+
 // ============================================================================
 // 幅度计算辅助结构
 // ============================================================================
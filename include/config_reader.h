@@ -6,8 +6,8 @@
 #ifndef CONFIG_READER_H
 #define CONFIG_READER_H
 
+#include <map>
 #include <string>
-#include <windows.h>
 
 namespace chan {
 
@@ -42,9 +42,49 @@ struct ChanIniConfig {
     int pre_first_time_window = 8;   // 准一买时间窗口
     int pre_second_time_window = 10; // 准二买时间窗口
     
+    // [Divergence] 背驰参数
+    int macd_fast = 12;             // MACD快线周期
+    int macd_slow = 26;             // MACD慢线周期
+    int macd_signal = 9;            // MACD信号线周期
+    
     // [Performance] 性能参数
     bool enable_incremental = true; // 启用增量计算
-    int cache_size = 100000;        // 缓存大小
+    int cache_size = 500000;        // 缓存容量（K线总数，约100个5000根K线的图表）
+    int cache_entries = 128;        // 最多缓存的分析会话数（图表/股票数）
+    bool enable_perf_counters = true;   // 启用性能计数（GetChanPerfStats，卸载时写 chan_perf.txt）
+    int perf_redundant_window_ms = 1000; // 同一函数收到相同数据的间隔小于此值时记为冗余调用
+};
+
+// ============================================================================
+// INI 文件解析（与平台无关）
+// ============================================================================
+
+/// @brief 简单 INI 解析器，语义与 GetPrivateProfileInt/String 一致：
+///        节名与键名不区分大小写，值两端空白去除，';' 或 '#' 开头的行为注释
+class IniFile {
+public:
+    /// @brief 从文件加载，文件不存在或无法读取返回false
+    bool Load(const std::string& path);
+    
+    /// @brief 从字符串解析（测试与内嵌配置用）
+    void Parse(const std::string& text);
+    
+    /// @brief 查找键值，不存在返回nullptr
+    const std::string* Find(const char* section, const char* key) const;
+    
+    /// @brief 读取整数，键不存在或不以数字开头时返回默认值
+    int GetInt(const char* section, const char* key, int default_val) const;
+    
+    /// @brief 读取布尔值：整数按非0为真，也接受 true/false、yes/no、on/off
+    bool GetBool(const char* section, const char* key, bool default_val) const;
+    
+    /// @brief 读取浮点数
+    float GetFloat(const char* section, const char* key, float default_val) const;
+    
+private:
+    static std::string MakeKey(const char* section, const char* key);
+    
+    std::map<std::string, std::string> m_values;   // "节\n键"（小写） -> 值
 };
 
 // ============================================================================
@@ -81,9 +121,10 @@ private:
     // 读取浮点值
     float ReadFloat(const char* section, const char* key, float default_val);
     
-    // 获取DLL所在目录
+    // 获取DLL所在目录（非Windows平台为当前目录）
     static std::string GetDllDirectory();
     
+    IniFile m_ini;
     ChanIniConfig m_config;
     std::string m_ini_path;
     bool m_loaded = false;
@@ -0,0 +1,49 @@
+#pragma once
+// ============================================================================
+// 缠论通达信DLL插件 - 浮点数组指纹
+// ============================================================================
+// K线数据内容哈希，用于判断数据是否变化（分析缓存、增量计算）
+// 仅含内联函数，chan.dll 与 chan_std.dll 共用
+// ============================================================================
+
+#ifndef FLOAT_HASH_H
+#define FLOAT_HASH_H
+
+#include <cstdint>
+#include <cstring>
+
+namespace chan {
+
+/// @brief 计算浮点数组的内容哈希
+/// @note 8路独立累加，循环体无跨路依赖，编译器可自动向量化
+inline uint64_t HashFloatArray(const float* data, int count) {
+    uint32_t lanes[8] = {
+        0x243F6A88u, 0x85A308D3u, 0x13198A2Eu, 0x03707344u,
+        0xA4093822u, 0x299F31D0u, 0x082EFA98u, 0xEC4E6C89u
+    };
+
+    int i = 0;
+    for (; i + 8 <= count; i += 8) {
+        for (int k = 0; k < 8; ++k) {
+            uint32_t bits;
+            memcpy(&bits, &data[i + k], sizeof(bits));
+            uint32_t h = (lanes[k] ^ bits) * 0x9E3779B1u;
+            lanes[k] = h ^ (h >> 15);
+        }
+    }
+
+    uint64_t result = (uint64_t)count * 0x9E3779B97F4A7C15ull;
+    for (; i < count; ++i) {
+        uint32_t bits;
+        memcpy(&bits, &data[i], sizeof(bits));
+        result = (result ^ bits) * 0x100000001B3ull;
+    }
+    for (int k = 0; k < 8; ++k) {
+        result = (result ^ lanes[k]) * 0x100000001B3ull;
+    }
+    return result ^ (result >> 29);
+}
+
+} // namespace chan
+
+#endif // FLOAT_HASH_H
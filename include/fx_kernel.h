@@ -0,0 +1,71 @@
+#pragma once
+// ============================================================================
+// 缠论通达信DLL插件 - 分型候选SIMD内核
+// ============================================================================
+// 分型识别分两步：
+//   1. 内核对合并K线 high/low 数组批量比较，输出顶/底候选位图
+//   2. ChanCore 按位图做标量压缩（连续同类分型取极值）
+// 运行时检测CPU支持的指令集（AVX2 / SSE4.1 / 标量），各路径结果逐位一致
+// ============================================================================
+
+#ifndef FX_KERNEL_H
+#define FX_KERNEL_H
+
+#include <cstdint>
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+namespace chan {
+
+/// @brief 分型内核使用的指令集
+enum class SimdLevel {
+    SCALAR = 0,
+    SSE41 = 1,
+    AVX2 = 2
+};
+
+/// @brief 检测当前CPU可用的最高指令集（结果缓存）
+SimdLevel GetSimdLevel();
+
+/// @brief 指令集名称（日志/诊断用）
+const char* SimdLevelName(SimdLevel level);
+
+/// @brief 计算分型候选位图所需的32位字数
+inline int FXMaskWords(int candidates) {
+    return candidates > 0 ? (candidates + 31) / 32 : 0;
+}
+
+/// @brief 最低置位的位序号（word 不能为0）
+inline int LowestBitIndex(uint32_t word) {
+#if defined(_MSC_VER)
+    unsigned long index;
+    _BitScanForward(&index, word);
+    return (int)index;
+#else
+    return __builtin_ctz(word);
+#endif
+}
+
+/// @brief 计算中间K线 [begin, end) 的顶/底分型候选位图
+/// @param high 合并K线最高价
+/// @param low 合并K线最低价
+/// @param begin 首个候选中间K线（>= 1）
+/// @param end 候选结束位置（<= K线数量 - 1）
+/// @param top_bits 输出：第 k 位对应候选 begin + k 为顶分型，至少 FXMaskWords(end - begin) 个字
+/// @param bottom_bits 输出：底分型位图，同上
+/// @param level 使用的指令集，高于 GetSimdLevel() 时自动降级
+/// @note 判定条件与 ChanCore 标量实现相同：
+///       顶 = 高点、低点都严格高于左右K线；底 = 高点、低点都严格低于左右K线
+void DetectFXCandidates(const float* high, const float* low, int begin, int end,
+                        uint32_t* top_bits, uint32_t* bottom_bits, SimdLevel level);
+
+/// @brief 使用 GetSimdLevel() 检测到的指令集计算候选位图
+inline void DetectFXCandidates(const float* high, const float* low, int begin, int end,
+                               uint32_t* top_bits, uint32_t* bottom_bits) {
+    DetectFXCandidates(high, low, begin, end, top_bits, bottom_bits, GetSimdLevel());
+}
+
+} // namespace chan
+
+#endif // FX_KERNEL_H
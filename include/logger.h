@@ -6,18 +6,30 @@
 #ifndef LOGGER_H
 #define LOGGER_H
 
-// 必须在 windows.h 之前取消 ERROR 宏定义
-#ifdef ERROR
-#undef ERROR
-#endif
+// 不依赖平台头文件：Windows 下输出到调试器，其它平台输出到 stderr，
+// 也可通过 LogSetSink 接管输出、LogSetFile 另写文件
+//
+// 异步输出：CHAN_LOG_* 宏在调用线程上只做级别判断并把格式串指针与参数的
+// 二进制值写入无锁环形缓冲（字符串参数按值复制），格式化、取时间、
+// OutputDebugStringA 与写文件都在后台线程完成。缓冲满时丢弃并计数，
+// 不阻塞计算线程。格式串须为字符串常量（宏只保存指针）
 
-#include <windows.h>
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+#include <type_traits>
 
-// 再次确保 ERROR 宏被取消
+// 与 windows.h 同时包含时，取消其 ERROR 宏定义
 #ifdef ERROR
 #undef ERROR
 #endif
 
+// 编译期日志级别：高于此级别的 CHAN_LOG_* 宏编译为空（0=OFF ... 4=DEBUG）
+// 默认全部保留，运行时由 LogSetLevel 控制，生产环境也能临时打开 DEBUG
+#ifndef CHAN_LOG_COMPILE_LEVEL
+#define CHAN_LOG_COMPILE_LEVEL 4
+#endif
+
 namespace chan {
 
 // 日志级别
@@ -34,28 +46,172 @@ void LogInit(LogLevel level = LogLevel::LOG_INFO);
 
 // 设置日志级别
 void LogSetLevel(LogLevel level);
+LogLevel LogGetLevel();
+
+/// @brief 日志输出回调（在后台线程调用）
+/// @param level 日志级别
+/// @param message 已格式化的完整日志行（含时间与级别前缀、换行）
+typedef void (*LogSink)(LogLevel level, const char* message);
+
+/// @brief 设置日志输出回调，传nullptr恢复平台默认输出
+void LogSetSink(LogSink sink);
+
+/// @brief 另将日志追加写入文件（每批写完刷新一次），传nullptr关闭
+/// @return 文件能否打开
+bool LogSetFile(const char* path);
+
+/// @brief 阻塞至此前提交的日志全部输出
+void LogFlush();
+
+/// @brief 输出剩余日志并停止后台线程（进程退出时自动调用），之后的日志同步输出
+void LogShutdown();
 
-// 日志输出函数
+/// @brief DLL卸载时调用（DllMain 中不能 join 线程）
+/// @param process_exit 进程退出（后台线程已被系统终止，由调用线程输出剩余日志）
+/// @note 后台线程启动时已把模块固定到进程退出，线程运行期间 FreeLibrary 不会卸载DLL
+void LogDetachFromLoader(bool process_exit);
+
+/// @brief 因缓冲满被丢弃的日志条数
+uint64_t LogGetDropped();
+
+// 日志输出函数（立即格式化后提交，供非字符串常量格式串使用）
 void LogError(const char* fmt, ...);
 void LogWarn(const char* fmt, ...);
 void LogInfo(const char* fmt, ...);
 void LogDebug(const char* fmt, ...);
 
+// ============================================================================
+// 延迟格式化（CHAN_LOG_* 宏的实现）
+// ============================================================================
+
+namespace log_detail {
+
+/// @brief 参数类型标记
+enum ArgTag : unsigned char {
+    ARG_INT = 1,        // int64
+    ARG_UINT,           // uint64
+    ARG_DOUBLE,         // double
+    ARG_STRING,         // uint16 长度 + 字节（截断）
+    ARG_POINTER         // uint64
+};
+
+/// @brief 环形缓冲中的一条日志（定长）
+struct LogRecord {
+    static const int PAYLOAD = 224;
+
+    const char* fmt;
+    int64_t time_us;            // 提交时刻（自1970年起的微秒）
+    unsigned char level;
+    unsigned char argc;
+    uint16_t size;              // payload 已用字节
+    unsigned char payload[PAYLOAD];
+
+    void PutRaw(ArgTag tag, const void* value, int bytes) {
+        if (size + 1 + bytes > PAYLOAD) {
+            return;             // 放不下的参数丢弃，格式化时原样输出说明符
+        }
+        payload[size] = tag;
+        memcpy(payload + size + 1, value, bytes);
+        size = (uint16_t)(size + 1 + bytes);
+        ++argc;
+    }
+
+    void PutString(const char* s) {
+        if (!s) s = "(null)";
+        int room = PAYLOAD - size - 3;
+        if (room < 0) {
+            return;
+        }
+        size_t len = strlen(s);
+        uint16_t n = (uint16_t)(len < (size_t)room ? len : (size_t)room);
+        payload[size] = ARG_STRING;
+        memcpy(payload + size + 1, &n, 2);
+        memcpy(payload + size + 3, s, n);
+        size = (uint16_t)(size + 3 + n);
+        ++argc;
+    }
+
+    template <typename T>
+    void Put(const T& value) {
+        typedef typename std::decay<T>::type U;
+        if constexpr (std::is_same<U, char*>::value || std::is_same<U, const char*>::value) {
+            PutString(value);
+        } else if constexpr (std::is_floating_point<U>::value) {
+            double v = (double)value;
+            PutRaw(ARG_DOUBLE, &v, 8);
+        } else if constexpr (std::is_enum<U>::value) {
+            int64_t v = (int64_t)value;
+            PutRaw(ARG_INT, &v, 8);
+        } else if constexpr (std::is_integral<U>::value && std::is_signed<U>::value) {
+            int64_t v = (int64_t)value;
+            PutRaw(ARG_INT, &v, 8);
+        } else if constexpr (std::is_integral<U>::value) {
+            uint64_t v = (uint64_t)value;
+            PutRaw(ARG_UINT, &v, 8);
+        } else if constexpr (std::is_pointer<U>::value || std::is_null_pointer<U>::value) {
+            uint64_t v = (uint64_t)(uintptr_t)value;
+            PutRaw(ARG_POINTER, &v, 8);
+        } else {
+            static_assert(std::is_arithmetic<U>::value, "日志参数只支持数值、指针与C字符串");
+        }
+    }
+};
+
+extern std::atomic<int> g_level;
+
+/// @brief 申请一个空记录（缓冲满返回nullptr并计入丢弃数），填写后须 Commit
+LogRecord* Claim(LogLevel level, const char* fmt, uint64_t& ticket);
+void Commit(LogRecord* record, uint64_t ticket);
+
+inline bool Enabled(LogLevel level) {
+    return (int)level <= g_level.load(std::memory_order_relaxed) && level != LogLevel::LOG_OFF;
+}
+
+template <typename... Args>
+inline void Submit(LogLevel level, const char* fmt, const Args&... args) {
+    if (!Enabled(level)) {
+        return;
+    }
+    uint64_t ticket;
+    LogRecord* record = Claim(level, fmt, ticket);
+    if (record) {
+        (record->Put(args), ...);
+        Commit(record, ticket);
+    }
+}
+
+} // namespace log_detail
+
 } // namespace chan
 
 // ============================================================================
 // 便捷宏定义
 // ============================================================================
 
-#ifdef _DEBUG
-    #define CHAN_LOG_ERROR(fmt, ...) chan::LogError(fmt, ##__VA_ARGS__)
-    #define CHAN_LOG_WARN(fmt, ...)  chan::LogWarn(fmt, ##__VA_ARGS__)
-    #define CHAN_LOG_INFO(fmt, ...)  chan::LogInfo(fmt, ##__VA_ARGS__)
-    #define CHAN_LOG_DEBUG(fmt, ...) chan::LogDebug(fmt, ##__VA_ARGS__)
+#define CHAN_LOG_AT(level, fmt, ...) \
+    chan::log_detail::Submit(chan::LogLevel::level, fmt, ##__VA_ARGS__)
+
+#if CHAN_LOG_COMPILE_LEVEL >= 1
+    #define CHAN_LOG_ERROR(fmt, ...) CHAN_LOG_AT(LOG_ERROR, fmt, ##__VA_ARGS__)
+#else
+    #define CHAN_LOG_ERROR(fmt, ...) ((void)0)
+#endif
+
+#if CHAN_LOG_COMPILE_LEVEL >= 2
+    #define CHAN_LOG_WARN(fmt, ...)  CHAN_LOG_AT(LOG_WARN, fmt, ##__VA_ARGS__)
+#else
+    #define CHAN_LOG_WARN(fmt, ...)  ((void)0)
+#endif
+
+#if CHAN_LOG_COMPILE_LEVEL >= 3
+    #define CHAN_LOG_INFO(fmt, ...)  CHAN_LOG_AT(LOG_INFO, fmt, ##__VA_ARGS__)
 #else
-    #define CHAN_LOG_ERROR(fmt, ...) chan::LogError(fmt, ##__VA_ARGS__)
-    #define CHAN_LOG_WARN(fmt, ...)  chan::LogWarn(fmt, ##__VA_ARGS__)
     #define CHAN_LOG_INFO(fmt, ...)  ((void)0)
+#endif
+
+#if CHAN_LOG_COMPILE_LEVEL >= 4
+    #define CHAN_LOG_DEBUG(fmt, ...) CHAN_LOG_AT(LOG_DEBUG, fmt, ##__VA_ARGS__)
+#else
     #define CHAN_LOG_DEBUG(fmt, ...) ((void)0)
 #endif
 
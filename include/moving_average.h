@@ -0,0 +1,93 @@
+#pragma once
+// ============================================================================
+// 缠论通达信DLL插件 - 滑动窗口均线
+// ============================================================================
+// 一次遍历收盘价同时计算多个周期的简单移动平均，每根K线 O(周期数)
+// 窗口和以 double + Kahan 补偿累加，长序列滚动不累积误差
+// 仅含内联函数，chan.dll 与 chan_std.dll 共用
+// ============================================================================
+
+#ifndef MOVING_AVERAGE_H
+#define MOVING_AVERAGE_H
+
+#include <vector>
+
+namespace chan {
+
+/// @brief 单次调用最多计算的均线周期数
+const int MAX_MA_PERIODS = 8;
+
+/// @brief 一次遍历计算多个周期的简单移动平均线
+/// @param closes 收盘价数组
+/// @param start 从该K线开始写入结果（之前的结果保留，用于增量更新）
+/// @param count K线数量
+/// @param periods 均线周期数组，<1 的周期按1处理
+/// @param period_count 周期数量（不超过 MAX_MA_PERIODS）
+/// @param outs 输出数组，outs[k] 长度至少为 count
+/// @note 不足一个周期的K线输出收盘价本身（与原 CalcMA 一致）
+inline void CalcMovingAverages(const float* closes, int start, int count,
+                               const int* periods, int period_count, float* const* outs) {
+    if (!closes || count <= 0 || period_count <= 0) {
+        return;
+    }
+    if (period_count > MAX_MA_PERIODS) {
+        period_count = MAX_MA_PERIODS;
+    }
+    if (start < 0) {
+        start = 0;
+    }
+
+    int p[MAX_MA_PERIODS];
+    int from[MAX_MA_PERIODS];      // 各周期开始累加的位置
+    double sum[MAX_MA_PERIODS];
+    double comp[MAX_MA_PERIODS];   // Kahan 补偿项
+    int max_period = 1;
+    for (int k = 0; k < period_count; ++k) {
+        p[k] = periods[k] < 1 ? 1 : periods[k];
+        sum[k] = 0.0;
+        comp[k] = 0.0;
+        // 从 start 之前一个周期处开始累加，预热窗口
+        from[k] = start - p[k] + 1 > 0 ? start - p[k] + 1 : 0;
+        if (p[k] > max_period) {
+            max_period = p[k];
+        }
+    }
+
+    int first = start - max_period + 1;
+    if (first < 0) {
+        first = 0;
+    }
+
+    for (int i = first; i < count; ++i) {
+        for (int k = 0; k < period_count; ++k) {
+            if (i < from[k]) {
+                continue;
+            }
+            // 两个 float 之差在 double 中精确表示
+            double delta = (double)closes[i];
+            if (i - p[k] >= from[k]) {
+                delta -= (double)closes[i - p[k]];
+            }
+            double y = delta - comp[k];
+            double t = sum[k] + y;
+            comp[k] = (t - sum[k]) - y;
+            sum[k] = t;
+
+            if (i >= start) {
+                outs[k][i] = (i < p[k] - 1) ? closes[i] : (float)(sum[k] / p[k]);
+            }
+        }
+    }
+}
+
+/// @brief 计算单个周期的简单移动平均线（从 start 开始重算，之前的结果保留）
+inline void CalcMovingAverage(const float* closes, int start, int count, int period,
+                              std::vector<float>& ma) {
+    ma.resize(count > 0 ? count : 0);
+    float* out = ma.data();
+    CalcMovingAverages(closes, start, count, &period, 1, &out);
+}
+
+} // namespace chan
+
+#endif // MOVING_AVERAGE_H
@@ -0,0 +1,126 @@
+#pragma once
+// ============================================================================
+// 缠论通达信DLL插件 - 多周期联立分析（区间套）
+// ============================================================================
+// 只输入1分钟K线，内部按A股交易时段聚合出 5/15/30/60 分钟与日线，
+// 各周期各用一个 ChanCore：
+//   - 批量载入时先聚合出各周期K线，再逐周期完整分析一次
+//   - 此后每根新1分钟K线对各周期只做一次 AppendBar（新周期K线开始）
+//     或 UpdateLastBar（并入当前周期K线），均摊O(1)
+//   - 各周期记录每根K线的第一根1分钟K线下标（单调递增），
+//     跨周期定位（低级别信号落在高级别哪根K线、哪一笔中）二分查找 O(log n)
+// ============================================================================
+
+#ifndef MULTI_LEVEL_H
+#define MULTI_LEVEL_H
+
+#include "chan_core.h"
+#include <vector>
+
+namespace chan {
+
+/// @brief 联立分析的周期
+enum class Timeframe {
+    M1 = 0,         // 1分钟
+    M5,             // 5分钟
+    M15,            // 15分钟
+    M30,            // 30分钟
+    M60,            // 60分钟
+    DAY,            // 日线
+    COUNT
+};
+
+/// @brief 周期的分钟数（日线返回0）
+int TimeframeMinutes(Timeframe tf);
+
+/// @brief A股交易时段内的分钟序号
+/// @param time 1分钟K线的结束时刻，距0点的分钟数（如 9:31 为 571）
+/// @return 1~240：上午 9:31-11:30 为 1~120，下午 13:01-15:00 为 121~240；
+///         集合竞价并入第一分钟，午间休市并入上午最后一分钟，收盘后并入最后一分钟
+int ASessionMinute(int time);
+
+// ============================================================================
+// 多周期联立分析器
+// ============================================================================
+
+class MultiLevelAnalyzer {
+public:
+    explicit MultiLevelAnalyzer(const ChanConfig& config = ChanConfig());
+
+    /// @brief 设置分析参数（各周期相同），下次更新生效
+    void SetConfig(const ChanConfig& config);
+    const ChanConfig& GetConfig() const { return m_config; }
+
+    /// @brief 清除全部K线与分析结果
+    void Clear();
+
+    /// @brief 载入1分钟K线历史（替换已有数据）
+    /// @param dates 日期（YYYYMMDD）
+    /// @param times 结束时刻（距0点的分钟数，同 TdxBars::times）
+    /// @param closes 可为nullptr（以 (high+low)/2 代替）
+    /// @param volumes 可为nullptr
+    /// @return 成功返回0；参数无效或时间不递增返回-1
+    int Analyze(const int* dates, const int* times, const float* highs, const float* lows,
+                const float* closes, const float* volumes, int count);
+
+    /// @brief 追加一根1分钟K线，各周期增量更新
+    /// @return 成功返回0，时间不晚于上一根返回-1
+    int AppendMinuteBar(int date, int time, float high, float low, float close, float volume);
+
+    /// @brief 修改最后一根1分钟K线（盘中刷新），各周期增量更新
+    /// @return 成功返回0，尚无K线时返回-1
+    int UpdateLastMinuteBar(float high, float low, float close, float volume);
+
+    /// @brief 指定周期的分析结果
+    const ChanCore& Core(Timeframe tf) const { return m_levels[(int)tf].core; }
+
+    /// @brief 指定周期的K线数量
+    int GetBarCount(Timeframe tf) const;
+
+    /// @brief 指定周期第 bar 根K线的第一根1分钟K线下标，越界返回-1
+    int GetFirstMinute(Timeframe tf, int bar) const;
+
+    /// @brief 跨周期定位：from 周期第 bar 根K线开始时刻所在的 to 周期K线
+    /// @return to 周期K线下标，越界返回-1
+    /// @note 二分查找 O(log n)；to 为更低级别时返回 from K线内的第一根
+    int MapBar(Timeframe from, int bar, Timeframe to) const;
+
+    /// @brief 包含 from 周期第 bar 根K线的 to 周期笔
+    /// @return 笔下标（落在笔端点上时取以该K线为起点的笔），不在任何笔内返回-1
+    int FindContainingStroke(Timeframe from, int bar, Timeframe to) const;
+
+private:
+    // 单个周期：分析状态与当前K线的聚合值
+    struct Level {
+        ChanCore core;
+        int period;                     // 分钟数（0=日线）
+        std::vector<int> first_minute;  // 每根K线的第一根1分钟K线下标
+        int date;                       // 当前K线所属日期与时段分组
+        int bucket;
+        float high;                     // 当前K线聚合值
+        float low;
+        float close;
+        float volume;
+        bool has_prev;                  // 当前K线除最后一根1分钟K线外的聚合值
+        float prev_high;
+        float prev_low;
+        float prev_volume;
+
+        /// @brief 并入一根1分钟K线，返回是否开始了新K线
+        bool Merge(int minute, int d, int time, float h, float l, float c, float v);
+        /// @brief 以新价格重新并入最后一根1分钟K线
+        void RemergeLast(float h, float l, float c, float v);
+    };
+
+    bool IsAfterLast(int date, int time) const;
+
+    ChanConfig m_config;
+    Level m_levels[(int)Timeframe::COUNT];
+    int m_minute_count;
+    int m_last_date;                    // 最后一根1分钟K线的时间
+    int m_last_time;
+};
+
+} // namespace chan
+
+#endif // MULTI_LEVEL_H
@@ -0,0 +1,185 @@
+#pragma once
+// ============================================================================
+// 缠论通达信DLL插件 - 运行时性能计数器
+// ============================================================================
+// 生产环境常开的轻量计数：每个导出函数/处理阶段一个槽位，记录
+//   调用次数、缓存命中/未命中、冗余调用（同一函数在短时间内收到相同数据）、
+//   累计耗时与延迟直方图（p50/p99/max）
+// 记录路径只有原子加法（relaxed），无锁无分配；直方图按2的幂分组、
+// 每组8个子桶，分位数相对误差不超过12.5%
+// ============================================================================
+
+#ifndef PERF_COUNTERS_H
+#define PERF_COUNTERS_H
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <string>
+
+namespace chan {
+
+// ============================================================================
+// 延迟直方图
+// ============================================================================
+
+class LatencyHistogram {
+public:
+    static const int SUB_BITS = 3;                          // 每组 2^3 个子桶
+    static const int SUB_COUNT = 1 << SUB_BITS;
+    static const int BUCKET_COUNT = (64 - SUB_BITS + 1) * SUB_COUNT;
+
+    LatencyHistogram();
+
+    /// @brief 记录一次耗时（纳秒），可多线程并发调用
+    void Record(uint64_t ns);
+
+    /// @brief 分位数（0~1），返回所在桶的上界（不超过最大值）；无样本返回0
+    uint64_t Percentile(double q) const;
+
+    uint64_t Count() const { return m_count.load(std::memory_order_relaxed); }
+    uint64_t Sum() const { return m_sum.load(std::memory_order_relaxed); }
+    uint64_t Max() const { return m_max.load(std::memory_order_relaxed); }
+
+    void Reset();
+
+    /// @brief 数值所在桶号及桶的取值范围 [lower, upper]
+    static int BucketIndex(uint64_t ns);
+    static uint64_t BucketLower(int index);
+    static uint64_t BucketUpper(int index);
+
+private:
+    std::atomic<uint64_t> m_buckets[BUCKET_COUNT];
+    std::atomic<uint64_t> m_count;
+    std::atomic<uint64_t> m_sum;
+    std::atomic<uint64_t> m_max;
+};
+
+// ============================================================================
+// 计数器注册表
+// ============================================================================
+
+/// @brief 槽位类型
+enum class PerfKind {
+    EXPORT = 0,     // 导出函数（一次完整调用）
+    STAGE = 1       // 处理阶段（调用内部的一段）
+};
+
+/// @brief 槽位统计快照（POD，可直接跨DLL边界复制）
+struct PerfStat {
+    char name[32];
+    int kind;                   // PerfKind
+    uint64_t calls;
+    uint64_t cache_hits;
+    uint64_t cache_misses;
+    uint64_t redundant;         // 冗余调用次数
+    double total_us;
+    double mean_us;
+    double p50_us;
+    double p99_us;
+    double max_us;
+};
+
+class PerfRegistry {
+public:
+    static const int MAX_SLOTS = 64;
+
+    /// @param redundant_window_ms 相同数据的重复调用在此时间窗内视为冗余
+    explicit PerfRegistry(int redundant_window_ms = 1000);
+
+    PerfRegistry(const PerfRegistry&) = delete;
+    PerfRegistry& operator=(const PerfRegistry&) = delete;
+
+    /// @brief 注册槽位，同名返回已有槽位；槽位用尽返回-1
+    /// @note 只应在初始化阶段调用（不与记录并发）
+    int Register(const char* name, PerfKind kind);
+    int Find(const char* name) const;
+    int GetSlotCount() const { return m_slot_count.load(std::memory_order_acquire); }
+
+    /// @brief 开关（关闭后记录函数直接返回，计时器不取时间）
+    void SetEnabled(bool enabled) { m_enabled.store(enabled, std::memory_order_relaxed); }
+    bool IsEnabled() const { return m_enabled.load(std::memory_order_relaxed); }
+
+    void SetRedundantWindowMs(int ms) { m_window_ns.store((uint64_t)ms * 1000000ull); }
+
+    // ---- 记录（线程安全，无锁） ----
+
+    void RecordLatency(int slot, uint64_t ns);
+    void RecordCache(int slot, bool hit);
+
+    /// @brief 以数据指纹检测冗余调用：与该槽位上次调用的指纹相同且间隔在时间窗内
+    /// @return 是否冗余
+    bool CheckRedundant(int slot, uint64_t data_key, uint64_t now_ns);
+
+    // ---- 读取 ----
+
+    /// @brief 复制各槽位快照
+    /// @return 槽位总数（可能大于 capacity，只复制前 capacity 个）
+    int Snapshot(PerfStat* out, int capacity) const;
+
+    /// @brief 文本报表（按累计耗时降序）
+    std::string Format() const;
+
+    /// @brief 写出报表到文件
+    bool DumpToFile(const std::string& path) const;
+
+    /// @brief 清零全部计数（槽位保留）
+    void Reset();
+
+    /// @brief 单调时钟（纳秒）
+    static uint64_t NowNs() {
+        return (uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now().time_since_epoch()).count();
+    }
+
+private:
+    struct Slot {
+        char name[32];
+        PerfKind kind;
+        std::atomic<uint64_t> cache_hits;
+        std::atomic<uint64_t> cache_misses;
+        std::atomic<uint64_t> redundant;
+        std::atomic<uint64_t> last_key;
+        std::atomic<uint64_t> last_time_ns;
+        LatencyHistogram latency;
+
+        Slot();
+    };
+
+    void FillStat(int slot, PerfStat& stat) const;
+
+    Slot m_slots[MAX_SLOTS];
+    std::atomic<int> m_slot_count;
+    std::atomic<bool> m_enabled;
+    std::atomic<uint64_t> m_window_ns;
+};
+
+/// @brief 作用域计时：析构时记录耗时到槽位
+class PerfTimer {
+public:
+    PerfTimer(PerfRegistry& registry, int slot)
+        : m_registry(registry)
+        , m_slot(slot)
+        , m_start(slot >= 0 && registry.IsEnabled() ? PerfRegistry::NowNs() : 0) {}
+
+    ~PerfTimer() {
+        if (m_start != 0) {
+            m_registry.RecordLatency(m_slot, PerfRegistry::NowNs() - m_start);
+        }
+    }
+
+    /// @brief 计时开始时刻（未计时为0），冗余检测复用，避免再取一次时间
+    uint64_t StartNs() const { return m_start; }
+
+    PerfTimer(const PerfTimer&) = delete;
+    PerfTimer& operator=(const PerfTimer&) = delete;
+
+private:
+    PerfRegistry& m_registry;
+    int m_slot;
+    uint64_t m_start;
+};
+
+} // namespace chan
+
+#endif // PERF_COUNTERS_H
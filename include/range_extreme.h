@@ -0,0 +1,87 @@
+#pragma once
+// ============================================================================
+// 缠论通达信DLL插件 - 原始K线区间极值索引
+// ============================================================================
+// 任意区间 [first, last] 的最高价/最低价及其K线下标，查询 O(1)：
+//   - K线按32根分块，块内每根K线记录以它结尾的单调栈位图
+//     （栈中为其后再无更高/更低K线的位置），块内区间查询取位图最低置位
+//   - 整块之间用稀疏表：第 k 层第 j 项为第 j~j+2^k-1 块的极值下标，
+//     两段重叠覆盖任意块区间
+// 内存 O(N)（每根K线两个位图，每块 O(log N) 项），批量构建 O(N)；
+// 追加/修改最后一根K线只更新其位图与以最后一块结尾的各层各一项，O(log N)。
+// 并列极值取最早的K线。
+// ============================================================================
+
+#ifndef RANGE_EXTREME_H
+#define RANGE_EXTREME_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace chan {
+
+class RangeExtremeIndex {
+public:
+    /// @brief 每块K线数（位图宽度）
+    static const int BLOCK = 32;
+
+    RangeExtremeIndex() {}
+
+    /// @brief 清空（保留容量）
+    void Clear();
+
+    /// @brief 由高低价数组批量构建（替换已有数据）
+    void Build(const float* highs, const float* lows, int count);
+
+    /// @brief 追加一根K线
+    void Append(float high, float low);
+
+    /// @brief 修改最后一根K线（盘中刷新），无K线时忽略
+    void UpdateLast(float high, float low);
+
+    int Count() const { return (int)m_high.size(); }
+    float High(int i) const { return m_high[i]; }
+    float Low(int i) const { return m_low[i]; }
+
+    /// @brief [first, last] 内最高价所在K线（含两端，并列取最早），区间无效返回-1
+    int ArgMax(int first, int last) const;
+
+    /// @brief [first, last] 内最低价所在K线（含两端，并列取最早），区间无效返回-1
+    int ArgMin(int first, int last) const;
+
+    /// @brief 占用的内存字节数（容量）
+    size_t MemoryBytes() const;
+
+private:
+    // 一侧（最高价或最低价）的位图与块稀疏表
+    struct Side {
+        std::vector<uint32_t> mask;             // 每根K线的块内单调栈位图
+        std::vector<std::vector<int>> table;    // table[k][j]：第 j~j+2^k-1 块的极值下标
+        int levels;                             // 使用中的层数
+        
+        Side() : levels(0) {}
+    };
+
+    // MAX 侧 a 严格优于 b 指 a > b，MIN 侧指 a < b
+    template <bool MAX>
+    static bool Better(float a, float b) { return MAX ? a > b : a < b; }
+
+    template <bool MAX>
+    void PushMask(Side& side, const std::vector<float>& value, int i);
+    template <bool MAX>
+    void RefreshLastBlock(Side& side, const std::vector<float>& value);
+    template <bool MAX>
+    void BuildTable(Side& side, const std::vector<float>& value);
+    template <bool MAX>
+    int Query(const Side& side, const std::vector<float>& value, int first, int last) const;
+
+    std::vector<float> m_high;
+    std::vector<float> m_low;
+    Side m_max;
+    Side m_min;
+};
+
+} // namespace chan
+
+#endif // RANGE_EXTREME_H
@@ -0,0 +1,136 @@
+#pragma once
+// ============================================================================
+// 缠论通达信DLL插件 - 通达信本地数据文件读取
+// ============================================================================
+// 直接读取通达信 vipdoc 目录下的定长记录文件，不经过CSV导出：
+//   lday/*.day   日线，每条32字节：
+//                uint32 日期(YYYYMMDD), uint32 开/高/低/收(价格x100), float 成交额,
+//                uint32 成交量, uint32 保留
+//   minline/*.lc1, fzline/*.lc5  1分钟/5分钟线，每条32字节：
+//                uint16 日期, uint16 分钟数, float 开/高/低/收, float 成交额,
+//                uint32 成交量, uint32 保留
+//                日期编码：年 = d/2048 + 2004，月 = (d%2048)/100，日 = (d%2048)%100
+// 文件以内存映射方式打开，记录逐块转置解码（SSE2一次4条）直接写入
+// ChanCore::Analyze 使用的 highs/lows/closes/volumes 数组，没有中间缓冲
+// ============================================================================
+
+#ifndef TDX_DATA_READER_H
+#define TDX_DATA_READER_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace chan {
+
+/// @brief 通达信数据文件记录长度（字节）
+const int TDX_RECORD_SIZE = 32;
+
+/// @brief 通达信数据文件类型
+enum class TdxFileType {
+    UNKNOWN = 0,
+    DAY,            // .day 日线
+    LC1,            // .lc1 1分钟线
+    LC5             // .lc5 5分钟线
+};
+
+/// @brief 按扩展名判断文件类型（不区分大小写）
+TdxFileType DetectTdxFileType(const std::string& path);
+
+// ============================================================================
+// 内存映射文件
+// ============================================================================
+
+/// @brief 只读内存映射文件
+class MappedFile {
+public:
+    MappedFile();
+    ~MappedFile();
+
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    /// @brief 映射整个文件，失败返回false（空文件成功，size()为0）
+    bool Open(const std::string& path);
+    void Close();
+
+    const unsigned char* data() const { return m_data; }
+    size_t size() const { return m_size; }
+
+private:
+    const unsigned char* m_data;
+    size_t m_size;
+#ifdef _WIN32
+    void* m_file;
+    void* m_mapping;
+#else
+    int m_fd;
+#endif
+};
+
+// ============================================================================
+// 记录解码
+// ============================================================================
+
+/// @brief 解码输出（列数组），不需要的列传nullptr
+struct TdxColumns {
+    float* opens;
+    float* highs;
+    float* lows;
+    float* closes;
+    float* volumes;
+    int* dates;         // YYYYMMDD
+    int* times;         // 距0点的分钟数（日线为0）
+
+    TdxColumns()
+        : opens(nullptr), highs(nullptr), lows(nullptr), closes(nullptr)
+        , volumes(nullptr), dates(nullptr), times(nullptr) {}
+};
+
+/// @brief 解码 count 条记录到列数组
+/// @param records 记录起始地址（无对齐要求）
+/// @param type 文件类型（决定价格与日期的编码）
+/// @param price_scale 日线整数价格的换算系数（股票0.01，基金/债券通常0.001），分钟线忽略
+/// @param simd 是否使用SSE2路径（不支持时自动退回标量），结果与标量路径逐位一致
+void DecodeTdxRecords(const void* records, int count, TdxFileType type, float price_scale,
+                      const TdxColumns& out, bool simd = true);
+
+/// @brief 分钟线日期编码转换为 YYYYMMDD
+inline int DecodeTdxMinuteDate(uint16_t packed) {
+    int year = packed / 2048 + 2004;
+    int md = packed % 2048;
+    return year * 10000 + (md / 100) * 100 + md % 100;
+}
+
+// ============================================================================
+// 文件加载
+// ============================================================================
+
+/// @brief 通达信K线数据（列存储，可直接传给 ChanCore::Analyze）
+struct TdxBars {
+    std::vector<float> opens;
+    std::vector<float> highs;
+    std::vector<float> lows;
+    std::vector<float> closes;
+    std::vector<float> volumes;
+    std::vector<int> dates;
+    std::vector<int> times;
+    std::vector<int> offsets;       // 多文件加载时各文件的起始下标，共 文件数+1 个
+
+    int Count() const { return (int)highs.size(); }
+    void Clear();
+};
+
+/// @brief 加载单个通达信数据文件（类型按扩展名判断）
+/// @return 成功返回true；文件长度不是32字节整数倍时末尾不完整的记录被忽略
+bool LoadTdxFile(const std::string& path, TdxBars& bars, float price_scale = 0.01f);
+
+/// @brief 依次加载多个文件到同一组列数组，bars.offsets 划分各文件
+/// @return 成功加载的文件数；无法打开或类型未知的文件记为空区间
+/// @note 先映射全部文件统计记录数，一次分配后逐文件解码，输出可直接作为 BatchInput
+int LoadTdxFiles(const std::vector<std::string>& paths, TdxBars& bars, float price_scale = 0.01f);
+
+} // namespace chan
+
+#endif // TDX_DATA_READER_H
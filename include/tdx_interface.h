@@ -7,6 +7,7 @@
 #define TDX_INTERFACE_H
 
 #include <windows.h>
+#include "perf_counters.h"
 
 // ============================================================================
 // 通达信插件接口定义
@@ -32,6 +33,9 @@ typedef void (__stdcall *PluginTCalcFunc)(
     float* pParam
 );
 
+// 性能计数快照（与 chan::PerfStat 相同的POD布局）
+typedef chan::PerfStat ChanPerfStat;
+
 // 函数信息结构体
 #pragma pack(push, 1)
 struct PluginTCalcFuncInfo {
@@ -56,8 +60,31 @@ extern "C" {
     // 参数: ppInfo - 返回函数信息数组指针
     //       pCount - 返回函数数量
     __declspec(dllexport) void __stdcall RegisterTdxFunc(PluginTCalcFuncInfo** ppInfo, int* pCount);
+    
+    // 分析缓存统计 - 供诊断工具查询缓存效果
+    // 参数: pHits    - 返回命中次数
+    //       pMisses  - 返回未命中次数（执行了完整分析）
+    //       pEntries - 返回当前缓存的分析实例数
+    __declspec(dllexport) void __stdcall GetChanCacheStats(int* pHits, int* pMisses, int* pEntries);
+    
+    // 性能计数快照 - 每个导出函数与处理阶段一项（调用数、命中/未命中、冗余调用、
+    //                  累计/平均/p50/p99/最大耗时）
+    // 参数: pStats    - 输出数组，可为NULL（只查询数量）
+    //       nCapacity - 数组容量
+    // 返回: 槽位总数（大于 nCapacity 时只填充前 nCapacity 项）
+    __declspec(dllexport) int __stdcall GetChanPerfStats(ChanPerfStat* pStats, int nCapacity);
+    
+    // 写出性能报表（追加），pPath 为 NULL 时写到DLL目录下的 chan_perf.txt
+    // 返回: 1=成功, 0=失败
+    __declspec(dllexport) int __stdcall DumpChanPerfStats(const char* pPath);
+    
+    // 清零性能计数
+    __declspec(dllexport) void __stdcall ResetChanPerfStats();
 }
 
+// DLL卸载时写出性能报表（有调用记录且未禁用计数时），由 DllMain 调用
+void ChanPerfDumpOnUnload();
+
 // ============================================================================
 // 计算函数声明
 // ============================================================================
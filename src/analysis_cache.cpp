@@ -0,0 +1,274 @@
+// ============================================================================
+// 缠论通达信DLL插件 - 分析结果缓存实现
+// ============================================================================
+
+#include "analysis_cache.h"
+#include "logger.h"
+#include <cstring>
+#include <iterator>
+
+namespace chan {
+
+// ============================================================================
+// 数据指纹
+// ============================================================================
+
+DataFingerprint MakeFingerprint(const float* highs, const float* lows, int count,
+                                const float* closes) {
+    DataFingerprint fp;
+    if (!highs || !lows || count <= 0) {
+        return fp;
+    }
+    fp.count = count;
+    fp.hash = HashFloatArray(highs, count);
+    fp.hash = (fp.hash ^ HashFloatArray(lows, count)) * 0x100000001B3ull;
+    if (closes) {
+        fp.hash = (fp.hash ^ HashFloatArray(closes, count)) * 0x100000001B3ull;
+    }
+    return fp;
+}
+
+// ============================================================================
+// 分析会话
+// ============================================================================
+
+AnalysisSession::AnalysisSession()
+    : m_count(0)
+    , m_bi_sequence_ready(false) {
+    for (int i = 0; i < (int)SessionSignal::COUNT; ++i) {
+        m_signal_ready[i] = false;
+    }
+}
+
+void AnalysisSession::Analyze(const float* highs, const float* lows,
+                              const float* closes, const float* volumes, int count,
+                              const ChanConfig& config) {
+    m_core.SetConfig(config);
+    m_core.Analyze(highs, lows, closes, volumes, count);
+    m_core.ComputeMAData(closes, count);
+    m_count = count;
+    
+    // 延迟生成的结果全部失效
+    m_bi_sequence_ready = false;
+    for (int i = 0; i < (int)SessionSignal::COUNT; ++i) {
+        m_signal_ready[i] = false;
+    }
+}
+
+void AnalysisSession::EnsureBiSequence() {
+    if (!m_bi_sequence_ready) {
+        m_core.BuildBiSequence(m_count - 1);
+        m_bi_sequence_ready = true;
+    }
+}
+
+bool AnalysisSession::HasSignal(SessionSignal kind) const {
+    int k = (int)kind;
+    return k >= 0 && k < (int)SessionSignal::COUNT && m_signal_ready[k];
+}
+
+const std::vector<float>& AnalysisSession::GetSignal(SessionSignal kind,
+                                                      const float* highs, const float* lows) {
+    int k = (int)kind;
+    if (m_signal_ready[k]) {
+        return m_signals[k];
+    }
+    
+    EnsureBiSequence();
+    
+    // 全部买卖条件只评估一次，各信号输出由位图投影
+    if (!m_core.HasSignalTable()) {
+        m_core.BuildSignalTable(highs, lows, m_count);
+    }
+    
+    std::vector<float>& out = m_signals[k];
+    out.resize(m_count);
+    m_core.ProjectSignal(kind, out.data(), m_count);
+    m_signal_ready[k] = true;
+    return out;
+}
+
+// ============================================================================
+// 分析结果缓存
+// ============================================================================
+
+AnalysisCache::AnalysisCache(int capacity_bars, int max_entries)
+    : m_capacity_bars(capacity_bars)
+    , m_max_entries(max_entries)
+    , m_cached_bars(0)
+    , m_hits(0)
+    , m_misses(0)
+    , m_evictions(0)
+    , m_last_key(0)
+    , m_last_hit(false) {
+}
+
+void AnalysisCache::SetCapacity(int capacity_bars) {
+    m_capacity_bars = capacity_bars;
+    EvictToCapacity();
+}
+
+void AnalysisCache::SetMaxEntries(int max_entries) {
+    m_max_entries = max_entries;
+    EvictToCapacity();
+}
+
+uint64_t AnalysisCache::MakeKey(const DataFingerprint& fp, const ChanConfig& config) {
+    uint64_t key = fp.hash ^ ((uint64_t)(uint32_t)fp.count << 32);
+    const int fields[12] = {
+        config.min_bi_len,
+        config.min_fx_distance,
+        config.min_zs_bi_count,
+        config.strict_bi ? 1 : 0,
+        config.enable_like_signals ? 1 : 0,
+        config.enable_pre_signals ? 1 : 0,
+        config.ma_short_period,
+        config.ma_long_period,
+        config.macd_fast,
+        config.macd_slow,
+        config.macd_signal,
+        config.range_index ? 1 : 0
+    };
+    for (int f : fields) {
+        key = (key ^ (uint32_t)f) * 0x100000001B3ull;
+    }
+    return key;
+}
+
+bool AnalysisCache::SameConfig(const ChanConfig& a, const ChanConfig& b) {
+    return a.min_bi_len == b.min_bi_len &&
+           a.min_fx_distance == b.min_fx_distance &&
+           a.min_zs_bi_count == b.min_zs_bi_count &&
+           a.strict_bi == b.strict_bi &&
+           a.enable_like_signals == b.enable_like_signals &&
+           a.enable_pre_signals == b.enable_pre_signals &&
+           a.ma_short_period == b.ma_short_period &&
+           a.ma_long_period == b.ma_long_period &&
+           a.macd_fast == b.macd_fast &&
+           a.macd_slow == b.macd_slow &&
+           a.macd_signal == b.macd_signal &&
+           a.range_index == b.range_index;
+}
+
+AnalysisSession* AnalysisCache::AcquireSession(const float* highs, const float* lows,
+                                               const float* closes, const float* volumes, int count,
+                                               const ChanConfig& config) {
+    if (!highs || !lows || count <= 0) {
+        CHAN_LOG_ERROR("AnalysisCache::AcquireSession: 输入参数无效");
+        return nullptr;
+    }
+
+    DataFingerprint fp = MakeFingerprint(highs, lows, count, closes);
+    uint64_t key = MakeKey(fp, config);
+    m_last_key = key;
+
+    auto found = m_index.find(key);
+    if (found != m_index.end()) {
+        auto it = found->second;
+        if (m_capacity_bars > 0 && it->fp == fp && SameConfig(it->config, config)) {
+            // 命中：移到LRU头部
+            m_entries.splice(m_entries.begin(), m_entries, it);
+            ++m_hits;
+            m_last_hit = true;
+            return it->session.get();
+        }
+
+        // 键冲突或缓存禁用：丢弃旧条目，复用其会话
+        m_cached_bars -= it->fp.count;
+        m_entries.splice(m_entries.begin(), m_entries, it);
+        RecycleIndexNode(found);
+    } else if (!m_spare.empty()) {
+        // 复用备用会话（保留上次分析的容器容量）
+        m_entries.splice(m_entries.begin(), m_spare, m_spare.begin());
+    } else {
+        m_entries.emplace_front();
+        m_entries.front().session.reset(new AnalysisSession());
+    }
+
+    ++m_misses;
+    m_last_hit = false;
+
+    Entry& entry = m_entries.front();
+    entry.fp = fp;
+    entry.config = config;
+    entry.key = key;
+    entry.session->Analyze(highs, lows, closes, volumes, count, config);
+    IndexFront(key);
+    m_cached_bars += count;
+
+    AnalysisSession* session = entry.session.get();
+    EvictToCapacity();
+    return session;
+}
+
+ChanCore* AnalysisCache::Acquire(const float* highs, const float* lows,
+                                 const float* closes, const float* volumes, int count,
+                                 const ChanConfig& config) {
+    AnalysisSession* session = AcquireSession(highs, lows, closes, volumes, count, config);
+    return session ? &session->Core() : nullptr;
+}
+
+// 备用会话数上限：逐个替换的稳态只需一个，多留一个应对一次淘汰多个
+static const size_t kMaxSpareSessions = 2;
+
+void AnalysisCache::EvictToCapacity() {
+    // 最近使用的会话始终保留
+    while (m_entries.size() > 1 &&
+           (m_cached_bars > m_capacity_bars ||
+            (m_max_entries > 0 && (int)m_entries.size() > m_max_entries))) {
+        const Entry& victim = m_entries.back();
+        m_cached_bars -= victim.fp.count;
+        RecycleIndexNode(m_index.find(victim.key));
+        if (m_spare.size() < kMaxSpareSessions) {
+            m_spare.splice(m_spare.begin(), m_entries, std::prev(m_entries.end()));
+        } else {
+            m_entries.pop_back();
+        }
+        ++m_evictions;
+    }
+}
+
+void AnalysisCache::IndexFront(uint64_t key) {
+    if (m_spare_nodes.empty()) {
+        m_index[key] = m_entries.begin();
+        return;
+    }
+    IndexMap::node_type node = std::move(m_spare_nodes.back());
+    m_spare_nodes.pop_back();
+    node.key() = key;
+    node.mapped() = m_entries.begin();
+    m_index.insert(std::move(node));
+}
+
+void AnalysisCache::RecycleIndexNode(IndexMap::iterator it) {
+    IndexMap::node_type node = m_index.extract(it);
+    if (m_spare_nodes.size() < kMaxSpareSessions) {
+        m_spare_nodes.push_back(std::move(node));
+    }
+}
+
+void AnalysisCache::Clear() {
+    m_entries.clear();
+    m_index.clear();
+    m_spare.clear();
+    m_spare_nodes.clear();
+    m_cached_bars = 0;
+}
+
+CacheStats AnalysisCache::GetStats() const {
+    CacheStats stats;
+    stats.hits = m_hits;
+    stats.misses = m_misses;
+    stats.evictions = m_evictions;
+    stats.entries = (int)m_entries.size();
+    stats.cached_bars = m_cached_bars;
+    return stats;
+}
+
+void AnalysisCache::ResetStats() {
+    m_hits = 0;
+    m_misses = 0;
+    m_evictions = 0;
+}
+
+} // namespace chan
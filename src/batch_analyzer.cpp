@@ -0,0 +1,262 @@
+// ============================================================================
+// 缠论通达信DLL插件 - 多核批量分析实现
+// ============================================================================
+
+#include "batch_analyzer.h"
+#include "logger.h"
+#include <algorithm>
+#include <chrono>
+
+namespace chan {
+
+// ============================================================================
+// 线程池
+// ============================================================================
+
+ChanBatchAnalyzer::ChanBatchAnalyzer(int thread_count)
+    : m_input(nullptr)
+    , m_output(nullptr)
+    , m_remaining(0)
+    , m_generation(0)
+    , m_active(0)
+    , m_stop(false) {
+    if (thread_count <= 0) {
+        thread_count = (int)std::thread::hardware_concurrency();
+    }
+    if (thread_count <= 0) {
+        thread_count = 1;
+    }
+
+    for (int i = 0; i < thread_count; ++i) {
+        m_workers.emplace_back(new Worker());
+    }
+    // 0号工作者由调用线程担任
+    for (int i = 1; i < thread_count; ++i) {
+        m_workers[i]->thread = std::thread(&ChanBatchAnalyzer::ThreadMain, this, i);
+    }
+}
+
+ChanBatchAnalyzer::~ChanBatchAnalyzer() {
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_stop = true;
+    }
+    m_start_cv.notify_all();
+    for (auto& worker : m_workers) {
+        if (worker->thread.joinable()) {
+            worker->thread.join();
+        }
+    }
+}
+
+void ChanBatchAnalyzer::ThreadMain(int id) {
+    uint64_t seen = 0;
+    for (;;) {
+        {
+            std::unique_lock<std::mutex> lock(m_mutex);
+            m_start_cv.wait(lock, [&] { return m_stop || m_generation != seen; });
+            if (m_stop) {
+                return;
+            }
+            seen = m_generation;
+        }
+
+        Work(id);
+
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            --m_active;
+        }
+        m_done_cv.notify_one();
+    }
+}
+
+// ============================================================================
+// 批量分析
+// ============================================================================
+
+int ChanBatchAnalyzer::Run(const BatchInput& input, const BatchOutput& output) {
+    if (!input.highs || !input.lows || !input.offsets || input.series_count < 0) {
+        CHAN_LOG_ERROR("ChanBatchAnalyzer::Run: 输入参数无效");
+        return -1;
+    }
+    for (int s = 0; s < input.series_count; ++s) {
+        if (input.offsets[s] < 0 || input.offsets[s + 1] < input.offsets[s]) {
+            CHAN_LOG_ERROR("ChanBatchAnalyzer::Run: offsets 必须非负且不减");
+            return -1;
+        }
+    }
+    if (output.HasSignals() && !input.closes) {
+        CHAN_LOG_ERROR("ChanBatchAnalyzer::Run: 输出信号需要收盘价");
+        return -1;
+    }
+
+    auto t0 = std::chrono::steady_clock::now();
+
+    int threads = (int)m_workers.size();
+    int series_count = input.series_count;
+    int first_bar = series_count > 0 ? input.offsets[0] : 0;
+    int total_bars = series_count > 0 ? input.offsets[series_count] - first_bar : 0;
+
+    // 按K线数均分标的区间，区间长短不一时由窃取再平衡
+    int begin = 0;
+    for (int w = 0; w < threads; ++w) {
+        int end = series_count;
+        if (w + 1 < threads) {
+            int64_t target = first_bar + (int64_t)total_bars * (w + 1) / threads;
+            end = (int)(std::lower_bound(input.offsets, input.offsets + series_count,
+                                         (int)target) - input.offsets);
+            end = std::max(end, begin);
+        }
+        Worker& worker = *m_workers[w];
+        worker.range.store(PackRange(begin, end), std::memory_order_relaxed);
+        worker.steals = 0;
+        worker.core.SetConfig(m_config);
+        begin = end;
+    }
+
+    m_input = &input;
+    m_output = &output;
+    m_remaining.store(series_count);
+
+    if (threads > 1) {
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_active = threads - 1;
+            ++m_generation;
+        }
+        m_start_cv.notify_all();
+    }
+
+    Work(0);
+
+    if (threads > 1) {
+        std::unique_lock<std::mutex> lock(m_mutex);
+        m_done_cv.wait(lock, [&] { return m_active == 0; });
+    }
+
+    m_input = nullptr;
+    m_output = nullptr;
+
+    m_stats.series = series_count;
+    m_stats.bars = total_bars;
+    m_stats.threads = threads;
+    m_stats.steals = 0;
+    for (auto& worker : m_workers) {
+        m_stats.steals += worker->steals;
+    }
+    m_stats.elapsed_us = std::chrono::duration_cast<std::chrono::microseconds>(
+        std::chrono::steady_clock::now() - t0).count();
+    return series_count;
+}
+
+bool ChanBatchAnalyzer::PopFront(Worker& worker, int& series) {
+    uint64_t cur = worker.range.load(std::memory_order_acquire);
+    for (;;) {
+        int b = RangeBegin(cur);
+        int e = RangeEnd(cur);
+        if (b >= e) {
+            return false;
+        }
+        if (worker.range.compare_exchange_weak(cur, PackRange(b + 1, e),
+                                               std::memory_order_acq_rel)) {
+            series = b;
+            return true;
+        }
+    }
+}
+
+bool ChanBatchAnalyzer::StealHalf(int thief) {
+    int threads = (int)m_workers.size();
+    for (int k = 1; k < threads; ++k) {
+        Worker& victim = *m_workers[(thief + k) % threads];
+        uint64_t cur = victim.range.load(std::memory_order_acquire);
+        for (;;) {
+            int b = RangeBegin(cur);
+            int e = RangeEnd(cur);
+            if (b >= e) {
+                break;
+            }
+            // 窃取尾部一半（至少一个）
+            int mid = b + (e - b) / 2;
+            if (victim.range.compare_exchange_weak(cur, PackRange(b, mid),
+                                                   std::memory_order_acq_rel)) {
+                // 自己的队列此时为空，只有本线程会写入非空区间
+                Worker& self = *m_workers[thief];
+                self.range.store(PackRange(mid, e), std::memory_order_release);
+                ++self.steals;
+                return true;
+            }
+        }
+    }
+    return false;
+}
+
+void ChanBatchAnalyzer::Work(int id) {
+    Worker& worker = *m_workers[id];
+    int series;
+    for (;;) {
+        while (PopFront(worker, series)) {
+            AnalyzeSeries(worker, series);
+            m_remaining.fetch_sub(1, std::memory_order_acq_rel);
+        }
+        if (m_remaining.load(std::memory_order_acquire) == 0) {
+            return;
+        }
+        if (!StealHalf(id)) {
+            // 剩余标的都在处理中，等待它们结束
+            std::this_thread::yield();
+        }
+    }
+}
+
+void ChanBatchAnalyzer::AnalyzeSeries(Worker& worker, int series) {
+    const BatchInput& in = *m_input;
+    const BatchOutput& out = *m_output;
+    int offset = in.offsets[series];
+    int count = in.offsets[series + 1] - offset;
+
+    const float* highs = in.highs + offset;
+    const float* lows = in.lows + offset;
+    const float* closes = in.closes ? in.closes + offset : nullptr;
+    const float* volumes = in.volumes ? in.volumes + offset : nullptr;
+
+    ChanCore& core = worker.core;
+    if (count > 0) {
+        core.Analyze(highs, lows, closes, volumes, count);
+    } else {
+        core.Clear();
+    }
+
+    if (out.stroke_counts) out.stroke_counts[series] = (int)core.GetStrokes().size();
+    if (out.pivot_counts) out.pivot_counts[series] = (int)core.GetPivots().size();
+    if (out.events) out.events[series].clear();
+    if (count <= 0) {
+        return;
+    }
+
+    if (out.fx) core.OutputFX(out.fx + offset, count);
+    if (out.bi) core.OutputBI(out.bi + offset, count);
+    if (out.duan) core.OutputDUAN(out.duan + offset, count);
+    if (out.zs_high) core.OutputZS_H(out.zs_high + offset, count);
+    if (out.zs_low) core.OutputZS_L(out.zs_low + offset, count);
+    if (out.bc) core.OutputBC(out.bc + offset, count);
+
+    if (out.HasSignals()) {
+        // 与分析会话相同：均线 + 递归引用序列 + 信号位图，各信号由位图投影
+        core.ComputeMAData(closes, count);
+        core.BuildBiSequence(count - 1);
+        core.BuildSignalTable(highs, lows, count);
+        for (int k = 0; k < (int)SignalOutput::COUNT; ++k) {
+            if (out.signals[k]) {
+                core.ProjectSignal((SignalOutput)k, out.signals[k] + offset, count);
+            }
+        }
+    }
+    if (out.events) {
+        int first_bar = out.event_window > 0 ? count - out.event_window : 0;
+        core.CollectEvents(out.event_kinds, out.events[series], highs, lows, first_bar);
+    }
+}
+
+} // namespace chan
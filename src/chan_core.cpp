@@ -7,6 +7,8 @@
 
 #include "chan_core.h"
 #include "logger.h"
+#include "fx_kernel.h"
+#include "moving_average.h"
 #include <cstring>
 #include <limits>
 #include <algorithm>
@@ -18,15 +20,28 @@ namespace chan {
 // ============================================================================
 
 ChanCore::ChanCore() 
-    : m_raw_count(0) {
+    : m_raw_count(0)
+    , m_pivot_level_count(0) {
+    Clear();
 }
 
 ChanCore::ChanCore(const ChanConfig& config) 
     : m_config(config)
-    , m_raw_count(0) {
+    , m_raw_count(0)
+    , m_pivot_level_count(0) {
+    Clear();
 }
 
 void ChanCore::SetConfig(const ChanConfig& config) {
+    // 成笔/中枢参数变化后，下次增量更新需从头重建对应阶段
+    if (config.min_bi_len != m_config.min_bi_len ||
+        config.min_fx_distance != m_config.min_fx_distance) {
+        m_bi_stale = true;
+    }
+    if (config.min_zs_bi_count != m_config.min_zs_bi_count) {
+        m_zs_boundaries.clear();
+        ResetPivotLevels(0);
+    }
     m_config = config;
 }
 
@@ -37,6 +52,98 @@ void ChanCore::Clear() {
     m_strokes.clear();
     m_pivots.clear();
     m_raw_to_merged.clear();
+    m_signal_table.clear();
+    m_signal_table_ready = false;
+    
+    m_include_dir = Direction::NONE;
+    m_snap_include_dir = Direction::NONE;
+    m_snap_merged_count = 0;
+    m_snap_back_high = 0.0f;
+    m_snap_back_low = 0.0f;
+    m_snap_back_end = 0;
+    ResetFXCheckpoint();
+    m_bi_stale = false;
+    m_bi_skips.clear();
+    m_zs_boundaries.clear();
+    m_seg_points.clear();
+    m_seg_checkpoints.clear();
+    m_seg_dirty_point = 0;
+    ResetSegScan(0);
+    ResetPivotLevels(0);
+    m_range.Clear();
+    m_macd.clear();
+    m_macd_red.assign(1, 0.0);
+    m_macd_green.assign(1, 0.0);
+    m_macd_prev = MacdState();
+    m_macd_last = MacdState();
+}
+
+// ============================================================================
+// SoA视图还原
+// ============================================================================
+
+KLine ChanCore::MergedKLineAt(int i) const {
+    const MergedKLineSoA& m = m_merged_klines;
+    KLine k;
+    k.index = m.merge_start[i];
+    k.high = m.high[i];
+    k.low = m.low[i];
+    k.merge_start = m.merge_start[i];
+    k.merge_end = m.merge_end[i];
+    k.is_merged = (k.merge_end != k.merge_start);
+    return k;
+}
+
+Fractal ChanCore::FractalAt(int i) const {
+    Fractal fx;
+    fx.index = m_fractals.index[i];
+    fx.type = m_fractals.type[i];
+    fx.price = m_fractals.price[i];
+    fx.kline_idx = m_fractals.kline_idx[i];
+    fx.is_valid = true;
+    fx.strength = 1;
+    return fx;
+}
+
+void ChanCore::SetFractal(int i, const Fractal& fx) {
+    m_fractals.index[i] = fx.index;
+    m_fractals.type[i] = fx.type;
+    m_fractals.price[i] = fx.price;
+    m_fractals.kline_idx[i] = fx.kline_idx;
+}
+
+Stroke ChanCore::StrokeAt(int i) const {
+    const StrokeSoA& st = m_strokes;
+    Stroke stroke;
+    stroke.id = i;
+    stroke.start_idx = st.start_idx[i];
+    stroke.end_idx = st.end_idx[i];
+    stroke.start_fx = FractalAt(st.start_fx[i]);
+    stroke.end_fx = FractalAt(st.end_fx[i]);
+    stroke.direction = st.direction[i];
+    stroke.high = st.high[i];
+    stroke.low = st.low[i];
+    // 力度：有MACD时为笔内同向MACD柱面积，否则为振幅
+    stroke.power = HasMACD() ? GetMACDArea(stroke.start_idx, stroke.end_idx, stroke.direction)
+                             : stroke.high - stroke.low;
+    stroke.kline_count = stroke.end_idx - stroke.start_idx + 1;
+    return stroke;
+}
+
+Segment ChanCore::SegmentAt(int i) const {
+    const SegPoint& from = m_seg_points[i];
+    const SegPoint& to = m_seg_points[i + 1];
+    Segment seg;
+    seg.id = i;
+    seg.start_stroke_id = from.stroke + 1;
+    seg.end_stroke_id = to.stroke;
+    seg.stroke_count = to.stroke - from.stroke;
+    seg.start_idx = from.kline_idx;
+    seg.end_idx = to.kline_idx;
+    seg.direction = (to.type == FractalType::TOP) ? Direction::UP : Direction::DOWN;
+    seg.high = std::max(from.price, to.price);
+    seg.low = std::min(from.price, to.price);
+    return seg;
 }
 
 // ============================================================================
@@ -53,6 +160,16 @@ int ChanCore::Analyze(const float* highs, const float* lows,
     Clear();
     m_raw_count = count;
     
+    // 步骤0: MACD（背驰判断用），与K线一一对应
+    if (closes) {
+        m_macd.reserve(count);
+        m_macd_red.reserve(count + 1);
+        m_macd_green.reserve(count + 1);
+        for (int i = 0; i < count; ++i) {
+            PushMACD(closes[i]);
+        }
+    }
+    
     // 步骤1: 去包含处理
     int merged_count = RemoveInclude(highs, lows, count);
     CHAN_LOG_DEBUG("去包含处理完成: %d -> %d 根K线", count, merged_count);
@@ -75,6 +192,10 @@ int ChanCore::Analyze(const float* highs, const float* lows,
     int bi_count = CheckBI();
     CHAN_LOG_DEBUG("笔识别完成: %d 笔", bi_count);
     
+    // 步骤3.5: 线段识别
+    int duan_count = CheckDUAN();
+    CHAN_LOG_DEBUG("线段识别完成: %d 段", duan_count);
+    
     if (bi_count < 3) {
         CHAN_LOG_DEBUG("笔数量不足，无法识别中枢");
         return 0;
@@ -84,9 +205,90 @@ int ChanCore::Analyze(const float* highs, const float* lows,
     int zs_count = CheckZS();
     CHAN_LOG_DEBUG("中枢识别完成: %d 个中枢", zs_count);
     
+    // 步骤5: 多级别中枢（线段中枢及升级）
+    int max_level = CheckPivotLevels();
+    CHAN_LOG_DEBUG("多级别中枢完成: 最高级别 %d", max_level);
+    
+    return 0;
+}
+
+// ============================================================================
+// 流式增量分析
+// ============================================================================
+// 各阶段只有尾部依赖最新K线：
+//   去包含 - 仅末尾合并K线会被新K线改写
+//   分型   - 中间K线及左右K线都已确定的候选不再变化
+//   笔     - 终点分型不再变化的笔保留，只重做其后的贪心成笔
+//   中枢   - 只依赖保留笔的判定断点保留，其后续算
+//   线段   - 只依赖保留笔的端点确认断点保留，其后续算
+//   多级别中枢 - 各级只从下一级首个变化的构件续算
+// 每根新K线只重算不稳定尾部，结果与完整 Analyze 一致。
+
+int ChanCore::AppendBar(float high, float low, float close, float volume) {
+    (void)volume;  // 与 Analyze 一致，只使用高低价与收盘价（MACD）
+    
+    // MACD 与K线同步时继续追加（Analyze 未传收盘价则不计算）
+    if (m_macd.size() == m_raw_to_merged.size()) {
+        PushMACD(close);
+    }
+    if (m_config.range_index && m_range.Count() == (int)m_raw_to_merged.size()) {
+        m_range.Append(high, low);
+    }
+    PushRawBar((int)m_raw_to_merged.size(), high, low);
+    m_raw_count = (int)m_raw_to_merged.size();
+    UpdateTail();
+    return 0;
+}
+
+int ChanCore::UpdateLastBar(float high, float low, float close, float volume) {
+    (void)volume;
+    
+    if (m_raw_to_merged.empty()) {
+        CHAN_LOG_ERROR("UpdateLastBar: 尚无K线");
+        return -1;
+    }
+    
+    if (m_macd.size() == m_raw_to_merged.size()) {
+        PopMACD();
+        PushMACD(close);
+    }
+    if (m_range.Count() == (int)m_raw_to_merged.size()) {
+        m_range.UpdateLast(high, low);
+    }
+    
+    // 回退最后一根原始K线的去包含效果，再以新价格重新并入
+    m_merged_klines.resize(m_snap_merged_count);
+    if (m_snap_merged_count > 0) {
+        int last = m_snap_merged_count - 1;
+        m_merged_klines.high[last] = m_snap_back_high;
+        m_merged_klines.low[last] = m_snap_back_low;
+        m_merged_klines.merge_end[last] = m_snap_back_end;
+    }
+    m_include_dir = m_snap_include_dir;
+    m_raw_to_merged.pop_back();
+    
+    PushRawBar((int)m_raw_to_merged.size(), high, low);
+    UpdateTail();
     return 0;
 }
 
+void ChanCore::UpdateTail() {
+    m_signal_table_ready = false;
+    
+    int fx_dirty = ResumeFX();
+    int stroke_dirty = ResumeBI(fx_dirty);
+    int seg_dirty = ResumeDUAN(stroke_dirty);
+    ResumePivotLevels(seg_dirty);
+    
+    if (m_strokes.size() < 3) {
+        // 与 Analyze 一致：笔数量不足时不识别中枢
+        m_pivots.clear();
+        m_zs_boundaries.clear();
+        return;
+    }
+    ResumeZS(stroke_dirty);
+}
+
 // ============================================================================
 // 去包含处理 (5.1)
 // ============================================================================
@@ -141,72 +343,95 @@ int ChanCore::RemoveInclude(const float* highs, const float* lows, int count) {
     
     m_merged_klines.clear();
     m_raw_to_merged.clear();
-    m_raw_to_merged.resize(count, -1);
-    
-    // 初始化第一根K线
-    KLine first;
-    first.index = 0;
-    first.high = highs[0];
-    first.low = lows[0];
-    first.is_merged = false;
-    first.merge_start = 0;
-    first.merge_end = 0;
-    m_merged_klines.push_back(first);
-    m_raw_to_merged[0] = 0;
-    
-    Direction curr_dir = Direction::NONE;
-    
-    for (int i = 1; i < count; ++i) {
-        KLine& last = m_merged_klines.back();
-        
-        KLine curr;
-        curr.index = i;
-        curr.high = highs[i];
-        curr.low = lows[i];
-        curr.is_merged = false;
-        curr.merge_start = i;
-        curr.merge_end = i;
+    m_raw_to_merged.reserve(count);
+    m_include_dir = Direction::NONE;
+    
+    // 区间极值索引与去包含同源，一并重建
+    if (m_config.range_index) {
+        m_range.Build(highs, lows, count);
+    } else {
+        m_range.Clear();
+    }
+    
+    // 合并K线全部重建，下游的增量确认前缀随之失效
+    ResetFXCheckpoint();
+    
+    for (int i = 0; i < count; ++i) {
+        PushRawBar(i, highs[i], lows[i]);
+    }
+    
+    return (int)m_merged_klines.size();
+}
+
+void ChanCore::PushRawBar(int index, float high, float low) {
+    MergedKLineSoA& merged = m_merged_klines;
+    int n = merged.size();
+    
+    // 记录并入前的快照，UpdateLastBar 据此回退最后一根原始K线
+    m_snap_merged_count = n;
+    m_snap_include_dir = m_include_dir;
+    if (n > 0) {
+        m_snap_back_high = merged.high[n - 1];
+        m_snap_back_low = merged.low[n - 1];
+        m_snap_back_end = merged.merge_end[n - 1];
+    }
+    
+    if (n == 0) {
+        // 第一根K线
+        merged.push_back(high, low, index);
+        m_raw_to_merged.push_back(0);
+        return;
+    }
+    
+    float& last_high = merged.high[n - 1];
+    float& last_low = merged.low[n - 1];
+    
+    // 判断是否存在包含关系（与 HasIncludeRelation 相同）
+    if ((last_high >= high && last_low <= low) ||
+        (high >= last_high && low <= last_low)) {
+        // 存在包含关系，需要合并
         
-        // 判断是否存在包含关系
-        if (HasIncludeRelation(last, curr)) {
-            // 存在包含关系，需要合并
-            
-            // 确定方向
-            if (curr_dir == Direction::NONE) {
-                // 首次确定方向，根据前两根K线
-                if (m_merged_klines.size() >= 2) {
-                    int prev_idx = (int)m_merged_klines.size() - 2;
-                    if (m_merged_klines[prev_idx].high < last.high) {
-                        curr_dir = Direction::UP;
-                    } else {
-                        curr_dir = Direction::DOWN;
-                    }
+        // 确定方向
+        if (m_include_dir == Direction::NONE) {
+            // 首次确定方向，根据前两根K线
+            if (n >= 2) {
+                if (merged.high[n - 2] < last_high) {
+                    m_include_dir = Direction::UP;
                 } else {
-                    // 只有一根K线，默认向上
-                    curr_dir = Direction::UP;
+                    m_include_dir = Direction::DOWN;
                 }
+            } else {
+                // 只有一根K线，默认向上
+                m_include_dir = Direction::UP;
             }
-            
-            // 合并K线
-            MergeKLine(last, curr, curr_dir);
-            m_raw_to_merged[i] = (int)m_merged_klines.size() - 1;
+        }
+        
+        // 合并K线（与 MergeKLine 相同）
+        if (m_include_dir == Direction::UP) {
+            // 向上趋势：高点取高者，低点取高者
+            last_high = std::max(last_high, high);
+            last_low = std::max(last_low, low);
         } else {
-            // 不存在包含关系，添加新K线
-            
-            // 更新方向
-            if (curr.high > last.high) {
-                curr_dir = Direction::UP;
-            } else if (curr.high < last.high) {
-                curr_dir = Direction::DOWN;
-            }
-            // 高点相等时保持原方向
-            
-            m_merged_klines.push_back(curr);
-            m_raw_to_merged[i] = (int)m_merged_klines.size() - 1;
+            // 向下趋势：高点取低者，低点取低者
+            last_high = std::min(last_high, high);
+            last_low = std::min(last_low, low);
         }
+        merged.merge_end[n - 1] = index;
+        m_raw_to_merged.push_back(n - 1);
+    } else {
+        // 不存在包含关系，添加新K线
+        
+        // 更新方向
+        if (high > last_high) {
+            m_include_dir = Direction::UP;
+        } else if (high < last_high) {
+            m_include_dir = Direction::DOWN;
+        }
+        // 高点相等时保持原方向
+        
+        merged.push_back(high, low, index);
+        m_raw_to_merged.push_back(n);
     }
-    
-    return (int)m_merged_klines.size();
 }
 
 // ============================================================================
@@ -215,70 +440,109 @@ int ChanCore::RemoveInclude(const float* highs, const float* lows, int count) {
 
 int ChanCore::CheckFX() {
     m_fractals.clear();
+    ResetFXCheckpoint();
     
-    const auto& klines = m_merged_klines;
-    int n = (int)klines.size();
+    // 分型全部重建，笔的增量记录随之失效（笔以分型下标引用分型）
+    m_strokes.clear();
+    m_bi_skips.clear();
+    m_bi_stale = false;
     
-    if (n < 3) {
-        return 0;
+    ResumeFX();
+    return (int)m_fractals.size();
+}
+
+void ChanCore::ResetFXCheckpoint() {
+    m_fx_next = 1;
+    m_fx_count = 0;
+    m_fx_back = Fractal();
+    m_fx_last_type = FractalType::NONE;
+}
+
+void ChanCore::ApplyFXCandidate(int i, FractalType type, FractalType& last_type) {
+    float price = (type == FractalType::TOP) ? m_merged_klines.high[i] : m_merged_klines.low[i];
+    FractalSoA& fx = m_fractals;
+    
+    // 处理连续同类型分型
+    if (last_type == type && !fx.empty()) {
+        // 取极值：顶分型取高者，底分型取低者
+        int last = fx.size() - 1;
+        bool replace = (type == FractalType::TOP) ? (price > fx.price[last])
+                                                   : (price < fx.price[last]);
+        if (replace) {
+            fx.index[last] = i;
+            fx.price[last] = price;
+            fx.kline_idx[last] = m_merged_klines.merge_end[i];
+        }
+    } else {
+        // 不同类型，添加新分型
+        fx.index.push_back(i);
+        fx.type.push_back(type);
+        fx.price.push_back(price);
+        fx.kline_idx.push_back(m_merged_klines.merge_end[i]);  // 使用合并K线的最后一根原始K线索引
+        last_type = type;
+    }
+}
+
+void ChanCore::ScanFX(int begin, int end, FractalType& last_type) {
+    if (begin >= end) {
+        return;
     }
     
-    FractalType last_type = FractalType::NONE;
+    // 第一步：SIMD内核批量判定顶/底候选
+    // 顶分型：中间K线高点最高，低点也最高
+    // 底分型：中间K线低点最低，高点也最低
+    int words = FXMaskWords(end - begin);
+    m_fx_top_bits.resize(words);
+    m_fx_bottom_bits.resize(words);
+    DetectFXCandidates(m_merged_klines.high.data(), m_merged_klines.low.data(), begin, end,
+                       m_fx_top_bits.data(), m_fx_bottom_bits.data());
     
-    for (int i = 1; i < n - 1; ++i) {
-        const KLine& k1 = klines[i - 1];
-        const KLine& k2 = klines[i];      // 中间K线
-        const KLine& k3 = klines[i + 1];
-        
-        FractalType type = FractalType::NONE;
-        
-        // 顶分型判断：
-        // 中间K线高点最高，低点也最高
-        if (k2.high > k1.high && k2.high > k3.high &&
-            k2.low > k1.low && k2.low > k3.low) {
-            type = FractalType::TOP;
-        }
-        // 底分型判断：
-        // 中间K线低点最低，高点也最低
-        else if (k2.low < k1.low && k2.low < k3.low &&
-                 k2.high < k1.high && k2.high < k3.high) {
-            type = FractalType::BOTTOM;
-        }
-        
-        if (type != FractalType::NONE) {
-            // 创建分型
-            Fractal fx;
-            fx.index = i;
-            fx.type = type;
-            fx.price = (type == FractalType::TOP) ? k2.high : k2.low;
-            fx.kline_idx = k2.merge_end;  // 使用合并K线的最后一根原始K线索引
-            fx.is_valid = true;
-            fx.strength = 1;
-            
-            // 处理连续同类型分型
-            if (last_type == type && !m_fractals.empty()) {
-                // 取极值
-                Fractal& last_fx = m_fractals.back();
-                if (type == FractalType::TOP) {
-                    // 顶分型取高者
-                    if (fx.price > last_fx.price) {
-                        last_fx = fx;
-                    }
-                } else {
-                    // 底分型取低者
-                    if (fx.price < last_fx.price) {
-                        last_fx = fx;
-                    }
-                }
-            } else {
-                // 不同类型，添加新分型
-                m_fractals.push_back(fx);
-                last_type = type;
-            }
+    // 第二步：按位置顺序逐个压缩（顶底互斥，同一位置至多一种）
+    for (int w = 0; w < words; ++w) {
+        uint32_t top = m_fx_top_bits[w];
+        uint32_t any = top | m_fx_bottom_bits[w];
+        while (any) {
+            uint32_t lowest = any & (0u - any);
+            int bit = LowestBitIndex(any);
+            FractalType type = (top & lowest) ? FractalType::TOP : FractalType::BOTTOM;
+            ApplyFXCandidate(begin + w * 32 + bit, type, last_type);
+            any ^= lowest;
         }
     }
+}
+
+int ChanCore::ResumeFX() {
+    // 回退到已确认前缀；确认前缀的末尾分型仍可能被后续同类分型替换
+    int fx_dirty = std::max(0, m_fx_count - 1);
+    m_fractals.resize(m_fx_count);
+    if (m_fx_count > 0) {
+        SetFractal(m_fx_count - 1, m_fx_back);
+    }
+    FractalType last_type = m_fx_last_type;
     
-    return (int)m_fractals.size();
+    int n = m_merged_klines.size();
+    if (n < 3) {
+        return fx_dirty;
+    }
+    
+    // 合并K线 [0, stable) 不会再变：最后一根原始K线并入前的末尾K线
+    // 仍可能被 UpdateLastBar 改写
+    int stable = m_snap_merged_count - 1;
+    int i = std::max(m_fx_next, std::min(n - 1, stable - 1));
+    
+    // 三根K线都已确定的候选，处理后推进确认前缀
+    ScanFX(m_fx_next, i, last_type);
+    m_fx_next = i;
+    m_fx_count = m_fractals.size();
+    if (m_fx_count > 0) {
+        m_fx_back = FractalAt(m_fx_count - 1);
+    }
+    m_fx_last_type = last_type;
+    
+    // 不稳定尾部（至多两个候选）
+    ScanFX(i, n - 1, last_type);
+    
+    return fx_dirty;
 }
 
 // ============================================================================
@@ -289,34 +553,42 @@ bool ChanCore::IsFXValid(const Fractal& fx) const {
     return fx.is_valid && fx.type != FractalType::NONE;
 }
 
-bool ChanCore::CanFormStroke(const Fractal& fx1, const Fractal& fx2) const {
-    // 检查分型类型是否交替
-    if (fx1.type == fx2.type) {
-        return false;
-    }
+bool ChanCore::IsStrokeLongEnough(int fx1, int fx2) const {
+    const FractalSoA& fx = m_fractals;
     
     // 检查分型间隔（合并K线索引差）
-    int distance = fx2.index - fx1.index;
+    int distance = fx.index[fx2] - fx.index[fx1];
     if (distance < m_config.min_fx_distance + 2) {  // +2 因为分型本身占3根K线
         return false;
     }
     
     // 检查K线数量是否满足最小笔长度
     // 使用原始K线索引计算
-    int raw_distance = fx2.kline_idx - fx1.kline_idx;
-    if (raw_distance < m_config.min_bi_len) {
+    int raw_distance = fx.kline_idx[fx2] - fx.kline_idx[fx1];
+    return raw_distance >= m_config.min_bi_len;
+}
+
+bool ChanCore::CanFormStroke(int fx1, int fx2) const {
+    const FractalSoA& fx = m_fractals;
+    
+    // 检查分型类型是否交替
+    if (fx.type[fx1] == fx.type[fx2]) {
+        return false;
+    }
+    
+    if (!IsStrokeLongEnough(fx1, fx2)) {
         return false;
     }
     
     // 检查价格有效性
-    if (fx1.type == FractalType::TOP) {
+    if (fx.type[fx1] == FractalType::TOP) {
         // 顶到底：顶的高点必须高于底的低点
-        if (fx1.price <= fx2.price) {
+        if (fx.price[fx1] <= fx.price[fx2]) {
             return false;
         }
     } else {
         // 底到顶：底的低点必须低于顶的高点
-        if (fx1.price >= fx2.price) {
+        if (fx.price[fx1] >= fx.price[fx2]) {
             return false;
         }
     }
@@ -324,66 +596,201 @@ bool ChanCore::CanFormStroke(const Fractal& fx1, const Fractal& fx2) const {
     return true;
 }
 
+void ChanCore::PushStroke(int start_fx, int end_fx) {
+    const FractalSoA& fx = m_fractals;
+    StrokeSoA& st = m_strokes;
+    
+    st.start_fx.push_back(start_fx);
+    st.end_fx.push_back(end_fx);
+    st.start_idx.push_back(fx.kline_idx[start_fx]);
+    st.end_idx.push_back(fx.kline_idx[end_fx]);
+    
+    // 前一笔同向时沿用其反向链接（跳过起点后可能出现连续同向笔）
+    int prev = st.size() - 2;
+    if (prev < 0) {
+        st.prev_turn.push_back(-1);
+    } else if ((fx.type[start_fx] == FractalType::BOTTOM) == (st.direction[prev] == Direction::UP)) {
+        st.prev_turn.push_back(st.prev_turn[prev]);
+    } else {
+        st.prev_turn.push_back(prev);
+    }
+    
+    if (fx.type[start_fx] == FractalType::BOTTOM) {
+        // 底到顶 = 上涨笔
+        st.direction.push_back(Direction::UP);
+        st.low.push_back(fx.price[start_fx]);
+        st.high.push_back(fx.price[end_fx]);
+    } else {
+        // 顶到底 = 下跌笔
+        st.direction.push_back(Direction::DOWN);
+        st.high.push_back(fx.price[start_fx]);
+        st.low.push_back(fx.price[end_fx]);
+    }
+}
+
+// ----------------------------------------------------------------------------
+// 成笔可达性
+// ----------------------------------------------------------------------------
+// 分型的合并K线索引与原始K线索引都递增，长度条件对终点单调：
+// 从某个分型起全部满足。其后能否成笔只取决于反向分型的最极端价格，
+// 用后缀最低底/最高顶 O(1) 判定，只有确定能成笔时才向后扫描终点。
+
+int ChanCore::FirstLongEnough(int start_fx, int from) const {
+    // 二分查找 from 之后第一个满足长度条件的分型
+    int lo = std::max(from, start_fx + 1);
+    int hi = m_fractals.size();
+    while (lo < hi) {
+        int mid = lo + (hi - lo) / 2;
+        if (IsStrokeLongEnough(start_fx, mid)) {
+            hi = mid;
+        } else {
+            lo = mid + 1;
+        }
+    }
+    return lo;
+}
+
+void ChanCore::PrepareStrokeReach(int from) {
+    const FractalSoA& fx = m_fractals;
+    int n = fx.size();
+    float min_bottom = std::numeric_limits<float>::max();
+    float max_top = -std::numeric_limits<float>::max();
+    if (m_bi_reach_from < n) {
+        min_bottom = m_bi_min_bottom[m_bi_reach_from];
+        max_top = m_bi_max_top[m_bi_reach_from];
+    }
+    for (int p = m_bi_reach_from - 1; p >= from; --p) {
+        if (fx.type[p] == FractalType::BOTTOM) {
+            min_bottom = std::min(min_bottom, fx.price[p]);
+        } else {
+            max_top = std::max(max_top, fx.price[p]);
+        }
+        m_bi_min_bottom[p] = min_bottom;
+        m_bi_max_top[p] = max_top;
+    }
+    m_bi_reach_from = std::min(m_bi_reach_from, std::max(from, 0));
+}
+
+bool ChanCore::CanReachStroke(int start_fx, int from) const {
+    // from 须不早于 FirstLongEnough(start_fx)，且已由 PrepareStrokeReach 覆盖
+    if (from >= m_fractals.size()) {
+        return false;
+    }
+    float price = m_fractals.price[start_fx];
+    if (m_fractals.type[start_fx] == FractalType::TOP) {
+        return m_bi_min_bottom[from] < price;
+    }
+    return m_bi_max_top[from] > price;
+}
+
 int ChanCore::CheckBI() {
     m_strokes.clear();
+    m_bi_stale = false;
+    m_bi_skips.clear();
     
-    const auto& fxlist = m_fractals;
-    int n = (int)fxlist.size();
+    // 笔全部重建，中枢/线段的增量断点失效
+    m_zs_boundaries.clear();
+    m_seg_checkpoints.clear();
     
-    if (n < 2) {
-        return 0;
+    ResumeBI(0);
+    return (int)m_strokes.size();
+}
+
+int ChanCore::ResumeBI(int fx_dirty) {
+    int n = m_fractals.size();
+    
+    // 0. 分型整体重建或成笔参数变化后，从头重建
+    if (m_bi_stale) {
+        m_strokes.clear();
+        m_bi_skips.clear();
+        m_bi_stale = false;
+    }
+    
+    // 1. 丢弃终点分型可能已变化的笔
+    int kept = m_strokes.size();
+    while (kept > 0 && m_strokes.end_fx[kept - 1] >= fx_dirty) {
+        --kept;
+    }
+    m_strokes.resize(kept);
+    int start_idx = kept == 0 ? 0 : m_strokes.end_fx[kept - 1];
+    
+    // 2. start_idx 之后的跳过记录将重新判定
+    while (!m_bi_skips.empty() && m_bi_skips.back().fx_idx >= start_idx) {
+        m_bi_skips.pop_back();
+    }
+    
+    // 后缀极值只覆盖需要判定的分型：跳过记录检查的新分型，及成笔失败扫描过的区间
+    m_bi_min_bottom.resize(n);
+    m_bi_max_top.resize(n);
+    m_bi_reach_from = n;
+    int reach_from = n;
+    for (const BiSkip& skip : m_bi_skips) {
+        reach_from = std::min(reach_from, std::min(skip.checked_until, fx_dirty));
+    }
+    PrepareStrokeReach(reach_from);
+    
+    // 3. 此前"找不到终点而跳过"的起点依赖全部分型：
+    //    若新增/变化的分型能与之成笔，则从该起点重做
+    for (size_t k = 0; k < m_bi_skips.size(); ++k) {
+        BiSkip& skip = m_bi_skips[k];
+        int from = std::max(std::min(skip.checked_until, fx_dirty), skip.fx_idx + 1);
+        
+        if (CanReachStroke(skip.fx_idx, FirstLongEnough(skip.fx_idx, from))) {
+            m_strokes.resize(skip.stroke_count);
+            start_idx = skip.fx_idx;
+            m_bi_skips.resize(k);
+            break;
+        }
+        skip.checked_until = n;
     }
     
-    int stroke_id = 0;
-    int start_idx = 0;  // 起始分型索引
+    int stroke_dirty = m_strokes.size();
     
+    // 4. 从 start_idx 继续贪心成笔：终点为满足长度条件后第一个价格有效的反向分型。
+    //    长度下界 reach 随起点单调前移；成笔时的扫描区间 [reach, 终点] 互不重叠。
+    //    扫描到后缀极值已覆盖的位置仍未成笔时由后缀极值判定，
+    //    判定失败则为扫描过的区间补上后缀极值，后续起点不再重复扫描，总计 O(F)
+    int reach = start_idx + 1;
     while (start_idx < n - 1) {
-        const Fractal& start_fx = fxlist[start_idx];
+        reach = std::max(reach, start_idx + 1);
+        while (reach < n && !IsStrokeLongEnough(start_idx, reach)) {
+            ++reach;
+        }
         
         // 寻找能够形成笔的下一个分型
+        int end_idx = reach;
         bool found = false;
-        for (int end_idx = start_idx + 1; end_idx < n; ++end_idx) {
-            const Fractal& end_fx = fxlist[end_idx];
-            
-            if (CanFormStroke(start_fx, end_fx)) {
-                // 可以形成笔
-                Stroke stroke;
-                stroke.id = stroke_id++;
-                stroke.start_idx = start_fx.kline_idx;
-                stroke.end_idx = end_fx.kline_idx;
-                stroke.start_fx = start_fx;
-                stroke.end_fx = end_fx;
-                
-                if (start_fx.type == FractalType::BOTTOM) {
-                    // 底到顶 = 上涨笔
-                    stroke.direction = Direction::UP;
-                    stroke.low = start_fx.price;
-                    stroke.high = end_fx.price;
-                } else {
-                    // 顶到底 = 下跌笔
-                    stroke.direction = Direction::DOWN;
-                    stroke.high = start_fx.price;
-                    stroke.low = end_fx.price;
-                }
-                
-                stroke.power = stroke.high - stroke.low;
-                stroke.kline_count = end_fx.kline_idx - start_fx.kline_idx + 1;
-                
-                m_strokes.push_back(stroke);
-                
-                start_idx = end_idx;
+        for (; end_idx < m_bi_reach_from; ++end_idx) {
+            if (CanFormStroke(start_idx, end_idx)) {
                 found = true;
                 break;
             }
         }
+        if (!found && CanReachStroke(start_idx, end_idx)) {
+            // 后缀极值保证其后存在终点
+            while (!CanFormStroke(start_idx, end_idx)) {
+                ++end_idx;
+            }
+            found = true;
+        }
         
-        if (!found) {
+        if (found) {
+            // 可以形成笔
+            PushStroke(start_idx, end_idx);
+            start_idx = end_idx;
+        } else {
             // 没有找到能形成笔的分型，跳过当前分型
+            PrepareStrokeReach(reach);
+            BiSkip skip;
+            skip.fx_idx = start_idx;
+            skip.stroke_count = m_strokes.size();
+            skip.checked_until = n;
+            m_bi_skips.push_back(skip);
             start_idx++;
         }
     }
     
-    return (int)m_strokes.size();
+    return stroke_dirty;
 }
 
 // ============================================================================
@@ -392,82 +799,805 @@ int ChanCore::CheckBI() {
 
 int ChanCore::CheckZS() {
     m_pivots.clear();
+    m_zs_boundaries.clear();
     
-    const auto& strokes = m_strokes;
-    int n = (int)strokes.size();
-    
-    if (n < m_config.min_zs_bi_count) {
-        return 0;
+    ResumeZS(0);
+    return (int)m_pivots.size();
+}
+
+void ChanCore::ResumeZS(int stroke_dirty) {
+    // 笔中枢：构件即笔
+    PivotInput in;
+    in.high = m_strokes.high.data();
+    in.low = m_strokes.low.data();
+    in.start_stroke = nullptr;
+    in.end_stroke = nullptr;
+    in.start_idx = m_strokes.start_idx.data();
+    in.end_idx = m_strokes.end_idx.data();
+    in.direction = m_strokes.direction.data();
+    in.count = m_strokes.size();
+    in.min_count = m_config.min_zs_bi_count;
+    in.level = 0;
+    ResumePivots(in, m_pivots, m_zs_boundaries, stroke_dirty);
+}
+
+int ChanCore::ResumePivots(const PivotInput& in, std::vector<Pivot>& pivots,
+                           std::vector<ZsBoundary>& boundaries, int dirty) {
+    // 回退到只依赖未变化构件的最后一个判定断点
+    while (!boundaries.empty() && boundaries.back().max_used >= dirty) {
+        boundaries.pop_back();
     }
     
-    int pivot_id = 0;
     int i = 0;
+    int max_used = -1;
+    int part_count = 0;
+    bool extending = false;
+    if (boundaries.empty()) {
+        pivots.clear();
+    } else {
+        const ZsBoundary& last = boundaries.back();
+        i = last.stroke_idx;
+        max_used = last.max_used;
+        pivots.resize(last.pivot_count);
+        if (last.extending) {
+            // 恢复末尾中枢到该断点时的扩展状态
+            Pivot& pivot = pivots.back();
+            part_count = last.part_count;
+            pivot.GG = last.gg;
+            pivot.DD = last.dd;
+            pivot.end_stroke_id = in.end_stroke ? in.end_stroke[i - 1] : i - 1;
+            extending = true;
+            // 扩展断点由 ExtendLastPivot 重新记录
+            boundaries.pop_back();
+        }
+    }
+    
+    // 之前的中枢不再变化（扩展中的末尾中枢除外），供上一级续算
+    int pivot_dirty = (int)pivots.size() - (extending ? 1 : 0);
     
-    while (i <= n - m_config.min_zs_bi_count) {
-        // 尝试从第i笔开始形成中枢
+    const float* high = in.high;
+    const float* low = in.low;
+    int n = in.count;
+    
+    if (extending) {
+        i = ExtendLastPivot(in, pivots, boundaries, i, part_count, max_used);
+    }
+    
+    while (i <= n - in.min_count) {
+        // 尝试从第i个构件开始形成中枢
         
-        // 初始化中枢边界（使用前三笔）
+        // 初始化中枢边界（使用前三个构件）
         float zg = std::numeric_limits<float>::max();   // 最低的高点
         float zd = std::numeric_limits<float>::lowest(); // 最高的低点
         float gg = std::numeric_limits<float>::lowest(); // 最高点
         float dd = std::numeric_limits<float>::max();    // 最低点
         
-        // 计算前三笔的重叠区间
-        for (int j = i; j < i + m_config.min_zs_bi_count && j < n; ++j) {
-            zg = std::min(zg, strokes[j].high);
-            zd = std::max(zd, strokes[j].low);
-            gg = std::max(gg, strokes[j].high);
-            dd = std::min(dd, strokes[j].low);
-        }
+        // 计算前三个构件的重叠区间
+        for (int j = i; j < i + in.min_count && j < n; ++j) {
+            zg = std::min(zg, high[j]);
+            zd = std::max(zd, low[j]);
+            gg = std::max(gg, high[j]);
+            dd = std::min(dd, low[j]);
+        }
+        int used = i + in.min_count - 1;
         
         // 检查是否有重叠区间
         if (zg > zd) {
             // 有效中枢
             Pivot pivot;
-            pivot.id = pivot_id++;
+            pivot.id = (int)pivots.size();
             pivot.ZG = zg;
             pivot.ZD = zd;
             pivot.ZZ = (zg + zd) / 2.0f;
             pivot.GG = gg;
             pivot.DD = dd;
-            pivot.start_stroke_id = strokes[i].id;
-            pivot.start_idx = strokes[i].start_idx;
-            pivot.stroke_count = m_config.min_zs_bi_count;
+            pivot.start_stroke_id = in.start_stroke ? in.start_stroke[i] : i;
+            pivot.start_idx = in.start_idx[i];
+            pivot.end_stroke_id = in.end_stroke ? in.end_stroke[used] : used;
+            pivot.level = in.level;
+            pivot.is_upgraded = (in.level >= 2);
             
             // 中枢方向由进入段决定
-            pivot.direction = strokes[i].direction;
-            
-            // 尝试扩展中枢
-            int end_bi = i + m_config.min_zs_bi_count - 1;
-            for (int j = end_bi + 1; j < n; ++j) {
-                // 检查该笔是否与中枢有重叠
-                if (strokes[j].high > zd && strokes[j].low < zg) {
-                    // 有重叠，扩展中枢
-                    end_bi = j;
-                    pivot.stroke_count++;
-                    pivot.GG = std::max(pivot.GG, strokes[j].high);
-                    pivot.DD = std::min(pivot.DD, strokes[j].low);
-                    // 注意：ZG和ZD不变，只是记录更多的笔进入中枢
-                } else {
-                    // 无重叠，中枢结束
-                    break;
-                }
-            }
-            
-            pivot.end_stroke_id = strokes[end_bi].id;
-            pivot.end_idx = strokes[end_bi].end_idx;
+            pivot.direction = in.direction[i];
             
-            m_pivots.push_back(pivot);
+            pivots.push_back(pivot);
+            max_used = std::max(max_used, used);
             
-            // 从中枢结束后的下一笔继续
-            i = end_bi + 1;
+            // 尝试扩展中枢，从中枢结束后的下一个构件继续
+            i = ExtendLastPivot(in, pivots, boundaries, used + 1, in.min_count, max_used);
+            continue;
+        }
+        
+        // 无重叠区间，跳过当前构件
+        i++;
+        
+        // 记录判定断点
+        ZsBoundary boundary;
+        boundary.stroke_idx = i;
+        boundary.pivot_count = (int)pivots.size();
+        boundary.max_used = max_used = std::max(max_used, used);
+        boundary.extending = false;
+        boundary.part_count = 0;
+        boundary.gg = 0;
+        boundary.dd = 0;
+        boundaries.push_back(boundary);
+    }
+    return pivot_dirty;
+}
+
+int ChanCore::ExtendLastPivot(const PivotInput& in, std::vector<Pivot>& pivots,
+                              std::vector<ZsBoundary>& boundaries, int from, int part_count, int& max_used) {
+    Pivot& pivot = pivots.back();
+    const float* high = in.high;
+    const float* low = in.low;
+    int n = in.count;
+    
+    // 一直扩展到最后一个构件的中枢仍依赖后续构件
+    int used = std::numeric_limits<int>::max();
+    int j = from;
+    for (; j < n; ++j) {
+        // 扩展断点：此前的判定只用到第 j-1 个构件及之前
+        ZsBoundary boundary;
+        boundary.stroke_idx = j;
+        boundary.pivot_count = (int)pivots.size();
+        boundary.max_used = max_used = std::max(max_used, j - 1);
+        boundary.extending = true;
+        boundary.part_count = part_count;
+        boundary.gg = pivot.GG;
+        boundary.dd = pivot.DD;
+        boundaries.push_back(boundary);
+        
+        // 检查该构件是否与中枢有重叠
+        if (high[j] > pivot.ZD && low[j] < pivot.ZG) {
+            // 有重叠，扩展中枢
+            part_count++;
+            pivot.GG = std::max(pivot.GG, high[j]);
+            pivot.DD = std::min(pivot.DD, low[j]);
+            // 注意：ZG和ZD不变，只是记录更多的构件进入中枢
         } else {
-            // 无重叠区间，跳过当前笔
-            i++;
+            // 无重叠，中枢结束
+            used = j;
+            break;
         }
     }
     
-    return (int)m_pivots.size();
+    int last = j - 1;
+    pivot.end_stroke_id = in.end_stroke ? in.end_stroke[last] : last;
+    pivot.end_idx = in.end_idx[last];
+    pivot.stroke_count = pivot.end_stroke_id - pivot.start_stroke_id + 1;
+    pivot.is_extended = (part_count > in.min_count);
+    
+    // 记录判定断点
+    ZsBoundary boundary;
+    boundary.stroke_idx = j;
+    boundary.pivot_count = (int)pivots.size();
+    boundary.max_used = max_used = std::max(max_used, used);
+    boundary.extending = false;
+    boundary.part_count = 0;
+    boundary.gg = 0;
+    boundary.dd = 0;
+    boundaries.push_back(boundary);
+    return j;
+}
+
+// ============================================================================
+// 多级别中枢
+// ============================================================================
+// 级别1：以线段为构件，与笔中枢相同的三段重叠与扩展规则
+// 级别k+1（升级）：以级别k的中枢为构件，相邻中枢波动区间 [DD,GG] 重叠即升级，
+// 后续中枢波动区间与之重叠则继续扩展。每个升级中枢至少包含两个下级中枢，
+// 各级中枢数逐级减半，总存储与线段数同量级。
+// 各级复用下一级的结果：下一级返回首个可能变化的中枢，本级只复制变化的构件并从断点续算。
+
+int ChanCore::CheckPivotLevels() {
+    ResetPivotLevels(0);
+    ResumePivotLevels(0);
+    return GetMaxPivotLevel();
+}
+
+const std::vector<Pivot>& ChanCore::GetPivots(int level) const {
+    static const std::vector<Pivot> empty;
+    if (level == 0) {
+        return m_pivots;
+    }
+    if (level < 0 || level > m_pivot_level_count) {
+        return empty;
+    }
+    return m_pivot_levels[level - 1].pivots;
+}
+
+int ChanCore::GetMaxPivotLevel() const {
+    for (int k = m_pivot_level_count; k > 0; --k) {
+        if (!m_pivot_levels[k - 1].pivots.empty()) {
+            return k;
+        }
+    }
+    return 0;
+}
+
+void ChanCore::ResetPivotLevels(int from) {
+    for (int k = from; k < (int)m_pivot_levels.size(); ++k) {
+        m_pivot_levels[k].Reset();
+    }
+    m_pivot_level_count = std::min(m_pivot_level_count, from);
+}
+
+void ChanCore::ResumePivotLevels(int seg_dirty) {
+    if (m_pivot_level_count == 0) {
+        if (m_pivot_levels.empty()) {
+            m_pivot_levels.emplace_back();
+        }
+        m_pivot_level_count = 1;
+    }
+
+    // 线段未变化（多数K线只延长末笔）：各级都无需续算
+    int seg_count = m_seg_points.empty() ? 0 : (int)m_seg_points.size() - 1;
+    if (seg_dirty >= seg_count && seg_count == (int)m_pivot_levels[0].high.size()) {
+        return;
+    }
+
+    int dirty = seg_dirty;
+    for (int k = 0; ; ++k) {
+        PivotLevel& level = m_pivot_levels[k];
+        int from = std::min(dirty, (int)level.high.size());
+        int n;
+        
+        if (k == 0) {
+            // 级别1的构件为线段
+            const std::vector<SegPoint>& pts = m_seg_points;
+            n = pts.empty() ? 0 : (int)pts.size() - 1;
+            level.ResizeParts(n);
+            for (int j = from; j < n; ++j) {
+                const SegPoint& a = pts[j];
+                const SegPoint& b = pts[j + 1];
+                level.high[j] = std::max(a.price, b.price);
+                level.low[j] = std::min(a.price, b.price);
+                level.start_stroke[j] = a.stroke + 1;
+                level.end_stroke[j] = b.stroke;
+                level.start_idx[j] = a.kline_idx;
+                level.end_idx[j] = b.kline_idx;
+                level.direction[j] = (b.type == FractalType::TOP) ? Direction::UP : Direction::DOWN;
+            }
+        } else {
+            // 升级：构件为下一级中枢的波动区间
+            const std::vector<Pivot>& below = m_pivot_levels[k - 1].pivots;
+            n = (int)below.size();
+            level.ResizeParts(n);
+            for (int j = from; j < n; ++j) {
+                const Pivot& pv = below[j];
+                level.high[j] = pv.GG;
+                level.low[j] = pv.DD;
+                level.start_stroke[j] = pv.start_stroke_id;
+                level.end_stroke[j] = pv.end_stroke_id;
+                level.start_idx[j] = pv.start_idx;
+                level.end_idx[j] = pv.end_idx;
+                level.direction[j] = pv.direction;
+            }
+        }
+        
+        PivotInput in;
+        in.high = level.high.data();
+        in.low = level.low.data();
+        in.start_stroke = level.start_stroke.data();
+        in.end_stroke = level.end_stroke.data();
+        in.start_idx = level.start_idx.data();
+        in.end_idx = level.end_idx.data();
+        in.direction = level.direction.data();
+        in.count = n;
+        in.min_count = (k == 0) ? m_config.min_zs_bi_count : 2;
+        in.level = k + 1;
+        dirty = ResumePivots(in, level.pivots, level.boundaries, from);
+        
+        // 不足两个中枢无法再升级
+        if (level.pivots.size() < 2) {
+            ResetPivotLevels(k + 1);
+            break;
+        }
+        if (k + 1 == m_pivot_level_count) {
+            if (m_pivot_level_count == (int)m_pivot_levels.size()) {
+                m_pivot_levels.emplace_back();
+            }
+            ++m_pivot_level_count;
+        }
+    }
+}
+
+// ============================================================================
+// 线段识别 (5.5)
+// ============================================================================
+// 特征序列法：向上段以其中的向下笔为特征元素，按向上方向做包含合并，
+// 特征序列出现顶分型时段结束于分型最高点（向下段镜像对称）。
+//   第一种情况：分型第一、二元素间无缺口，顶分型成立即确认
+//   第二种情况：有缺口，还需新段的特征序列（顶之后的向上笔）出现底分型
+// 段至少包含3笔；确认前价格越过本段起点时，已满3笔的段就此结束，
+// 不足3笔视为上一段延伸（替换末端点）。
+// 端点确认后从终点之后的笔重新扫描新段；每根新笔处理后记录断点供流式续算。
+
+int ChanCore::CheckDUAN() {
+    m_seg_checkpoints.clear();
+    
+    // 线段全部重建，多级别中枢的构件与增量断点失效
+    for (PivotLevel& level : m_pivot_levels) {
+        level.ResizeParts(0);
+        level.boundaries.clear();
+    }
+    
+    ResumeDUAN(0);
+    return (int)GetSegments().size();
+}
+
+void ChanCore::ResetSegScan(int start) {
+    SegScan& scan = m_seg_scan;
+    scan.next = start;
+    scan.start = start;
+    scan.ext = -1;
+    scan.ext_price = 0.0f;
+    scan.ext_kline = 0;
+    scan.has_elem2 = false;
+    scan.elem2_high = 0.0f;
+    scan.elem2_low = 0.0f;
+    scan.gap = false;
+    scan.elem3 = false;
+    scan.rev_count = 0;
+    scan.rev_fractal = false;
+}
+
+void ChanCore::ScanSegmentStroke(int i) {
+    const StrokeSoA& st = m_strokes;
+    SegScan& scan = m_seg_scan;
+    SegPoint& last = m_seg_points.back();
+    
+    // 当前段方向由末端点决定；向下段取反价格，统一按向上段处理
+    bool up = (last.type == FractalType::BOTTOM);
+    Direction seg_dir = up ? Direction::UP : Direction::DOWN;
+    bool with = (st.direction[i] == seg_dir);
+    float hi = up ? st.high[i] : -st.low[i];
+    float lo = up ? st.low[i] : -st.high[i];
+    float start_price = up ? last.price : -last.price;
+    
+    // 越过本段起点：本段已满3笔则在极值处结束（特征序列待定也以此确认），
+    // 否则上一段延伸，末端点替换为该笔的低点
+    // （反向笔为其终点；同向笔只在笔不相接时出现，为其起点）
+    if (lo < start_price) {
+        if (scan.ext >= 0 && scan.ext - scan.start + 1 >= 3) {
+            CommitSegmentPoint(up);
+            return;
+        }
+        m_seg_dirty_point = std::min(m_seg_dirty_point, (int)m_seg_points.size() - 1);
+        last.stroke = with ? i - 1 : i;
+        last.kline_idx = with ? st.start_idx[i] : st.end_idx[i];
+        last.price = up ? st.low[i] : st.high[i];
+        ResetSegScan(with ? i : i + 1);
+        return;
+    }
+    
+    // 创新高：更新候选终点，特征序列从头开始
+    // （同向笔为其终点；反向笔只在笔不相接时出现，为其起点）
+    if (hi > scan.ext_price || (with && scan.ext < 0)) {
+        scan.ext = with ? i : i - 1;
+        scan.ext_price = hi;
+        scan.ext_kline = with ? st.end_idx[i] : st.start_idx[i];
+        scan.has_elem2 = false;
+        scan.gap = false;
+        scan.elem3 = false;
+        scan.rev_count = 0;
+        scan.rev_fractal = false;
+        if (with) {
+            return;
+        }
+    }
+    if (scan.ext < 0) {
+        return;
+    }
+    
+    if (!with) {
+        // 极值之后的反向笔为特征元素，按向上方向合并，寻找顶分型
+        if (scan.elem3) {
+            return;
+        }
+        if (!scan.has_elem2) {
+            scan.has_elem2 = true;
+            scan.elem2_high = hi;
+            scan.elem2_low = lo;
+            // 第一元素：极值笔之前的反向笔
+            int prev = scan.ext - 1;
+            if (prev >= scan.start && st.direction[prev] != seg_dir) {
+                float prev_hi = up ? st.high[prev] : -st.low[prev];
+                scan.gap = prev_hi < lo;
+            }
+        } else if ((scan.elem2_high >= hi && scan.elem2_low <= lo) ||
+                   (hi >= scan.elem2_high && lo <= scan.elem2_low)) {
+            scan.elem2_high = std::max(scan.elem2_high, hi);
+            scan.elem2_low = std::max(scan.elem2_low, lo);
+        } else if (hi < scan.elem2_high && lo < scan.elem2_low) {
+            scan.elem3 = true;
+        } else {
+            scan.elem2_high = hi;
+            scan.elem2_low = lo;
+        }
+    } else if (!scan.rev_fractal) {
+        // 极值之后的同向笔为新段的特征元素，按向下方向合并，寻找底分型
+        int& n = scan.rev_count;
+        if (n > 0 && ((scan.rev_high[n - 1] >= hi && scan.rev_low[n - 1] <= lo) ||
+                      (hi >= scan.rev_high[n - 1] && lo <= scan.rev_low[n - 1]))) {
+            scan.rev_high[n - 1] = std::min(scan.rev_high[n - 1], hi);
+            scan.rev_low[n - 1] = std::min(scan.rev_low[n - 1], lo);
+        } else if (n == 2 &&
+                   scan.rev_high[1] < scan.rev_high[0] && scan.rev_low[1] < scan.rev_low[0] &&
+                   scan.rev_high[1] < hi && scan.rev_low[1] < lo) {
+            scan.rev_fractal = true;
+        } else {
+            if (n == 2) {
+                scan.rev_high[0] = scan.rev_high[1];
+                scan.rev_low[0] = scan.rev_low[1];
+                n = 1;
+            }
+            scan.rev_high[n] = hi;
+            scan.rev_low[n] = lo;
+            ++n;
+        }
+    }
+    
+    // 确认端点：分型成立（有缺口时新段特征序列也已出现分型）且段内至少3笔
+    if (!scan.elem3 || (scan.gap && !scan.rev_fractal) || scan.ext - scan.start + 1 < 3) {
+        return;
+    }
+    
+    CommitSegmentPoint(up);
+}
+
+void ChanCore::CommitSegmentPoint(bool up) {
+    // 当前段结束于极值，从其后一笔重新扫描新段
+    const SegScan& scan = m_seg_scan;
+    SegPoint point;
+    point.stroke = scan.ext;
+    point.kline_idx = scan.ext_kline;
+    point.price = up ? scan.ext_price : -scan.ext_price;
+    point.type = up ? FractalType::TOP : FractalType::BOTTOM;
+    m_seg_points.push_back(point);
+    ResetSegScan(point.stroke + 1);
+}
+
+int ChanCore::ResumeDUAN(int stroke_dirty) {
+    const StrokeSoA& st = m_strokes;
+    int n = st.size();
+    m_seg_dirty_point = (int)m_seg_points.size();
+    
+    // 已处理的笔都未变化：直接续算
+    if (!m_seg_points.empty() && stroke_dirty >= m_seg_scan.next) {
+        ScanSegments(n);
+        return std::max(0, m_seg_dirty_point - 1);
+    }
+    
+    // 回退到只依赖未变化笔的最后一个断点
+    while (!m_seg_checkpoints.empty() && m_seg_checkpoints.back().max_used >= stroke_dirty) {
+        m_seg_checkpoints.pop_back();
+    }
+    
+    if (m_seg_checkpoints.empty()) {
+        m_seg_points.clear();
+        m_seg_dirty_point = 0;
+        ResetSegScan(0);
+        if (n == 0) {
+            return 0;
+        }
+        // 第一个端点为第一笔起点
+        SegPoint first;
+        first.stroke = -1;
+        first.kline_idx = st.start_idx[0];
+        bool up = (st.direction[0] == Direction::UP);
+        first.price = up ? st.low[0] : st.high[0];
+        first.type = up ? FractalType::BOTTOM : FractalType::TOP;
+        m_seg_points.push_back(first);
+    } else {
+        // 保留回退前的末尾端点，续算后与之比较，重算出相同端点的部分不算变化
+        const SegCheckpoint& cp = m_seg_checkpoints.back();
+        int base = cp.point_count - 1;
+        m_seg_old_tail.assign(m_seg_points.begin() + std::min(base, (int)m_seg_points.size()),
+                              m_seg_points.end());
+        m_seg_scan = cp.scan;
+        m_seg_points.resize(cp.point_count);
+        m_seg_points.back() = cp.back;
+        m_seg_dirty_point = std::min(m_seg_dirty_point, base);
+        ScanSegments(n);
+        
+        int p = m_seg_dirty_point;
+        int same_end = std::min((int)m_seg_points.size(), base + (int)m_seg_old_tail.size());
+        while (p < same_end && m_seg_points[p] == m_seg_old_tail[p - base]) {
+            ++p;
+        }
+        m_seg_dirty_point = p;
+        return std::max(0, m_seg_dirty_point - 1);
+    }
+    ScanSegments(n);
+    
+    // 端点 p 变化影响第 p-1、p 段
+    return std::max(0, m_seg_dirty_point - 1);
+}
+
+void ChanCore::ScanSegments(int n) {
+    while (m_seg_scan.next < n) {
+        int i = m_seg_scan.next++;
+        ScanSegmentStroke(i);
+        
+        // 每根新笔处理后记录断点；确认端点后重扫的笔不再记录（依赖已到更后的笔）
+        if (m_seg_checkpoints.empty() || i > m_seg_checkpoints.back().max_used) {
+            SegCheckpoint cp;
+            cp.scan = m_seg_scan;
+            cp.point_count = (int)m_seg_points.size();
+            cp.back = m_seg_points.back();
+            cp.max_used = i;
+            m_seg_checkpoints.push_back(cp);
+        }
+    }
+}
+
+// ============================================================================
+// 背驰判断（MACD面积）
+// ============================================================================
+// MACD 随K线流式递推（EMA只依赖上一根的状态），红/绿柱面积各存前缀和，
+// 任意区间面积 O(1)。盘中刷新最后一根时回退到上一根的状态重新递推。
+// 背驰：中枢的进入段与离开段同向，离开段创新高（新低）而同向MACD柱面积更小。
+// 中枢扩展到第一个不重叠的构件为止，离开中枢的一段与中枢重叠而计入中枢，
+// 故离开段取中枢最后一个构件（与进入段反向时为向另一侧离开，不构成背驰）。
+
+void ChanCore::PushMACD(float close) {
+    MacdState s;
+    if (m_macd.empty()) {
+        // 与通达信 EMA 一致：首根以收盘价为初值，DIF=DEA=0
+        s.fast = close;
+        s.slow = close;
+        s.dea = 0.0;
+    } else {
+        const double af = 2.0 / (std::max(1, m_config.macd_fast) + 1);
+        const double as = 2.0 / (std::max(1, m_config.macd_slow) + 1);
+        const double ad = 2.0 / (std::max(1, m_config.macd_signal) + 1);
+        const MacdState& p = m_macd_last;
+        s.fast = p.fast + af * (close - p.fast);
+        s.slow = p.slow + as * (close - p.slow);
+        s.dea = p.dea + ad * ((s.fast - s.slow) - p.dea);
+    }
+    m_macd_prev = m_macd_last;
+    m_macd_last = s;
+    
+    double bar = 2.0 * (s.fast - s.slow - s.dea);
+    m_macd.push_back((float)bar);
+    m_macd_red.push_back(m_macd_red.back() + (bar > 0.0 ? bar : 0.0));
+    m_macd_green.push_back(m_macd_green.back() + (bar < 0.0 ? -bar : 0.0));
+}
+
+void ChanCore::PopMACD() {
+    m_macd.pop_back();
+    m_macd_red.pop_back();
+    m_macd_green.pop_back();
+    m_macd_last = m_macd_prev;
+}
+
+float ChanCore::GetMACDArea(int start_idx, int end_idx, Direction dir) const {
+    int n = (int)m_macd.size();
+    start_idx = std::max(0, start_idx);
+    end_idx = std::min(n - 1, end_idx);
+    if (start_idx > end_idx) {
+        return 0.0f;
+    }
+    const std::vector<double>& sum = (dir == Direction::UP) ? m_macd_red : m_macd_green;
+    return (float)(sum[end_idx + 1] - sum[start_idx]);
+}
+
+void ChanCore::ScanDivergence(std::vector<Signal>* signals, std::vector<ChanEvent>* events,
+                              float* out, int count) const {
+    if (!HasMACD()) {
+        return;
+    }
+    
+    auto emit = [&](int idx, bool top, float price, int pivot_id, int strength,
+                    ReasonCode reason) {
+        if (out && idx >= 0 && idx < count) {
+            out[idx] = top ? 1.0f : -1.0f;
+        }
+        if (events) {
+            ChanEvent ev;
+            ev.index = idx;
+            ev.kind = EventKind::DIVERGENCE;
+            ev.code = top ? 1 : -1;
+            ev.reason = reason;
+            ev.price = price;
+            ev.ref = pivot_id;
+            events->push_back(ev);
+        }
+        if (signals) {
+            Signal sig;
+            sig.index = idx;
+            sig.type = top ? SignalType::SELL1 : SignalType::BUY1;
+            sig.price = price;
+            sig.strength = strength;
+            sig.pivot_id = pivot_id;
+            sig.has_divergence = true;
+            sig.reason = reason;
+            signals->push_back(sig);
+        }
+    };
+    
+    // 笔中枢：进入笔为中枢第一笔之前一笔，离开笔为中枢最后一笔
+    const StrokeSoA& st = m_strokes;
+    for (const Pivot& pivot : m_pivots) {
+        int e = pivot.start_stroke_id - 1;
+        int l = pivot.end_stroke_id;
+        if (e < 0 || st.direction[e] != st.direction[l]) {
+            continue;
+        }
+        bool up = (st.direction[l] == Direction::UP);
+        bool extreme = up ? st.high[l] > st.high[e] : st.low[l] < st.low[e];
+        if (!extreme) {
+            continue;
+        }
+        float area_in = GetMACDArea(st.start_idx[e], st.end_idx[e], st.direction[e]);
+        float area_out = GetMACDArea(st.start_idx[l], st.end_idx[l], st.direction[l]);
+        if (area_out < area_in) {
+            emit(st.end_idx[l], up, up ? st.high[l] : st.low[l], pivot.id, 1, ReasonCode::STROKE_PIVOT_DIVERGENCE);
+        }
+    }
+    
+    // 线段中枢：端点按笔下标递增，进入段终止于中枢第一笔之前的端点，离开段终止于中枢终点
+    const std::vector<Pivot>& seg_pivots = GetPivots(1);
+    const std::vector<SegPoint>& points = m_seg_points;
+    auto find_point = [&](int stroke) {
+        auto it = std::lower_bound(points.begin(), points.end(), stroke,
+                                   [](const SegPoint& p, int s) { return p.stroke < s; });
+        return (it != points.end() && it->stroke == stroke) ? (int)(it - points.begin()) : -1;
+    };
+    for (const Pivot& pivot : seg_pivots) {
+        int q_in = find_point(pivot.start_stroke_id - 1);
+        int q_out = find_point(pivot.end_stroke_id);
+        if (q_in < 1 || q_out < 0) {
+            continue;
+        }
+        const SegPoint& in_end = points[q_in];
+        const SegPoint& out_end = points[q_out];
+        if (in_end.type != out_end.type) {
+            continue;
+        }
+        bool up = (out_end.type == FractalType::TOP);
+        bool extreme = up ? out_end.price > in_end.price : out_end.price < in_end.price;
+        if (!extreme) {
+            continue;
+        }
+        Direction dir = up ? Direction::UP : Direction::DOWN;
+        float area_in = GetMACDArea(points[q_in - 1].kline_idx, in_end.kline_idx, dir);
+        float area_out = GetMACDArea(points[q_out - 1].kline_idx, out_end.kline_idx, dir);
+        if (area_out < area_in) {
+            emit(out_end.kline_idx, up, out_end.price, pivot.id, 2, ReasonCode::SEGMENT_PIVOT_DIVERGENCE);
+        }
+    }
+}
+
+std::vector<Signal> ChanCore::CheckBC() const {
+    std::vector<Signal> signals;
+    ScanDivergence(&signals, nullptr, nullptr, 0);
+    std::stable_sort(signals.begin(), signals.end(),
+                     [](const Signal& a, const Signal& b) { return a.index < b.index; });
+    return signals;
+}
+
+// ============================================================================
+// 稀疏结果
+// ============================================================================
+// 各种类分别按K线顺序生成，再对追加部分整体排序（std::sort 原地进行，不分配内存）
+
+int ChanCore::CollectEvents(uint32_t kinds, std::vector<ChanEvent>& out,
+                            const float* highs, const float* lows, int first_bar) const {
+    const size_t base = out.size();
+    first_bar = std::max(0, first_bar);
+    auto push = [&](int index, EventKind kind, int code, ReasonCode reason, float price, int ref) {
+        if (index < first_bar) {
+            return;
+        }
+        ChanEvent ev;
+        ev.index = index;
+        ev.kind = kind;
+        ev.code = (int8_t)code;
+        ev.reason = reason;
+        ev.price = price;
+        ev.ref = ref;
+        out.push_back(ev);
+    };
+    
+    if (kinds & EventBit(EventKind::FRACTAL)) {
+        const FractalSoA& fx = m_fractals;
+        for (int i = 0; i < fx.size(); ++i) {
+            push(fx.kline_idx[i], EventKind::FRACTAL, fx.type[i] == FractalType::TOP ? 1 : -1,
+                 ReasonCode::NONE, fx.price[i], -1);
+        }
+    }
+    
+    if (kinds & EventBit(EventKind::STROKE)) {
+        // 与 OutputBI 相同的端点：首笔（及不相接的笔）起点，各笔终点
+        const StrokeSoA& st = m_strokes;
+        for (int i = 0; i < st.size(); ++i) {
+            bool up = (st.direction[i] == Direction::UP);
+            if (i == 0 || st.start_idx[i] != st.end_idx[i - 1]) {
+                push(st.start_idx[i], EventKind::STROKE, up ? -1 : 1, ReasonCode::NONE,
+                     up ? st.low[i] : st.high[i], i - 1);
+            }
+            push(st.end_idx[i], EventKind::STROKE, up ? 1 : -1, ReasonCode::NONE,
+                 up ? st.high[i] : st.low[i], i);
+        }
+    }
+    
+    if ((kinds & EventBit(EventKind::SEGMENT)) && m_seg_points.size() >= 2) {
+        for (size_t i = 0; i < m_seg_points.size(); ++i) {
+            const SegPoint& point = m_seg_points[i];
+            push(point.kline_idx, EventKind::SEGMENT, point.type == FractalType::TOP ? 1 : -1,
+                 ReasonCode::NONE, point.price, (int)i - 1);
+        }
+    }
+    
+    if (kinds & (EventBit(EventKind::PIVOT_START) | EventBit(EventKind::PIVOT_END))) {
+        for (int level = 0; level <= GetMaxPivotLevel(); ++level) {
+            for (const Pivot& pivot : GetPivots(level)) {
+                if (kinds & EventBit(EventKind::PIVOT_START)) {
+                    push(pivot.start_idx, EventKind::PIVOT_START, level, ReasonCode::NONE,
+                         pivot.ZG, pivot.id);
+                }
+                if (kinds & EventBit(EventKind::PIVOT_END)) {
+                    push(pivot.end_idx, EventKind::PIVOT_END, level, ReasonCode::NONE,
+                         pivot.ZD, pivot.id);
+                }
+            }
+        }
+    }
+    
+    if ((kinds & EventBit(EventKind::SIGNAL)) && m_signal_table_ready) {
+        using namespace SignalBits;
+        // 各字段：原因码、位移、位宽
+        static const struct { ReasonCode reason; int shift; int width; } fields[] = {
+            { ReasonCode::FIRST, FIRST_SHIFT, 2 },
+            { ReasonCode::SECOND, SECOND_SHIFT, 2 },
+            { ReasonCode::THIRD, THIRD_SHIFT, 1 },
+            { ReasonCode::PRE_FIRST, PRE_FIRST_SHIFT, 1 },
+            { ReasonCode::PRE_SECOND, PRE_SECOND_SHIFT, 1 },
+            { ReasonCode::PRE_THIRD, PRE_THIRD_SHIFT, 1 },
+            { ReasonCode::LIKE_SECOND, LIKE_SECOND_SHIFT, 2 },
+        };
+        for (int i = first_bar; i < (int)m_signal_table.size(); ++i) {
+            uint32_t table = m_signal_table[i];
+            if (table == 0) {
+                continue;
+            }
+            for (int side = 0; side < 2; ++side) {
+                bool sell = (side == 1);
+                uint32_t bits = (table >> (sell ? SELL_SHIFT : 0)) & 0xFFFFu;
+                if (bits == 0) {
+                    continue;
+                }
+                const float* prices = sell ? highs : lows;
+                float price = prices ? prices[i] : 0.0f;
+                for (const auto& f : fields) {
+                    int value = Field(bits, f.shift, f.width);
+                    if (value) {
+                        push(i, EventKind::SIGNAL, sell ? -value : value, f.reason, price, -1);
+                    }
+                }
+            }
+        }
+    }
+    
+    if (kinds & EventBit(EventKind::DIVERGENCE)) {
+        ScanDivergence(nullptr, &out, nullptr, 0);
+        // 背驰事件数与中枢同量级，直接剔除窗口之前的
+        out.erase(std::remove_if(out.begin() + base, out.end(), [&](const ChanEvent& ev) {
+            return ev.index < first_bar;
+        }), out.end());
+    }
+    
+    std::sort(out.begin() + base, out.end(), [](const ChanEvent& a, const ChanEvent& b) {
+        if (a.index != b.index) return a.index < b.index;
+        if (a.kind != b.kind) return a.kind < b.kind;
+        if (a.reason != b.reason) return a.reason < b.reason;
+        if (a.code != b.code) return a.code < b.code;
+        return a.ref < b.ref;
+    });
+    return (int)(out.size() - base);
 }
 
 // ============================================================================
@@ -481,10 +1611,11 @@ void ChanCore::OutputFX(float* out, int count) const {
     memset(out, 0, count * sizeof(float));
     
     // 填充分型标记
-    for (const auto& fx : m_fractals) {
-        int idx = fx.kline_idx;
+    const FractalSoA& fx = m_fractals;
+    for (int i = 0; i < fx.size(); ++i) {
+        int idx = fx.kline_idx[i];
         if (idx >= 0 && idx < count) {
-            out[idx] = static_cast<float>(fx.type == FractalType::TOP ? 1 : -1);
+            out[idx] = static_cast<float>(fx.type[i] == FractalType::TOP ? 1 : -1);
         }
     }
 }
@@ -496,23 +1627,47 @@ void ChanCore::OutputBI(float* out, int count) const {
     memset(out, 0, count * sizeof(float));
     
     // 填充笔端点
-    for (const auto& stroke : m_strokes) {
+    const StrokeSoA& st = m_strokes;
+    for (int i = 0; i < st.size(); ++i) {
+        bool up = (st.direction[i] == Direction::UP);
+        
         // 起点
-        int start = stroke.start_idx;
+        int start = st.start_idx[i];
         if (start >= 0 && start < count) {
-            out[start] = (stroke.direction == Direction::UP) ? 
-                         stroke.low : stroke.high;
+            out[start] = up ? st.low[i] : st.high[i];
         }
         
         // 终点
-        int end = stroke.end_idx;
+        int end = st.end_idx[i];
         if (end >= 0 && end < count) {
-            out[end] = (stroke.direction == Direction::UP) ? 
-                       stroke.high : stroke.low;
+            out[end] = up ? st.high[i] : st.low[i];
+        }
+    }
+}
+
+void ChanCore::OutputDUAN(float* out, int count) const {
+    if (!out || count <= 0) return;
+    
+    // 初始化为0
+    memset(out, 0, count * sizeof(float));
+    
+    // 填充线段端点（不足一段时不输出）
+    if (m_seg_points.size() < 2) return;
+    for (const SegPoint& point : m_seg_points) {
+        if (point.kline_idx >= 0 && point.kline_idx < count) {
+            out[point.kline_idx] = point.price;
         }
     }
 }
 
+void ChanCore::OutputBC(float* out, int count) const {
+    if (!out || count <= 0) return;
+    
+    // 初始化为0
+    memset(out, 0, count * sizeof(float));
+    ScanDivergence(nullptr, nullptr, out, count);
+}
+
 void ChanCore::OutputZS_H(float* out, int count) const {
     if (!out || count <= 0) return;
     
@@ -545,6 +1700,20 @@ void ChanCore::OutputZS_L(float* out, int count) const {
     }
 }
 
+int ChanCore::GetRangeHighIndex(int first, int last) const {
+    if (m_range.Count() != m_raw_count) {
+        return -1;
+    }
+    return m_range.ArgMax(first, last);
+}
+
+int ChanCore::GetRangeLowIndex(int first, int last) const {
+    if (m_range.Count() != m_raw_count) {
+        return -1;
+    }
+    return m_range.ArgMin(first, last);
+}
+
 int ChanCore::GetMergedIndex(int raw_index) const {
     if (raw_index < 0 || raw_index >= (int)m_raw_to_merged.size()) {
         return -1;
@@ -557,102 +1726,85 @@ int ChanCore::GetMergedIndex(int raw_index) const {
 // ============================================================================
 
 void ChanCore::BuildBiSequence(int current_bar_idx) {
-    // 清空之前的数据
+    // 清空之前的数据（默认构造即全0）
     m_bi_sequence.clear();
+    m_signal_table_ready = false;
+    if (current_bar_idx < 0) {
+        return;
+    }
     m_bi_sequence.resize(current_bar_idx + 1);
-    
+
     if (m_strokes.empty()) {
         return;
     }
-    
-    // 为每一根K线计算其对应的 GG/DD/HH/LL 序列
+
+    // 单次前向扫描 O(N+S)：
+    // CheckBI 产出的笔按 end_idx 严格递增，因此沿K线前进时只需把
+    // 新完成的笔压入 5 深的顶/底滚动窗口，窗口即为 GG1-5 / DD1-5。
+    // 结果与逐K线收集+排序的旧实现逐字节一致。
+    float top_price[5] = {0};      // top_price[0] = GG1
+    int   top_idx[5] = {0};        // 对应顶点K线索引
+    int   top_count = 0;
+    float bottom_price[5] = {0};   // bottom_price[0] = DD1
+    int   bottom_idx[5] = {0};
+    int   bottom_count = 0;
+    int   direction = 0;           // 等价于 GetStateAt(bar).seq.direction
+
+    const StrokeSoA& st = m_strokes;
+    const int stroke_count = st.size();
+    int next = 0;  // 下一根尚未完成的笔
+
     for (int bar = 0; bar <= current_bar_idx; ++bar) {
-        BiSequenceData& seq = m_bi_sequence[bar];
-        
-        // 初始化为0
-        for (int i = 0; i < 6; ++i) {
-            seq.GG[i] = 0.0f;
-            seq.DD[i] = 0.0f;
-            seq.HH[i] = 0;
-            seq.LL[i] = 0;
-        }
-        seq.direction = 0;
-        
-        // 收集在当前K线之前完成的所有顶点和底点
-        std::vector<std::pair<float, int>> tops;    // (价格, K线索引)
-        std::vector<std::pair<float, int>> bottoms; // (价格, K线索引)
-        
-        for (const auto& stroke : m_strokes) {
-            // 只考虑在当前K线之前完成的笔
-            if (stroke.end_idx > bar) {
-                continue;
-            }
-            
-            if (stroke.direction == Direction::UP) {
+        // 压入所有在当前K线（含）之前完成的笔
+        while (next < stroke_count && st.end_idx[next] <= bar) {
+            const int k_stroke = next++;
+
+            if (st.direction[k_stroke] == Direction::UP) {
                 // 向上笔：终点是顶点
-                tops.push_back({stroke.high, stroke.end_idx});
+                for (int k = 4; k > 0; --k) {
+                    top_price[k] = top_price[k - 1];
+                    top_idx[k] = top_idx[k - 1];
+                }
+                top_price[0] = st.high[k_stroke];
+                top_idx[0] = st.end_idx[k_stroke];
+                if (top_count < 5) ++top_count;
+                direction = -1;  // 上涨后，看跌
             } else {
                 // 向下笔：终点是底点
-                bottoms.push_back({stroke.low, stroke.end_idx});
+                for (int k = 4; k > 0; --k) {
+                    bottom_price[k] = bottom_price[k - 1];
+                    bottom_idx[k] = bottom_idx[k - 1];
+                }
+                bottom_price[0] = st.low[k_stroke];
+                bottom_idx[0] = st.end_idx[k_stroke];
+                if (bottom_count < 5) ++bottom_count;
+                direction = (st.direction[k_stroke] == Direction::DOWN) ? 1 : 0;
             }
         }
-        
-        // 按K线索引降序排序（最近的在前）
-        auto cmp = [](const std::pair<float, int>& a, const std::pair<float, int>& b) {
-            return a.second > b.second;
-        };
-        std::sort(tops.begin(), tops.end(), cmp);
-        std::sort(bottoms.begin(), bottoms.end(), cmp);
-        
+
+        BiSequenceData& seq = m_bi_sequence[bar];
+
         // 填充 GG1-GG5, HH1-HH5
-        for (int i = 0; i < 5 && i < (int)tops.size(); ++i) {
-            seq.GG[i + 1] = tops[i].first;  // GG[1] = GG1
-            seq.HH[i + 1] = bar - tops[i].second;
+        for (int i = 0; i < top_count; ++i) {
+            seq.GG[i + 1] = top_price[i];  // GG[1] = GG1
+            seq.HH[i + 1] = bar - top_idx[i];
         }
-        
+
         // 填充 DD1-DD5, LL1-LL5
-        for (int i = 0; i < 5 && i < (int)bottoms.size(); ++i) {
-            seq.DD[i + 1] = bottoms[i].first;  // DD[1] = DD1
-            seq.LL[i + 1] = bar - bottoms[i].second;
+        for (int i = 0; i < bottom_count; ++i) {
+            seq.DD[i + 1] = bottom_price[i];  // DD[1] = DD1
+            seq.LL[i + 1] = bar - bottom_idx[i];
         }
-        
-        // 计算方向
-        seq.direction = CalculateDirection(bar);
+
+        seq.direction = direction;
     }
 }
 
-int ChanCore::CalculateDirection(int bar_idx) const {
-    // 方向判断规则：
-    // 方向=1：下跌趋势后（底分型）- 看涨
-    // 方向=-1：上涨趋势后（顶分型）- 看跌
-    // 方向=0：震荡
-    
-    if (m_strokes.empty()) {
-        return 0;
-    }
-    
-    // 找到当前K线所在的最近一笔
-    const Stroke* lastStroke = nullptr;
-    for (auto it = m_strokes.rbegin(); it != m_strokes.rend(); ++it) {
-        if (it->end_idx <= bar_idx) {
-            lastStroke = &(*it);
-            break;
-        }
-    }
-    
-    if (!lastStroke) {
-        return 0;
-    }
-    
-    // 如果最近完成的笔是向下笔，说明刚形成底分型，方向=1（看涨）
-    // 如果最近完成的笔是向上笔，说明刚形成顶分型，方向=-1（看跌）
-    if (lastStroke->direction == Direction::DOWN) {
-        return 1;   // 下跌后，看涨
-    } else if (lastStroke->direction == Direction::UP) {
-        return -1;  // 上涨后，看跌
+int ChanCore::LastStrokeOf(int stroke, Direction dir) const {
+    if (stroke < 0) {
+        return -1;
     }
-    
-    return 0;
+    return m_strokes.direction[stroke] == dir ? stroke : m_strokes.prev_turn[stroke];
 }
 
 float ChanCore::GetGG(int bar_idx, int n) const {
@@ -690,6 +1842,53 @@ int ChanCore::GetDirection(int bar_idx) const {
     return m_bi_sequence[bar_idx].direction;
 }
 
+ChanState ChanCore::GetStateAt(int bar_idx) const {
+    ChanState state;
+    if (bar_idx < 0) {
+        return state;
+    }
+    state.seq.kline_idx = bar_idx;
+    
+    // 最后一根终点不晚于该K线的笔（笔终点严格递增）
+    const StrokeSoA& st = m_strokes;
+    int last = (int)(std::upper_bound(st.end_idx.begin(), st.end_idx.end(), bar_idx) -
+                     st.end_idx.begin()) - 1;
+    if (last < 0) {
+        return state;
+    }
+    state.stroke = last;
+    
+    // 方向：最近完成的是向下笔 = 下跌后（1），向上笔 = 上涨后（-1）
+    state.seq.direction = st.direction[last] == Direction::DOWN ? 1 :
+                          st.direction[last] == Direction::UP ? -1 : 0;
+    
+    // GG1-5：最近5根向上笔的终点；DD1-5：最近5根向下笔的终点
+    int up = LastStrokeOf(last, Direction::UP);
+    for (int n = 1; n <= 5 && up >= 0; ++n) {
+        state.seq.GG[n] = st.high[up];
+        state.seq.HH[n] = bar_idx - st.end_idx[up];
+        up = LastStrokeOf(up - 1, Direction::UP);
+    }
+    int down = LastStrokeOf(last, Direction::DOWN);
+    for (int n = 1; n <= 5 && down >= 0; ++n) {
+        state.seq.DD[n] = st.low[down];
+        state.seq.LL[n] = bar_idx - st.end_idx[down];
+        down = LastStrokeOf(down - 1, Direction::DOWN);
+    }
+    
+    // 笔中枢按起始笔递增：已形成 = 前 min_zs_bi_count 笔均已完成
+    int formed_start = last - std::max(m_config.min_zs_bi_count, 1) + 1;
+    int pivot = (int)(std::upper_bound(m_pivots.begin(), m_pivots.end(), formed_start,
+                                       [](int stroke, const Pivot& p) {
+                                           return stroke < p.start_stroke_id;
+                                       }) - m_pivots.begin()) - 1;
+    if (pivot >= 0) {
+        state.pivot = pivot;
+        state.in_pivot = last <= m_pivots[pivot].end_stroke_id;
+    }
+    return state;
+}
+
 // ============================================================================
 // 阶段二：幅度计算
 // ============================================================================
@@ -852,6 +2051,7 @@ void ChanCore::OutputLL(float* out, int count, int n) const {
 void ChanCore::SetMAData(const float* ma13, const float* ma26, int count) {
     m_ma13.clear();
     m_ma26.clear();
+    m_signal_table_ready = false;
     
     if (ma13 && count > 0) {
         m_ma13.assign(ma13, ma13 + count);
@@ -861,6 +2061,22 @@ void ChanCore::SetMAData(const float* ma13, const float* ma26, int count) {
     }
 }
 
+void ChanCore::ComputeMAData(const float* closes, int count) {
+    m_ma13.clear();
+    m_ma26.clear();
+    m_signal_table_ready = false;
+    
+    if (!closes || count <= 0) {
+        return;
+    }
+    
+    const int periods[2] = { m_config.ma_short_period, m_config.ma_long_period };
+    m_ma13.resize(count);
+    m_ma26.resize(count);
+    float* outs[2] = { m_ma13.data(), m_ma26.data() };
+    CalcMovingAverages(closes, 0, count, periods, 2, outs);
+}
+
 bool ChanCore::CheckFiveDownPattern(int bar_idx) const {
     // 五段下跌形态：
     // DD1 < GG1（当前底低于当前顶）
@@ -2014,6 +3230,121 @@ void ChanCore::OutputLikeSecondSellSignal(float* out, int count, const float* hi
     }
 }
 
+// ============================================================================
+// 信号位图
+// ============================================================================
+// 各 Output*Signal 按优先级逐K线调用多个 Check*，多个输出一起调用时同一条件
+// 会被重复评估。位图把每个条件逐K线只评估一次，各输出只做位运算投影。
+
+void ChanCore::BuildSignalTable(const float* highs, const float* lows, int count) {
+    int n = std::max(0, std::min(count, (int)m_bi_sequence.size()));
+    m_signal_table.assign(n, 0u);
+    
+    for (int i = 0; i < n; ++i) {
+        // 所有买点条件都要求方向=1，卖点条件都要求方向=-1：
+        // 每根K线至多一侧需要评估
+        int direction = m_bi_sequence[i].direction;
+        if (direction == 1) {
+            m_signal_table[i] = EvaluateBuyBits(i, lows ? lows[i] : 0);
+        } else if (direction == -1) {
+            m_signal_table[i] = EvaluateSellBits(i, highs ? highs[i] : 0) << SignalBits::SELL_SHIFT;
+        }
+    }
+    
+    m_signal_table_ready = true;
+}
+
+uint32_t ChanCore::EvaluateBuyBits(int i, float low) const {
+    uint32_t buy = 0;
+    buy |= (uint32_t)CheckFirstBuy(i, low) << SignalBits::FIRST_SHIFT;
+    buy |= (uint32_t)CheckSecondBuy(i, low) << SignalBits::SECOND_SHIFT;
+    buy |= (uint32_t)CheckThirdBuy(i, low) << SignalBits::THIRD_SHIFT;
+    buy |= (uint32_t)CheckPreFirstBuy(i, low) << SignalBits::PRE_FIRST_SHIFT;
+    buy |= (uint32_t)CheckPreSecondBuy(i, low) << SignalBits::PRE_SECOND_SHIFT;
+    buy |= (uint32_t)CheckPreThirdBuy(i, low) << SignalBits::PRE_THIRD_SHIFT;
+    buy |= (uint32_t)CheckLikeSecondBuy(i, low) << SignalBits::LIKE_SECOND_SHIFT;
+    return buy;
+}
+
+uint32_t ChanCore::EvaluateSellBits(int i, float high) const {
+    uint32_t sell = 0;
+    sell |= (uint32_t)CheckFirstSell(i, high) << SignalBits::FIRST_SHIFT;
+    sell |= (uint32_t)CheckSecondSell(i, high) << SignalBits::SECOND_SHIFT;
+    sell |= (uint32_t)CheckThirdSell(i, high) << SignalBits::THIRD_SHIFT;
+    sell |= (uint32_t)CheckPreFirstSell(i, high) << SignalBits::PRE_FIRST_SHIFT;
+    sell |= (uint32_t)CheckPreSecondSell(i, high) << SignalBits::PRE_SECOND_SHIFT;
+    sell |= (uint32_t)CheckPreThirdSell(i, high) << SignalBits::PRE_THIRD_SHIFT;
+    sell |= (uint32_t)CheckLikeSecondSell(i, high) << SignalBits::LIKE_SECOND_SHIFT;
+    return sell;
+}
+
+void ChanCore::ProjectSignal(SignalOutput kind, float* out, int count) const {
+    if (!out || count <= 0) return;
+    
+    memset(out, 0, count * sizeof(float));
+    if (!m_signal_table_ready) {
+        return;
+    }
+    
+    using namespace SignalBits;
+    bool sell = (kind == SignalOutput::SELL || kind == SignalOutput::SELLX ||
+                 kind == SignalOutput::PRESELL || kind == SignalOutput::LIKE2S);
+    float sign = sell ? -1.0f : 1.0f;
+    int shift = sell ? SELL_SHIFT : 0;
+    
+    int n = std::min(count, (int)m_signal_table.size());
+    for (int i = 0; i < n; ++i) {
+        uint32_t bits = m_signal_table[i] >> shift;
+        if ((bits & 0xFFFFu) == 0) {
+            continue;
+        }
+        
+        int first = Field(bits, FIRST_SHIFT, 2);
+        int second = Field(bits, SECOND_SHIFT, 2);
+        int third = Field(bits, THIRD_SHIFT, 1);
+        int pre_first = Field(bits, PRE_FIRST_SHIFT, 1);
+        int pre_second = Field(bits, PRE_SECOND_SHIFT, 1);
+        int pre_third = Field(bits, PRE_THIRD_SHIFT, 1);
+        int like_second = Field(bits, LIKE_SECOND_SHIFT, 2);
+        
+        float value = 0.0f;
+        switch (kind) {
+            case SignalOutput::BUY:
+            case SignalOutput::SELL:
+                // 细分类型：1-3=一买, 11-13=二买, 21=三买
+                if (first) value = (float)first;
+                else if (second) value = 10.0f + second;
+                else if (third) value = 20.0f + third;
+                break;
+            case SignalOutput::BUYX:
+            case SignalOutput::SELLX:
+                // 标准 > 类二买 > 准买点
+                if (first) value = 1.0f;
+                else if (second) value = 2.0f;
+                else if (third) value = 3.0f;
+                else if (m_config.enable_like_signals && like_second) value = 21.0f;
+                else if (m_config.enable_pre_signals && pre_first) value = 11.0f;
+                else if (m_config.enable_pre_signals && pre_second) value = 12.0f;
+                else if (m_config.enable_pre_signals && pre_third) value = 13.0f;
+                break;
+            case SignalOutput::PREBUY:
+            case SignalOutput::PRESELL:
+                if (pre_first) value = 11.0f;
+                else if (pre_second) value = 12.0f;
+                else if (pre_third) value = 13.0f;
+                break;
+            case SignalOutput::LIKE2B:
+            case SignalOutput::LIKE2S:
+                // 1=A型 -> 21, 2=AAA型 -> 22
+                if (like_second) value = 20.0f + like_second;
+                break;
+            default:
+                break;
+        }
+        out[i] = sign * value;
+    }
+}
+
 void ChanCore::OutputNewBar(float* out, int count) const {
     if (!out || count <= 0) return;
     
@@ -2024,9 +3355,9 @@ void ChanCore::OutputNewBar(float* out, int count) const {
     
     // 标记新K线（去包含后保留的K线）
     // 使用合并后的K线序列来确定哪些原始K线被保留
-    for (const auto& merged_kline : m_merged_klines) {
-        // merged_kline.index 是合并后K线对应的原始索引
-        int idx = merged_kline.index;
+    for (int i = 0; i < m_merged_klines.size(); ++i) {
+        // merge_start 是合并后K线对应的原始索引
+        int idx = m_merged_klines.merge_start[i];
         if (idx >= 0 && idx < count) {
             out[idx] = 1.0f;  // 1=新K线（被保留）
         }
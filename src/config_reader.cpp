@@ -5,11 +5,121 @@
 #include "config_reader.h"
 #include "chan_core.h"
 #include "logger.h"
-#include <sstream>
+#include <cctype>
+#include <cstdlib>
+#include <cstring>
 #include <fstream>
+#include <sstream>
+
+#ifdef _WIN32
+#include <windows.h>
+#endif
 
 namespace chan {
 
+// ============================================================================
+// IniFile 实现
+// ============================================================================
+
+static std::string Trim(const std::string& text) {
+    size_t begin = 0;
+    size_t end = text.size();
+    while (begin < end && isspace((unsigned char)text[begin])) ++begin;
+    while (end > begin && isspace((unsigned char)text[end - 1])) --end;
+    return text.substr(begin, end - begin);
+}
+
+static std::string ToLower(std::string text) {
+    for (char& c : text) {
+        c = (char)tolower((unsigned char)c);
+    }
+    return text;
+}
+
+std::string IniFile::MakeKey(const char* section, const char* key) {
+    return ToLower(Trim(section)) + "\n" + ToLower(Trim(key));
+}
+
+bool IniFile::Load(const std::string& path) {
+    std::ifstream file(path, std::ios::binary);
+    if (!file.good()) {
+        return false;
+    }
+    std::stringstream buffer;
+    buffer << file.rdbuf();
+    Parse(buffer.str());
+    return true;
+}
+
+void IniFile::Parse(const std::string& text) {
+    m_values.clear();
+    
+    std::string section;
+    std::istringstream stream(text);
+    std::string line;
+    bool first_line = true;
+    while (std::getline(stream, line)) {
+        // 跳过 UTF-8 BOM
+        if (first_line && line.compare(0, 3, "\xEF\xBB\xBF") == 0) {
+            line.erase(0, 3);
+        }
+        first_line = false;
+        
+        line = Trim(line);
+        if (line.empty() || line[0] == ';' || line[0] == '#') {
+            continue;
+        }
+        
+        if (line[0] == '[') {
+            size_t close = line.find(']');
+            section = Trim(line.substr(1, close == std::string::npos ? std::string::npos : close - 1));
+            continue;
+        }
+        
+        size_t eq = line.find('=');
+        if (eq == std::string::npos) {
+            continue;
+        }
+        std::string key = MakeKey(section.c_str(), line.substr(0, eq).c_str());
+        // 同一键出现多次时取第一个（与 GetPrivateProfileString 一致）
+        m_values.insert(std::make_pair(key, Trim(line.substr(eq + 1))));
+    }
+}
+
+const std::string* IniFile::Find(const char* section, const char* key) const {
+    auto it = m_values.find(MakeKey(section, key));
+    return it == m_values.end() ? nullptr : &it->second;
+}
+
+int IniFile::GetInt(const char* section, const char* key, int default_val) const {
+    const std::string* value = Find(section, key);
+    if (!value || value->empty()) {
+        return default_val;
+    }
+    char* end = nullptr;
+    long result = strtol(value->c_str(), &end, 10);
+    return end == value->c_str() ? default_val : (int)result;
+}
+
+bool IniFile::GetBool(const char* section, const char* key, bool default_val) const {
+    const std::string* value = Find(section, key);
+    if (!value || value->empty()) {
+        return default_val;
+    }
+    std::string lower = ToLower(*value);
+    if (lower == "true" || lower == "yes" || lower == "on") return true;
+    if (lower == "false" || lower == "no" || lower == "off") return false;
+    return GetInt(section, key, default_val ? 1 : 0) != 0;
+}
+
+float IniFile::GetFloat(const char* section, const char* key, float default_val) const {
+    const std::string* value = Find(section, key);
+    if (!value || value->empty()) {
+        return default_val;
+    }
+    return static_cast<float>(atof(value->c_str()));
+}
+
 // ============================================================================
 // ConfigReader 实现
 // ============================================================================
@@ -19,6 +129,7 @@ ConfigReader::ConfigReader() {}
 ConfigReader::~ConfigReader() {}
 
 std::string ConfigReader::GetDllDirectory() {
+#ifdef _WIN32
     char path[MAX_PATH] = {0};
     HMODULE hModule = NULL;
     
@@ -38,6 +149,9 @@ std::string ConfigReader::GetDllDirectory() {
     }
     
     return ".\\";
+#else
+    return "./";
+#endif
 }
 
 bool ConfigReader::LoadConfig(const std::string& ini_path) {
@@ -51,13 +165,11 @@ bool ConfigReader::LoadConfig(const std::string& ini_path) {
     CHAN_LOG_INFO("加载配置文件: %s", m_ini_path.c_str());
     
     // 检查文件是否存在
-    std::ifstream file(m_ini_path);
-    if (!file.good()) {
+    if (!m_ini.Load(m_ini_path)) {
         CHAN_LOG_WARN("配置文件不存在，使用默认配置: %s", m_ini_path.c_str());
         m_loaded = false;
         return false;
     }
-    file.close();
     
     // 读取 [General] 节
     m_config.min_bi_length = ReadInt("General", "MinBiLength", 5);
@@ -82,9 +194,17 @@ bool ConfigReader::LoadConfig(const std::string& ini_path) {
     m_config.pre_first_time_window = ReadInt("PreBuy", "FirstTimeWindow", 8);
     m_config.pre_second_time_window = ReadInt("PreBuy", "SecondTimeWindow", 10);
     
+    // 读取 [Divergence] 节
+    m_config.macd_fast = ReadInt("Divergence", "MACDFast", 12);
+    m_config.macd_slow = ReadInt("Divergence", "MACDSlow", 26);
+    m_config.macd_signal = ReadInt("Divergence", "MACDSignal", 9);
+    
     // 读取 [Performance] 节
     m_config.enable_incremental = ReadBool("Performance", "EnableIncremental", true);
-    m_config.cache_size = ReadInt("Performance", "CacheSize", 100000);
+    m_config.cache_size = ReadInt("Performance", "CacheSize", 500000);
+    m_config.cache_entries = ReadInt("Performance", "CacheEntries", 128);
+    m_config.enable_perf_counters = ReadBool("Performance", "EnablePerfCounters", true);
+    m_config.perf_redundant_window_ms = ReadInt("Performance", "RedundantWindowMs", 1000);
     
     m_loaded = true;
     
@@ -95,23 +215,15 @@ bool ConfigReader::LoadConfig(const std::string& ini_path) {
 }
 
 int ConfigReader::ReadInt(const char* section, const char* key, int default_val) {
-    return GetPrivateProfileIntA(section, key, default_val, m_ini_path.c_str());
+    return m_ini.GetInt(section, key, default_val);
 }
 
 bool ConfigReader::ReadBool(const char* section, const char* key, bool default_val) {
-    int val = GetPrivateProfileIntA(section, key, default_val ? 1 : 0, m_ini_path.c_str());
-    return val != 0;
+    return m_ini.GetBool(section, key, default_val);
 }
 
 float ConfigReader::ReadFloat(const char* section, const char* key, float default_val) {
-    char buffer[64] = {0};
-    GetPrivateProfileStringA(section, key, "", buffer, sizeof(buffer), m_ini_path.c_str());
-    
-    if (buffer[0] == '\0') {
-        return default_val;
-    }
-    
-    return static_cast<float>(atof(buffer));
+    return m_ini.GetFloat(section, key, default_val);
 }
 
 ChanConfig ConfigReader::ToChanConfig() const {
@@ -121,6 +233,11 @@ ChanConfig ConfigReader::ToChanConfig() const {
     config.strict_bi = m_config.strict_bi;
     config.enable_pre_signals = m_config.enable_pre_signal;
     config.enable_like_signals = m_config.enable_like_signal;
+    config.ma_short_period = m_config.first_buy_ma_period;
+    config.ma_long_period = m_config.second_buy_ma_period;
+    config.macd_fast = m_config.macd_fast;
+    config.macd_slow = m_config.macd_slow;
+    config.macd_signal = m_config.macd_signal;
     return config;
 }
 
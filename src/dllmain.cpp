@@ -4,6 +4,7 @@
 
 #include <windows.h>
 #include "logger.h"
+#include "tdx_interface.h"
 
 // DLL入口函数
 BOOL APIENTRY DllMain(HMODULE hModule, DWORD ul_reason_for_call, LPVOID lpReserved)
@@ -24,8 +25,11 @@ BOOL APIENTRY DllMain(HMODULE hModule, DWORD ul_reason_for_call, LPVOID lpReserv
         break;
         
     case DLL_PROCESS_DETACH:
-        // DLL被卸载时
+        // DLL被卸载时（进程退出时 lpReserved 非空，此时仍可写文件）
+        ChanPerfDumpOnUnload();
         CHAN_LOG_INFO("chan.dll 已卸载");
+        // 加载器锁内不能 join 日志线程：输出剩余日志后分离
+        chan::LogDetachFromLoader(lpReserved != nullptr);
         break;
         
     case DLL_THREAD_ATTACH:
@@ -0,0 +1,212 @@
+// ============================================================================
+// 缠论通达信DLL插件 - 分型候选SIMD内核实现
+// ============================================================================
+
+#include "fx_kernel.h"
+#include <cstring>
+
+#if defined(_M_IX86) || defined(_M_X64) || defined(__i386__) || defined(__x86_64__)
+#define CHAN_FX_X86 1
+#include <immintrin.h>
+#if defined(_MSC_VER)
+#include <intrin.h>
+#else
+#include <cpuid.h>
+#endif
+#else
+#define CHAN_FX_X86 0
+#endif
+
+// GCC/Clang 需按函数开启指令集，MSVC 可直接使用内建函数
+#if CHAN_FX_X86 && (defined(__GNUC__) || defined(__clang__))
+#define CHAN_TARGET_SSE41 __attribute__((target("sse4.1")))
+#define CHAN_TARGET_AVX2  __attribute__((target("avx2")))
+#else
+#define CHAN_TARGET_SSE41
+#define CHAN_TARGET_AVX2
+#endif
+
+namespace chan {
+
+// ============================================================================
+// 指令集检测
+// ============================================================================
+
+#if CHAN_FX_X86
+
+static void CpuId(int leaf, int subleaf, unsigned int regs[4]) {
+#if defined(_MSC_VER)
+    int r[4];
+    __cpuidex(r, leaf, subleaf);
+    for (int i = 0; i < 4; ++i) {
+        regs[i] = (unsigned int)r[i];
+    }
+#else
+    regs[0] = regs[1] = regs[2] = regs[3] = 0;
+    __get_cpuid_count((unsigned int)leaf, (unsigned int)subleaf,
+                      &regs[0], &regs[1], &regs[2], &regs[3]);
+#endif
+}
+
+static uint64_t ReadXCR0() {
+#if defined(_MSC_VER)
+    return (uint64_t)_xgetbv(0);
+#else
+    unsigned int eax = 0, edx = 0;
+    __asm__ volatile(".byte 0x0f, 0x01, 0xd0" : "=a"(eax), "=d"(edx) : "c"(0));
+    return ((uint64_t)edx << 32) | eax;
+#endif
+}
+
+static SimdLevel DetectSimdLevel() {
+    unsigned int regs[4];
+    CpuId(0, 0, regs);
+    unsigned int max_leaf = regs[0];
+    if (max_leaf < 1) {
+        return SimdLevel::SCALAR;
+    }
+
+    CpuId(1, 0, regs);
+    bool sse41 = (regs[2] & (1u << 19)) != 0;
+    bool osxsave = (regs[2] & (1u << 27)) != 0;
+    bool avx = (regs[2] & (1u << 28)) != 0;
+
+    // AVX 还需操作系统保存 YMM 寄存器（XCR0 的 SSE/AVX 位）
+    if (max_leaf >= 7 && osxsave && avx && (ReadXCR0() & 0x6) == 0x6) {
+        CpuId(7, 0, regs);
+        if (regs[1] & (1u << 5)) {
+            return SimdLevel::AVX2;
+        }
+    }
+    return sse41 ? SimdLevel::SSE41 : SimdLevel::SCALAR;
+}
+
+#else
+
+static SimdLevel DetectSimdLevel() {
+    return SimdLevel::SCALAR;
+}
+
+#endif
+
+SimdLevel GetSimdLevel() {
+    static const SimdLevel level = DetectSimdLevel();
+    return level;
+}
+
+const char* SimdLevelName(SimdLevel level) {
+    switch (level) {
+        case SimdLevel::AVX2:  return "AVX2";
+        case SimdLevel::SSE41: return "SSE4.1";
+        default:               return "Scalar";
+    }
+}
+
+// ============================================================================
+// 候选判定
+// ============================================================================
+
+/// @brief 标量判定候选 [from, end)，位图下标相对 begin
+static void DetectScalar(const float* high, const float* low, int begin, int end, int from,
+                         uint32_t* top_bits, uint32_t* bottom_bits) {
+    for (int i = from; i < end; ++i) {
+        int bit = i - begin;
+        uint32_t flag = 1u << (bit & 31);
+
+        if (high[i] > high[i - 1] && high[i] > high[i + 1] &&
+            low[i] > low[i - 1] && low[i] > low[i + 1]) {
+            top_bits[bit >> 5] |= flag;
+        } else if (low[i] < low[i - 1] && low[i] < low[i + 1] &&
+                   high[i] < high[i - 1] && high[i] < high[i + 1]) {
+            bottom_bits[bit >> 5] |= flag;
+        }
+    }
+}
+
+#if CHAN_FX_X86
+
+/// @brief SSE4.1：每次判定4个候选
+CHAN_TARGET_SSE41
+static int DetectSSE41(const float* high, const float* low, int begin, int end,
+                       uint32_t* top_bits, uint32_t* bottom_bits) {
+    int i = begin;
+    for (; i + 4 <= end; i += 4) {
+        __m128 h = _mm_loadu_ps(high + i);
+        __m128 hl = _mm_loadu_ps(high + i - 1);
+        __m128 hr = _mm_loadu_ps(high + i + 1);
+        __m128 l = _mm_loadu_ps(low + i);
+        __m128 ll = _mm_loadu_ps(low + i - 1);
+        __m128 lr = _mm_loadu_ps(low + i + 1);
+
+        // 有序比较：任一操作数为NaN时结果为假，与标量 > / < 一致
+        __m128 top = _mm_and_ps(_mm_and_ps(_mm_cmpgt_ps(h, hl), _mm_cmpgt_ps(h, hr)),
+                                _mm_and_ps(_mm_cmpgt_ps(l, ll), _mm_cmpgt_ps(l, lr)));
+        __m128 bottom = _mm_and_ps(_mm_and_ps(_mm_cmplt_ps(l, ll), _mm_cmplt_ps(l, lr)),
+                                   _mm_and_ps(_mm_cmplt_ps(h, hl), _mm_cmplt_ps(h, hr)));
+
+        int bit = i - begin;
+        top_bits[bit >> 5] |= (uint32_t)_mm_movemask_ps(top) << (bit & 31);
+        bottom_bits[bit >> 5] |= (uint32_t)_mm_movemask_ps(bottom) << (bit & 31);
+    }
+    return i;
+}
+
+/// @brief AVX2：每次判定8个候选
+CHAN_TARGET_AVX2
+static int DetectAVX2(const float* high, const float* low, int begin, int end,
+                      uint32_t* top_bits, uint32_t* bottom_bits) {
+    int i = begin;
+    for (; i + 8 <= end; i += 8) {
+        __m256 h = _mm256_loadu_ps(high + i);
+        __m256 hl = _mm256_loadu_ps(high + i - 1);
+        __m256 hr = _mm256_loadu_ps(high + i + 1);
+        __m256 l = _mm256_loadu_ps(low + i);
+        __m256 ll = _mm256_loadu_ps(low + i - 1);
+        __m256 lr = _mm256_loadu_ps(low + i + 1);
+
+        __m256 top = _mm256_and_ps(
+            _mm256_and_ps(_mm256_cmp_ps(h, hl, _CMP_GT_OQ), _mm256_cmp_ps(h, hr, _CMP_GT_OQ)),
+            _mm256_and_ps(_mm256_cmp_ps(l, ll, _CMP_GT_OQ), _mm256_cmp_ps(l, lr, _CMP_GT_OQ)));
+        __m256 bottom = _mm256_and_ps(
+            _mm256_and_ps(_mm256_cmp_ps(l, ll, _CMP_LT_OQ), _mm256_cmp_ps(l, lr, _CMP_LT_OQ)),
+            _mm256_and_ps(_mm256_cmp_ps(h, hl, _CMP_LT_OQ), _mm256_cmp_ps(h, hr, _CMP_LT_OQ)));
+
+        // 8位掩码按字节对齐落入32位字（步长8，不会跨字）
+        int bit = i - begin;
+        top_bits[bit >> 5] |= (uint32_t)_mm256_movemask_ps(top) << (bit & 31);
+        bottom_bits[bit >> 5] |= (uint32_t)_mm256_movemask_ps(bottom) << (bit & 31);
+    }
+    return i;
+}
+
+#endif
+
+void DetectFXCandidates(const float* high, const float* low, int begin, int end,
+                        uint32_t* top_bits, uint32_t* bottom_bits, SimdLevel level) {
+    int words = FXMaskWords(end - begin);
+    if (words == 0) {
+        return;
+    }
+    memset(top_bits, 0, words * sizeof(uint32_t));
+    memset(bottom_bits, 0, words * sizeof(uint32_t));
+
+    if (level > GetSimdLevel()) {
+        level = GetSimdLevel();
+    }
+
+    int i = begin;
+#if CHAN_FX_X86
+    if (level == SimdLevel::AVX2) {
+        i = DetectAVX2(high, low, begin, end, top_bits, bottom_bits);
+    } else if (level == SimdLevel::SSE41) {
+        i = DetectSSE41(high, low, begin, end, top_bits, bottom_bits);
+    }
+#else
+    (void)level;
+#endif
+
+    // 不足一个向量的尾部
+    DetectScalar(high, low, begin, end, i, top_bits, bottom_bits);
+}
+
+} // namespace chan
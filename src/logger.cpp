@@ -3,14 +3,28 @@
 // ============================================================================
 
 #include "logger.h"
+#include <chrono>
+#include <condition_variable>
 #include <cstdio>
 #include <cstdarg>
+#include <cstdlib>
 #include <ctime>
+#include <mutex>
+#include <string>
+#include <thread>
+
+#ifdef _WIN32
+#include <windows.h>
+#endif
 
 namespace chan {
 
-// 全局日志级别
-static LogLevel g_LogLevel = LogLevel::LOG_INFO;
+namespace log_detail {
+// 全局日志级别（宏在调用线程上直接读取）
+std::atomic<int> g_level((int)LogLevel::LOG_INFO);
+}
+
+using log_detail::LogRecord;
 
 // 日志前缀
 static const char* g_LogPrefix[] = {
@@ -22,61 +36,562 @@ static const char* g_LogPrefix[] = {
 };
 
 // ============================================================================
-// 内部函数
+// 输出
 // ============================================================================
 
-static void LogOutput(LogLevel level, const char* fmt, va_list args)
+static void DefaultSink(LogLevel level, const char* message)
 {
-    if (level > g_LogLevel || level == LogLevel::LOG_OFF) {
-        return;
-    }
-    
-    char buffer[1024];
-    char message[1200];
-    
-    // 格式化用户消息
-    vsnprintf(buffer, sizeof(buffer), fmt, args);
-    
-    // 获取当前时间
-    time_t now = time(nullptr);
-    struct tm* tm_now = localtime(&now);
-    
-    // 构造完整日志消息
-    snprintf(message, sizeof(message), 
-             "[CHAN %02d:%02d:%02d] %s %s\n",
-             tm_now->tm_hour, tm_now->tm_min, tm_now->tm_sec,
-             g_LogPrefix[static_cast<int>(level)],
-             buffer);
-    
+#ifdef _WIN32
     // 输出到调试器
     OutputDebugStringA(message);
-    
+
     // 如果是错误级别，也输出到stderr
     if (level == LogLevel::LOG_ERROR) {
         fprintf(stderr, "%s", message);
     }
+#else
+    (void)level;
+    fprintf(stderr, "%s", message);
+#endif
+}
+
+static int64_t NowMicros()
+{
+    return std::chrono::duration_cast<std::chrono::microseconds>(
+        std::chrono::system_clock::now().time_since_epoch()).count();
+}
+
+// 按格式串逐个说明符取出二进制参数格式化
+// 长度修饰符统一改写：整数按 long long、浮点按 double 传给 snprintf
+static void FormatRecord(const LogRecord& rec, std::string& out)
+{
+    const unsigned char* p = rec.payload;
+    const unsigned char* end = rec.payload + rec.size;
+    char spec[32];
+    char buf[256];
+
+    for (const char* f = rec.fmt; *f; ++f) {
+        if (*f != '%') {
+            out += *f;
+            continue;
+        }
+        if (f[1] == '%') {
+            out += '%';
+            ++f;
+            continue;
+        }
+
+        // 标志、宽度、精度
+        const char* start = f++;
+        int n = 0;
+        spec[n++] = '%';
+        while (*f && strchr("-+ #0123456789.", *f) && n < 20) {
+            spec[n++] = *f++;
+        }
+        while (*f && strchr("hlLqjzt", *f)) {
+            ++f;
+        }
+        char conv = *f;
+        if (!conv || !strchr("diuxXocsfFeEgGaAp", conv) || p >= end) {
+            // 不支持的说明符或参数不足：原样输出
+            out.append(start, conv ? f - start + 1 : f - start);
+            if (!conv) break;
+            continue;
+        }
+
+        unsigned char tag = *p++;
+        int64_t iv = 0;
+        double dv = 0.0;
+        const char* sv = nullptr;
+        uint16_t slen = 0;
+        if (tag == log_detail::ARG_STRING) {
+            memcpy(&slen, p, 2);
+            sv = (const char*)p + 2;
+            p += 2 + slen;
+        } else {
+            if (tag == log_detail::ARG_DOUBLE) {
+                memcpy(&dv, p, 8);
+                iv = (int64_t)dv;
+            } else {
+                memcpy(&iv, p, 8);
+                dv = tag == log_detail::ARG_UINT ? (double)(uint64_t)iv : (double)iv;
+            }
+            p += 8;
+        }
+
+        switch (conv) {
+        case 's':
+            spec[n++] = '.';
+            spec[n++] = '*';
+            spec[n++] = 's';
+            spec[n] = '\0';
+            if (sv) {
+                snprintf(buf, sizeof(buf), spec, (int)slen, sv);
+            } else {
+                snprintf(buf, sizeof(buf), "%lld", (long long)iv);
+            }
+            break;
+        case 'p':
+            snprintf(buf, sizeof(buf), "0x%llx", (unsigned long long)iv);
+            break;
+        case 'c':
+            spec[n++] = 'c';
+            spec[n] = '\0';
+            snprintf(buf, sizeof(buf), spec, (int)iv);
+            break;
+        case 'f': case 'F': case 'e': case 'E': case 'g': case 'G': case 'a': case 'A':
+            spec[n++] = conv;
+            spec[n] = '\0';
+            snprintf(buf, sizeof(buf), spec, dv);
+            break;
+        default:
+            spec[n++] = 'l';
+            spec[n++] = 'l';
+            spec[n++] = conv;
+            spec[n] = '\0';
+            snprintf(buf, sizeof(buf), spec, (long long)iv);
+            break;
+        }
+        out += buf;
+    }
+}
+
+// ============================================================================
+// 日志后台
+// ============================================================================
+
+// 后台线程运行期间本模块（DLL）不能被 FreeLibrary 卸载，否则线程会在已解除映射的
+// 代码中继续执行：启动线程前把模块固定到进程退出。固定失败时不启动线程，同步输出
+static bool PinCurrentModule()
+{
+#ifdef _WIN32
+    HMODULE hModule = NULL;
+    return GetModuleHandleExA(
+               GET_MODULE_HANDLE_EX_FLAG_FROM_ADDRESS | GET_MODULE_HANDLE_EX_FLAG_PIN,
+               (LPCSTR)&PinCurrentModule,
+               &hModule) != 0;
+#else
+    return true;
+#endif
+}
+
+// 有界多生产者单消费者环形缓冲：每个槽位带序号，生产者 CAS 抢占写位置，
+// 写完发布序号；消费者只在后台线程（或停止后持锁的调用线程）中读取
+class AsyncLogger {
+public:
+    static const int CAPACITY = 4096;      // 2的幂，约1MB
+
+    AsyncLogger()
+        : m_tail(0), m_head(0), m_dropped(0), m_reported_dropped(0)
+        , m_running(false), m_stopped(false), m_worker_done(false)
+        , m_sleeping(false), m_output_abandoned(false)
+        , m_flush_request(0), m_flush_done(0)
+        , m_sink(nullptr), m_file(nullptr) {
+        for (int i = 0; i < CAPACITY; ++i) {
+            m_slots[i].seq.store((uint64_t)i, std::memory_order_relaxed);
+        }
+    }
+
+    LogRecord* Claim(uint64_t& ticket) {
+        if (m_stopped.load(std::memory_order_acquire) || !EnsureStarted()) {
+            return nullptr;
+        }
+        uint64_t pos = m_tail.load(std::memory_order_relaxed);
+        for (;;) {
+            Slot& slot = m_slots[pos & (CAPACITY - 1)];
+            uint64_t seq = slot.seq.load(std::memory_order_acquire);
+            int64_t diff = (int64_t)seq - (int64_t)pos;
+            if (diff == 0) {
+                if (m_tail.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+                    ticket = pos;
+                    return &slot.record;
+                }
+            } else if (diff < 0) {
+                m_dropped.fetch_add(1, std::memory_order_relaxed);
+                return nullptr;
+            } else {
+                pos = m_tail.load(std::memory_order_relaxed);
+            }
+        }
+    }
+
+    void Commit(uint64_t ticket) {
+        m_slots[ticket & (CAPACITY - 1)].seq.store(ticket + 1, std::memory_order_release);
+        // 后台线程只在缓冲为空时休眠：与 Run 中先置休眠标志、再检查缓冲的顺序配对，
+        // 两边至少一方看到对方，不会漏唤醒。线程工作期间提交不加锁
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        if (m_sleeping.load(std::memory_order_relaxed)) {
+            std::lock_guard<std::mutex> lock(m_wake_mutex);
+            m_wake_cv.notify_one();
+        }
+    }
+
+    bool Stopped() const { return m_stopped.load(std::memory_order_acquire); }
+
+    uint64_t Dropped() const { return m_dropped.load(std::memory_order_relaxed); }
+
+    void SetSink(LogSink sink) {
+        std::lock_guard<std::mutex> lock(m_output_mutex);
+        m_sink = sink;
+    }
+
+    bool SetFile(const char* path) {
+        std::lock_guard<std::mutex> lock(m_output_mutex);
+        if (m_file) {
+            fclose(m_file);
+            m_file = nullptr;
+        }
+        if (path) {
+            m_file = fopen(path, "a");
+        }
+        return !path || m_file;
+    }
+
+    /// @brief 直接输出一条（停止后的同步路径）
+    void WriteNow(const LogRecord& record) {
+        if (m_output_abandoned.load(std::memory_order_acquire)) {
+            return;     // 进程退出时输出锁被已终止的线程持有
+        }
+        std::lock_guard<std::mutex> lock(m_output_mutex);
+        std::string line;
+        Emit(record, line);
+        if (m_file) fflush(m_file);
+    }
+
+    void Flush() {
+        if (!m_running.load(std::memory_order_acquire) || Stopped()) {
+            return;
+        }
+        std::unique_lock<std::mutex> lock(m_wake_mutex);
+        uint64_t request = ++m_flush_request;
+        m_wake_cv.notify_one();
+        m_flush_cv.wait(lock, [&] { return m_flush_done >= request || m_worker_done; });
+    }
+
+    void Shutdown() {
+        {
+            std::lock_guard<std::mutex> lock(m_start_mutex);
+            if (m_stopped.exchange(true)) {
+                return;
+            }
+        }
+        WakeWorker();
+        if (m_thread.joinable()) {
+            m_thread.join();
+        }
+        Drain();
+    }
+
+    void DetachFromLoader(bool process_exit) {
+        if (process_exit) {
+            // 其它线程已被系统终止，可能正持有锁：不等待任何锁
+            if (m_stopped.exchange(true)) {
+                return;
+            }
+            if (m_thread.joinable()) {
+                m_thread.detach();
+            }
+            std::unique_lock<std::mutex> lock(m_output_mutex, std::try_to_lock);
+            if (!lock.owns_lock()) {
+                // 后台线程终止于输出途中：放弃剩余日志，之后的同步输出也丢弃
+                m_output_abandoned.store(true, std::memory_order_release);
+                return;
+            }
+            DrainLocked();
+            CloseFileLocked();
+            return;
+        }
+
+        {
+            std::lock_guard<std::mutex> lock(m_start_mutex);
+            if (m_stopped.exchange(true)) {
+                return;
+            }
+        }
+        // 线程启动时模块已固定，FreeLibrary 不会卸载本模块：线程在运行时卸载通知
+        // 只在进程退出时到来。持有加载器锁，不能 join
+        if (m_thread.joinable()) {
+            m_thread.detach();
+            WakeWorker();       // 线程自行输出剩余日志后退出
+        } else {
+            Drain();
+        }
+        std::lock_guard<std::mutex> lock(m_output_mutex);
+        CloseFileLocked();
+    }
+
+private:
+    struct Slot {
+        std::atomic<uint64_t> seq;
+        LogRecord record;
+    };
+
+    // 返回后台线程是否在运行（模块固定失败时转为停止状态，之后同步输出）
+    bool EnsureStarted() {
+        if (m_running.load(std::memory_order_acquire)) {
+            return true;
+        }
+        std::lock_guard<std::mutex> lock(m_start_mutex);
+        if (!m_running.load(std::memory_order_relaxed) && !Stopped()) {
+            if (!PinCurrentModule()) {
+                m_stopped.store(true, std::memory_order_release);
+                return false;
+            }
+            m_thread = std::thread(&AsyncLogger::Run, this);
+            m_running.store(true, std::memory_order_release);
+        }
+        return m_running.load(std::memory_order_relaxed);
+    }
+
+    // 停止或刷新请求时唤醒后台线程（持锁通知，线程检查条件后才会休眠）
+    void WakeWorker() {
+        std::lock_guard<std::mutex> lock(m_wake_mutex);
+        m_wake_cv.notify_one();
+    }
+
+    // 缓冲中有已发布的记录（只在后台线程调用，m_head 仅由它修改）
+    bool HasPending() const {
+        const Slot& slot = m_slots[m_head & (CAPACITY - 1)];
+        return slot.seq.load(std::memory_order_acquire) == m_head + 1;
+    }
+
+    void Run() {
+        for (;;) {
+            uint64_t request;
+            {
+                // 空闲时无限期休眠，由 Commit/Flush/停止唤醒
+                std::unique_lock<std::mutex> lock(m_wake_mutex);
+                m_sleeping.store(true, std::memory_order_relaxed);
+                std::atomic_thread_fence(std::memory_order_seq_cst);
+                m_wake_cv.wait(lock, [&] {
+                    return Stopped() || m_flush_request != m_flush_done || HasPending();
+                });
+                m_sleeping.store(false, std::memory_order_relaxed);
+                request = m_flush_request;
+            }
+            Drain();
+            {
+                std::lock_guard<std::mutex> lock(m_wake_mutex);
+                m_flush_done = request;
+            }
+            m_flush_cv.notify_all();
+            if (Stopped()) {
+                break;
+            }
+        }
+        Drain();
+        {
+            std::lock_guard<std::mutex> lock(m_wake_mutex);
+            m_worker_done.store(true);
+        }
+        m_flush_cv.notify_all();
+    }
+
+    // 输出缓冲中已发布的全部记录
+    void Drain() {
+        std::lock_guard<std::mutex> lock(m_output_mutex);
+        DrainLocked();
+    }
+
+    void CloseFileLocked() {
+        if (m_file) {
+            fclose(m_file);
+            m_file = nullptr;
+        }
+    }
+
+    // 同 Drain，调用方已持有 m_output_mutex
+    void DrainLocked() {
+        std::string line;
+        bool wrote = false;
+        for (;;) {
+            Slot& slot = m_slots[m_head & (CAPACITY - 1)];
+            if (slot.seq.load(std::memory_order_acquire) != m_head + 1) {
+                break;
+            }
+            Emit(slot.record, line);
+            slot.seq.store(m_head + CAPACITY, std::memory_order_release);
+            ++m_head;
+            wrote = true;
+        }
+
+        uint64_t dropped = Dropped();
+        if (dropped != m_reported_dropped) {
+            char msg[96];
+            snprintf(msg, sizeof(msg), "[CHAN] [WARN]  日志缓冲已满，丢弃 %llu 条\n",
+                     (unsigned long long)(dropped - m_reported_dropped));
+            m_reported_dropped = dropped;
+            Output(LogLevel::LOG_WARN, msg);
+            wrote = true;
+        }
+        if (wrote && m_file) {
+            fflush(m_file);
+        }
+    }
+
+    void Emit(const LogRecord& record, std::string& line) {
+        time_t seconds = (time_t)(record.time_us / 1000000);
+        struct tm tm_now;
+#ifdef _WIN32
+        localtime_s(&tm_now, &seconds);
+#else
+        localtime_r(&seconds, &tm_now);
+#endif
+        char prefix[48];
+        int level = record.level <= (int)LogLevel::LOG_DEBUG ? record.level : 0;
+        snprintf(prefix, sizeof(prefix), "[CHAN %02d:%02d:%02d] %s ",
+                 tm_now.tm_hour, tm_now.tm_min, tm_now.tm_sec, g_LogPrefix[level]);
+        line = prefix;
+        FormatRecord(record, line);
+        line += '\n';
+        Output((LogLevel)level, line.c_str());
+    }
+
+    void Output(LogLevel level, const char* message) {
+        (m_sink ? m_sink : DefaultSink)(level, message);
+        if (m_file) {
+            fputs(message, m_file);
+        }
+    }
+
+    Slot m_slots[CAPACITY];
+    alignas(64) std::atomic<uint64_t> m_tail;
+    alignas(64) uint64_t m_head;                // 仅消费者访问（持 m_output_mutex）
+    std::atomic<uint64_t> m_dropped;
+    uint64_t m_reported_dropped;
+
+    std::atomic<bool> m_running;
+    std::atomic<bool> m_stopped;
+    std::atomic<bool> m_worker_done;
+    std::atomic<bool> m_sleeping;           // 后台线程在等待唤醒
+    std::atomic<bool> m_output_abandoned;   // 进程退出时未能取得输出锁
+    std::thread m_thread;
+    std::mutex m_start_mutex;
+
+    std::mutex m_wake_mutex;
+    std::condition_variable m_wake_cv;
+    std::condition_variable m_flush_cv;
+    uint64_t m_flush_request;
+    uint64_t m_flush_done;
+
+    std::mutex m_output_mutex;
+    LogSink m_sink;
+    FILE* m_file;
+};
+
+// 不析构：静态对象析构期间仍可能写日志；进程退出时由 atexit 输出剩余日志
+static AsyncLogger& Logger()
+{
+    static AsyncLogger* logger = [] {
+        AsyncLogger* instance = new AsyncLogger();
+        std::atexit([] { LogShutdown(); });
+        return instance;
+    }();
+    return *logger;
+}
+
+namespace log_detail {
+
+// 停止后（或缓冲满时）不走缓冲：停止后用线程局部记录同步输出
+static thread_local LogRecord t_sync_record;
+static const uint64_t SYNC_TICKET = ~0ull;
+
+LogRecord* Claim(LogLevel level, const char* fmt, uint64_t& ticket)
+{
+    AsyncLogger& logger = Logger();
+    LogRecord* record = logger.Claim(ticket);
+    if (!record) {
+        if (!logger.Stopped()) {
+            return nullptr;     // 缓冲满，已计入丢弃
+        }
+        record = &t_sync_record;
+        ticket = SYNC_TICKET;
+    }
+    record->fmt = fmt;
+    record->time_us = NowMicros();
+    record->level = (unsigned char)level;
+    record->argc = 0;
+    record->size = 0;
+    return record;
+}
+
+void Commit(LogRecord* record, uint64_t ticket)
+{
+    if (ticket == SYNC_TICKET) {
+        Logger().WriteNow(*record);
+    } else {
+        Logger().Commit(ticket);
+    }
 }
 
+} // namespace log_detail
+
 // ============================================================================
 // 公共接口
 // ============================================================================
 
 void LogInit(LogLevel level)
 {
-    g_LogLevel = level;
-    LogInfo("日志系统初始化, 级别=%d", static_cast<int>(level));
+    LogSetLevel(level);
+    CHAN_LOG_INFO("日志系统初始化, 级别=%d", static_cast<int>(level));
 }
 
 void LogSetLevel(LogLevel level)
 {
-    g_LogLevel = level;
+    log_detail::g_level.store((int)level, std::memory_order_relaxed);
+}
+
+LogLevel LogGetLevel()
+{
+    return (LogLevel)log_detail::g_level.load(std::memory_order_relaxed);
+}
+
+void LogSetSink(LogSink sink)
+{
+    Logger().SetSink(sink);
+}
+
+bool LogSetFile(const char* path)
+{
+    return Logger().SetFile(path);
+}
+
+void LogFlush()
+{
+    Logger().Flush();
+}
+
+void LogShutdown()
+{
+    Logger().Shutdown();
+}
+
+void LogDetachFromLoader(bool process_exit)
+{
+    Logger().DetachFromLoader(process_exit);
+}
+
+uint64_t LogGetDropped()
+{
+    return Logger().Dropped();
+}
+
+// 立即格式化为一个字符串参数后提交
+static void LogFormatted(LogLevel level, const char* fmt, va_list args)
+{
+    if (!log_detail::Enabled(level)) {
+        return;
+    }
+    char buffer[LogRecord::PAYLOAD];
+    vsnprintf(buffer, sizeof(buffer), fmt, args);
+    log_detail::Submit(level, "%s", (const char*)buffer);
 }
 
 void LogError(const char* fmt, ...)
 {
     va_list args;
     va_start(args, fmt);
-    LogOutput(LogLevel::LOG_ERROR, fmt, args);
+    LogFormatted(LogLevel::LOG_ERROR, fmt, args);
     va_end(args);
 }
 
@@ -84,7 +599,7 @@ void LogWarn(const char* fmt, ...)
 {
     va_list args;
     va_start(args, fmt);
-    LogOutput(LogLevel::LOG_WARN, fmt, args);
+    LogFormatted(LogLevel::LOG_WARN, fmt, args);
     va_end(args);
 }
 
@@ -92,7 +607,7 @@ void LogInfo(const char* fmt, ...)
 {
     va_list args;
     va_start(args, fmt);
-    LogOutput(LogLevel::LOG_INFO, fmt, args);
+    LogFormatted(LogLevel::LOG_INFO, fmt, args);
     va_end(args);
 }
 
@@ -100,7 +615,7 @@ void LogDebug(const char* fmt, ...)
 {
     va_list args;
     va_start(args, fmt);
-    LogOutput(LogLevel::LOG_DEBUG, fmt, args);
+    LogFormatted(LogLevel::LOG_DEBUG, fmt, args);
     va_end(args);
 }
 
@@ -0,0 +1,262 @@
+// ============================================================================
+// 缠论通达信DLL插件 - 多周期联立分析实现
+// ============================================================================
+
+#include "multi_level.h"
+#include "logger.h"
+#include <algorithm>
+
+namespace chan {
+
+// ============================================================================
+// 周期与交易时段
+// ============================================================================
+
+int TimeframeMinutes(Timeframe tf) {
+    switch (tf) {
+    case Timeframe::M1:  return 1;
+    case Timeframe::M5:  return 5;
+    case Timeframe::M15: return 15;
+    case Timeframe::M30: return 30;
+    case Timeframe::M60: return 60;
+    default:             return 0;
+    }
+}
+
+int ASessionMinute(int time) {
+    const int MORNING_OPEN = 9 * 60 + 30;
+    const int MORNING_CLOSE = 11 * 60 + 30;
+    const int AFTERNOON_OPEN = 13 * 60;
+    const int SESSION = 120;            // 每个时段的分钟数
+
+    if (time <= MORNING_CLOSE) {
+        return std::max(1, time - MORNING_OPEN);
+    }
+    if (time <= AFTERNOON_OPEN) {
+        return SESSION;
+    }
+    return std::min(2 * SESSION, SESSION + time - AFTERNOON_OPEN);
+}
+
+// ============================================================================
+// 周期聚合
+// ============================================================================
+// 5/15/30/60 分钟都整除半天的120分钟，分组 = (时段分钟序号-1)/周期，
+// 周期K线不跨越午休；日线按日期分组；1分钟线每根单独成K线
+
+bool MultiLevelAnalyzer::Level::Merge(int minute, int d, int time,
+                                      float h, float l, float c, float v) {
+    int b;
+    if (period == 1) {
+        b = minute;
+    } else if (period == 0) {
+        b = 0;
+    } else {
+        b = (ASessionMinute(time) - 1) / period;
+    }
+
+    bool fresh = first_minute.empty() || d != date || b != bucket;
+    if (fresh) {
+        first_minute.push_back(minute);
+        date = d;
+        bucket = b;
+        has_prev = false;
+        high = h;
+        low = l;
+        volume = v;
+    } else {
+        has_prev = true;
+        prev_high = high;
+        prev_low = low;
+        prev_volume = volume;
+        high = std::max(high, h);
+        low = std::min(low, l);
+        volume += v;
+    }
+    close = c;
+    return fresh;
+}
+
+void MultiLevelAnalyzer::Level::RemergeLast(float h, float l, float c, float v) {
+    if (has_prev) {
+        high = std::max(prev_high, h);
+        low = std::min(prev_low, l);
+        volume = prev_volume + v;
+    } else {
+        high = h;
+        low = l;
+        volume = v;
+    }
+    close = c;
+}
+
+// ============================================================================
+// 多周期联立分析器
+// ============================================================================
+
+MultiLevelAnalyzer::MultiLevelAnalyzer(const ChanConfig& config)
+    : m_config(config) {
+    for (int k = 0; k < (int)Timeframe::COUNT; ++k) {
+        m_levels[k].period = TimeframeMinutes((Timeframe)k);
+    }
+    Clear();
+}
+
+void MultiLevelAnalyzer::SetConfig(const ChanConfig& config) {
+    m_config = config;
+    for (Level& level : m_levels) {
+        level.core.SetConfig(config);
+    }
+}
+
+void MultiLevelAnalyzer::Clear() {
+    for (Level& level : m_levels) {
+        level.core.SetConfig(m_config);
+        level.core.Clear();
+        level.first_minute.clear();
+        level.date = 0;
+        level.bucket = 0;
+        level.high = level.low = level.close = level.volume = 0.0f;
+        level.has_prev = false;
+        level.prev_high = level.prev_low = level.prev_volume = 0.0f;
+    }
+    m_minute_count = 0;
+    m_last_date = 0;
+    m_last_time = 0;
+}
+
+bool MultiLevelAnalyzer::IsAfterLast(int date, int time) const {
+    return m_minute_count == 0 || date > m_last_date ||
+           (date == m_last_date && time > m_last_time);
+}
+
+int MultiLevelAnalyzer::Analyze(const int* dates, const int* times, const float* highs,
+                                const float* lows, const float* closes, const float* volumes,
+                                int count) {
+    if (!dates || !times || !highs || !lows || count < 0) {
+        CHAN_LOG_ERROR("MultiLevelAnalyzer::Analyze: 输入参数无效");
+        return -1;
+    }
+    Clear();
+
+    // 先聚合出各周期K线（1分钟线直接使用输入），再逐周期完整分析
+    std::vector<float> agg[(int)Timeframe::COUNT][4];
+    for (int i = 0; i < count; ++i) {
+        if (!IsAfterLast(dates[i], times[i])) {
+            CHAN_LOG_ERROR("MultiLevelAnalyzer::Analyze: 第 %d 根K线时间不递增", i);
+            Clear();
+            return -1;
+        }
+        m_last_date = dates[i];
+        m_last_time = times[i];
+        float c = closes ? closes[i] : (highs[i] + lows[i]) * 0.5f;
+        float v = volumes ? volumes[i] : 0.0f;
+
+        for (int k = 0; k < (int)Timeframe::COUNT; ++k) {
+            Level& level = m_levels[k];
+            bool fresh = level.Merge(i, dates[i], times[i], highs[i], lows[i], c, v);
+            if (k == (int)Timeframe::M1) {
+                continue;
+            }
+            std::vector<float>* cols = agg[k];
+            if (fresh) {
+                cols[0].push_back(level.high);
+                cols[1].push_back(level.low);
+                cols[2].push_back(level.close);
+                cols[3].push_back(level.volume);
+            } else {
+                cols[0].back() = level.high;
+                cols[1].back() = level.low;
+                cols[2].back() = level.close;
+                cols[3].back() = level.volume;
+            }
+        }
+        ++m_minute_count;
+    }
+    if (count == 0) {
+        return 0;
+    }
+
+    m_levels[(int)Timeframe::M1].core.Analyze(highs, lows, closes, volumes, count);
+    for (int k = (int)Timeframe::M1 + 1; k < (int)Timeframe::COUNT; ++k) {
+        std::vector<float>* cols = agg[k];
+        m_levels[k].core.Analyze(cols[0].data(), cols[1].data(), cols[2].data(),
+                                 cols[3].data(), (int)cols[0].size());
+    }
+    return 0;
+}
+
+int MultiLevelAnalyzer::AppendMinuteBar(int date, int time, float high, float low,
+                                        float close, float volume) {
+    if (!IsAfterLast(date, time)) {
+        CHAN_LOG_ERROR("AppendMinuteBar: 时间 %d %d 不晚于上一根K线", date, time);
+        return -1;
+    }
+    m_last_date = date;
+    m_last_time = time;
+
+    int minute = m_minute_count++;
+    for (Level& level : m_levels) {
+        if (level.Merge(minute, date, time, high, low, close, volume)) {
+            level.core.AppendBar(level.high, level.low, level.close, level.volume);
+        } else {
+            level.core.UpdateLastBar(level.high, level.low, level.close, level.volume);
+        }
+    }
+    return 0;
+}
+
+int MultiLevelAnalyzer::UpdateLastMinuteBar(float high, float low, float close, float volume) {
+    if (m_minute_count == 0) {
+        CHAN_LOG_ERROR("UpdateLastMinuteBar: 尚无K线");
+        return -1;
+    }
+    for (Level& level : m_levels) {
+        level.RemergeLast(high, low, close, volume);
+        level.core.UpdateLastBar(level.high, level.low, level.close, level.volume);
+    }
+    return 0;
+}
+
+// ============================================================================
+// 跨周期定位
+// ============================================================================
+
+int MultiLevelAnalyzer::GetBarCount(Timeframe tf) const {
+    return (int)m_levels[(int)tf].first_minute.size();
+}
+
+int MultiLevelAnalyzer::GetFirstMinute(Timeframe tf, int bar) const {
+    const std::vector<int>& first = m_levels[(int)tf].first_minute;
+    if (bar < 0 || bar >= (int)first.size()) {
+        return -1;
+    }
+    return first[bar];
+}
+
+int MultiLevelAnalyzer::MapBar(Timeframe from, int bar, Timeframe to) const {
+    int minute = GetFirstMinute(from, bar);
+    if (minute < 0) {
+        return -1;
+    }
+    // 最后一根第一分钟不晚于 minute 的K线
+    const std::vector<int>& first = m_levels[(int)to].first_minute;
+    return (int)(std::upper_bound(first.begin(), first.end(), minute) - first.begin()) - 1;
+}
+
+int MultiLevelAnalyzer::FindContainingStroke(Timeframe from, int bar, Timeframe to) const {
+    int target = MapBar(from, bar, to);
+    if (target < 0) {
+        return -1;
+    }
+    // 笔按起点递增：取最后一笔起点不晚于目标K线的笔，再检查终点
+    const StrokeSoA& st = m_levels[(int)to].core.GetStrokeSoA();
+    int k = (int)(std::upper_bound(st.start_idx.begin(), st.start_idx.end(), target) -
+                  st.start_idx.begin()) - 1;
+    if (k < 0 || st.end_idx[k] < target) {
+        return -1;
+    }
+    return k;
+}
+
+} // namespace chan
@@ -0,0 +1,270 @@
+// ============================================================================
+// 缠论通达信DLL插件 - 运行时性能计数器实现
+// ============================================================================
+
+#include "perf_counters.h"
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <ctime>
+#include <vector>
+
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+
+namespace chan {
+
+// 最高有效位位置（v != 0）
+static inline int HighestBit(uint64_t v) {
+#if defined(_MSC_VER) && defined(_M_X64)
+    unsigned long index;
+    _BitScanReverse64(&index, v);
+    return (int)index;
+#elif defined(__GNUC__) || defined(__clang__)
+    return 63 - __builtin_clzll(v);
+#else
+    int bit = 0;
+    while (v >>= 1) ++bit;
+    return bit;
+#endif
+}
+
+static void AtomicMax(std::atomic<uint64_t>& target, uint64_t value) {
+    uint64_t cur = target.load(std::memory_order_relaxed);
+    while (value > cur &&
+           !target.compare_exchange_weak(cur, value, std::memory_order_relaxed)) {
+    }
+}
+
+// ============================================================================
+// 延迟直方图
+// ============================================================================
+
+LatencyHistogram::LatencyHistogram() {
+    Reset();
+}
+
+int LatencyHistogram::BucketIndex(uint64_t ns) {
+    if (ns < (uint64_t)SUB_COUNT) {
+        return (int)ns;
+    }
+    int shift = HighestBit(ns) - SUB_BITS;
+    return (shift + 1) * SUB_COUNT + (int)((ns >> shift) & (SUB_COUNT - 1));
+}
+
+uint64_t LatencyHistogram::BucketLower(int index) {
+    if (index < SUB_COUNT) {
+        return (uint64_t)index;
+    }
+    int shift = index / SUB_COUNT - 1;
+    return (uint64_t)(SUB_COUNT + index % SUB_COUNT) << shift;
+}
+
+uint64_t LatencyHistogram::BucketUpper(int index) {
+    if (index < SUB_COUNT) {
+        return (uint64_t)index;
+    }
+    int shift = index / SUB_COUNT - 1;
+    return BucketLower(index) + ((uint64_t)1 << shift) - 1;
+}
+
+void LatencyHistogram::Record(uint64_t ns) {
+    m_buckets[BucketIndex(ns)].fetch_add(1, std::memory_order_relaxed);
+    m_count.fetch_add(1, std::memory_order_relaxed);
+    m_sum.fetch_add(ns, std::memory_order_relaxed);
+    AtomicMax(m_max, ns);
+}
+
+uint64_t LatencyHistogram::Percentile(double q) const {
+    uint64_t total = Count();
+    if (total == 0) {
+        return 0;
+    }
+    q = std::min(std::max(q, 0.0), 1.0);
+    // 第 rank 个样本（从1计）所在的桶
+    uint64_t rank = (uint64_t)(q * (double)total + 0.5);
+    rank = std::min(std::max<uint64_t>(rank, 1), total);
+
+    uint64_t seen = 0;
+    for (int i = 0; i < BUCKET_COUNT; ++i) {
+        seen += m_buckets[i].load(std::memory_order_relaxed);
+        if (seen >= rank) {
+            return std::min(BucketUpper(i), Max());
+        }
+    }
+    return Max();   // 并发记录时桶计数可能略少于总数
+}
+
+void LatencyHistogram::Reset() {
+    for (int i = 0; i < BUCKET_COUNT; ++i) {
+        m_buckets[i].store(0, std::memory_order_relaxed);
+    }
+    m_count.store(0, std::memory_order_relaxed);
+    m_sum.store(0, std::memory_order_relaxed);
+    m_max.store(0, std::memory_order_relaxed);
+}
+
+// ============================================================================
+// 计数器注册表
+// ============================================================================
+
+PerfRegistry::Slot::Slot()
+    : kind(PerfKind::EXPORT)
+    , cache_hits(0)
+    , cache_misses(0)
+    , redundant(0)
+    , last_key(0)
+    , last_time_ns(0) {
+    name[0] = '\0';
+}
+
+PerfRegistry::PerfRegistry(int redundant_window_ms)
+    : m_slot_count(0)
+    , m_enabled(true)
+    , m_window_ns((uint64_t)redundant_window_ms * 1000000ull) {}
+
+int PerfRegistry::Register(const char* name, PerfKind kind) {
+    int existing = Find(name);
+    if (existing >= 0) {
+        return existing;
+    }
+    int count = m_slot_count.load(std::memory_order_relaxed);
+    if (count >= MAX_SLOTS) {
+        return -1;
+    }
+    Slot& slot = m_slots[count];
+    strncpy(slot.name, name, sizeof(slot.name) - 1);
+    slot.name[sizeof(slot.name) - 1] = '\0';
+    slot.kind = kind;
+    m_slot_count.store(count + 1, std::memory_order_release);
+    return count;
+}
+
+int PerfRegistry::Find(const char* name) const {
+    int count = GetSlotCount();
+    for (int i = 0; i < count; ++i) {
+        if (strncmp(m_slots[i].name, name, sizeof(m_slots[i].name) - 1) == 0) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+void PerfRegistry::RecordLatency(int slot, uint64_t ns) {
+    if (slot < 0 || !IsEnabled()) {
+        return;
+    }
+    m_slots[slot].latency.Record(ns);
+}
+
+void PerfRegistry::RecordCache(int slot, bool hit) {
+    if (slot < 0 || !IsEnabled()) {
+        return;
+    }
+    Slot& s = m_slots[slot];
+    (hit ? s.cache_hits : s.cache_misses).fetch_add(1, std::memory_order_relaxed);
+}
+
+bool PerfRegistry::CheckRedundant(int slot, uint64_t data_key, uint64_t now_ns) {
+    if (slot < 0 || !IsEnabled()) {
+        return false;
+    }
+    Slot& s = m_slots[slot];
+    uint64_t last_key = s.last_key.exchange(data_key, std::memory_order_relaxed);
+    uint64_t last_time = s.last_time_ns.exchange(now_ns, std::memory_order_relaxed);
+    bool redundant = last_time != 0 && last_key == data_key &&
+                     now_ns - last_time <= m_window_ns.load(std::memory_order_relaxed);
+    if (redundant) {
+        s.redundant.fetch_add(1, std::memory_order_relaxed);
+    }
+    return redundant;
+}
+
+void PerfRegistry::FillStat(int slot, PerfStat& stat) const {
+    const Slot& s = m_slots[slot];
+    memset(&stat, 0, sizeof(stat));
+    memcpy(stat.name, s.name, sizeof(stat.name));
+    stat.kind = (int)s.kind;
+    stat.calls = s.latency.Count();
+    stat.cache_hits = s.cache_hits.load(std::memory_order_relaxed);
+    stat.cache_misses = s.cache_misses.load(std::memory_order_relaxed);
+    stat.redundant = s.redundant.load(std::memory_order_relaxed);
+    stat.total_us = s.latency.Sum() / 1000.0;
+    stat.mean_us = stat.calls > 0 ? stat.total_us / stat.calls : 0.0;
+    stat.p50_us = s.latency.Percentile(0.50) / 1000.0;
+    stat.p99_us = s.latency.Percentile(0.99) / 1000.0;
+    stat.max_us = s.latency.Max() / 1000.0;
+}
+
+int PerfRegistry::Snapshot(PerfStat* out, int capacity) const {
+    int count = GetSlotCount();
+    for (int i = 0; out && i < count && i < capacity; ++i) {
+        FillStat(i, out[i]);
+    }
+    return count;
+}
+
+std::string PerfRegistry::Format() const {
+    int count = GetSlotCount();
+    std::vector<PerfStat> stats(count);
+    Snapshot(stats.data(), count);
+    std::stable_sort(stats.begin(), stats.end(), [](const PerfStat& a, const PerfStat& b) {
+        if (a.kind != b.kind) return a.kind < b.kind;
+        return a.total_us > b.total_us;
+    });
+
+    std::string text;
+    char line[256];
+    snprintf(line, sizeof(line), "%-20s %-6s %10s %10s %10s %10s %12s %10s %10s %10s %10s\n",
+             "name", "kind", "calls", "hits", "misses", "redundant",
+             "total_ms", "mean_us", "p50_us", "p99_us", "max_us");
+    text += line;
+    for (const PerfStat& s : stats) {
+        if (s.calls == 0 && s.cache_hits == 0 && s.cache_misses == 0) {
+            continue;
+        }
+        snprintf(line, sizeof(line),
+                 "%-20s %-6s %10llu %10llu %10llu %10llu %12.3f %10.1f %10.1f %10.1f %10.1f\n",
+                 s.name, s.kind == (int)PerfKind::STAGE ? "stage" : "export",
+                 (unsigned long long)s.calls, (unsigned long long)s.cache_hits,
+                 (unsigned long long)s.cache_misses, (unsigned long long)s.redundant,
+                 s.total_us / 1000.0, s.mean_us, s.p50_us, s.p99_us, s.max_us);
+        text += line;
+    }
+    return text;
+}
+
+bool PerfRegistry::DumpToFile(const std::string& path) const {
+    FILE* f = fopen(path.c_str(), "a");
+    if (!f) {
+        return false;
+    }
+    char stamp[32];
+    time_t now = time(nullptr);
+    struct tm tm_now;
+#ifdef _WIN32
+    localtime_s(&tm_now, &now);
+#else
+    localtime_r(&now, &tm_now);
+#endif
+    strftime(stamp, sizeof(stamp), "%Y-%m-%d %H:%M:%S", &tm_now);
+    fprintf(f, "==== 缠论插件性能统计 %s ====\n%s\n", stamp, Format().c_str());
+    fclose(f);
+    return true;
+}
+
+void PerfRegistry::Reset() {
+    int count = GetSlotCount();
+    for (int i = 0; i < count; ++i) {
+        Slot& s = m_slots[i];
+        s.cache_hits.store(0, std::memory_order_relaxed);
+        s.cache_misses.store(0, std::memory_order_relaxed);
+        s.redundant.store(0, std::memory_order_relaxed);
+        s.last_key.store(0, std::memory_order_relaxed);
+        s.last_time_ns.store(0, std::memory_order_relaxed);
+        s.latency.Reset();
+    }
+}
+
+} // namespace chan
@@ -0,0 +1,262 @@
+// ============================================================================
+// 缠论通达信DLL插件 - 原始K线区间极值索引实现
+// ============================================================================
+
+#include "range_extreme.h"
+#include "fx_kernel.h"
+
+// SSE2 在 x64 与 /arch:SSE2 以上的 x86 目标上总是可用
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define CHAN_RANGE_SSE2 1
+#include <emmintrin.h>
+#else
+#define CHAN_RANGE_SSE2 0
+#endif
+
+namespace chan {
+
+namespace {
+
+// 最高置位的位序号（word 不能为0）
+inline int HighestBitIndex(uint32_t word) {
+#if defined(_MSC_VER)
+    unsigned long index;
+    _BitScanReverse(&index, word);
+    return (int)index;
+#else
+    return 31 - __builtin_clz(word);
+#endif
+}
+
+#if CHAN_RANGE_SSE2
+/// @brief 批量计算一整块（32根）K线的两侧位图
+/// @note 单调栈中严格劣于新K线的元素恰为栈顶连续一段，即块内严格劣于它的位置：
+///       与整块比较一次得到，无逐个弹栈的分支，结果与 PushMask 相同
+void FullBlockMasks(const float* high, const float* low, uint32_t* max_mask, uint32_t* min_mask) {
+    __m128 h[8];
+    __m128 l[8];
+    for (int g = 0; g < 8; ++g) {
+        h[g] = _mm_loadu_ps(high + 4 * g);
+        l[g] = _mm_loadu_ps(low + 4 * g);
+    }
+    uint32_t max_stack = 0;
+    uint32_t min_stack = 0;
+    for (int k = 0; k < RangeExtremeIndex::BLOCK; ++k) {
+        __m128 vh = _mm_set1_ps(high[k]);
+        __m128 vl = _mm_set1_ps(low[k]);
+        uint32_t below = 0;     // 最高价低于第 k 根的位置
+        uint32_t above = 0;     // 最低价高于第 k 根的位置
+        for (int g = 0; g < 8; ++g) {
+            below |= (uint32_t)_mm_movemask_ps(_mm_cmplt_ps(h[g], vh)) << (4 * g);
+            above |= (uint32_t)_mm_movemask_ps(_mm_cmpgt_ps(l[g], vl)) << (4 * g);
+        }
+        max_stack = (max_stack & ~below) | (1u << k);
+        min_stack = (min_stack & ~above) | (1u << k);
+        max_mask[k] = max_stack;
+        min_mask[k] = min_stack;
+    }
+}
+#endif
+
+} // namespace
+
+// ============================================================================
+// 构建与增量更新
+// ============================================================================
+
+void RangeExtremeIndex::Clear() {
+    m_high.clear();
+    m_low.clear();
+    Side* sides[2] = {&m_max, &m_min};
+    for (Side* side : sides) {
+        side->mask.clear();
+        for (std::vector<int>& level : side->table) {
+            level.clear();
+        }
+        side->levels = 0;
+    }
+}
+
+template <bool MAX>
+void RangeExtremeIndex::PushMask(Side& side, const std::vector<float>& value, int i) {
+    // 块内单调栈：弹出严格劣于新K线的栈顶（并列保留较早的），再压入新K线
+    int offset = i % BLOCK;
+    int base = i - offset;
+    uint32_t stack = offset == 0 ? 0u : side.mask[i - 1];
+    while (stack != 0) {
+        int top = HighestBitIndex(stack);
+        if (!Better<MAX>(value[i], value[base + top])) {
+            break;
+        }
+        stack &= ~(1u << top);
+    }
+    side.mask[i] = stack | (1u << offset);
+}
+
+template <bool MAX>
+void RangeExtremeIndex::RefreshLastBlock(Side& side, const std::vector<float>& value) {
+    // 最后一块的极值 = 最后一根K线位图的最低置位；其余各层只有以最后一块结尾的一项可能变化
+    int n = (int)value.size();
+    int blocks = (n + BLOCK - 1) / BLOCK;
+    int b = blocks - 1;
+    side.levels = HighestBitIndex((uint32_t)blocks) + 1;
+    if ((int)side.table.size() < side.levels) {
+        side.table.resize(side.levels);
+    }
+    
+    std::vector<int>& first = side.table[0];
+    first.resize(blocks);
+    first[b] = b * BLOCK + LowestBitIndex(side.mask[n - 1]);
+    for (int k = 1; k < side.levels; ++k) {
+        int j = blocks - (1 << k);
+        const std::vector<int>& lower = side.table[k - 1];
+        int a = lower[j];
+        int c = lower[j + (1 << (k - 1))];
+        std::vector<int>& level = side.table[k];
+        level.resize(j + 1);
+        level[j] = Better<MAX>(value[c], value[a]) ? c : a;
+    }
+}
+
+template <bool MAX>
+void RangeExtremeIndex::BuildTable(Side& side, const std::vector<float>& value) {
+    int n = (int)value.size();
+    int blocks = (n + BLOCK - 1) / BLOCK;
+    side.levels = blocks > 0 ? HighestBitIndex((uint32_t)blocks) + 1 : 0;
+    if ((int)side.table.size() < side.levels) {
+        side.table.resize(side.levels);
+    }
+    if (blocks == 0) {
+        return;
+    }
+    
+    std::vector<int>& first = side.table[0];
+    first.resize(blocks);
+    for (int b = 0; b < blocks; ++b) {
+        int last = (b + 1) * BLOCK < n ? (b + 1) * BLOCK - 1 : n - 1;
+        first[b] = b * BLOCK + LowestBitIndex(side.mask[last]);
+    }
+    for (int k = 1; k < side.levels; ++k) {
+        const std::vector<int>& lower = side.table[k - 1];
+        std::vector<int>& level = side.table[k];
+        int half = 1 << (k - 1);
+        level.resize(blocks - (1 << k) + 1);
+        for (int j = 0; j < (int)level.size(); ++j) {
+            int a = lower[j];
+            int c = lower[j + half];
+            level[j] = Better<MAX>(value[c], value[a]) ? c : a;
+        }
+    }
+}
+
+void RangeExtremeIndex::Build(const float* highs, const float* lows, int count) {
+    Clear();
+    if (!highs || !lows || count <= 0) {
+        return;
+    }
+    m_high.assign(highs, highs + count);
+    m_low.assign(lows, lows + count);
+    m_max.mask.resize(count);
+    m_min.mask.resize(count);
+    int i = 0;
+#if CHAN_RANGE_SSE2
+    for (; i + BLOCK <= count; i += BLOCK) {
+        FullBlockMasks(&m_high[i], &m_low[i], &m_max.mask[i], &m_min.mask[i]);
+    }
+#endif
+    for (; i < count; ++i) {
+        PushMask<true>(m_max, m_high, i);
+        PushMask<false>(m_min, m_low, i);
+    }
+    BuildTable<true>(m_max, m_high);
+    BuildTable<false>(m_min, m_low);
+}
+
+void RangeExtremeIndex::Append(float high, float low) {
+    int i = (int)m_high.size();
+    m_high.push_back(high);
+    m_low.push_back(low);
+    m_max.mask.push_back(0);
+    m_min.mask.push_back(0);
+    PushMask<true>(m_max, m_high, i);
+    PushMask<false>(m_min, m_low, i);
+    RefreshLastBlock<true>(m_max, m_high);
+    RefreshLastBlock<false>(m_min, m_low);
+}
+
+void RangeExtremeIndex::UpdateLast(float high, float low) {
+    if (m_high.empty()) {
+        return;
+    }
+    int i = (int)m_high.size() - 1;
+    m_high[i] = high;
+    m_low[i] = low;
+    PushMask<true>(m_max, m_high, i);
+    PushMask<false>(m_min, m_low, i);
+    RefreshLastBlock<true>(m_max, m_high);
+    RefreshLastBlock<false>(m_min, m_low);
+}
+
+// ============================================================================
+// 查询
+// ============================================================================
+
+template <bool MAX>
+int RangeExtremeIndex::Query(const Side& side, const std::vector<float>& value,
+                             int first, int last) const {
+    if (first < 0 || last < first || last >= (int)value.size()) {
+        return -1;
+    }
+    
+    // 块内：last 的位图中不早于 first 的最低置位
+    auto in_block = [&](int l, int r) {
+        return l + LowestBitIndex(side.mask[r] >> (l % BLOCK));
+    };
+    
+    int first_block = first / BLOCK;
+    int last_block = last / BLOCK;
+    if (first_block == last_block) {
+        return in_block(first, last);
+    }
+    
+    // 首块后缀 + 中间整块（稀疏表两段重叠覆盖）+ 末块前缀，并列取靠前的
+    int best = in_block(first, first_block * BLOCK + BLOCK - 1);
+    if (last_block - first_block > 1) {
+        int a = first_block + 1;
+        int c = last_block - 1;
+        int k = HighestBitIndex((uint32_t)(c - a + 1));
+        int left = side.table[k][a];
+        int right = side.table[k][c - (1 << k) + 1];
+        int mid = Better<MAX>(value[right], value[left]) ? right : left;
+        if (Better<MAX>(value[mid], value[best])) {
+            best = mid;
+        }
+    }
+    int tail = in_block(last_block * BLOCK, last);
+    if (Better<MAX>(value[tail], value[best])) {
+        best = tail;
+    }
+    return best;
+}
+
+int RangeExtremeIndex::ArgMax(int first, int last) const {
+    return Query<true>(m_max, m_high, first, last);
+}
+
+int RangeExtremeIndex::ArgMin(int first, int last) const {
+    return Query<false>(m_min, m_low, first, last);
+}
+
+size_t RangeExtremeIndex::MemoryBytes() const {
+    size_t bytes = (m_high.capacity() + m_low.capacity()) * sizeof(float);
+    const Side* sides[2] = {&m_max, &m_min};
+    for (const Side* side : sides) {
+        bytes += side->mask.capacity() * sizeof(uint32_t);
+        for (const std::vector<int>& level : side->table) {
+            bytes += level.capacity() * sizeof(int);
+        }
+    }
+    return bytes;
+}
+
+} // namespace chan
@@ -0,0 +1,343 @@
+// ============================================================================
+// 缠论通达信DLL插件 - 通达信本地数据文件读取实现
+// ============================================================================
+
+#include "tdx_data_reader.h"
+#include "logger.h"
+#include <cctype>
+#include <cstring>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+// SSE2 在 x64 与 /arch:SSE2 以上的 x86 目标上总是可用
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define CHAN_TDX_SSE2 1
+#include <emmintrin.h>
+#else
+#define CHAN_TDX_SSE2 0
+#endif
+
+namespace chan {
+
+TdxFileType DetectTdxFileType(const std::string& path) {
+    size_t dot = path.find_last_of('.');
+    if (dot == std::string::npos) {
+        return TdxFileType::UNKNOWN;
+    }
+    std::string ext = path.substr(dot + 1);
+    for (char& c : ext) {
+        c = (char)tolower((unsigned char)c);
+    }
+    if (ext == "day") return TdxFileType::DAY;
+    if (ext == "lc1") return TdxFileType::LC1;
+    if (ext == "lc5") return TdxFileType::LC5;
+    return TdxFileType::UNKNOWN;
+}
+
+// ============================================================================
+// 内存映射文件
+// ============================================================================
+
+#ifdef _WIN32
+
+MappedFile::MappedFile()
+    : m_data(nullptr), m_size(0), m_file(INVALID_HANDLE_VALUE), m_mapping(nullptr) {}
+
+bool MappedFile::Open(const std::string& path) {
+    Close();
+    HANDLE file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_WRITE,
+                              NULL, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, NULL);
+    if (file == INVALID_HANDLE_VALUE) {
+        return false;
+    }
+    m_file = file;
+
+    LARGE_INTEGER size;
+    if (!GetFileSizeEx(file, &size)) {
+        Close();
+        return false;
+    }
+    m_size = (size_t)size.QuadPart;
+    if (m_size == 0) {
+        return true;  // 空文件无法映射
+    }
+
+    m_mapping = CreateFileMappingA(file, NULL, PAGE_READONLY, 0, 0, NULL);
+    if (!m_mapping) {
+        Close();
+        return false;
+    }
+    m_data = (const unsigned char*)MapViewOfFile(m_mapping, FILE_MAP_READ, 0, 0, 0);
+    if (!m_data) {
+        Close();
+        return false;
+    }
+    return true;
+}
+
+void MappedFile::Close() {
+    if (m_data) UnmapViewOfFile(m_data);
+    if (m_mapping) CloseHandle(m_mapping);
+    if (m_file != INVALID_HANDLE_VALUE) CloseHandle(m_file);
+    m_data = nullptr;
+    m_size = 0;
+    m_mapping = nullptr;
+    m_file = INVALID_HANDLE_VALUE;
+}
+
+#else
+
+MappedFile::MappedFile() : m_data(nullptr), m_size(0), m_fd(-1) {}
+
+bool MappedFile::Open(const std::string& path) {
+    Close();
+    m_fd = open(path.c_str(), O_RDONLY);
+    if (m_fd < 0) {
+        return false;
+    }
+
+    struct stat st;
+    if (fstat(m_fd, &st) != 0) {
+        Close();
+        return false;
+    }
+    m_size = (size_t)st.st_size;
+    if (m_size == 0) {
+        return true;  // 空文件无法映射
+    }
+
+    void* addr = mmap(nullptr, m_size, PROT_READ, MAP_PRIVATE, m_fd, 0);
+    if (addr == MAP_FAILED) {
+        Close();
+        return false;
+    }
+    // 顺序读取，提示内核预读
+    madvise(addr, m_size, MADV_SEQUENTIAL);
+    m_data = (const unsigned char*)addr;
+    return true;
+}
+
+void MappedFile::Close() {
+    if (m_data) munmap((void*)m_data, m_size);
+    if (m_fd >= 0) close(m_fd);
+    m_data = nullptr;
+    m_size = 0;
+    m_fd = -1;
+}
+
+#endif
+
+MappedFile::~MappedFile() {
+    Close();
+}
+
+// ============================================================================
+// 记录解码
+// ============================================================================
+
+/// @brief uint32 转 float：高低16位分别精确转换后相加，只舍入一次
+///        （与 SSE2 路径算法相同，保证两条路径逐位一致）
+static inline float U32ToFloat(uint32_t v) {
+    return (float)(int)(v >> 16) * 65536.0f + (float)(int)(v & 0xFFFF);
+}
+
+static void DecodeScalar(const unsigned char* rec, int begin, int count, TdxFileType type,
+                         float price_scale, const TdxColumns& out) {
+    for (int i = begin; i < count; ++i) {
+        const unsigned char* r = rec + (size_t)i * TDX_RECORD_SIZE;
+        uint32_t w[8];
+        memcpy(w, r, sizeof(w));
+
+        float price[4];   // 开/高/低/收
+        if (type == TdxFileType::DAY) {
+            for (int k = 0; k < 4; ++k) {
+                price[k] = (float)(int32_t)w[1 + k] * price_scale;
+            }
+            if (out.dates) out.dates[i] = (int)w[0];
+            if (out.times) out.times[i] = 0;
+        } else {
+            memcpy(price, &w[1], 3 * sizeof(float));
+            memcpy(&price[3], &w[4], sizeof(float));
+            if (out.dates) out.dates[i] = DecodeTdxMinuteDate((uint16_t)(w[0] & 0xFFFF));
+            if (out.times) out.times[i] = (int)(w[0] >> 16);
+        }
+
+        if (out.opens) out.opens[i] = price[0];
+        if (out.highs) out.highs[i] = price[1];
+        if (out.lows) out.lows[i] = price[2];
+        if (out.closes) out.closes[i] = price[3];
+        if (out.volumes) out.volumes[i] = U32ToFloat(w[6]);
+    }
+}
+
+#if CHAN_TDX_SSE2
+
+/// @brief 一次转置4条记录：前16字节为 日期/开/高/低，后16字节为 收/成交额/成交量/保留
+/// @return 已处理的记录数（4的倍数）
+static int DecodeSSE2(const unsigned char* rec, int count, TdxFileType type,
+                      float price_scale, const TdxColumns& out) {
+    const bool day = type == TdxFileType::DAY;
+    const __m128 scale = _mm_set1_ps(price_scale);
+    const __m128 k65536 = _mm_set1_ps(65536.0f);
+    const __m128i lo16 = _mm_set1_epi32(0xFFFF);
+
+    int i = 0;
+    for (; i + 4 <= count; i += 4) {
+        const unsigned char* r = rec + (size_t)i * TDX_RECORD_SIZE;
+        __m128 a0 = _mm_loadu_ps((const float*)(r + 0));
+        __m128 b0 = _mm_loadu_ps((const float*)(r + 16));
+        __m128 a1 = _mm_loadu_ps((const float*)(r + 32));
+        __m128 b1 = _mm_loadu_ps((const float*)(r + 48));
+        __m128 a2 = _mm_loadu_ps((const float*)(r + 64));
+        __m128 b2 = _mm_loadu_ps((const float*)(r + 80));
+        __m128 a3 = _mm_loadu_ps((const float*)(r + 96));
+        __m128 b3 = _mm_loadu_ps((const float*)(r + 112));
+
+        // 纯数据搬移，不改变位模式
+        _MM_TRANSPOSE4_PS(a0, a1, a2, a3);  // a0=日期 a1=开 a2=高 a3=低
+        _MM_TRANSPOSE4_PS(b0, b1, b2, b3);  // b0=收 b1=成交额 b2=成交量 b3=保留
+
+        __m128 open = a1, high = a2, low = a3, close = b0;
+        if (day) {
+            open = _mm_mul_ps(_mm_cvtepi32_ps(_mm_castps_si128(a1)), scale);
+            high = _mm_mul_ps(_mm_cvtepi32_ps(_mm_castps_si128(a2)), scale);
+            low = _mm_mul_ps(_mm_cvtepi32_ps(_mm_castps_si128(a3)), scale);
+            close = _mm_mul_ps(_mm_cvtepi32_ps(_mm_castps_si128(b0)), scale);
+        }
+
+        if (out.opens) _mm_storeu_ps(out.opens + i, open);
+        if (out.highs) _mm_storeu_ps(out.highs + i, high);
+        if (out.lows) _mm_storeu_ps(out.lows + i, low);
+        if (out.closes) _mm_storeu_ps(out.closes + i, close);
+        if (out.volumes) {
+            __m128i v = _mm_castps_si128(b2);
+            __m128 hi = _mm_cvtepi32_ps(_mm_srli_epi32(v, 16));
+            __m128 lo = _mm_cvtepi32_ps(_mm_and_si128(v, lo16));
+            _mm_storeu_ps(out.volumes + i, _mm_add_ps(_mm_mul_ps(hi, k65536), lo));
+        }
+
+        __m128i date = _mm_castps_si128(a0);
+        if (day) {
+            if (out.dates) _mm_storeu_si128((__m128i*)(out.dates + i), date);
+            if (out.times) _mm_storeu_si128((__m128i*)(out.times + i), _mm_setzero_si128());
+        } else {
+            if (out.times) _mm_storeu_si128((__m128i*)(out.times + i), _mm_srli_epi32(date, 16));
+            if (out.dates) {
+                // 分钟线日期需要除法，逐条换算
+                uint32_t packed[4];
+                _mm_storeu_si128((__m128i*)packed, date);
+                for (int k = 0; k < 4; ++k) {
+                    out.dates[i + k] = DecodeTdxMinuteDate((uint16_t)(packed[k] & 0xFFFF));
+                }
+            }
+        }
+    }
+    return i;
+}
+
+#endif
+
+void DecodeTdxRecords(const void* records, int count, TdxFileType type, float price_scale,
+                      const TdxColumns& out, bool simd) {
+    if (!records || count <= 0 || type == TdxFileType::UNKNOWN) {
+        return;
+    }
+    const unsigned char* rec = (const unsigned char*)records;
+
+    int i = 0;
+#if CHAN_TDX_SSE2
+    if (simd) {
+        i = DecodeSSE2(rec, count, type, price_scale, out);
+    }
+#else
+    (void)simd;
+#endif
+    DecodeScalar(rec, i, count, type, price_scale, out);
+}
+
+// ============================================================================
+// 文件加载
+// ============================================================================
+
+void TdxBars::Clear() {
+    opens.clear();
+    highs.clear();
+    lows.clear();
+    closes.clear();
+    volumes.clear();
+    dates.clear();
+    times.clear();
+    offsets.clear();
+}
+
+static void ResizeBars(TdxBars& bars, int count) {
+    bars.opens.resize(count);
+    bars.highs.resize(count);
+    bars.lows.resize(count);
+    bars.closes.resize(count);
+    bars.volumes.resize(count);
+    bars.dates.resize(count);
+    bars.times.resize(count);
+}
+
+static TdxColumns ColumnsAt(TdxBars& bars, int offset) {
+    TdxColumns out;
+    out.opens = bars.opens.data() + offset;
+    out.highs = bars.highs.data() + offset;
+    out.lows = bars.lows.data() + offset;
+    out.closes = bars.closes.data() + offset;
+    out.volumes = bars.volumes.data() + offset;
+    out.dates = bars.dates.data() + offset;
+    out.times = bars.times.data() + offset;
+    return out;
+}
+
+bool LoadTdxFile(const std::string& path, TdxBars& bars, float price_scale) {
+    std::vector<std::string> paths(1, path);
+    return LoadTdxFiles(paths, bars, price_scale) == 1;
+}
+
+int LoadTdxFiles(const std::vector<std::string>& paths, TdxBars& bars, float price_scale) {
+    bars.Clear();
+
+    // 第一遍：映射全部文件并统计记录数
+    std::vector<MappedFile> files(paths.size());
+    std::vector<TdxFileType> types(paths.size());
+    bars.offsets.resize(paths.size() + 1);
+    bars.offsets[0] = 0;
+    int loaded = 0;
+    for (size_t f = 0; f < paths.size(); ++f) {
+        types[f] = DetectTdxFileType(paths[f]);
+        int count = 0;
+        if (types[f] == TdxFileType::UNKNOWN) {
+            CHAN_LOG_ERROR("LoadTdxFiles: 无法识别的文件类型 %s", paths[f].c_str());
+        } else if (!files[f].Open(paths[f])) {
+            CHAN_LOG_ERROR("LoadTdxFiles: 无法打开 %s", paths[f].c_str());
+        } else {
+            count = (int)(files[f].size() / TDX_RECORD_SIZE);
+            ++loaded;
+        }
+        bars.offsets[f + 1] = bars.offsets[f] + count;
+    }
+
+    // 一次分配，逐文件解码到各自区间
+    ResizeBars(bars, bars.offsets[paths.size()]);
+    for (size_t f = 0; f < paths.size(); ++f) {
+        int count = bars.offsets[f + 1] - bars.offsets[f];
+        if (count > 0) {
+            DecodeTdxRecords(files[f].data(), count, types[f], price_scale,
+                             ColumnsAt(bars, bars.offsets[f]));
+            files[f].Close();
+        }
+    }
+    return loaded;
+}
+
+} // namespace chan
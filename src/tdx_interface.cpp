@@ -5,10 +5,13 @@
 #include "tdx_interface.h"
 #include "chan_core.h"
 #include "config_reader.h"
+#include "analysis_cache.h"
+#include "perf_counters.h"
 #include "logger.h"
 #include <cstring>
 #include <cmath>
 #include <memory>
+#include <mutex>
 #include <chrono>
 
 // ============================================================================
@@ -21,52 +24,161 @@
 // 函数信息数组
 static PluginTCalcFuncInfo g_FuncInfo[FUNC_COUNT];
 
-// 全局缠论核心实例（用于缓存计算结果）
-static std::unique_ptr<chan::ChanCore> g_ChanCore;
-static int g_LastCount = 0;  // 上次计算的K线数量
-static bool g_ConfigLoaded = false;  // 配置是否已加载
+// 全局分析缓存：按 (数据指纹, ChanConfig) 缓存分析会话
+// 同一公式中的多个函数调用共享同一会话，只分析一次
+// 通达信在多个线程上执行公式：缓存及取得的会话只在持有 g_CacheMutex 时访问，
+// 每次导出函数调用从取会话到复制输出全程持锁（见 ExportScope），
+// 避免会话被其它线程淘汰或复用重算时仍在读取
+static chan::AnalysisCache g_AnalysisCache;
+static std::mutex g_CacheMutex;
+static std::once_flag g_ConfigOnce;  // 配置只加载一次
 
-// 性能统计
-static long long g_TotalCalcTimeUs = 0;  // 总计算时间(微秒)
-static int g_CalcCount = 0;  // 计算次数
+// ============================================================================
+// 性能计数
+// ============================================================================
+
+// 槽位编号即注册顺序：各导出函数在前，处理阶段在后
+enum PerfSlotId {
+    PERF_FX, PERF_BI, PERF_DUAN, PERF_ZS_H, PERF_ZS_L, PERF_BUY, PERF_SELL, PERF_BC,
+    PERF_DIR, PERF_GG, PERF_DD, PERF_HH, PERF_LL, PERF_AMP, PERF_BUYX, PERF_SELLX,
+    PERF_ZS_Z, PERF_PREBUY, PERF_PRESELL, PERF_LIKE2B, PERF_LIKE2S, PERF_NEWBAR,
+    PERF_STAGE_LOOKUP,          // 缓存命中时的查找（含数据指纹）
+    PERF_STAGE_ANALYZE,         // 缓存未命中时的完整分析
+    PERF_STAGE_BI_SEQUENCE,     // 递归引用序列首次构建
+    PERF_STAGE_SIGNAL,          // 信号首次生成
+    PERF_SLOT_COUNT
+};
+
+static const char* const kPerfSlotNames[PERF_SLOT_COUNT] = {
+    "CHAN_FX", "CHAN_BI", "CHAN_DUAN", "CHAN_ZS_H", "CHAN_ZS_L", "CHAN_BUY", "CHAN_SELL", "CHAN_BC",
+    "CHAN_DIR", "CHAN_GG", "CHAN_DD", "CHAN_HH", "CHAN_LL", "CHAN_AMP", "CHAN_BUYX", "CHAN_SELLX",
+    "CHAN_ZS_Z", "CHAN_PREBUY", "CHAN_PRESELL", "CHAN_LIKE2B", "CHAN_LIKE2S", "CHAN_NEWBAR",
+    "stage.lookup", "stage.analyze", "stage.bi_sequence", "stage.signal"
+};
+
+static chan::PerfRegistry g_Perf;
+
+static bool RegisterPerfSlots() {
+    for (int i = 0; i < PERF_SLOT_COUNT; ++i) {
+        g_Perf.Register(kPerfSlotNames[i], i < PERF_STAGE_LOOKUP ? chan::PerfKind::EXPORT
+                                                                 : chan::PerfKind::STAGE);
+    }
+    return true;
+}
+static const bool g_PerfSlotsRegistered = RegisterPerfSlots();
+
+// 一次导出函数调用：计时（含等待缓存锁），持有缓存锁，
+// 并供 AcquireSession 记录命中与冗余调用
+class ExportScope {
+public:
+    // param_count: 参与冗余判断的公式参数个数（只读取函数实际声明的参数）
+    ExportScope(int slot, const float* pParam, int param_count = 1)
+        : m_timer(g_Perf, slot), m_cache_lock(g_CacheMutex)
+        , m_slot(slot), m_param_key(0), m_prev(t_current) {
+        for (int i = 0; pParam && i < param_count; ++i) {
+            uint32_t bits;
+            memcpy(&bits, &pParam[i], sizeof(bits));
+            m_param_key = (m_param_key ^ bits) * 0x9E3779B97F4A7C15ull;
+        }
+        t_current = this;
+    }
+    ~ExportScope() { t_current = m_prev; }
+
+    static ExportScope* Current() { return t_current; }
+
+    // 缓存查找后调用：hit 为是否命中，key 为 (数据指纹, 配置) 键
+    void OnSession(bool hit, uint64_t key) {
+        g_Perf.RecordCache(m_slot, hit);
+        if (m_timer.StartNs() != 0) {
+            g_Perf.CheckRedundant(m_slot, key ^ m_param_key, m_timer.StartNs());
+        }
+    }
 
-// 初始化核心实例
-static void EnsureChanCore() {
-    // 首次加载配置
-    if (!g_ConfigLoaded) {
+private:
+    chan::PerfTimer m_timer;
+    std::lock_guard<std::mutex> m_cache_lock;
+    int m_slot;
+    uint64_t m_param_key;
+    ExportScope* m_prev;
+    static thread_local ExportScope* t_current;
+};
+thread_local ExportScope* ExportScope::t_current = nullptr;
+
+// 首次调用时加载配置并设置缓存容量
+static void EnsureConfig() {
+    std::call_once(g_ConfigOnce, [] {
         chan::InitGlobalConfig();
-        g_ConfigLoaded = true;
+        
+        const auto& config = chan::GetGlobalConfigReader().GetConfig();
+        // 禁用增量计算时缓存容量为0，每次调用都重新分析
+        g_AnalysisCache.SetCapacity(config.enable_incremental ? config.cache_size : 0);
+        g_AnalysisCache.SetMaxEntries(config.cache_entries);
+        g_Perf.SetEnabled(config.enable_perf_counters);
+        g_Perf.SetRedundantWindowMs(config.perf_redundant_window_ms);
+    });
+}
+
+// 获取已分析的会话，数据与配置均未变化时直接复用缓存结果
+// minBiLen>0 时覆盖笔最小K线数（来自公式参数N）；全部导出函数都传入 ParseMinBiLen(pParam)，
+// 同一公式中的函数配置一致，共享同一会话
+static chan::AnalysisSession* AcquireSession(int nCount, const float* pHigh, const float* pLow,
+                                       const float* pClose, const float* pVol, int minBiLen) {
+    EnsureConfig();
+    
+    // 从INI配置初始化
+    chan::ChanConfig config;
+    const auto& reader = chan::GetGlobalConfigReader();
+    if (reader.IsLoaded()) {
+        config = reader.ToChanConfig();
+    } else {
+        config.min_bi_len = 5;
+        config.min_fx_distance = 1;
+        config.min_zs_bi_count = 3;
+    }
+    if (minBiLen > 0) {
+        config.min_bi_len = minBiLen;
     }
     
-    if (!g_ChanCore) {
-        g_ChanCore = std::make_unique<chan::ChanCore>();
-        
-        // 从INI配置初始化
-        const auto& reader = chan::GetGlobalConfigReader();
-        if (reader.IsLoaded()) {
-            g_ChanCore->SetConfig(reader.ToChanConfig());
-        } else {
-            chan::ChanConfig config;
-            config.min_bi_len = 5;
-            config.min_fx_distance = 1;
-            config.min_zs_bi_count = 3;
-            g_ChanCore->SetConfig(config);
+    uint64_t t0 = g_Perf.IsEnabled() ? chan::PerfRegistry::NowNs() : 0;
+    chan::AnalysisSession* session =
+        g_AnalysisCache.AcquireSession(pHigh, pLow, pClose, pVol, nCount, config);
+    if (session && t0 != 0) {
+        bool hit = g_AnalysisCache.LastWasHit();
+        g_Perf.RecordLatency(hit ? PERF_STAGE_LOOKUP : PERF_STAGE_ANALYZE,
+                             chan::PerfRegistry::NowNs() - t0);
+        if (ExportScope* scope = ExportScope::Current()) {
+            scope->OnSession(hit, g_AnalysisCache.LastKey());
         }
     }
+    return session;
 }
 
-// 增量计算检查 - 如果K线数量变化则需要重新计算
-static bool NeedRecalculate(int nCount) {
-    const auto& config = chan::GetGlobalConfigReader().GetConfig();
-    if (!config.enable_incremental) {
-        return true;  // 禁用增量计算，总是重新计算
+// 确保递归引用序列已构建（首次构建计入阶段耗时）
+static void EnsureBiSequence(chan::AnalysisSession* session) {
+    if (!session->HasBiSequence()) {
+        chan::PerfTimer timer(g_Perf, PERF_STAGE_BI_SEQUENCE);
+        session->EnsureBiSequence();
     }
-    
-    if (nCount != g_LastCount) {
-        g_LastCount = nCount;
-        return true;
+}
+
+// 复制会话中延迟生成的信号到输出数组
+static void CopySessionSignal(chan::AnalysisSession* session, chan::SessionSignal kind,
+                              float* pOut, int nCount, const float* pHigh, const float* pLow) {
+    if (!session->HasSignal(kind)) {
+        chan::PerfTimer timer(g_Perf, PERF_STAGE_SIGNAL);
+        session->GetSignal(kind, pHigh, pLow);
+    }
+    const std::vector<float>& signal = session->GetSignal(kind, pHigh, pLow);
+    memcpy(pOut, signal.data(), nCount * sizeof(float));
+}
+
+// 解析公式参数N（笔最小K线数），超出范围时使用默认值5
+static int ParseMinBiLen(const float* pParam) {
+    int minBiLen = 5;
+    if (pParam && pParam[0] >= 1 && pParam[0] <= 10) {
+        minBiLen = static_cast<int>(pParam[0]);
     }
-    return false;
+    return minBiLen;
 }
 
 // ============================================================================
@@ -265,194 +377,197 @@ extern "C" __declspec(dllexport) void __stdcall RegisterTdxFunc(PluginTCalcFuncI
     CHAN_LOG_INFO("已注册 %d 个函数", idx);
 }
 
+extern "C" __declspec(dllexport) void __stdcall GetChanCacheStats(int* pHits, int* pMisses, int* pEntries)
+{
+    chan::CacheStats stats;
+    {
+        std::lock_guard<std::mutex> lock(g_CacheMutex);
+        stats = g_AnalysisCache.GetStats();
+    }
+    if (pHits) *pHits = static_cast<int>(stats.hits);
+    if (pMisses) *pMisses = static_cast<int>(stats.misses);
+    if (pEntries) *pEntries = stats.entries;
+}
+
+extern "C" __declspec(dllexport) int __stdcall GetChanPerfStats(ChanPerfStat* pStats, int nCapacity)
+{
+    return g_Perf.Snapshot(pStats, nCapacity);
+}
+
+extern "C" __declspec(dllexport) int __stdcall DumpChanPerfStats(const char* pPath)
+{
+    std::string path = pPath ? pPath : "";
+    if (path.empty()) {
+        // 默认写到配置文件（DLL）所在目录
+        std::string ini = chan::GetGlobalConfigReader().GetIniPath();
+        size_t pos = ini.find_last_of("\\/");
+        path = (pos == std::string::npos ? std::string() : ini.substr(0, pos + 1)) + "chan_perf.txt";
+    }
+    return g_Perf.DumpToFile(path) ? 1 : 0;
+}
+
+extern "C" __declspec(dllexport) void __stdcall ResetChanPerfStats()
+{
+    g_Perf.Reset();
+}
+
+void ChanPerfDumpOnUnload()
+{
+    if (!g_Perf.IsEnabled()) {
+        return;
+    }
+    // 没有任何调用（如只被枚举注册）时不写文件
+    ChanPerfStat stats[PERF_SLOT_COUNT];
+    int count = g_Perf.Snapshot(stats, PERF_SLOT_COUNT);
+    uint64_t calls = 0;
+    for (int i = 0; i < count && i < PERF_SLOT_COUNT; ++i) {
+        calls += stats[i].calls;
+    }
+    if (calls > 0) {
+        DumpChanPerfStats(nullptr);
+    }
+}
+
 // ============================================================================
-// 计算函数实现 (P1阶段: 占位实现，输出全0)
+// 计算函数实现（阶段一：分型/笔/线段/中枢/背驰）
 // ============================================================================
 
 // 分型标记函数
 void __stdcall CHAN_FX_Calc(int nCount, float* pOut, float* pHigh, float* pLow, 
                             float* pClose, float* pVol, float* pAmount, float* pParam)
 {
+    ExportScope perf(PERF_FX, pParam);
     CHAN_LOG_DEBUG("CHAN_FX_Calc: nCount=%d", nCount);
     
     if (pOut == nullptr || nCount <= 0) return;
     
-    EnsureChanCore();
-    
-    // 获取参数（笔最小K线数）
-    int minBiLen = 5;
-    if (pParam && pParam[0] >= 1 && pParam[0] <= 10) {
-        minBiLen = static_cast<int>(pParam[0]);
-    }
-    
-    // 更新配置
-    chan::ChanConfig config = g_ChanCore->GetConfig();
-    config.min_bi_len = minBiLen;
-    g_ChanCore->SetConfig(config);
-    
-    // 执行分析
-    g_ChanCore->Analyze(pHigh, pLow, pClose, pVol, nCount);
-    g_LastCount = nCount;
+    // 获取参数（笔最小K线数）并执行分析
+    chan::AnalysisSession* session = AcquireSession(nCount, pHigh, pLow, pClose, pVol, ParseMinBiLen(pParam));
+    if (!session) return;
     
     // 输出分型标记
-    g_ChanCore->OutputFX(pOut, nCount);
+    session->Core().OutputFX(pOut, nCount);
 }
 
 // 笔端点函数
 void __stdcall CHAN_BI_Calc(int nCount, float* pOut, float* pHigh, float* pLow, 
                             float* pClose, float* pVol, float* pAmount, float* pParam)
 {
+    ExportScope perf(PERF_BI, pParam);
     CHAN_LOG_DEBUG("CHAN_BI_Calc: nCount=%d", nCount);
     
     if (pOut == nullptr || nCount <= 0) return;
     
-    EnsureChanCore();
-    
-    // 获取参数
-    int minBiLen = 5;
-    if (pParam && pParam[0] >= 1 && pParam[0] <= 10) {
-        minBiLen = static_cast<int>(pParam[0]);
-    }
-    
-    // 更新配置
-    chan::ChanConfig config = g_ChanCore->GetConfig();
-    config.min_bi_len = minBiLen;
-    g_ChanCore->SetConfig(config);
-    
-    // 如果K线数量变化，重新计算
-    if (nCount != g_LastCount) {
-        g_ChanCore->Analyze(pHigh, pLow, pClose, pVol, nCount);
-        g_LastCount = nCount;
-    }
+    // 数据或参数变化时重新计算
+    chan::AnalysisSession* session = AcquireSession(nCount, pHigh, pLow, pClose, pVol, ParseMinBiLen(pParam));
+    if (!session) return;
     
     // 输出笔端点
-    g_ChanCore->OutputBI(pOut, nCount);
+    session->Core().OutputBI(pOut, nCount);
 }
 
 // 线段端点函数
 void __stdcall CHAN_DUAN_Calc(int nCount, float* pOut, float* pHigh, float* pLow, 
                               float* pClose, float* pVol, float* pAmount, float* pParam)
 {
+    ExportScope perf(PERF_DUAN, pParam);
     CHAN_LOG_DEBUG("CHAN_DUAN_Calc: nCount=%d", nCount);
     
     if (pOut == nullptr || nCount <= 0) return;
     
-    // 线段识别暂未实现，输出全0
-    memset(pOut, 0, nCount * sizeof(float));
+    // 数据或参数变化时重新计算
+    chan::AnalysisSession* session = AcquireSession(nCount, pHigh, pLow, pClose, pVol, ParseMinBiLen(pParam));
+    if (!session) return;
     
-    // TODO: 实现线段划分逻辑（阶段二）
+    // 输出线段端点
+    session->Core().OutputDUAN(pOut, nCount);
 }
 
 // 中枢高点函数
 void __stdcall CHAN_ZS_H_Calc(int nCount, float* pOut, float* pHigh, float* pLow, 
                               float* pClose, float* pVol, float* pAmount, float* pParam)
 {
+    ExportScope perf(PERF_ZS_H, pParam);
     CHAN_LOG_DEBUG("CHAN_ZS_H_Calc: nCount=%d", nCount);
     
     if (pOut == nullptr || nCount <= 0) return;
     
-    EnsureChanCore();
-    
-    // 如果K线数量变化，重新计算
-    if (nCount != g_LastCount) {
-        int minBiLen = 5;
-        if (pParam && pParam[0] >= 1 && pParam[0] <= 10) {
-            minBiLen = static_cast<int>(pParam[0]);
-        }
-        chan::ChanConfig config = g_ChanCore->GetConfig();
-        config.min_bi_len = minBiLen;
-        g_ChanCore->SetConfig(config);
-        g_ChanCore->Analyze(pHigh, pLow, pClose, pVol, nCount);
-        g_LastCount = nCount;
-    }
+    // 数据或参数变化时重新计算
+    chan::AnalysisSession* session = AcquireSession(nCount, pHigh, pLow, pClose, pVol, ParseMinBiLen(pParam));
+    if (!session) return;
     
     // 输出中枢高点
-    g_ChanCore->OutputZS_H(pOut, nCount);
+    session->Core().OutputZS_H(pOut, nCount);
 }
 
 // 中枢低点函数
 void __stdcall CHAN_ZS_L_Calc(int nCount, float* pOut, float* pHigh, float* pLow, 
                               float* pClose, float* pVol, float* pAmount, float* pParam)
 {
+    ExportScope perf(PERF_ZS_L, pParam);
     CHAN_LOG_DEBUG("CHAN_ZS_L_Calc: nCount=%d", nCount);
     
     if (pOut == nullptr || nCount <= 0) return;
     
-    EnsureChanCore();
-    
-    // 如果K线数量变化，重新计算
-    if (nCount != g_LastCount) {
-        int minBiLen = 5;
-        if (pParam && pParam[0] >= 1 && pParam[0] <= 10) {
-            minBiLen = static_cast<int>(pParam[0]);
-        }
-        chan::ChanConfig config = g_ChanCore->GetConfig();
-        config.min_bi_len = minBiLen;
-        g_ChanCore->SetConfig(config);
-        g_ChanCore->Analyze(pHigh, pLow, pClose, pVol, nCount);
-        g_LastCount = nCount;
-    }
+    // 数据或参数变化时重新计算
+    chan::AnalysisSession* session = AcquireSession(nCount, pHigh, pLow, pClose, pVol, ParseMinBiLen(pParam));
+    if (!session) return;
     
     // 输出中枢低点
-    g_ChanCore->OutputZS_L(pOut, nCount);
+    session->Core().OutputZS_L(pOut, nCount);
 }
 
 // 买点信号函数 (阶段三)
 void __stdcall CHAN_BUY_Calc(int nCount, float* pOut, float* pHigh, float* pLow, 
                              float* pClose, float* pVol, float* pAmount, float* pParam)
 {
+    ExportScope perf(PERF_BUY, pParam);
     (void)pAmount;  // 未使用
-    (void)pParam;   // 未使用
     
     CHAN_LOG_DEBUG("CHAN_BUY_Calc: nCount=%d", nCount);
     
     if (pOut == nullptr || nCount <= 0) return;
     
-    EnsureChanCore();
-    
-    g_ChanCore->RemoveInclude(pHigh, pLow, nCount);
-    g_ChanCore->CheckFX();
-    g_ChanCore->CheckBI();
-    g_ChanCore->BuildBiSequence(nCount - 1);
+    chan::AnalysisSession* session = AcquireSession(nCount, pHigh, pLow, pClose, pVol, ParseMinBiLen(pParam));
+    if (!session) return;
     
     // 输出买点信号 (传入low数组用于价格比较)
-    g_ChanCore->OutputBuySignal(pOut, nCount, pLow);
+    CopySessionSignal(session, chan::SessionSignal::BUY, pOut, nCount, pHigh, pLow);
 }
 
 // 卖点信号函数 (阶段三)
 void __stdcall CHAN_SELL_Calc(int nCount, float* pOut, float* pHigh, float* pLow, 
                               float* pClose, float* pVol, float* pAmount, float* pParam)
 {
+    ExportScope perf(PERF_SELL, pParam);
     (void)pAmount;  // 未使用
-    (void)pParam;   // 未使用
     
     CHAN_LOG_DEBUG("CHAN_SELL_Calc: nCount=%d", nCount);
     
     if (pOut == nullptr || nCount <= 0) return;
     
-    EnsureChanCore();
-    
-    g_ChanCore->RemoveInclude(pHigh, pLow, nCount);
-    g_ChanCore->CheckFX();
-    g_ChanCore->CheckBI();
-    g_ChanCore->BuildBiSequence(nCount - 1);
+    chan::AnalysisSession* session = AcquireSession(nCount, pHigh, pLow, pClose, pVol, ParseMinBiLen(pParam));
+    if (!session) return;
     
     // 输出卖点信号 (传入high数组用于价格比较)
-    g_ChanCore->OutputSellSignal(pOut, nCount, pHigh);
+    CopySessionSignal(session, chan::SessionSignal::SELL, pOut, nCount, pHigh, pLow);
 }
 
 // 背驰标记函数
 void __stdcall CHAN_BC_Calc(int nCount, float* pOut, float* pHigh, float* pLow, 
                             float* pClose, float* pVol, float* pAmount, float* pParam)
 {
+    ExportScope perf(PERF_BC, pParam);
     CHAN_LOG_DEBUG("CHAN_BC_Calc: nCount=%d", nCount);
     
     if (pOut == nullptr || nCount <= 0) return;
     
-    // P1阶段: 输出全0
-    memset(pOut, 0, nCount * sizeof(float));
+    // 数据或参数变化时重新计算
+    chan::AnalysisSession* session = AcquireSession(nCount, pHigh, pLow, pClose, pVol, ParseMinBiLen(pParam));
+    if (!session) return;
     
-    // TODO P6: 实现背驰判断逻辑
+    // 输出背驰标记（MACD面积比较）
+    session->Core().OutputBC(pOut, nCount);
 }
 
 // ============================================================================
@@ -463,26 +578,25 @@ void __stdcall CHAN_BC_Calc(int nCount, float* pOut, float* pHigh, float* pLow,
 void __stdcall CHAN_DIR_Calc(int nCount, float* pOut, float* pHigh, float* pLow, 
                              float* pClose, float* pVol, float* pAmount, float* pParam)
 {
+    ExportScope perf(PERF_DIR, pParam);
     CHAN_LOG_DEBUG("CHAN_DIR_Calc: nCount=%d", nCount);
     
     if (pOut == nullptr || nCount <= 0) return;
     
-    EnsureChanCore();
-    
     // 执行计算
-    g_ChanCore->RemoveInclude(pHigh, pLow, nCount);
-    g_ChanCore->CheckFX();
-    g_ChanCore->CheckBI();
-    g_ChanCore->BuildBiSequence(nCount - 1);
+    chan::AnalysisSession* session = AcquireSession(nCount, pHigh, pLow, pClose, pVol, ParseMinBiLen(pParam));
+    if (!session) return;
+    EnsureBiSequence(session);
     
     // 输出方向
-    g_ChanCore->OutputDirection(pOut, nCount);
+    session->Core().OutputDirection(pOut, nCount);
 }
 
 // GG顶点价格函数
 void __stdcall CHAN_GG_Calc(int nCount, float* pOut, float* pHigh, float* pLow, 
                             float* pClose, float* pVol, float* pAmount, float* pParam)
 {
+    ExportScope perf(PERF_GG, pParam, 2);
     CHAN_LOG_DEBUG("CHAN_GG_Calc: nCount=%d", nCount);
     
     if (pOut == nullptr || nCount <= 0) return;
@@ -491,20 +605,18 @@ void __stdcall CHAN_GG_Calc(int nCount, float* pOut, float* pHigh, float* pLow,
     if (idx < 1) idx = 1;
     if (idx > 5) idx = 5;
     
-    EnsureChanCore();
+    chan::AnalysisSession* session = AcquireSession(nCount, pHigh, pLow, pClose, pVol, ParseMinBiLen(pParam));
+    if (!session) return;
+    EnsureBiSequence(session);
     
-    g_ChanCore->RemoveInclude(pHigh, pLow, nCount);
-    g_ChanCore->CheckFX();
-    g_ChanCore->CheckBI();
-    g_ChanCore->BuildBiSequence(nCount - 1);
-    
-    g_ChanCore->OutputGG(pOut, nCount, idx);
+    session->Core().OutputGG(pOut, nCount, idx);
 }
 
 // DD底点价格函数
 void __stdcall CHAN_DD_Calc(int nCount, float* pOut, float* pHigh, float* pLow, 
                             float* pClose, float* pVol, float* pAmount, float* pParam)
 {
+    ExportScope perf(PERF_DD, pParam, 2);
     CHAN_LOG_DEBUG("CHAN_DD_Calc: nCount=%d", nCount);
     
     if (pOut == nullptr || nCount <= 0) return;
@@ -513,20 +625,18 @@ void __stdcall CHAN_DD_Calc(int nCount, float* pOut, float* pHigh, float* pLow,
     if (idx < 1) idx = 1;
     if (idx > 5) idx = 5;
     
-    EnsureChanCore();
-    
-    g_ChanCore->RemoveInclude(pHigh, pLow, nCount);
-    g_ChanCore->CheckFX();
-    g_ChanCore->CheckBI();
-    g_ChanCore->BuildBiSequence(nCount - 1);
+    chan::AnalysisSession* session = AcquireSession(nCount, pHigh, pLow, pClose, pVol, ParseMinBiLen(pParam));
+    if (!session) return;
+    EnsureBiSequence(session);
     
-    g_ChanCore->OutputDD(pOut, nCount, idx);
+    session->Core().OutputDD(pOut, nCount, idx);
 }
 
 // HH顶点距离函数
 void __stdcall CHAN_HH_Calc(int nCount, float* pOut, float* pHigh, float* pLow, 
                             float* pClose, float* pVol, float* pAmount, float* pParam)
 {
+    ExportScope perf(PERF_HH, pParam, 2);
     CHAN_LOG_DEBUG("CHAN_HH_Calc: nCount=%d", nCount);
     
     if (pOut == nullptr || nCount <= 0) return;
@@ -535,20 +645,18 @@ void __stdcall CHAN_HH_Calc(int nCount, float* pOut, float* pHigh, float* pLow,
     if (idx < 1) idx = 1;
     if (idx > 5) idx = 5;
     
-    EnsureChanCore();
+    chan::AnalysisSession* session = AcquireSession(nCount, pHigh, pLow, pClose, pVol, ParseMinBiLen(pParam));
+    if (!session) return;
+    EnsureBiSequence(session);
     
-    g_ChanCore->RemoveInclude(pHigh, pLow, nCount);
-    g_ChanCore->CheckFX();
-    g_ChanCore->CheckBI();
-    g_ChanCore->BuildBiSequence(nCount - 1);
-    
-    g_ChanCore->OutputHH(pOut, nCount, idx);
+    session->Core().OutputHH(pOut, nCount, idx);
 }
 
 // LL底点距离函数
 void __stdcall CHAN_LL_Calc(int nCount, float* pOut, float* pHigh, float* pLow, 
                             float* pClose, float* pVol, float* pAmount, float* pParam)
 {
+    ExportScope perf(PERF_LL, pParam, 2);
     CHAN_LOG_DEBUG("CHAN_LL_Calc: nCount=%d", nCount);
     
     if (pOut == nullptr || nCount <= 0) return;
@@ -557,32 +665,27 @@ void __stdcall CHAN_LL_Calc(int nCount, float* pOut, float* pHigh, float* pLow,
     if (idx < 1) idx = 1;
     if (idx > 5) idx = 5;
     
-    EnsureChanCore();
-    
-    g_ChanCore->RemoveInclude(pHigh, pLow, nCount);
-    g_ChanCore->CheckFX();
-    g_ChanCore->CheckBI();
-    g_ChanCore->BuildBiSequence(nCount - 1);
+    chan::AnalysisSession* session = AcquireSession(nCount, pHigh, pLow, pClose, pVol, ParseMinBiLen(pParam));
+    if (!session) return;
+    EnsureBiSequence(session);
     
-    g_ChanCore->OutputLL(pOut, nCount, idx);
+    session->Core().OutputLL(pOut, nCount, idx);
 }
 
 // 幅度检查函数
 void __stdcall CHAN_AMP_Calc(int nCount, float* pOut, float* pHigh, float* pLow, 
                              float* pClose, float* pVol, float* pAmount, float* pParam)
 {
+    ExportScope perf(PERF_AMP, pParam, 2);
     CHAN_LOG_DEBUG("CHAN_AMP_Calc: nCount=%d", nCount);
     
     if (pOut == nullptr || nCount <= 0) return;
     
     int type = (pParam != nullptr) ? static_cast<int>(pParam[1]) : 1;
     
-    EnsureChanCore();
-    
-    g_ChanCore->RemoveInclude(pHigh, pLow, nCount);
-    g_ChanCore->CheckFX();
-    g_ChanCore->CheckBI();
-    g_ChanCore->BuildBiSequence(nCount - 1);
+    chan::AnalysisSession* session = AcquireSession(nCount, pHigh, pLow, pClose, pVol, ParseMinBiLen(pParam));
+    if (!session) return;
+    EnsureBiSequence(session);
     
     // 填充输出
     memset(pOut, 0, nCount * sizeof(float));
@@ -591,13 +694,13 @@ void __stdcall CHAN_AMP_Calc(int nCount, float* pOut, float* pHigh, float* pLow,
         bool result = false;
         switch (type) {
             case 1:  // KJA
-                result = g_ChanCore->CheckFirstBuyKJA(i);
+                result = session->Core().CheckFirstBuyKJA(i);
                 break;
             case 2:  // KJB
-                result = g_ChanCore->CheckFirstBuyKJB(i);
+                result = session->Core().CheckFirstBuyKJB(i);
                 break;
             case 3:  // 二买幅度
-                result = g_ChanCore->CheckSecondBuyAmplitude(i);
+                result = session->Core().CheckSecondBuyAmplitude(i);
                 break;
         }
         pOut[i] = result ? 1.0f : 0.0f;
@@ -608,42 +711,36 @@ void __stdcall CHAN_AMP_Calc(int nCount, float* pOut, float* pHigh, float* pLow,
 void __stdcall CHAN_BUYX_Calc(int nCount, float* pOut, float* pHigh, float* pLow, 
                               float* pClose, float* pVol, float* pAmount, float* pParam)
 {
-    (void)pClose; (void)pVol; (void)pAmount; (void)pParam;
+    ExportScope perf(PERF_BUYX, pParam);
+    (void)pClose; (void)pVol; (void)pAmount;
     
     CHAN_LOG_DEBUG("CHAN_BUYX_Calc: nCount=%d", nCount);
     
     if (pOut == nullptr || nCount <= 0) return;
     
-    EnsureChanCore();
-    
-    g_ChanCore->RemoveInclude(pHigh, pLow, nCount);
-    g_ChanCore->CheckFX();
-    g_ChanCore->CheckBI();
-    g_ChanCore->BuildBiSequence(nCount - 1);
+    chan::AnalysisSession* session = AcquireSession(nCount, pHigh, pLow, pClose, pVol, ParseMinBiLen(pParam));
+    if (!session) return;
     
     // 输出综合买点信号
-    g_ChanCore->OutputCombinedBuySignal(pOut, nCount, pLow);
+    CopySessionSignal(session, chan::SessionSignal::BUYX, pOut, nCount, pHigh, pLow);
 }
 
 // 综合卖点信号函数 (阶段四)
 void __stdcall CHAN_SELLX_Calc(int nCount, float* pOut, float* pHigh, float* pLow, 
                                float* pClose, float* pVol, float* pAmount, float* pParam)
 {
-    (void)pClose; (void)pVol; (void)pAmount; (void)pParam;
+    ExportScope perf(PERF_SELLX, pParam);
+    (void)pClose; (void)pVol; (void)pAmount;
     
     CHAN_LOG_DEBUG("CHAN_SELLX_Calc: nCount=%d", nCount);
     
     if (pOut == nullptr || nCount <= 0) return;
     
-    EnsureChanCore();
-    
-    g_ChanCore->RemoveInclude(pHigh, pLow, nCount);
-    g_ChanCore->CheckFX();
-    g_ChanCore->CheckBI();
-    g_ChanCore->BuildBiSequence(nCount - 1);
+    chan::AnalysisSession* session = AcquireSession(nCount, pHigh, pLow, pClose, pVol, ParseMinBiLen(pParam));
+    if (!session) return;
     
     // 输出综合卖点信号
-    g_ChanCore->OutputCombinedSellSignal(pOut, nCount, pHigh);
+    CopySessionSignal(session, chan::SessionSignal::SELLX, pOut, nCount, pHigh, pLow);
 }
 
 // ============================================================================
@@ -654,109 +751,94 @@ void __stdcall CHAN_SELLX_Calc(int nCount, float* pOut, float* pHigh, float* pLo
 void __stdcall CHAN_ZS_Z_Calc(int nCount, float* pOut, float* pHigh, float* pLow, 
                               float* pClose, float* pVol, float* pAmount, float* pParam)
 {
-    (void)pClose; (void)pVol; (void)pAmount; (void)pParam;
+    ExportScope perf(PERF_ZS_Z, pParam);
+    (void)pClose; (void)pVol; (void)pAmount;
     
     if (pOut == nullptr || nCount <= 0) return;
     
-    EnsureChanCore();
-    
-    g_ChanCore->RemoveInclude(pHigh, pLow, nCount);
-    g_ChanCore->CheckFX();
-    g_ChanCore->CheckBI();
-    g_ChanCore->CheckZS();
+    chan::AnalysisSession* session = AcquireSession(nCount, pHigh, pLow, pClose, pVol, ParseMinBiLen(pParam));
+    if (!session) return;
     
     // 输出中枢中轴
-    g_ChanCore->OutputZS_Z(pOut, nCount);
+    session->Core().OutputZS_Z(pOut, nCount);
 }
 
 // 准买点信号函数
 void __stdcall CHAN_PREBUY_Calc(int nCount, float* pOut, float* pHigh, float* pLow, 
                                 float* pClose, float* pVol, float* pAmount, float* pParam)
 {
-    (void)pClose; (void)pVol; (void)pAmount; (void)pParam;
+    ExportScope perf(PERF_PREBUY, pParam);
+    (void)pClose; (void)pVol; (void)pAmount;
     
     if (pOut == nullptr || nCount <= 0) return;
     
-    EnsureChanCore();
-    
-    g_ChanCore->RemoveInclude(pHigh, pLow, nCount);
-    g_ChanCore->CheckFX();
-    g_ChanCore->CheckBI();
-    g_ChanCore->BuildBiSequence(nCount - 1);
+    chan::AnalysisSession* session = AcquireSession(nCount, pHigh, pLow, pClose, pVol, ParseMinBiLen(pParam));
+    if (!session) return;
     
     // 输出准买点信号
-    g_ChanCore->OutputPreBuySignal(pOut, nCount, pLow);
+    CopySessionSignal(session, chan::SessionSignal::PREBUY, pOut, nCount, pHigh, pLow);
 }
 
 // 准卖点信号函数
 void __stdcall CHAN_PRESELL_Calc(int nCount, float* pOut, float* pHigh, float* pLow, 
                                  float* pClose, float* pVol, float* pAmount, float* pParam)
 {
-    (void)pClose; (void)pVol; (void)pAmount; (void)pParam;
+    ExportScope perf(PERF_PRESELL, pParam);
+    (void)pClose; (void)pVol; (void)pAmount;
     
     if (pOut == nullptr || nCount <= 0) return;
     
-    EnsureChanCore();
-    
-    g_ChanCore->RemoveInclude(pHigh, pLow, nCount);
-    g_ChanCore->CheckFX();
-    g_ChanCore->CheckBI();
-    g_ChanCore->BuildBiSequence(nCount - 1);
+    chan::AnalysisSession* session = AcquireSession(nCount, pHigh, pLow, pClose, pVol, ParseMinBiLen(pParam));
+    if (!session) return;
     
     // 输出准卖点信号
-    g_ChanCore->OutputPreSellSignal(pOut, nCount, pHigh);
+    CopySessionSignal(session, chan::SessionSignal::PRESELL, pOut, nCount, pHigh, pLow);
 }
 
 // 类二买信号函数
 void __stdcall CHAN_LIKE2B_Calc(int nCount, float* pOut, float* pHigh, float* pLow, 
                                 float* pClose, float* pVol, float* pAmount, float* pParam)
 {
-    (void)pClose; (void)pVol; (void)pAmount; (void)pParam;
+    ExportScope perf(PERF_LIKE2B, pParam);
+    (void)pClose; (void)pVol; (void)pAmount;
     
     if (pOut == nullptr || nCount <= 0) return;
     
-    EnsureChanCore();
-    
-    g_ChanCore->RemoveInclude(pHigh, pLow, nCount);
-    g_ChanCore->CheckFX();
-    g_ChanCore->CheckBI();
-    g_ChanCore->BuildBiSequence(nCount - 1);
+    chan::AnalysisSession* session = AcquireSession(nCount, pHigh, pLow, pClose, pVol, ParseMinBiLen(pParam));
+    if (!session) return;
     
     // 输出类二买信号
-    g_ChanCore->OutputLikeSecondBuySignal(pOut, nCount, pLow);
+    CopySessionSignal(session, chan::SessionSignal::LIKE2B, pOut, nCount, pHigh, pLow);
 }
 
 // 类二卖信号函数
 void __stdcall CHAN_LIKE2S_Calc(int nCount, float* pOut, float* pHigh, float* pLow, 
                                 float* pClose, float* pVol, float* pAmount, float* pParam)
 {
-    (void)pClose; (void)pVol; (void)pAmount; (void)pParam;
+    ExportScope perf(PERF_LIKE2S, pParam);
+    (void)pClose; (void)pVol; (void)pAmount;
     
     if (pOut == nullptr || nCount <= 0) return;
     
-    EnsureChanCore();
-    
-    g_ChanCore->RemoveInclude(pHigh, pLow, nCount);
-    g_ChanCore->CheckFX();
-    g_ChanCore->CheckBI();
-    g_ChanCore->BuildBiSequence(nCount - 1);
+    chan::AnalysisSession* session = AcquireSession(nCount, pHigh, pLow, pClose, pVol, ParseMinBiLen(pParam));
+    if (!session) return;
     
     // 输出类二卖信号
-    g_ChanCore->OutputLikeSecondSellSignal(pOut, nCount, pHigh);
+    CopySessionSignal(session, chan::SessionSignal::LIKE2S, pOut, nCount, pHigh, pLow);
 }
 
 // 去包含后新K线标记函数
 void __stdcall CHAN_NEWBAR_Calc(int nCount, float* pOut, float* pHigh, float* pLow, 
                                 float* pClose, float* pVol, float* pAmount, float* pParam)
 {
-    (void)pClose; (void)pVol; (void)pAmount; (void)pParam;
+    ExportScope perf(PERF_NEWBAR, pParam);
+    (void)pClose; (void)pVol; (void)pAmount;
     
     if (pOut == nullptr || nCount <= 0) return;
     
-    EnsureChanCore();
-    
-    g_ChanCore->RemoveInclude(pHigh, pLow, nCount);
+    chan::AnalysisSession* session = AcquireSession(nCount, pHigh, pLow, pClose, pVol, ParseMinBiLen(pParam));
+    if (!session) return;
     
     // 输出新K线标记
-    g_ChanCore->OutputNewBar(pOut, nCount);
+    session->Core().OutputNewBar(pOut, nCount);
 }
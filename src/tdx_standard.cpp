@@ -9,10 +9,17 @@
 #include <windows.h>
 #include <cstdio>
 #include <cstring>
+#include <cstdint>
+#include <string>
 #include <vector>
 #include <algorithm>
 #include <cmath>
 
+#include "logger.h"
+#include "moving_average.h"
+#include "float_hash.h"
+#include "perf_counters.h"
+
 // ============================================================================
 // 通达信标准插件接口
 // ============================================================================
@@ -30,19 +37,8 @@ typedef struct tagPluginTCalcFuncInfo {
 // 调试日志
 // ============================================================================
 
-static FILE* g_LogFile = NULL;
-
-static void WriteLog(const char* msg) {
-    if (!g_LogFile) {
-        g_LogFile = fopen("D:\\chan_debug.log", "a");
-    }
-    if (g_LogFile) {
-        SYSTEMTIME st;
-        GetLocalTime(&st);
-        fprintf(g_LogFile, "[%02d:%02d:%02d] %s\n", st.wHour, st.wMinute, st.wSecond, msg);
-        fflush(g_LogFile);
-    }
-}
+// 经异步日志模块写入（后台线程输出，计算线程不做文件IO）
+static const char* CHAN_DEBUG_LOG_PATH = "D:\\chan_debug.log";
 
 // ============================================================================
 // 缠论核心数据结构
@@ -91,20 +87,57 @@ struct BiSequenceData {
 };
 
 // ============================================================================
-// 全局缓存（避免重复计算）
+// 分析上下文（每线程一份）
 // ============================================================================
+// 多个线程同时计算公式（选股与图表刷新并行）时，各线程使用自己的上下文，
+// 互不干扰，无需加锁。容器容量在同一线程的多次调用间复用，
+// 稳态（数据量不再增长）下不再分配内存。
+
+struct AnalysisContext {
+    std::vector<MergedKLine> merged_klines;
+    std::vector<Fractal> fractals;
+    std::vector<Stroke> strokes;
+    std::vector<Pivot> pivots;
+    std::vector<int> raw_to_merged;
+    std::vector<float> ma13;            // 13周期均线
+    std::vector<float> ma26;            // 26周期均线
+    std::vector<float> closes;          // 收盘价缓存
+    int last_count;
+    
+    // 增量重算状态：新数据是上次数据的前缀延伸时只重算尾部
+    uint64_t prefix_hash;               // 上次数据前 last_count-1 根K线的指纹
+    float last_bar_high;                // 上次数据最后一根K线（盘中可能变化）
+    float last_bar_low;
+    float last_bar_close;
+    
+    int include_dir;                    // 去包含方向：0=未定, 1=向上, -1=向下
+    int snap_merged_count;              // 最后一根K线并入前的合并K线数量
+    MergedKLine snap_merged_back;       // 最后一根K线并入前的末尾合并K线
+    int snap_include_dir;
+    
+    int fx_next;                        // 分型确认前缀：下一个待处理的中间K线
+    int fx_count;                       // 分型确认前缀：分型数量
+    Fractal fx_back;                    // 分型确认前缀：末尾分型
+    
+    // 笔端点序列：(索引, 价格)，按笔的顺序收集；
+    // 第 k 笔完成时的顶/底个数，GetBiSequence 据此取前缀
+    std::vector<std::pair<int, float>> tops;
+    std::vector<std::pair<int, float>> bottoms;
+    std::vector<int> top_counts;
+    std::vector<int> bottom_counts;
+    
+    AnalysisContext()
+        : last_count(0), prefix_hash(0)
+        , last_bar_high(0), last_bar_low(0), last_bar_close(0)
+        , include_dir(0), snap_merged_count(0), snap_merged_back(), snap_include_dir(0)
+        , fx_next(1), fx_count(0), fx_back() {}
+};
 
-static std::vector<MergedKLine> g_MergedKLines;
-static std::vector<Fractal> g_Fractals;
-static std::vector<Stroke> g_Strokes;
-static std::vector<Pivot> g_Pivots;
-static std::vector<int> g_RawToMerged;
-static std::vector<float> g_MA13;       // 13周期均线
-static std::vector<float> g_MA26;       // 26周期均线
-static std::vector<float> g_Closes;     // 收盘价缓存
-static int g_LastCount = 0;
-static float g_LastHigh0 = 0;
-static float g_LastLow0 = 0;
+// 当前线程的分析上下文
+static AnalysisContext& ThreadContext() {
+    static thread_local AnalysisContext ctx;
+    return ctx;
+}
 
 // ============================================================================
 // 工具函数
@@ -118,20 +151,22 @@ static inline float MAX3(float a, float b, float c) {
     return std::max(std::max(a, b), c);
 }
 
-// 计算简单移动平均线
-static void CalcMA(const float* closes, int count, int period, std::vector<float>& ma) {
-    ma.resize(count);
-    for (int i = 0; i < count; ++i) {
-        if (i < period - 1) {
-            ma[i] = closes[i];
-        } else {
-            float sum = 0;
-            for (int j = 0; j < period; ++j) {
-                sum += closes[i - j];
-            }
-            ma[i] = sum / period;
-        }
-    }
+// 前 count 根K线（高/低/收）的指纹
+static uint64_t HashBars(const float* highs, const float* lows, const float* closes, int count) {
+    if (count <= 0) return 0;
+    uint64_t h = chan::HashFloatArray(highs, count);
+    h = (h ^ chan::HashFloatArray(lows, count)) * 0x100000001B3ull;
+    h = (h ^ chan::HashFloatArray(closes, count)) * 0x100000001B3ull;
+    return h;
+}
+
+// 计算 MA13/MA26（一次遍历，从 start 开始重算，之前的结果保留）
+static void CalcMA(AnalysisContext& ctx, const float* closes, int start, int count) {
+    static const int periods[2] = { 13, 26 };
+    ctx.ma13.resize(count);
+    ctx.ma26.resize(count);
+    float* outs[2] = { ctx.ma13.data(), ctx.ma26.data() };
+    chan::CalcMovingAverages(closes, start, count, periods, 2, outs);
 }
 
 // ============================================================================
@@ -144,42 +179,60 @@ static bool HasIncludeRelation(float h1, float l1, float h2, float l2) {
 }
 
 // 去包含处理
-static void RemoveInclude(const float* highs, const float* lows, int count) {
-    g_MergedKLines.clear();
-    g_RawToMerged.clear();
-    g_RawToMerged.resize(count, -1);
-    
-    if (count <= 0) return;
-    
-    // 第一根K线
-    MergedKLine first;
-    first.index = 0;
-    first.high = highs[0];
-    first.low = lows[0];
-    first.is_merged = false;
-    first.merge_start = 0;
-    first.merge_end = 0;
-    g_MergedKLines.push_back(first);
-    g_RawToMerged[0] = 0;
-    
-    int curr_dir = 0;  // 0=未定, 1=向上, -1=向下
-    
-    for (int i = 1; i < count; ++i) {
-        MergedKLine& last = g_MergedKLines.back();
+// start>0 时从上次最后一根K线并入前的快照续算（仅在 start 为上次数据量-1 时有效）
+static void RemoveInclude(AnalysisContext& ctx, const float* highs, const float* lows, int start, int count) {
+    if (start <= 0) {
+        start = 0;
+        ctx.merged_klines.clear();
+        ctx.include_dir = 0;
+    } else {
+        ctx.merged_klines.resize(ctx.snap_merged_count);
+        if (ctx.snap_merged_count > 0) {
+            ctx.merged_klines.back() = ctx.snap_merged_back;
+        }
+        ctx.include_dir = ctx.snap_include_dir;
+    }
+    ctx.raw_to_merged.resize(count, -1);
+    
+    for (int i = start; i < count; ++i) {
+        if (i == count - 1) {
+            // 记录最后一根K线并入前的快照，供下次盘中刷新时回退
+            ctx.snap_merged_count = (int)ctx.merged_klines.size();
+            ctx.snap_include_dir = ctx.include_dir;
+            if (!ctx.merged_klines.empty()) {
+                ctx.snap_merged_back = ctx.merged_klines.back();
+            }
+        }
+        
+        if (ctx.merged_klines.empty()) {
+            // 第一根K线
+            MergedKLine first;
+            first.index = i;
+            first.high = highs[i];
+            first.low = lows[i];
+            first.is_merged = false;
+            first.merge_start = i;
+            first.merge_end = i;
+            ctx.merged_klines.push_back(first);
+            ctx.raw_to_merged[i] = 0;
+            continue;
+        }
+        
+        MergedKLine& last = ctx.merged_klines.back();
         
         if (HasIncludeRelation(last.high, last.low, highs[i], lows[i])) {
             // 存在包含关系，合并
-            if (curr_dir == 0) {
+            if (ctx.include_dir == 0) {
                 // 确定方向
-                if (g_MergedKLines.size() >= 2) {
-                    int prev_idx = (int)g_MergedKLines.size() - 2;
-                    curr_dir = (g_MergedKLines[prev_idx].high < last.high) ? 1 : -1;
+                if (ctx.merged_klines.size() >= 2) {
+                    int prev_idx = (int)ctx.merged_klines.size() - 2;
+                    ctx.include_dir = (ctx.merged_klines[prev_idx].high < last.high) ? 1 : -1;
                 } else {
-                    curr_dir = 1;
+                    ctx.include_dir = 1;
                 }
             }
             
-            if (curr_dir > 0) {
+            if (ctx.include_dir > 0) {
                 // 向上：取高的高点和高的低点
                 last.high = std::max(last.high, highs[i]);
                 last.low = std::max(last.low, lows[i]);
@@ -190,10 +243,10 @@ static void RemoveInclude(const float* highs, const float* lows, int count) {
             }
             last.is_merged = true;
             last.merge_end = i;
-            g_RawToMerged[i] = (int)g_MergedKLines.size() - 1;
+            ctx.raw_to_merged[i] = (int)ctx.merged_klines.size() - 1;
         } else {
             // 无包含关系，新增K线
-            curr_dir = (highs[i] > last.high) ? 1 : -1;
+            ctx.include_dir = (highs[i] > last.high) ? 1 : -1;
             
             MergedKLine curr;
             curr.index = i;
@@ -202,75 +255,100 @@ static void RemoveInclude(const float* highs, const float* lows, int count) {
             curr.is_merged = false;
             curr.merge_start = i;
             curr.merge_end = i;
-            g_MergedKLines.push_back(curr);
-            g_RawToMerged[i] = (int)g_MergedKLines.size() - 1;
+            ctx.merged_klines.push_back(curr);
+            ctx.raw_to_merged[i] = (int)ctx.merged_klines.size() - 1;
         }
     }
 }
 
-// 分型识别
-static void CheckFX() {
-    g_Fractals.clear();
-    
-    int n = (int)g_MergedKLines.size();
-    if (n < 3) return;
-    
-    for (int i = 1; i < n - 1; ++i) {
-        const MergedKLine& prev = g_MergedKLines[i - 1];
-        const MergedKLine& curr = g_MergedKLines[i];
-        const MergedKLine& next = g_MergedKLines[i + 1];
+// 分型识别：处理以第 i 根合并K线为中间K线的候选
+static void ProcessFXCandidate(AnalysisContext& ctx, int i) {
+    const MergedKLine& prev = ctx.merged_klines[i - 1];
+    const MergedKLine& curr = ctx.merged_klines[i];
+    const MergedKLine& next = ctx.merged_klines[i + 1];
+    
+    // 顶分型：中间K线高点最高且低点也最高
+    if (curr.high > prev.high && curr.high > next.high &&
+        curr.low > prev.low && curr.low > next.low) {
+        Fractal fx;
+        fx.type = 1;
+        fx.index = curr.merge_end;  // 使用合并后的最后一根K线索引
+        fx.high = curr.high;
+        fx.low = curr.low;
         
-        // 顶分型：中间K线高点最高且低点也最高
-        if (curr.high > prev.high && curr.high > next.high &&
-            curr.low > prev.low && curr.low > next.low) {
-            Fractal fx;
-            fx.type = 1;
-            fx.index = curr.merge_end;  // 使用合并后的最后一根K线索引
-            fx.high = curr.high;
-            fx.low = curr.low;
-            
-            // 处理连续同类型分型：取极值
-            if (!g_Fractals.empty() && g_Fractals.back().type == 1) {
-                if (curr.high > g_Fractals.back().high) {
-                    g_Fractals.back() = fx;
-                }
-            } else {
-                g_Fractals.push_back(fx);
+        // 处理连续同类型分型：取极值
+        if (!ctx.fractals.empty() && ctx.fractals.back().type == 1) {
+            if (curr.high > ctx.fractals.back().high) {
+                ctx.fractals.back() = fx;
             }
+        } else {
+            ctx.fractals.push_back(fx);
         }
-        // 底分型：中间K线低点最低且高点也最低
-        else if (curr.low < prev.low && curr.low < next.low &&
-                 curr.high < prev.high && curr.high < next.high) {
-            Fractal fx;
-            fx.type = -1;
-            fx.index = curr.merge_end;
-            fx.high = curr.high;
-            fx.low = curr.low;
-            
-            // 处理连续同类型分型：取极值
-            if (!g_Fractals.empty() && g_Fractals.back().type == -1) {
-                if (curr.low < g_Fractals.back().low) {
-                    g_Fractals.back() = fx;
-                }
-            } else {
-                g_Fractals.push_back(fx);
+    }
+    // 底分型：中间K线低点最低且高点也最低
+    else if (curr.low < prev.low && curr.low < next.low &&
+             curr.high < prev.high && curr.high < next.high) {
+        Fractal fx;
+        fx.type = -1;
+        fx.index = curr.merge_end;
+        fx.high = curr.high;
+        fx.low = curr.low;
+        
+        // 处理连续同类型分型：取极值
+        if (!ctx.fractals.empty() && ctx.fractals.back().type == -1) {
+            if (curr.low < ctx.fractals.back().low) {
+                ctx.fractals.back() = fx;
             }
+        } else {
+            ctx.fractals.push_back(fx);
         }
     }
 }
 
+// 分型识别
+// resume=true 时从已确认前缀续算：三根K线都不会再变的候选已处理完毕
+static void CheckFX(AnalysisContext& ctx, bool resume) {
+    if (!resume) {
+        ctx.fx_next = 1;
+        ctx.fx_count = 0;
+    }
+    ctx.fractals.resize(ctx.fx_count);
+    if (ctx.fx_count > 0) {
+        ctx.fractals.back() = ctx.fx_back;
+    }
+    
+    int n = (int)ctx.merged_klines.size();
+    if (n < 3) return;
+    
+    // 合并K线 [0, stable) 不会再被后续K线改写
+    int stable = ctx.snap_merged_count - 1;
+    int i = ctx.fx_next;
+    for (; i < n - 1 && i + 1 < stable; ++i) {
+        ProcessFXCandidate(ctx, i);
+    }
+    ctx.fx_next = i;
+    ctx.fx_count = (int)ctx.fractals.size();
+    if (ctx.fx_count > 0) {
+        ctx.fx_back = ctx.fractals.back();
+    }
+    
+    for (; i < n - 1; ++i) {
+        ProcessFXCandidate(ctx, i);
+    }
+}
+
 // 笔识别
-static void CheckBI(int min_bi_len = 5) {
-    g_Strokes.clear();
+static void CheckBI(AnalysisContext& ctx, int min_bi_len = 5) {
+    ctx.strokes.clear();
     
-    int n = (int)g_Fractals.size();
+    int n = (int)ctx.fractals.size();
     if (n < 2) return;
     
     int last_fx_idx = 0;
     
     for (int i = 1; i < n; ++i) {
-        const Fractal& fx1 = g_Fractals[last_fx_idx];
-        const Fractal& fx2 = g_Fractals[i];
+        const Fractal& fx1 = ctx.fractals[last_fx_idx];
+        const Fractal& fx2 = ctx.fractals[i];
         
         // 必须顶底交替
         if (fx1.type == fx2.type) continue;
@@ -305,16 +383,16 @@ static void CheckBI(int min_bi_len = 5) {
             stroke.direction = -1;
         }
         
-        g_Strokes.push_back(stroke);
+        ctx.strokes.push_back(stroke);
         last_fx_idx = i;
     }
 }
 
 // 中枢识别
-static void CheckZS(int min_zs_bi_count = 3) {
-    g_Pivots.clear();
+static void CheckZS(AnalysisContext& ctx, int min_zs_bi_count = 3) {
+    ctx.pivots.clear();
     
-    int n = (int)g_Strokes.size();
+    int n = (int)ctx.strokes.size();
     if (n < min_zs_bi_count) return;
     
     int i = 0;
@@ -323,12 +401,12 @@ static void CheckZS(int min_zs_bi_count = 3) {
         float zg = 99999.0f;  // 中枢高点 = MIN(各笔高点)
         float zd = 0.0f;       // 中枢低点 = MAX(各笔低点)
         
-        int zs_start = g_Strokes[i].start_idx;
-        int zs_end = g_Strokes[i].end_idx;
+        int zs_start = ctx.strokes[i].start_idx;
+        int zs_end = ctx.strokes[i].end_idx;
         int zs_bi_count = 0;
         
         for (int j = i; j < n && j < i + 7; ++j) {  // 最多检查7笔
-            const Stroke& bi = g_Strokes[j];
+            const Stroke& bi = ctx.strokes[j];
             
             float bi_high = std::max(bi.start_price, bi.end_price);
             float bi_low = std::min(bi.start_price, bi.end_price);
@@ -355,8 +433,8 @@ static void CheckZS(int min_zs_bi_count = 3) {
             pivot.zd = zd;
             pivot.zz = (zg + zd) / 2.0f;
             // 判断中枢方向：第一笔向下则为向下中枢，否则为向上中枢
-            pivot.direction = (g_Strokes[i].direction == -1) ? -1 : 1;
-            g_Pivots.push_back(pivot);
+            pivot.direction = (ctx.strokes[i].direction == -1) ? -1 : 1;
+            ctx.pivots.push_back(pivot);
             
             i += zs_bi_count;
         } else {
@@ -369,28 +447,16 @@ static void CheckZS(int min_zs_bi_count = 3) {
 // 递归引用系统 - 构建 GG/DD/HH/LL 序列
 // ============================================================================
 
-// 获取指定K线位置的递归引用数据
-static BiSequenceData GetBiSequence(int kline_idx) {
-    BiSequenceData seq;
-    memset(&seq, 0, sizeof(seq));
-    
-    // 初始化为无效值
-    for (int i = 0; i < 6; ++i) {
-        seq.GG[i] = 0;
-        seq.DD[i] = 0;
-        seq.HH[i] = 9999;
-        seq.LL[i] = 9999;
-    }
-    
-    if (g_Strokes.empty()) return seq;
+// 收集全部笔端点，记录每笔完成时的顶/底个数（笔识别后调用一次，O(S)）
+static void BuildBiEndpoints(AnalysisContext& ctx) {
+    std::vector<std::pair<int, float>>& tops = ctx.tops;        // (索引, 价格) - 顶点
+    std::vector<std::pair<int, float>>& bottoms = ctx.bottoms;  // (索引, 价格) - 底点
+    tops.clear();
+    bottoms.clear();
+    ctx.top_counts.clear();
+    ctx.bottom_counts.clear();
     
-    // 收集截至 kline_idx 的所有笔端点
-    std::vector<std::pair<int, float>> tops;    // (索引, 价格) - 顶点
-    std::vector<std::pair<int, float>> bottoms; // (索引, 价格) - 底点
-    
-    for (const Stroke& bi : g_Strokes) {
-        if (bi.end_idx > kline_idx) break;
-        
+    for (const Stroke& bi : ctx.strokes) {
         if (bi.direction == 1) {
             // 向上笔：终点是顶
             tops.push_back({bi.end_idx, bi.end_price});
@@ -406,10 +472,36 @@ static BiSequenceData GetBiSequence(int kline_idx) {
                 tops.push_back({bi.start_idx, bi.start_price});
             }
         }
+        ctx.top_counts.push_back((int)tops.size());
+        ctx.bottom_counts.push_back((int)bottoms.size());
     }
+}
+
+// 获取指定K线位置的递归引用数据
+// 笔终点递增，二分查找截至 kline_idx 完成的笔数，端点序列取前缀，O(log S)
+static BiSequenceData GetBiSequence(const AnalysisContext& ctx, int kline_idx) {
+    BiSequenceData seq;
+    memset(&seq, 0, sizeof(seq));
+    
+    // 初始化为无效值
+    for (int i = 0; i < 6; ++i) {
+        seq.GG[i] = 0;
+        seq.DD[i] = 0;
+        seq.HH[i] = 9999;
+        seq.LL[i] = 9999;
+    }
+    
+    if (ctx.strokes.empty()) return seq;
+    
+    // 截至 kline_idx 完成的笔数
+    int done = (int)(std::upper_bound(ctx.strokes.begin(), ctx.strokes.end(), kline_idx,
+                                      [](int idx, const Stroke& bi) { return idx < bi.end_idx; }) -
+                     ctx.strokes.begin());
+    const std::vector<std::pair<int, float>>& tops = ctx.tops;
+    const std::vector<std::pair<int, float>>& bottoms = ctx.bottoms;
     
     // 填充 GG1-GG5（从最近到最远）
-    int top_count = (int)tops.size();
+    int top_count = done > 0 ? ctx.top_counts[done - 1] : 0;
     for (int i = 1; i <= 5 && i <= top_count; ++i) {
         int idx = top_count - i;
         seq.GG[i] = tops[idx].second;
@@ -417,7 +509,7 @@ static BiSequenceData GetBiSequence(int kline_idx) {
     }
     
     // 填充 DD1-DD5
-    int bottom_count = (int)bottoms.size();
+    int bottom_count = done > 0 ? ctx.bottom_counts[done - 1] : 0;
     for (int i = 1; i <= 5 && i <= bottom_count; ++i) {
         int idx = bottom_count - i;
         seq.DD[i] = bottoms[idx].second;
@@ -425,8 +517,8 @@ static BiSequenceData GetBiSequence(int kline_idx) {
     }
     
     // 判断方向：最后一笔方向决定当前趋势后状态
-    if (!g_Strokes.empty()) {
-        const Stroke& last_bi = g_Strokes.back();
+    if (!ctx.strokes.empty()) {
+        const Stroke& last_bi = ctx.strokes.back();
         if (last_bi.end_idx <= kline_idx) {
             // 最后一笔向下 = 下跌后 = 方向1（适合找买点）
             // 最后一笔向上 = 上涨后 = 方向-1（适合找卖点）
@@ -773,36 +865,151 @@ static int CheckPreThirdSell(int kline_idx, float high, const BiSequenceData& se
     return 0;
 }
 
+// ============================================================================
+// 性能计数
+// ============================================================================
+
+// 槽位编号即注册顺序：TDXDLL1 函数号 1~21 在前，处理阶段在后
+enum PerfSlotId {
+    PERF_FENXING, PERF_BIDUANDIAN, PERF_ZSGAO, PERF_ZSDI, PERF_ZSZHONG, PERF_BIDIRECTION,
+    PERF_BUY, PERF_SELL, PERF_NEWBAR, PERF_TEST, PERF_DIRECTION, PERF_GG1, PERF_DD1,
+    PERF_LL1, PERF_HH1, PERF_MA13, PERF_MA26, PERF_ZSKAISHI, PERF_ZSJIESHU,
+    PERF_BIGAODIAN, PERF_BIDIDIAN,
+    PERF_STAGE_LOOKUP,          // 数据未变，直接使用线程上下文
+    PERF_STAGE_ANALYZE,         // 增量或全量重算
+    PERF_SLOT_COUNT
+};
+
+static const char* const kPerfSlotNames[PERF_SLOT_COUNT] = {
+    "TDXDLL1(1).FenXing", "TDXDLL1(2).BiDuanDian", "TDXDLL1(3).ZhongShuGao",
+    "TDXDLL1(4).ZhongShuDi", "TDXDLL1(5).ZhongShuZhong", "TDXDLL1(6).BiDirection",
+    "TDXDLL1(7).BuySignal", "TDXDLL1(8).SellSignal", "TDXDLL1(9).NewBar",
+    "TDXDLL1(10).TestFunc", "TDXDLL1(11).Direction", "TDXDLL1(12).GG1",
+    "TDXDLL1(13).DD1", "TDXDLL1(14).LL1", "TDXDLL1(15).HH1", "TDXDLL1(16).MA13",
+    "TDXDLL1(17).MA26", "TDXDLL1(18).ZhongShuKaiShi", "TDXDLL1(19).ZhongShuJieShu",
+    "TDXDLL1(20).BiGaoDian", "TDXDLL1(21).BiDiDian",
+    "stage.lookup", "stage.analyze"
+};
+
+// 首次使用时构造并注册槽位（不依赖跨编译单元的静态初始化顺序）
+static chan::PerfRegistry& Perf() {
+    static chan::PerfRegistry* registry = [] {
+        chan::PerfRegistry* instance = new chan::PerfRegistry();
+        for (int i = 0; i < PERF_SLOT_COUNT; ++i) {
+            instance->Register(kPerfSlotNames[i], i < PERF_STAGE_LOOKUP ? chan::PerfKind::EXPORT
+                                                                        : chan::PerfKind::STAGE);
+        }
+        return instance;
+    }();
+    return *registry;
+}
+
+// 一次导出函数调用：计时，并供 FullAnalyzeWithMA 记录命中与冗余调用
+class ExportScope {
+public:
+    explicit ExportScope(int slot)
+        : m_timer(Perf(), slot), m_slot(slot), m_prev(t_current) {
+        t_current = this;
+    }
+    ~ExportScope() { t_current = m_prev; }
+
+    static ExportScope* Current() { return t_current; }
+
+    // 分析后调用：hit 为数据是否未变，key 为数据指纹
+    void OnAnalyze(bool hit, uint64_t key) {
+        Perf().RecordCache(m_slot, hit);
+        if (m_timer.StartNs() != 0) {
+            Perf().CheckRedundant(m_slot, key, m_timer.StartNs());
+        }
+    }
+
+private:
+    chan::PerfTimer m_timer;
+    int m_slot;
+    ExportScope* m_prev;
+    static thread_local ExportScope* t_current;
+};
+thread_local ExportScope* ExportScope::t_current = NULL;
+
 // ============================================================================
 // 完整分析流程（带均线计算）
 // ============================================================================
 
-static void FullAnalyzeWithMA(const float* highs, const float* lows, const float* closes, int count) {
-    // 检查是否需要重新计算
-    if (count == g_LastCount && count > 0 &&
-        highs[0] == g_LastHigh0 && lows[0] == g_LastLow0) {
-        return;  // 数据未变，使用缓存
+// 分析当前线程的上下文并返回；数据与上次相同时直接返回缓存结果（hit=true）
+static AnalysisContext& AnalyzeContext(const float* highs, const float* lows, const float* closes,
+                                       int count, bool& hit) {
+    AnalysisContext& ctx = ThreadContext();
+    hit = false;
+    if (count <= 0) return ctx;
+    
+    // 检查与上次数据的关系：
+    //   完全相同         -> 直接使用缓存
+    //   前缀延伸/末根变化 -> 从上次最后一根K线起重算尾部
+    //   其他             -> 全量重算
+    int prev = ctx.last_count;
+    int start = 0;
+    uint64_t prefix_hash = 0;
+    if (prev > 1 && count >= prev) {
+        prefix_hash = HashBars(highs, lows, closes, prev - 1);
+        if (prefix_hash == ctx.prefix_hash) {
+            if (count == prev &&
+                highs[prev - 1] == ctx.last_bar_high &&
+                lows[prev - 1] == ctx.last_bar_low &&
+                closes[prev - 1] == ctx.last_bar_close) {
+                hit = true;
+                return ctx;  // 数据未变，使用缓存
+            }
+            start = prev - 1;
+        }
     }
     
-    g_LastCount = count;
-    g_LastHigh0 = (count > 0) ? highs[0] : 0;
-    g_LastLow0 = (count > 0) ? lows[0] : 0;
+    ctx.last_count = count;
+    ctx.prefix_hash = (count == prev && start > 0) ? prefix_hash
+                                                 : HashBars(highs, lows, closes, count - 1);
+    ctx.last_bar_high = highs[count - 1];
+    ctx.last_bar_low = lows[count - 1];
+    ctx.last_bar_close = closes[count - 1];
     
     // 缓存收盘价
-    g_Closes.resize(count);
-    for (int i = 0; i < count; ++i) {
-        g_Closes[i] = closes[i];
+    ctx.closes.resize(count);
+    for (int i = start; i < count; ++i) {
+        ctx.closes[i] = closes[i];
     }
     
     // 计算均线
-    CalcMA(closes, count, 13, g_MA13);
-    CalcMA(closes, count, 26, g_MA26);
-    
-    // 基础分析
-    RemoveInclude(highs, lows, count);
-    CheckFX();
-    CheckBI(5);
-    CheckZS(3);
+    CalcMA(ctx, closes, start, count);
+    
+    // 基础分析（去包含与分型只重算尾部，笔和中枢基于分型重建）
+    RemoveInclude(ctx, highs, lows, start, count);
+    CheckFX(ctx, start > 0);
+    CheckBI(ctx, 5);
+    BuildBiEndpoints(ctx);
+    CheckZS(ctx, 3);
+    return ctx;
+}
+
+// 分析并记录阶段耗时与当前导出函数的命中情况
+static AnalysisContext& FullAnalyzeWithMA(const float* highs, const float* lows, const float* closes, int count) {
+    chan::PerfRegistry& perf = Perf();
+    uint64_t t0 = perf.IsEnabled() ? chan::PerfRegistry::NowNs() : 0;
+    bool hit = false;
+    AnalysisContext& ctx = AnalyzeContext(highs, lows, closes, count, hit);
+    if (t0 != 0 && count > 0) {
+        perf.RecordLatency(hit ? PERF_STAGE_LOOKUP : PERF_STAGE_ANALYZE,
+                           chan::PerfRegistry::NowNs() - t0);
+        if (ExportScope* scope = ExportScope::Current()) {
+            uint32_t last[3];
+            memcpy(&last[0], &ctx.last_bar_high, sizeof(float));
+            memcpy(&last[1], &ctx.last_bar_low, sizeof(float));
+            memcpy(&last[2], &ctx.last_bar_close, sizeof(float));
+            uint64_t key = ctx.prefix_hash ^ ((uint64_t)(uint32_t)count << 32);
+            for (uint32_t bits : last) {
+                key = (key ^ bits) * 0x100000001B3ull;
+            }
+            scope->OnAnalyze(hit, key);
+        }
+    }
+    return ctx;
 }
 
 // ============================================================================
@@ -813,15 +1020,16 @@ static void FullAnalyzeWithMA(const float* highs, const float* lows, const float
 // 公式调用：FX:TDXDLL1(1, H, L, C);
 // 返回值：1=顶分型, -1=底分型, 0=无
 void FenXing(int DataLen, float* pfOUT, float* pfINa, float* pfINb, float* pfINc) {
+    ExportScope perf(PERF_FENXING);
     if (!pfOUT || DataLen <= 0) return;
     
-    FullAnalyzeWithMA(pfINa, pfINb, pfINc, DataLen);
+    AnalysisContext& ctx = FullAnalyzeWithMA(pfINa, pfINb, pfINc, DataLen);
     
     // 初始化输出
     memset(pfOUT, 0, DataLen * sizeof(float));
     
     // 填充分型标记
-    for (const Fractal& fx : g_Fractals) {
+    for (const Fractal& fx : ctx.fractals) {
         if (fx.index >= 0 && fx.index < DataLen) {
             pfOUT[fx.index] = (float)fx.type;
         }
@@ -832,13 +1040,14 @@ void FenXing(int DataLen, float* pfOUT, float* pfINa, float* pfINb, float* pfINc
 // 公式调用：BI:TDXDLL1(2, H, L, C);
 // 返回值：1=顶端点, -1=底端点, 0=非端点
 void BiDuanDian(int DataLen, float* pfOUT, float* pfINa, float* pfINb, float* pfINc) {
+    ExportScope perf(PERF_BIDUANDIAN);
     if (!pfOUT || DataLen <= 0) return;
     
-    FullAnalyzeWithMA(pfINa, pfINb, pfINc, DataLen);
+    AnalysisContext& ctx = FullAnalyzeWithMA(pfINa, pfINb, pfINc, DataLen);
     
     memset(pfOUT, 0, DataLen * sizeof(float));
     
-    for (const Stroke& bi : g_Strokes) {
+    for (const Stroke& bi : ctx.strokes) {
         // 向上笔：起点是底，终点是顶
         if (bi.direction == 1) {
             if (bi.start_idx >= 0 && bi.start_idx < DataLen) {
@@ -863,13 +1072,14 @@ void BiDuanDian(int DataLen, float* pfOUT, float* pfINa, float* pfINb, float* pf
 // 函数3：中枢高点
 // 公式调用：ZS_H:TDXDLL1(3, H, L, C);
 void ZhongShuGao(int DataLen, float* pfOUT, float* pfINa, float* pfINb, float* pfINc) {
+    ExportScope perf(PERF_ZSGAO);
     if (!pfOUT || DataLen <= 0) return;
     
-    FullAnalyzeWithMA(pfINa, pfINb, pfINc, DataLen);
+    AnalysisContext& ctx = FullAnalyzeWithMA(pfINa, pfINb, pfINc, DataLen);
     
     memset(pfOUT, 0, DataLen * sizeof(float));
     
-    for (const Pivot& zs : g_Pivots) {
+    for (const Pivot& zs : ctx.pivots) {
         for (int i = zs.start_idx; i <= zs.end_idx && i < DataLen; ++i) {
             if (i >= 0) {
                 pfOUT[i] = zs.zg;
@@ -881,13 +1091,14 @@ void ZhongShuGao(int DataLen, float* pfOUT, float* pfINa, float* pfINb, float* p
 // 函数4：中枢低点
 // 公式调用：ZS_L:TDXDLL1(4, H, L, C);
 void ZhongShuDi(int DataLen, float* pfOUT, float* pfINa, float* pfINb, float* pfINc) {
+    ExportScope perf(PERF_ZSDI);
     if (!pfOUT || DataLen <= 0) return;
     
-    FullAnalyzeWithMA(pfINa, pfINb, pfINc, DataLen);
+    AnalysisContext& ctx = FullAnalyzeWithMA(pfINa, pfINb, pfINc, DataLen);
     
     memset(pfOUT, 0, DataLen * sizeof(float));
     
-    for (const Pivot& zs : g_Pivots) {
+    for (const Pivot& zs : ctx.pivots) {
         for (int i = zs.start_idx; i <= zs.end_idx && i < DataLen; ++i) {
             if (i >= 0) {
                 pfOUT[i] = zs.zd;
@@ -899,13 +1110,14 @@ void ZhongShuDi(int DataLen, float* pfOUT, float* pfINa, float* pfINb, float* pf
 // 函数5：中枢中轴
 // 公式调用：ZS_Z:TDXDLL1(5, H, L, C);
 void ZhongShuZhong(int DataLen, float* pfOUT, float* pfINa, float* pfINb, float* pfINc) {
+    ExportScope perf(PERF_ZSZHONG);
     if (!pfOUT || DataLen <= 0) return;
     
-    FullAnalyzeWithMA(pfINa, pfINb, pfINc, DataLen);
+    AnalysisContext& ctx = FullAnalyzeWithMA(pfINa, pfINb, pfINc, DataLen);
     
     memset(pfOUT, 0, DataLen * sizeof(float));
     
-    for (const Pivot& zs : g_Pivots) {
+    for (const Pivot& zs : ctx.pivots) {
         for (int i = zs.start_idx; i <= zs.end_idx && i < DataLen; ++i) {
             if (i >= 0) {
                 pfOUT[i] = zs.zz;
@@ -918,13 +1130,14 @@ void ZhongShuZhong(int DataLen, float* pfOUT, float* pfINa, float* pfINb, float*
 // 公式调用：BI_DIR:TDXDLL1(6, H, L, C);
 // 返回值：1=向上笔, -1=向下笔, 0=不在笔内
 void BiDirection(int DataLen, float* pfOUT, float* pfINa, float* pfINb, float* pfINc) {
+    ExportScope perf(PERF_BIDIRECTION);
     if (!pfOUT || DataLen <= 0) return;
     
-    FullAnalyzeWithMA(pfINa, pfINb, pfINc, DataLen);
+    AnalysisContext& ctx = FullAnalyzeWithMA(pfINa, pfINb, pfINc, DataLen);
     
     memset(pfOUT, 0, DataLen * sizeof(float));
     
-    for (const Stroke& bi : g_Strokes) {
+    for (const Stroke& bi : ctx.strokes) {
         for (int i = bi.start_idx; i <= bi.end_idx && i < DataLen; ++i) {
             if (i >= 0) {
                 pfOUT[i] = (float)bi.direction;
@@ -937,25 +1150,26 @@ void BiDirection(int DataLen, float* pfOUT, float* pfINa, float* pfINb, float* p
 // 公式调用：BUY:TDXDLL1(7, H, L, C);
 // 返回值：1/2=一买A/B, 11/12/13=二买A/B1/B2, 21=三买, 31/32/33=准买点, 0=无
 void BuySignal(int DataLen, float* pfOUT, float* pfINa, float* pfINb, float* pfINc) {
+    ExportScope perf(PERF_BUY);
     if (!pfOUT || DataLen <= 0) return;
     
-    FullAnalyzeWithMA(pfINa, pfINb, pfINc, DataLen);
+    AnalysisContext& ctx = FullAnalyzeWithMA(pfINa, pfINb, pfINc, DataLen);
     
     memset(pfOUT, 0, DataLen * sizeof(float));
     
     // 遍历所有向下笔的终点，检查买点条件
-    for (const Stroke& bi : g_Strokes) {
+    for (const Stroke& bi : ctx.strokes) {
         if (bi.direction != -1) continue;  // 只检查向下笔终点
         
         int idx = bi.end_idx;
         if (idx < 0 || idx >= DataLen) continue;
         
         float low = pfINb[idx];
-        float ma13 = (idx < (int)g_MA13.size()) ? g_MA13[idx] : low;
-        float ma26 = (idx < (int)g_MA26.size()) ? g_MA26[idx] : low;
+        float ma13 = (idx < (int)ctx.ma13.size()) ? ctx.ma13[idx] : low;
+        float ma26 = (idx < (int)ctx.ma26.size()) ? ctx.ma26[idx] : low;
         
         // 获取递归引用数据
-        BiSequenceData seq = GetBiSequence(idx);
+        BiSequenceData seq = GetBiSequence(ctx, idx);
         
         // 按优先级检查：一买 > 二买 > 三买 > 准买点
         int signal = 0;
@@ -975,7 +1189,7 @@ void BuySignal(int DataLen, float* pfOUT, float* pfINa, float* pfINb, float* pfI
         }
         
         // 三买检查
-        signal = CheckThirdBuy(idx, low, ma13, seq, g_Pivots);
+        signal = CheckThirdBuy(idx, low, ma13, seq, ctx.pivots);
         if (signal > 0) {
             pfOUT[idx] = (float)signal;
             continue;
@@ -1006,25 +1220,26 @@ void BuySignal(int DataLen, float* pfOUT, float* pfINa, float* pfINb, float* pfI
 // 公式调用：SELL:TDXDLL1(8, H, L, C);
 // 返回值：-1/-2/-3=一卖A/B/C, -11/-12/-13/-14=二卖, -21=三卖, -31/-32/-33=准卖点, 0=无
 void SellSignal(int DataLen, float* pfOUT, float* pfINa, float* pfINb, float* pfINc) {
+    ExportScope perf(PERF_SELL);
     if (!pfOUT || DataLen <= 0) return;
     
-    FullAnalyzeWithMA(pfINa, pfINb, pfINc, DataLen);
+    AnalysisContext& ctx = FullAnalyzeWithMA(pfINa, pfINb, pfINc, DataLen);
     
     memset(pfOUT, 0, DataLen * sizeof(float));
     
     // 遍历所有向上笔的终点，检查卖点条件
-    for (const Stroke& bi : g_Strokes) {
+    for (const Stroke& bi : ctx.strokes) {
         if (bi.direction != 1) continue;  // 只检查向上笔终点
         
         int idx = bi.end_idx;
         if (idx < 0 || idx >= DataLen) continue;
         
         float high = pfINa[idx];
-        float ma13 = (idx < (int)g_MA13.size()) ? g_MA13[idx] : high;
-        float ma26 = (idx < (int)g_MA26.size()) ? g_MA26[idx] : high;
+        float ma13 = (idx < (int)ctx.ma13.size()) ? ctx.ma13[idx] : high;
+        float ma26 = (idx < (int)ctx.ma26.size()) ? ctx.ma26[idx] : high;
         
         // 获取递归引用数据
-        BiSequenceData seq = GetBiSequence(idx);
+        BiSequenceData seq = GetBiSequence(ctx, idx);
         
         // 按优先级检查：一卖 > 二卖 > 三卖 > 准卖点
         int signal = 0;
@@ -1075,15 +1290,16 @@ void SellSignal(int DataLen, float* pfOUT, float* pfINa, float* pfINb, float* pf
 // 公式调用：NEWBAR:TDXDLL1(9, H, L, C);
 // 返回值：1=保留的K线, 0=被合并的K线
 void NewBar(int DataLen, float* pfOUT, float* pfINa, float* pfINb, float* pfINc) {
+    ExportScope perf(PERF_NEWBAR);
     if (!pfOUT || DataLen <= 0) return;
     
-    FullAnalyzeWithMA(pfINa, pfINb, pfINc, DataLen);
+    AnalysisContext& ctx = FullAnalyzeWithMA(pfINa, pfINb, pfINc, DataLen);
     
     // 默认全部为0（被合并）
     memset(pfOUT, 0, DataLen * sizeof(float));
     
     // 标记保留的K线
-    for (const MergedKLine& mk : g_MergedKLines) {
+    for (const MergedKLine& mk : ctx.merged_klines) {
         if (mk.merge_end >= 0 && mk.merge_end < DataLen) {
             pfOUT[mk.merge_end] = 1.0f;
         }
@@ -1093,6 +1309,7 @@ void NewBar(int DataLen, float* pfOUT, float* pfINa, float* pfINb, float* pfINc)
 // 函数10：测试函数
 // 公式调用：TEST:TDXDLL1(10, H, L, C);
 void TestFunc(int DataLen, float* pfOUT, float* pfINa, float* pfINb, float* pfINc) {
+    ExportScope perf(PERF_TEST);
     if (!pfOUT) return;
     
     for (int i = 0; i < DataLen; ++i) {
@@ -1104,14 +1321,15 @@ void TestFunc(int DataLen, float* pfOUT, float* pfINa, float* pfINb, float* pfIN
 // 公式调用：DIR:TDXDLL1(11, H, L, C);
 // 返回值：1=下跌后(适合找买点), -1=上涨后(适合找卖点), 0=无
 void Direction(int DataLen, float* pfOUT, float* pfINa, float* pfINb, float* pfINc) {
+    ExportScope perf(PERF_DIRECTION);
     if (!pfOUT || DataLen <= 0) return;
     
-    FullAnalyzeWithMA(pfINa, pfINb, pfINc, DataLen);
+    AnalysisContext& ctx = FullAnalyzeWithMA(pfINa, pfINb, pfINc, DataLen);
     
     memset(pfOUT, 0, DataLen * sizeof(float));
     
     for (int i = 0; i < DataLen; ++i) {
-        BiSequenceData seq = GetBiSequence(i);
+        BiSequenceData seq = GetBiSequence(ctx, i);
         pfOUT[i] = (float)seq.direction;
     }
 }
@@ -1119,14 +1337,15 @@ void Direction(int DataLen, float* pfOUT, float* pfINa, float* pfINb, float* pfI
 // 函数12：GG1 - 最近顶点价格
 // 公式调用：GG1:TDXDLL1(12, H, L, C);
 void OutputGG1(int DataLen, float* pfOUT, float* pfINa, float* pfINb, float* pfINc) {
+    ExportScope perf(PERF_GG1);
     if (!pfOUT || DataLen <= 0) return;
     
-    FullAnalyzeWithMA(pfINa, pfINb, pfINc, DataLen);
+    AnalysisContext& ctx = FullAnalyzeWithMA(pfINa, pfINb, pfINc, DataLen);
     
     memset(pfOUT, 0, DataLen * sizeof(float));
     
     for (int i = 0; i < DataLen; ++i) {
-        BiSequenceData seq = GetBiSequence(i);
+        BiSequenceData seq = GetBiSequence(ctx, i);
         pfOUT[i] = seq.GG[1];
     }
 }
@@ -1134,14 +1353,15 @@ void OutputGG1(int DataLen, float* pfOUT, float* pfINa, float* pfINb, float* pfI
 // 函数13：DD1 - 最近底点价格
 // 公式调用：DD1:TDXDLL1(13, H, L, C);
 void OutputDD1(int DataLen, float* pfOUT, float* pfINa, float* pfINb, float* pfINc) {
+    ExportScope perf(PERF_DD1);
     if (!pfOUT || DataLen <= 0) return;
     
-    FullAnalyzeWithMA(pfINa, pfINb, pfINc, DataLen);
+    AnalysisContext& ctx = FullAnalyzeWithMA(pfINa, pfINb, pfINc, DataLen);
     
     memset(pfOUT, 0, DataLen * sizeof(float));
     
     for (int i = 0; i < DataLen; ++i) {
-        BiSequenceData seq = GetBiSequence(i);
+        BiSequenceData seq = GetBiSequence(ctx, i);
         pfOUT[i] = seq.DD[1];
     }
 }
@@ -1149,14 +1369,15 @@ void OutputDD1(int DataLen, float* pfOUT, float* pfINa, float* pfINb, float* pfI
 // 函数14：LL1 - 最近底点距当前K线数
 // 公式调用：LL1:TDXDLL1(14, H, L, C);
 void OutputLL1(int DataLen, float* pfOUT, float* pfINa, float* pfINb, float* pfINc) {
+    ExportScope perf(PERF_LL1);
     if (!pfOUT || DataLen <= 0) return;
     
-    FullAnalyzeWithMA(pfINa, pfINb, pfINc, DataLen);
+    AnalysisContext& ctx = FullAnalyzeWithMA(pfINa, pfINb, pfINc, DataLen);
     
     memset(pfOUT, 0, DataLen * sizeof(float));
     
     for (int i = 0; i < DataLen; ++i) {
-        BiSequenceData seq = GetBiSequence(i);
+        BiSequenceData seq = GetBiSequence(ctx, i);
         pfOUT[i] = (float)seq.LL[1];
     }
 }
@@ -1164,14 +1385,15 @@ void OutputLL1(int DataLen, float* pfOUT, float* pfINa, float* pfINb, float* pfI
 // 函数15：HH1 - 最近顶点距当前K线数
 // 公式调用：HH1:TDXDLL1(15, H, L, C);
 void OutputHH1(int DataLen, float* pfOUT, float* pfINa, float* pfINb, float* pfINc) {
+    ExportScope perf(PERF_HH1);
     if (!pfOUT || DataLen <= 0) return;
     
-    FullAnalyzeWithMA(pfINa, pfINb, pfINc, DataLen);
+    AnalysisContext& ctx = FullAnalyzeWithMA(pfINa, pfINb, pfINc, DataLen);
     
     memset(pfOUT, 0, DataLen * sizeof(float));
     
     for (int i = 0; i < DataLen; ++i) {
-        BiSequenceData seq = GetBiSequence(i);
+        BiSequenceData seq = GetBiSequence(ctx, i);
         pfOUT[i] = (float)seq.HH[1];
     }
 }
@@ -1179,24 +1401,26 @@ void OutputHH1(int DataLen, float* pfOUT, float* pfINa, float* pfINb, float* pfI
 // 函数16：MA13均线
 // 公式调用：MA13:TDXDLL1(16, H, L, C);
 void OutputMA13(int DataLen, float* pfOUT, float* pfINa, float* pfINb, float* pfINc) {
+    ExportScope perf(PERF_MA13);
     if (!pfOUT || DataLen <= 0) return;
     
-    FullAnalyzeWithMA(pfINa, pfINb, pfINc, DataLen);
+    AnalysisContext& ctx = FullAnalyzeWithMA(pfINa, pfINb, pfINc, DataLen);
     
     for (int i = 0; i < DataLen; ++i) {
-        pfOUT[i] = (i < (int)g_MA13.size()) ? g_MA13[i] : pfINc[i];
+        pfOUT[i] = (i < (int)ctx.ma13.size()) ? ctx.ma13[i] : pfINc[i];
     }
 }
 
 // 函数17：MA26均线
 // 公式调用：MA26:TDXDLL1(17, H, L, C);
 void OutputMA26(int DataLen, float* pfOUT, float* pfINa, float* pfINb, float* pfINc) {
+    ExportScope perf(PERF_MA26);
     if (!pfOUT || DataLen <= 0) return;
     
-    FullAnalyzeWithMA(pfINa, pfINb, pfINc, DataLen);
+    AnalysisContext& ctx = FullAnalyzeWithMA(pfINa, pfINb, pfINc, DataLen);
     
     for (int i = 0; i < DataLen; ++i) {
-        pfOUT[i] = (i < (int)g_MA26.size()) ? g_MA26[i] : pfINc[i];
+        pfOUT[i] = (i < (int)ctx.ma26.size()) ? ctx.ma26[i] : pfINc[i];
     }
 }
 
@@ -1204,13 +1428,14 @@ void OutputMA26(int DataLen, float* pfOUT, float* pfINa, float* pfINb, float* pf
 // 公式调用：ZSKS:TDXDLL1(18, H, L, C);
 // 返回值：1=下跌中枢开始, 2=上涨中枢开始, 0=非开始位置
 void ZhongShuKaiShi(int DataLen, float* pfOUT, float* pfINa, float* pfINb, float* pfINc) {
+    ExportScope perf(PERF_ZSKAISHI);
     if (!pfOUT || DataLen <= 0) return;
     
-    FullAnalyzeWithMA(pfINa, pfINb, pfINc, DataLen);
+    AnalysisContext& ctx = FullAnalyzeWithMA(pfINa, pfINb, pfINc, DataLen);
     
     memset(pfOUT, 0, DataLen * sizeof(float));
     
-    for (const Pivot& zs : g_Pivots) {
+    for (const Pivot& zs : ctx.pivots) {
         if (zs.start_idx >= 0 && zs.start_idx < DataLen) {
             // 1=下跌中枢(第一笔向下), 2=上涨中枢(第一笔向上)
             pfOUT[zs.start_idx] = (zs.direction == -1) ? 1.0f : 2.0f;
@@ -1222,13 +1447,14 @@ void ZhongShuKaiShi(int DataLen, float* pfOUT, float* pfINa, float* pfINb, float
 // 公式调用：ZSJS:TDXDLL1(19, H, L, C);
 // 返回值：1=下跌中枢结束, 2=上涨中枢结束, 0=非结束位置
 void ZhongShuJieShu(int DataLen, float* pfOUT, float* pfINa, float* pfINb, float* pfINc) {
+    ExportScope perf(PERF_ZSJIESHU);
     if (!pfOUT || DataLen <= 0) return;
     
-    FullAnalyzeWithMA(pfINa, pfINb, pfINc, DataLen);
+    AnalysisContext& ctx = FullAnalyzeWithMA(pfINa, pfINb, pfINc, DataLen);
     
     memset(pfOUT, 0, DataLen * sizeof(float));
     
-    for (const Pivot& zs : g_Pivots) {
+    for (const Pivot& zs : ctx.pivots) {
         if (zs.end_idx >= 0 && zs.end_idx < DataLen) {
             pfOUT[zs.end_idx] = (zs.direction == -1) ? 1.0f : 2.0f;
         }
@@ -1238,13 +1464,14 @@ void ZhongShuJieShu(int DataLen, float* pfOUT, float* pfINa, float* pfINb, float
 // 函数20：笔端点高点价格（只在顶点输出）
 // 公式调用：KXG:TDXDLL1(20, H, L, C);
 void BiGaoDian(int DataLen, float* pfOUT, float* pfINa, float* pfINb, float* pfINc) {
+    ExportScope perf(PERF_BIGAODIAN);
     if (!pfOUT || DataLen <= 0) return;
     
-    FullAnalyzeWithMA(pfINa, pfINb, pfINc, DataLen);
+    AnalysisContext& ctx = FullAnalyzeWithMA(pfINa, pfINb, pfINc, DataLen);
     
     memset(pfOUT, 0, DataLen * sizeof(float));
     
-    for (const Stroke& bi : g_Strokes) {
+    for (const Stroke& bi : ctx.strokes) {
         // 向上笔的终点是顶点
         if (bi.direction == 1 && bi.end_idx >= 0 && bi.end_idx < DataLen) {
             pfOUT[bi.end_idx] = bi.end_price;
@@ -1259,13 +1486,14 @@ void BiGaoDian(int DataLen, float* pfOUT, float* pfINa, float* pfINb, float* pfI
 // 函数21：笔端点低点价格（只在底点输出）
 // 公式调用：KXD:TDXDLL1(21, H, L, C);
 void BiDiDian(int DataLen, float* pfOUT, float* pfINa, float* pfINb, float* pfINc) {
+    ExportScope perf(PERF_BIDIDIAN);
     if (!pfOUT || DataLen <= 0) return;
     
-    FullAnalyzeWithMA(pfINa, pfINb, pfINc, DataLen);
+    AnalysisContext& ctx = FullAnalyzeWithMA(pfINa, pfINb, pfINc, DataLen);
     
     memset(pfOUT, 0, DataLen * sizeof(float));
     
-    for (const Stroke& bi : g_Strokes) {
+    for (const Stroke& bi : ctx.strokes) {
         // 向下笔的终点是底点
         if (bi.direction == -1 && bi.end_idx >= 0 && bi.end_idx < DataLen) {
             pfOUT[bi.end_idx] = bi.end_price;
@@ -1312,22 +1540,67 @@ PluginTCalcFuncInfo g_CalcFuncSets[] = {
 
 extern "C" __declspec(dllexport) 
 BOOL RegisterTdxFunc(PluginTCalcFuncInfo** pFun) {
-    WriteLog("RegisterTdxFunc v6.1 - 增加中枢开始/结束标记");
+    CHAN_LOG_INFO("RegisterTdxFunc v6.1 - 增加中枢开始/结束标记");
     
     if (pFun == NULL) {
-        WriteLog("错误: pFun 为 NULL");
+        CHAN_LOG_ERROR("错误: pFun 为 NULL");
         return FALSE;
     }
     
     if (*pFun == NULL) {
         *pFun = g_CalcFuncSets;
-        WriteLog("函数数组已注册: 21个函数");
+        CHAN_LOG_INFO("函数数组已注册: %d个函数", 21);
         return TRUE;
     }
     
     return FALSE;
 }
 
+// 性能计数快照：TDXDLL1 函数号 1~21 与处理阶段各一项（与 chan.dll 同名同签名）
+// 返回槽位总数（大于 nCapacity 时只填充前 nCapacity 项）
+extern "C" __declspec(dllexport)
+int __stdcall GetChanPerfStats(chan::PerfStat* pStats, int nCapacity) {
+    return Perf().Snapshot(pStats, nCapacity);
+}
+
+// 写出性能报表（追加），pPath 为 NULL 时写到DLL目录下的 chan_std_perf.txt
+extern "C" __declspec(dllexport)
+int __stdcall DumpChanPerfStats(const char* pPath) {
+    std::string path = pPath ? pPath : "";
+    if (path.empty()) {
+        char module_path[MAX_PATH] = {0};
+        HMODULE hModule = NULL;
+        if (GetModuleHandleExA(
+                GET_MODULE_HANDLE_EX_FLAG_FROM_ADDRESS | GET_MODULE_HANDLE_EX_FLAG_UNCHANGED_REFCOUNT,
+                (LPCSTR)&DumpChanPerfStats, &hModule)) {
+            GetModuleFileNameA(hModule, module_path, MAX_PATH);
+        }
+        path = module_path;
+        size_t pos = path.find_last_of("\\/");
+        path = (pos == std::string::npos ? std::string() : path.substr(0, pos + 1)) + "chan_std_perf.txt";
+    }
+    return Perf().DumpToFile(path) ? 1 : 0;
+}
+
+// 清零性能计数
+extern "C" __declspec(dllexport)
+void __stdcall ResetChanPerfStats() {
+    Perf().Reset();
+}
+
+// DLL卸载时写出性能报表（有调用记录时）
+static void PerfDumpOnUnload() {
+    chan::PerfStat stats[PERF_SLOT_COUNT];
+    int count = Perf().Snapshot(stats, PERF_SLOT_COUNT);
+    uint64_t calls = 0;
+    for (int i = 0; i < count && i < PERF_SLOT_COUNT; ++i) {
+        calls += stats[i].calls;
+    }
+    if (calls > 0) {
+        DumpChanPerfStats(NULL);
+    }
+}
+
 // ============================================================================
 // DLL入口
 // ============================================================================
@@ -1336,13 +1609,14 @@ BOOL APIENTRY DllMain(HMODULE hModule, DWORD ul_reason_for_call, LPVOID lpReserv
     switch (ul_reason_for_call) {
     case DLL_PROCESS_ATTACH:
         DisableThreadLibraryCalls(hModule);
-        WriteLog("=== chan.dll v6.0 完整版加载 ===");
+        chan::LogSetLevel(chan::LogLevel::LOG_INFO);
+        chan::LogSetFile(CHAN_DEBUG_LOG_PATH);
+        CHAN_LOG_INFO("=== chan.dll v6.0 完整版加载 ===");
         break;
     case DLL_PROCESS_DETACH:
-        if (g_LogFile) {
-            fclose(g_LogFile);
-            g_LogFile = NULL;
-        }
+        PerfDumpOnUnload();
+        // 加载器锁内不能 join：输出剩余日志后分离后台线程
+        chan::LogDetachFromLoader(lpReserved != NULL);
         break;
     }
     return TRUE;
@@ -6,6 +6,15 @@
 // ============================================================================
 
 #include "../include/chan_core.h"
+#include "../include/analysis_cache.h"
+#include "../include/fx_kernel.h"
+#include "../include/moving_average.h"
+#include "../include/batch_analyzer.h"
+#include "../include/config_reader.h"
+#include "../include/tdx_data_reader.h"
+#include "../include/perf_counters.h"
+#include "../include/logger.h"
+#include "../include/multi_level.h"
 #include <iostream>
 #include <iomanip>
 #include <cassert>
@@ -13,6 +22,15 @@
 #include <vector>
 #include <string>
 #include <chrono>
+#include <thread>
+#include <cstdio>
+#include <cstring>
+#include <utility>
+#include <cstdlib>
+#include <new>
+#include <random>
+#include <mutex>
+#include <type_traits>
 
 // ============================================================================
 // 测试辅助宏
@@ -1441,6 +1459,2839 @@ TEST_CASE(Integration_SignalOutputFormat) {
     std::cout << "\n  信号格式验证通过";
 }
 
+// ============================================================================
+// 阶段七：性能优化回归测试
+// ============================================================================
+
+// 生成与 Performance_100K_Klines 相同的正弦波行情
+static void MakeSineKlines(int size, std::vector<float>& highs, std::vector<float>& lows,
+                           std::vector<float>& closes, std::vector<float>& volumes) {
+    highs.resize(size);
+    lows.resize(size);
+    closes.resize(size);
+    volumes.resize(size);
+
+    float base = 100.0f;
+    for (int i = 0; i < size; ++i) {
+        float wave = std::sin(i * 0.01f) * 10.0f;
+        float trend = i * 0.001f;
+
+        highs[i] = base + wave + trend + 2.0f;
+        lows[i] = base + wave + trend - 2.0f;
+        closes[i] = base + wave + trend;
+        volumes[i] = 1000000.0f + std::sin(i * 0.05f) * 500000.0f;
+    }
+}
+
+// 旧版逐K线收集+排序的 GG/DD 构建，仅作为对照基准
+static std::vector<chan::BiSequenceData> ReferenceBiSequence(const std::vector<chan::Stroke>& strokes,
+                                                             int current_bar_idx) {
+    std::vector<chan::BiSequenceData> result(current_bar_idx + 1);
+    if (strokes.empty()) return result;
+
+    for (int bar = 0; bar <= current_bar_idx; ++bar) {
+        chan::BiSequenceData& seq = result[bar];
+        std::vector<std::pair<float, int>> tops;
+        std::vector<std::pair<float, int>> bottoms;
+
+        for (const auto& stroke : strokes) {
+            if (stroke.end_idx > bar) continue;
+            if (stroke.direction == chan::Direction::UP) {
+                tops.push_back({stroke.high, stroke.end_idx});
+            } else {
+                bottoms.push_back({stroke.low, stroke.end_idx});
+            }
+        }
+
+        auto cmp = [](const std::pair<float, int>& a, const std::pair<float, int>& b) {
+            return a.second > b.second;
+        };
+        std::sort(tops.begin(), tops.end(), cmp);
+        std::sort(bottoms.begin(), bottoms.end(), cmp);
+
+        for (int i = 0; i < 5 && i < (int)tops.size(); ++i) {
+            seq.GG[i + 1] = tops[i].first;
+            seq.HH[i + 1] = bar - tops[i].second;
+        }
+        for (int i = 0; i < 5 && i < (int)bottoms.size(); ++i) {
+            seq.DD[i + 1] = bottoms[i].first;
+            seq.LL[i + 1] = bar - bottoms[i].second;
+        }
+
+        // 最近完成的笔决定方向
+        for (auto it = strokes.rbegin(); it != strokes.rend(); ++it) {
+            if (it->end_idx <= bar) {
+                seq.direction = (it->direction == chan::Direction::DOWN) ? 1 :
+                                (it->direction == chan::Direction::UP) ? -1 : 0;
+                break;
+            }
+        }
+    }
+    return result;
+}
+
+// 逐字段比较 ChanCore 的序列与参考序列
+static bool SameBiSequence(const chan::ChanCore& core, const std::vector<chan::BiSequenceData>& ref) {
+    for (int bar = 0; bar < (int)ref.size(); ++bar) {
+        if (core.GetDirection(bar) != ref[bar].direction) return false;
+        for (int n = 1; n <= 5; ++n) {
+            if (core.GetGG(bar, n) != ref[bar].GG[n] || core.GetDD(bar, n) != ref[bar].DD[n] ||
+                core.GetHH(bar, n) != ref[bar].HH[n] || core.GetLL(bar, n) != ref[bar].LL[n]) {
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+// ----------------------------------------------------------------------------
+// 测试33: BuildBiSequence 线性扫描 - 与旧实现逐字节一致并对比耗时
+// ----------------------------------------------------------------------------
+TEST_CASE(BiSequence_LinearSweep_100K) {
+    const int SIZE = 100000;
+    std::vector<float> highs, lows, closes, volumes;
+    MakeSineKlines(SIZE, highs, lows, closes, volumes);
+
+    chan::ChanCore core;
+    core.Analyze(highs.data(), lows.data(), closes.data(), volumes.data(), SIZE);
+    REQUIRE(core.GetStrokes().size() > 10);
+
+    auto t0 = std::chrono::high_resolution_clock::now();
+    core.BuildBiSequence(SIZE - 1);
+    auto t1 = std::chrono::high_resolution_clock::now();
+    std::vector<chan::BiSequenceData> ref = ReferenceBiSequence(core.GetStrokes().ToVector(), SIZE - 1);
+    auto t2 = std::chrono::high_resolution_clock::now();
+
+    auto sweep_us = std::chrono::duration_cast<std::chrono::microseconds>(t1 - t0).count();
+    auto ref_us = std::chrono::duration_cast<std::chrono::microseconds>(t2 - t1).count();
+    std::cout << "\n  笔=" << core.GetStrokes().size()
+              << ", 线性扫描=" << sweep_us << " us"
+              << ", 旧实现=" << ref_us << " us";
+
+    REQUIRE(SameBiSequence(core, ref));
+    REQUIRE(sweep_us <= ref_us);
+}
+
+// ----------------------------------------------------------------------------
+// 测试34: BuildBiSequence 线性扫描 - 短序列与边界
+// ----------------------------------------------------------------------------
+TEST_CASE(BiSequence_LinearSweep_Edges) {
+    chan::ChanCore core;
+
+    // 笔不足5个顶/底时，未填充的序号保持0
+    float highs[] = {12, 10, 11, 13, 15, 17, 16, 14, 12, 10, 9, 11, 13, 15, 17, 19, 18, 16, 14, 12, 10};
+    float lows[]  = {10,  8,  9, 11, 13, 15, 14, 12, 10,  8, 7,  9, 11, 13, 15, 17, 16, 14, 12, 10,  8};
+    int count = 21;
+
+    core.RemoveInclude(highs, lows, count);
+    core.CheckFX();
+    core.CheckBI();
+    core.BuildBiSequence(count - 1);
+    REQUIRE(SameBiSequence(core, ReferenceBiSequence(core.GetStrokes().ToVector(), count - 1)));
+
+    // 负索引不构建任何序列
+    core.BuildBiSequence(-1);
+    ASSERT_EQ(core.GetDirection(0), 0);
+    ASSERT_FLOAT_EQ(core.GetGG(0, 1), 0.0f);
+}
+
+// ----------------------------------------------------------------------------
+// 流式增量分析辅助函数
+// ----------------------------------------------------------------------------
+
+// 生成带大量包含关系的随机游走K线（固定种子，可复现）
+struct RandomWalk {
+    unsigned int seed;
+    float price;
+    explicit RandomWalk(unsigned int s) : seed(s), price(100.0f) {}
+    float Next() {
+        seed = seed * 1103515245u + 12345u;
+        return (float)((seed >> 16) & 0x7FFF) / 32767.0f;
+    }
+    void Bar(float& high, float& low) {
+        price += (Next() - 0.5f) * 2.0f;
+        high = price + Next() * 1.5f;
+        low = price - Next() * 1.5f;
+    }
+};
+
+// 比较两个 ChanCore 的去包含/分型/笔/中枢结果是否一致
+static bool SameAnalysis(const chan::ChanCore& a, const chan::ChanCore& b) {
+    const auto& ka = a.GetMergedKLines();
+    const auto& kb = b.GetMergedKLines();
+    if (ka.size() != kb.size()) return false;
+    for (size_t i = 0; i < ka.size(); ++i) {
+        if (ka[i].high != kb[i].high || ka[i].low != kb[i].low ||
+            ka[i].merge_start != kb[i].merge_start || ka[i].merge_end != kb[i].merge_end) {
+            return false;
+        }
+    }
+    
+    const auto& fa = a.GetFractals();
+    const auto& fb = b.GetFractals();
+    if (fa.size() != fb.size()) return false;
+    for (size_t i = 0; i < fa.size(); ++i) {
+        if (fa[i].index != fb[i].index || fa[i].type != fb[i].type ||
+            fa[i].price != fb[i].price || fa[i].kline_idx != fb[i].kline_idx) {
+            return false;
+        }
+    }
+    
+    const auto& sa = a.GetStrokes();
+    const auto& sb = b.GetStrokes();
+    if (sa.size() != sb.size()) return false;
+    for (size_t i = 0; i < sa.size(); ++i) {
+        if (sa[i].id != sb[i].id || sa[i].start_idx != sb[i].start_idx ||
+            sa[i].end_idx != sb[i].end_idx || sa[i].direction != sb[i].direction ||
+            sa[i].high != sb[i].high || sa[i].low != sb[i].low) {
+            return false;
+        }
+    }
+    
+    // 各级中枢（0=笔中枢）
+    if (a.GetMaxPivotLevel() != b.GetMaxPivotLevel()) return false;
+    for (int level = 0; level <= a.GetMaxPivotLevel(); ++level) {
+        const auto& pa = a.GetPivots(level);
+        const auto& pb = b.GetPivots(level);
+        if (pa.size() != pb.size()) return false;
+        for (size_t i = 0; i < pa.size(); ++i) {
+            if (pa[i].id != pb[i].id || pa[i].ZG != pb[i].ZG || pa[i].ZD != pb[i].ZD ||
+                pa[i].GG != pb[i].GG || pa[i].DD != pb[i].DD ||
+                pa[i].start_stroke_id != pb[i].start_stroke_id ||
+                pa[i].end_stroke_id != pb[i].end_stroke_id ||
+                pa[i].start_idx != pb[i].start_idx || pa[i].end_idx != pb[i].end_idx ||
+                pa[i].stroke_count != pb[i].stroke_count || pa[i].level != pb[i].level ||
+                pa[i].is_extended != pb[i].is_extended || pa[i].is_upgraded != pb[i].is_upgraded) {
+                return false;
+            }
+        }
+    }
+    
+    const auto& da = a.GetSegments();
+    const auto& db = b.GetSegments();
+    if (da.size() != db.size()) return false;
+    for (size_t i = 0; i < da.size(); ++i) {
+        if (da[i].start_stroke_id != db[i].start_stroke_id ||
+            da[i].end_stroke_id != db[i].end_stroke_id ||
+            da[i].start_idx != db[i].start_idx || da[i].end_idx != db[i].end_idx ||
+            da[i].direction != db[i].direction ||
+            da[i].high != db[i].high || da[i].low != db[i].low) {
+            return false;
+        }
+    }
+    return true;
+}
+
+// 流式喂入K线（每根附带若干次盘中刷新），定期与完整 Analyze 对比
+static bool StreamMatchesAnalyze(const chan::ChanConfig& config, unsigned int seed, int size) {
+    chan::ChanCore stream(config);
+    chan::ChanCore full(config);
+    RandomWalk walk(seed);
+    std::vector<float> highs, lows, closes, volumes;
+    
+    for (int i = 0; i < size; ++i) {
+        float h, l;
+        walk.Bar(h, l);
+        stream.AppendBar(h, l, (h + l) / 2, 1000.0f);
+        
+        // 盘中刷新：价格在最后一根K线上反复变化
+        int updates = (int)(walk.Next() * 4);
+        for (int u = 0; u < updates; ++u) {
+            h += (walk.Next() - 0.3f) * 1.0f;
+            l -= (walk.Next() - 0.3f) * 1.0f;
+            if (l > h) l = h;
+            stream.UpdateLastBar(h, l, (h + l) / 2, 1000.0f);
+        }
+        
+        highs.push_back(h);
+        lows.push_back(l);
+        closes.push_back((h + l) / 2);
+        volumes.push_back(1000.0f);
+        
+        if (i % 37 == 0 || i == size - 1) {
+            full.Analyze(highs.data(), lows.data(), closes.data(), volumes.data(), i + 1);
+            if (!SameAnalysis(stream, full)) {
+                std::cout << "\n  流式结果在第 " << i << " 根K线处不一致";
+                return false;
+            }
+        }
+    }
+    return stream.GetRawCount() == size;
+}
+
+// ----------------------------------------------------------------------------
+// 测试35: 流式增量分析 - 追加与盘中刷新结果与完整分析一致
+// ----------------------------------------------------------------------------
+TEST_CASE(Streaming_MatchesFullAnalyze) {
+    chan::ChanConfig config;
+    REQUIRE(StreamMatchesAnalyze(config, 12345u, 3000));
+    
+    // 较短的笔长度产生更多笔与中枢
+    config.min_bi_len = 3;
+    config.min_fx_distance = 0;
+    REQUIRE(StreamMatchesAnalyze(config, 777u, 3000));
+    
+    config.min_zs_bi_count = 5;
+    REQUIRE(StreamMatchesAnalyze(config, 2024u, 3000));
+}
+
+// ----------------------------------------------------------------------------
+// 测试36: 流式增量分析 - 边界：空数据刷新、Analyze后续追加、修改配置
+// ----------------------------------------------------------------------------
+TEST_CASE(Streaming_Edges) {
+    chan::ChanCore stream;
+    ASSERT_EQ(stream.UpdateLastBar(10, 9, 9.5f, 100), -1);
+    
+    RandomWalk walk(99u);
+    std::vector<float> highs, lows, closes, volumes;
+    for (int i = 0; i < 800; ++i) {
+        float h, l;
+        walk.Bar(h, l);
+        highs.push_back(h);
+        lows.push_back(l);
+        closes.push_back((h + l) / 2);
+        volumes.push_back(1000.0f);
+    }
+    
+    // 先完整分析前500根，再逐根追加剩余K线
+    stream.Analyze(highs.data(), lows.data(), closes.data(), volumes.data(), 500);
+    for (int i = 500; i < 650; ++i) {
+        stream.AppendBar(highs[i], lows[i], closes[i], volumes[i]);
+    }
+    chan::ChanCore full;
+    full.Analyze(highs.data(), lows.data(), closes.data(), volumes.data(), 650);
+    REQUIRE(SameAnalysis(stream, full));
+    
+    // 修改成笔参数后，后续追加按新参数重建
+    chan::ChanConfig config;
+    config.min_bi_len = 3;
+    stream.SetConfig(config);
+    full.SetConfig(config);
+    for (int i = 650; i < 800; ++i) {
+        stream.AppendBar(highs[i], lows[i], closes[i], volumes[i]);
+    }
+    full.Analyze(highs.data(), lows.data(), closes.data(), volumes.data(), 800);
+    REQUIRE(SameAnalysis(stream, full));
+    ASSERT_EQ(stream.GetRawCount(), 800);
+}
+
+// ----------------------------------------------------------------------------
+// 测试37: 流式增量分析 - 100K K线逐根追加耗时
+// ----------------------------------------------------------------------------
+TEST_CASE(Streaming_Performance_100K) {
+    const int SIZE = 100000;
+    std::vector<float> highs, lows, closes, volumes;
+    MakeSineKlines(SIZE, highs, lows, closes, volumes);
+    
+    auto t0 = std::chrono::high_resolution_clock::now();
+    chan::ChanCore full;
+    full.Analyze(highs.data(), lows.data(), closes.data(), volumes.data(), SIZE);
+    auto t1 = std::chrono::high_resolution_clock::now();
+    chan::ChanCore stream;
+    for (int i = 0; i < SIZE; ++i) {
+        stream.AppendBar(highs[i], lows[i], closes[i], volumes[i]);
+    }
+    auto t2 = std::chrono::high_resolution_clock::now();
+    
+    auto full_us = std::chrono::duration_cast<std::chrono::microseconds>(t1 - t0).count();
+    auto stream_us = std::chrono::duration_cast<std::chrono::microseconds>(t2 - t1).count();
+    std::cout << "\n  完整分析=" << full_us << " us"
+              << ", 逐根追加=" << stream_us << " us"
+              << " (" << std::fixed << std::setprecision(3)
+              << (double)stream_us / SIZE << " us/根)";
+    
+    REQUIRE(SameAnalysis(stream, full));
+    // 均摊O(1)：逐根追加全部K线的总耗时与一次完整分析同量级
+    REQUIRE(stream_us < full_us * 20 + 10000);
+}
+
+// ----------------------------------------------------------------------------
+// 测试38: 分析缓存 - 命中/未命中、配置区分、同数量不同数据不冲突
+// ----------------------------------------------------------------------------
+TEST_CASE(AnalysisCache_HitMiss) {
+    std::vector<float> highs, lows, closes, volumes;
+    MakeSineKlines(500, highs, lows, closes, volumes);
+    
+    chan::AnalysisCache cache(100000);
+    chan::ChanConfig config;
+    
+    chan::ChanCore* a = cache.Acquire(highs.data(), lows.data(), closes.data(), volumes.data(), 500, config);
+    REQUIRE(a != nullptr);
+    chan::ChanCore* b = cache.Acquire(highs.data(), lows.data(), closes.data(), volumes.data(), 500, config);
+    REQUIRE(a == b);
+    ASSERT_EQ((int)cache.GetStats().hits, 1);
+    ASSERT_EQ((int)cache.GetStats().misses, 1);
+    
+    // 结果与直接分析一致
+    chan::ChanCore direct;
+    direct.Analyze(highs.data(), lows.data(), closes.data(), volumes.data(), 500);
+    REQUIRE(SameAnalysis(*b, direct));
+    
+    // 配置不同：独立实例
+    chan::ChanConfig config3 = config;
+    config3.min_bi_len = 3;
+    chan::ChanCore* c = cache.Acquire(highs.data(), lows.data(), closes.data(), volumes.data(), 500, config3);
+    REQUIRE(c != a);
+    ASSERT_EQ(c->GetConfig().min_bi_len, 3);
+    
+    // K线数量相同但最后一根变化（盘中刷新）：不能命中旧结果
+    std::vector<float> highs2 = highs;
+    highs2[499] += 5.0f;
+    chan::ChanCore* d = cache.Acquire(highs2.data(), lows.data(), closes.data(), volumes.data(), 500, config);
+    REQUIRE(d != a);
+    ASSERT_EQ((int)cache.GetStats().misses, 3);
+    ASSERT_EQ(cache.GetStats().entries, 3);
+    
+    // 原数据仍在缓存中
+    REQUIRE(cache.Acquire(highs.data(), lows.data(), closes.data(), volumes.data(), 500, config) == a);
+    ASSERT_EQ((int)cache.GetStats().hits, 2);
+    
+    // 无效参数
+    REQUIRE(cache.Acquire(nullptr, lows.data(), nullptr, nullptr, 500, config) == nullptr);
+}
+
+// ----------------------------------------------------------------------------
+// 测试39: 分析缓存 - 按K线总数/会话数LRU淘汰、禁用缓存
+// ----------------------------------------------------------------------------
+TEST_CASE(AnalysisCache_Eviction) {
+    // 模拟50只股票的自选股列表，每只300根K线
+    const int STOCKS = 50;
+    const int BARS = 300;
+    std::vector<std::vector<float>> highs(STOCKS), lows(STOCKS);
+    for (int s = 0; s < STOCKS; ++s) {
+        RandomWalk walk(1000u + s);
+        for (int i = 0; i < BARS; ++i) {
+            float h, l;
+            walk.Bar(h, l);
+            highs[s].push_back(h);
+            lows[s].push_back(l);
+        }
+    }
+    
+    chan::ChanConfig config;
+    chan::AnalysisCache cache(STOCKS * BARS);
+    for (int round = 0; round < 3; ++round) {
+        for (int s = 0; s < STOCKS; ++s) {
+            cache.Acquire(highs[s].data(), lows[s].data(), nullptr, nullptr, BARS, config);
+        }
+    }
+    // 容量足够：只有第一轮未命中
+    ASSERT_EQ((int)cache.GetStats().misses, STOCKS);
+    ASSERT_EQ((int)cache.GetStats().hits, STOCKS * 2);
+    ASSERT_EQ(cache.GetStats().cached_bars, STOCKS * BARS);
+    
+    // 缩小容量：按最近使用保留10只
+    cache.SetCapacity(10 * BARS);
+    ASSERT_EQ(cache.GetStats().entries, 10);
+    ASSERT_EQ((int)cache.GetStats().evictions, STOCKS - 10);
+    cache.ResetStats();
+    cache.Acquire(highs[STOCKS - 1].data(), lows[STOCKS - 1].data(), nullptr, nullptr, BARS, config);
+    cache.Acquire(highs[0].data(), lows[0].data(), nullptr, nullptr, BARS, config);
+    ASSERT_EQ((int)cache.GetStats().hits, 1);
+    ASSERT_EQ((int)cache.GetStats().misses, 1);
+    
+    // 容量小于单只股票：仍保留最近使用的一个实例
+    cache.SetCapacity(BARS / 2);
+    ASSERT_EQ(cache.GetStats().entries, 1);
+    
+    // 会话数上限：K线容量充足时按会话数淘汰，轮动不超过上限的股票全部命中
+    cache.SetCapacity(STOCKS * BARS);
+    cache.SetMaxEntries(5);
+    ASSERT_EQ(cache.GetMaxEntries(), 5);
+    for (int s = 0; s < STOCKS; ++s) {
+        cache.Acquire(highs[s].data(), lows[s].data(), nullptr, nullptr, BARS, config);
+    }
+    ASSERT_EQ(cache.GetStats().entries, 5);
+    cache.ResetStats();
+    for (int round = 0; round < 3; ++round) {
+        for (int s = STOCKS - 5; s < STOCKS; ++s) {
+            cache.Acquire(highs[s].data(), lows[s].data(), nullptr, nullptr, BARS, config);
+        }
+    }
+    ASSERT_EQ((int)cache.GetStats().hits, 15);
+    ASSERT_EQ((int)cache.GetStats().misses, 0);
+    cache.SetMaxEntries(0);
+    
+    // 禁用缓存：每次都重新分析
+    cache.SetCapacity(0);
+    cache.ResetStats();
+    cache.Acquire(highs[0].data(), lows[0].data(), nullptr, nullptr, BARS, config);
+    cache.Acquire(highs[0].data(), lows[0].data(), nullptr, nullptr, BARS, config);
+    ASSERT_EQ((int)cache.GetStats().hits, 0);
+    ASSERT_EQ((int)cache.GetStats().misses, 2);
+    ASSERT_EQ(cache.GetStats().entries, 1);
+}
+
+// ----------------------------------------------------------------------------
+// 测试40: 分析会话 - 多个输出共享一次分析，序列与信号延迟生成
+// ----------------------------------------------------------------------------
+TEST_CASE(AnalysisSession_LazyOutputs) {
+    const int SIZE = 2000;
+    std::vector<float> highs, lows, closes, volumes;
+    MakeSineKlines(SIZE, highs, lows, closes, volumes);
+    
+    chan::AnalysisCache cache(100000);
+    chan::ChanConfig config;
+    
+    // 模拟一个公式依次调用多个导出函数
+    chan::AnalysisSession* session = cache.AcquireSession(highs.data(), lows.data(), closes.data(), volumes.data(), SIZE, config);
+    REQUIRE(session != nullptr);
+    REQUIRE(!session->HasBiSequence());
+    REQUIRE(!session->HasSignal(chan::SessionSignal::BUY));
+    
+    const std::vector<float>& buy = session->GetSignal(chan::SessionSignal::BUY, highs.data(), lows.data());
+    REQUIRE(session->HasBiSequence());
+    REQUIRE(session->HasSignal(chan::SessionSignal::BUY));
+    REQUIRE(!session->HasSignal(chan::SessionSignal::SELL));
+    ASSERT_EQ((int)buy.size(), SIZE);
+    
+    for (int call = 0; call < 8; ++call) {
+        chan::AnalysisSession* again = cache.AcquireSession(highs.data(), lows.data(), closes.data(), volumes.data(), SIZE, config);
+        REQUIRE(again == session);
+    }
+    ASSERT_EQ((int)cache.GetStats().misses, 1);
+    ASSERT_EQ((int)cache.GetStats().hits, 8);
+    
+    // 已生成的信号直接复用
+    const std::vector<float>& buy2 = session->GetSignal(chan::SessionSignal::BUY, highs.data(), lows.data());
+    REQUIRE(&buy2 == &buy);
+    
+    // 与直接计算的结果一致
+    chan::ChanCore direct;
+    direct.Analyze(highs.data(), lows.data(), closes.data(), volumes.data(), SIZE);
+    direct.ComputeMAData(closes.data(), SIZE);
+    direct.BuildBiSequence(SIZE - 1);
+    std::vector<float> expect(SIZE);
+    direct.OutputBuySignal(expect.data(), SIZE, lows.data());
+    REQUIRE(expect == buy);
+    direct.OutputCombinedSellSignal(expect.data(), SIZE, highs.data());
+    REQUIRE(expect == session->GetSignal(chan::SessionSignal::SELLX, highs.data(), lows.data()));
+    
+    // 会话重新分析后，延迟生成的结果失效
+    chan::AnalysisSession standalone;
+    standalone.Analyze(highs.data(), lows.data(), closes.data(), volumes.data(), SIZE, config);
+    standalone.GetSignal(chan::SessionSignal::BUY, highs.data(), lows.data());
+    standalone.Analyze(highs.data(), lows.data(), closes.data(), volumes.data(), SIZE - 10, config);
+    REQUIRE(!standalone.HasBiSequence());
+    REQUIRE(!standalone.HasSignal(chan::SessionSignal::BUY));
+    ASSERT_EQ((int)standalone.GetSignal(chan::SessionSignal::BUY, highs.data(), lows.data()).size(), SIZE - 10);
+}
+
+// ----------------------------------------------------------------------------
+// 测试41: SoA存储 - 视图还原的结构体与SoA字段一致，且可转为完整数组
+// ----------------------------------------------------------------------------
+TEST_CASE(SoA_ViewsMatchStorage) {
+    const int SIZE = 5000;
+    RandomWalk walk(41);
+    std::vector<float> highs(SIZE), lows(SIZE);
+    for (int i = 0; i < SIZE; ++i) {
+        walk.Bar(highs[i], lows[i]);
+    }
+    
+    chan::ChanCore core;
+    core.Analyze(highs.data(), lows.data(), nullptr, nullptr, SIZE);
+    
+    const chan::MergedKLineSoA& merged = core.GetMergedKLineSoA();
+    auto klines = core.GetMergedKLines();
+    ASSERT_EQ((int)klines.size(), merged.size());
+    for (int i = 0; i < merged.size(); ++i) {
+        chan::KLine k = klines[i];
+        REQUIRE(k.high == merged.high[i] && k.low == merged.low[i]);
+        ASSERT_EQ(k.index, merged.merge_start[i]);
+        ASSERT_EQ(k.merge_end, merged.merge_end[i]);
+        REQUIRE(k.is_merged == (merged.merge_end[i] != merged.merge_start[i]));
+    }
+    
+    const chan::FractalSoA& fx = core.GetFractalSoA();
+    auto fractals = core.GetFractals();
+    ASSERT_EQ((int)fractals.size(), fx.size());
+    REQUIRE(fx.size() > 10);
+    
+    const chan::StrokeSoA& st = core.GetStrokeSoA();
+    std::vector<chan::Stroke> strokes = core.GetStrokes().ToVector();
+    ASSERT_EQ((int)strokes.size(), st.size());
+    REQUIRE(st.size() > 10);
+    for (int i = 0; i < st.size(); ++i) {
+        const chan::Stroke& s = strokes[i];
+        ASSERT_EQ(s.id, i);
+        ASSERT_EQ(s.start_idx, fx.kline_idx[st.start_fx[i]]);
+        ASSERT_EQ(s.end_idx, fx.kline_idx[st.end_fx[i]]);
+        ASSERT_EQ(s.start_fx.index, fractals[st.start_fx[i]].index);
+        REQUIRE(s.end_fx.price == fx.price[st.end_fx[i]]);
+        REQUIRE(s.power == s.high - s.low);
+        ASSERT_EQ(s.kline_count, s.end_idx - s.start_idx + 1);
+        // 笔首尾相接
+        if (i > 0) {
+            ASSERT_EQ(st.start_fx[i], st.end_fx[i - 1]);
+        }
+    }
+    
+    // 范围for与下标访问一致
+    int n = 0;
+    for (const auto& f : core.GetFractals()) {
+        REQUIRE(f.price == fx.price[n] && f.type == fx.type[n]);
+        ++n;
+    }
+    ASSERT_EQ(n, fx.size());
+}
+
+// ----------------------------------------------------------------------------
+// 测试42: 分型SIMD内核 - 各指令集候选位图与标量逐位一致
+// ----------------------------------------------------------------------------
+TEST_CASE(FXKernel_MatchesScalar) {
+    const int SIZE = 4099;  // 非向量宽度整数倍，覆盖尾部
+    RandomWalk walk(42);
+    std::vector<float> highs(SIZE), lows(SIZE);
+    for (int i = 0; i < SIZE; ++i) {
+        walk.Bar(highs[i], lows[i]);
+        // 制造相等价格，检验严格比较
+        if (i % 7 == 3) {
+            highs[i] = highs[i - 1];
+        }
+    }
+    highs[100] = std::nanf("");
+    lows[200] = std::nanf("");
+    
+    std::cout << "\n  检测到指令集: " << chan::SimdLevelName(chan::GetSimdLevel());
+    
+    const int ranges[][2] = { {1, SIZE - 1}, {5, 6}, {3, 40}, {17, SIZE - 9}, {1, 1} };
+    for (const auto& r : ranges) {
+        int words = chan::FXMaskWords(r[1] - r[0]);
+        std::vector<uint32_t> ref_top(words + 1), ref_bottom(words + 1);
+        chan::DetectFXCandidates(highs.data(), lows.data(), r[0], r[1],
+                                 ref_top.data(), ref_bottom.data(), chan::SimdLevel::SCALAR);
+        
+        for (int lv = 1; lv <= (int)chan::GetSimdLevel(); ++lv) {
+            std::vector<uint32_t> top(words + 1, 0xFFFFFFFFu), bottom(words + 1, 0xFFFFFFFFu);
+            chan::DetectFXCandidates(highs.data(), lows.data(), r[0], r[1],
+                                     top.data(), bottom.data(), (chan::SimdLevel)lv);
+            for (int w = 0; w < words; ++w) {
+                ASSERT_EQ(top[w], ref_top[w]);
+                ASSERT_EQ(bottom[w], ref_bottom[w]);
+                REQUIRE((top[w] & bottom[w]) == 0);
+            }
+            // 不越界写
+            ASSERT_EQ(top[words], 0xFFFFFFFFu);
+        }
+    }
+    
+    // 位图与标量三K线判定一致
+    std::vector<uint32_t> top(chan::FXMaskWords(SIZE)), bottom(chan::FXMaskWords(SIZE));
+    chan::DetectFXCandidates(highs.data(), lows.data(), 1, SIZE - 1, top.data(), bottom.data());
+    for (int i = 1; i < SIZE - 1; ++i) {
+        bool is_top = highs[i] > highs[i - 1] && highs[i] > highs[i + 1] &&
+                      lows[i] > lows[i - 1] && lows[i] > lows[i + 1];
+        bool is_bottom = lows[i] < lows[i - 1] && lows[i] < lows[i + 1] &&
+                         highs[i] < highs[i - 1] && highs[i] < highs[i + 1];
+        int bit = i - 1;
+        REQUIRE(((top[bit >> 5] >> (bit & 31)) & 1u) == (is_top ? 1u : 0u));
+        REQUIRE(((bottom[bit >> 5] >> (bit & 31)) & 1u) == (is_bottom ? 1u : 0u));
+    }
+}
+
+// ----------------------------------------------------------------------------
+// 测试43: 分型SIMD内核性能 - 百万根K线的候选判定
+// ----------------------------------------------------------------------------
+TEST_CASE(FXKernel_Performance_1M) {
+    const int SIZE = 1000000;
+    RandomWalk walk(43);
+    std::vector<float> highs(SIZE), lows(SIZE);
+    for (int i = 0; i < SIZE; ++i) {
+        walk.Bar(highs[i], lows[i]);
+    }
+    
+    int words = chan::FXMaskWords(SIZE - 2);
+    std::vector<uint32_t> top(words), bottom(words), ref_top(words), ref_bottom(words);
+    
+    auto t0 = std::chrono::high_resolution_clock::now();
+    chan::DetectFXCandidates(highs.data(), lows.data(), 1, SIZE - 1,
+                             ref_top.data(), ref_bottom.data(), chan::SimdLevel::SCALAR);
+    auto t1 = std::chrono::high_resolution_clock::now();
+    chan::DetectFXCandidates(highs.data(), lows.data(), 1, SIZE - 1, top.data(), bottom.data());
+    auto t2 = std::chrono::high_resolution_clock::now();
+    
+    auto scalar_us = std::chrono::duration_cast<std::chrono::microseconds>(t1 - t0).count();
+    auto simd_us = std::chrono::duration_cast<std::chrono::microseconds>(t2 - t1).count();
+    std::cout << "\n  标量=" << scalar_us << " us"
+              << ", " << chan::SimdLevelName(chan::GetSimdLevel()) << "=" << simd_us << " us";
+    
+    REQUIRE(top == ref_top);
+    REQUIRE(bottom == ref_bottom);
+    
+    // 完整分型识别结果不受内核影响
+    chan::ChanCore core;
+    core.Analyze(highs.data(), lows.data(), nullptr, nullptr, SIZE);
+    REQUIRE(core.GetFractals().size() > 1000);
+}
+
+// ----------------------------------------------------------------------------
+// 测试44: 滑动窗口均线 - 多周期单次遍历、增量续算与逐窗口求和一致
+// ----------------------------------------------------------------------------
+
+// 逐窗口求和的参考实现（窗口和在 double 中精确）
+static std::vector<float> ReferenceMA(const std::vector<float>& closes, int period) {
+    std::vector<float> ma(closes.size());
+    for (int i = 0; i < (int)closes.size(); ++i) {
+        if (i < period - 1) {
+            ma[i] = closes[i];
+        } else {
+            double sum = 0;
+            for (int j = 0; j < period; ++j) {
+                sum += closes[i - j];
+            }
+            ma[i] = (float)(sum / period);
+        }
+    }
+    return ma;
+}
+
+TEST_CASE(MovingAverage_MultiPeriod) {
+    const int SIZE = 20000;
+    RandomWalk walk(44);
+    std::vector<float> closes(SIZE);
+    for (int i = 0; i < SIZE; ++i) {
+        float h, l;
+        walk.Bar(h, l);
+        closes[i] = (h + l) / 2;
+    }
+    
+    const int periods[5] = { 1, 5, 13, 26, 250 };
+    std::vector<std::vector<float>> ma(5, std::vector<float>(SIZE));
+    float* outs[5];
+    for (int k = 0; k < 5; ++k) {
+        outs[k] = ma[k].data();
+    }
+    chan::CalcMovingAverages(closes.data(), 0, SIZE, periods, 5, outs);
+    
+    for (int k = 0; k < 5; ++k) {
+        REQUIRE(ma[k] == ReferenceMA(closes, periods[k]));
+    }
+    
+    // 增量续算：只重算 start 之后，结果与完整计算相同
+    std::vector<float> part(SIZE, -1.0f);
+    chan::CalcMovingAverage(closes.data(), 0, 12345, 26, part);
+    chan::CalcMovingAverage(closes.data(), 12345, SIZE, 26, part);
+    REQUIRE(part == ma[3]);
+    
+    // 边界：数据短于周期，周期非法
+    std::vector<float> short_ma;
+    chan::CalcMovingAverage(closes.data(), 0, 10, 26, short_ma);
+    for (int i = 0; i < 10; ++i) {
+        REQUIRE(short_ma[i] == closes[i]);
+    }
+    chan::CalcMovingAverage(closes.data(), 0, 10, 0, short_ma);
+    REQUIRE(short_ma[9] == closes[9]);
+}
+
+// ----------------------------------------------------------------------------
+// 测试45: ChanCore 自行计算均线 - 与调用方传入 MA13/MA26 的结果一致
+// ----------------------------------------------------------------------------
+TEST_CASE(MovingAverage_ComputeMAData) {
+    const int SIZE = 3000;
+    std::vector<float> highs, lows, closes, volumes;
+    MakeSineKlines(SIZE, highs, lows, closes, volumes);
+    
+    chan::ChanCore supplied;
+    supplied.Analyze(highs.data(), lows.data(), closes.data(), volumes.data(), SIZE);
+    std::vector<float> ma13 = ReferenceMA(closes, 13);
+    std::vector<float> ma26 = ReferenceMA(closes, 26);
+    supplied.SetMAData(ma13.data(), ma26.data(), SIZE);
+    supplied.BuildBiSequence(SIZE - 1);
+    
+    chan::ChanCore computed;
+    computed.Analyze(highs.data(), lows.data(), closes.data(), volumes.data(), SIZE);
+    computed.ComputeMAData(closes.data(), SIZE);
+    computed.BuildBiSequence(SIZE - 1);
+    
+    std::vector<float> a(SIZE), b(SIZE);
+    supplied.OutputCombinedBuySignal(a.data(), SIZE, lows.data());
+    computed.OutputCombinedBuySignal(b.data(), SIZE, lows.data());
+    REQUIRE(a == b);
+    supplied.OutputCombinedSellSignal(a.data(), SIZE, highs.data());
+    computed.OutputCombinedSellSignal(b.data(), SIZE, highs.data());
+    REQUIRE(a == b);
+    
+    // 周期来自配置
+    chan::ChanConfig config;
+    config.ma_short_period = 5;
+    config.ma_long_period = 60;
+    chan::AnalysisCache cache(100000);
+    chan::AnalysisSession* s1 = cache.AcquireSession(highs.data(), lows.data(), closes.data(), volumes.data(), SIZE, config);
+    config.ma_long_period = 120;
+    chan::AnalysisSession* s2 = cache.AcquireSession(highs.data(), lows.data(), closes.data(), volumes.data(), SIZE, config);
+    REQUIRE(s1 != s2);  // 均线周期不同，不能共用缓存
+    
+    // 收盘价变化（高低价不变）同样需要重新计算均线
+    std::vector<float> closes2 = closes;
+    closes2[SIZE / 2] += 0.01f;
+    cache.AcquireSession(highs.data(), lows.data(), closes2.data(), volumes.data(), SIZE, config);
+    ASSERT_EQ((int)cache.GetStats().misses, 3);
+}
+
+// ----------------------------------------------------------------------------
+// 测试46: 滑动窗口均线性能 - 百万根K线、8个周期
+// ----------------------------------------------------------------------------
+TEST_CASE(MovingAverage_Performance_1M) {
+    const int SIZE = 1000000;
+    RandomWalk walk(46);
+    std::vector<float> closes(SIZE);
+    for (int i = 0; i < SIZE; ++i) {
+        float h, l;
+        walk.Bar(h, l);
+        closes[i] = (h + l) / 2;
+    }
+    
+    const int periods[8] = { 5, 10, 13, 20, 26, 60, 120, 250 };
+    std::vector<std::vector<float>> ma(8, std::vector<float>(SIZE));
+    float* outs[8];
+    for (int k = 0; k < 8; ++k) {
+        outs[k] = ma[k].data();
+    }
+    
+    auto t0 = std::chrono::high_resolution_clock::now();
+    chan::CalcMovingAverages(closes.data(), 0, SIZE, periods, 8, outs);
+    auto t1 = std::chrono::high_resolution_clock::now();
+    std::vector<float> ref = ReferenceMA(closes, 250);
+    auto t2 = std::chrono::high_resolution_clock::now();
+    
+    auto engine_us = std::chrono::duration_cast<std::chrono::microseconds>(t1 - t0).count();
+    auto naive_us = std::chrono::duration_cast<std::chrono::microseconds>(t2 - t1).count();
+    std::cout << "\n  8周期单次遍历=" << engine_us << " us"
+              << ", 逐窗口MA250=" << naive_us << " us";
+    
+    REQUIRE(ma[7] == ref);
+    // 8个周期合计仍远快于单个长周期的逐窗口求和
+    REQUIRE(engine_us < naive_us);
+}
+
+// ----------------------------------------------------------------------------
+// 测试47: 信号位图 - 各输出的投影结果与逐条件判断一致
+// ----------------------------------------------------------------------------
+
+// 直接调用 Output*Signal 的参考结果
+static void OutputSignalDirect(const chan::ChanCore& core, chan::SignalOutput kind, float* out, int count,
+                               const float* highs, const float* lows) {
+    switch (kind) {
+        case chan::SignalOutput::BUY:     core.OutputBuySignal(out, count, lows); break;
+        case chan::SignalOutput::SELL:    core.OutputSellSignal(out, count, highs); break;
+        case chan::SignalOutput::BUYX:    core.OutputCombinedBuySignal(out, count, lows); break;
+        case chan::SignalOutput::SELLX:   core.OutputCombinedSellSignal(out, count, highs); break;
+        case chan::SignalOutput::PREBUY:  core.OutputPreBuySignal(out, count, lows); break;
+        case chan::SignalOutput::PRESELL: core.OutputPreSellSignal(out, count, highs); break;
+        case chan::SignalOutput::LIKE2B:  core.OutputLikeSecondBuySignal(out, count, lows); break;
+        case chan::SignalOutput::LIKE2S:  core.OutputLikeSecondSellSignal(out, count, highs); break;
+        default: break;
+    }
+}
+
+TEST_CASE(SignalTable_MatchesOutputs) {
+    const int SIZE = 20000;
+    RandomWalk walk(47);
+    std::vector<float> highs(SIZE), lows(SIZE), closes(SIZE);
+    for (int i = 0; i < SIZE; ++i) {
+        walk.Bar(highs[i], lows[i]);
+        closes[i] = (highs[i] + lows[i]) / 2;
+    }
+    
+    for (int variant = 0; variant < 3; ++variant) {
+        chan::ChanConfig config;
+        config.enable_like_signals = (variant != 1);
+        config.enable_pre_signals = (variant != 2);
+        
+        chan::ChanCore core(config);
+        core.Analyze(highs.data(), lows.data(), closes.data(), nullptr, SIZE);
+        core.ComputeMAData(closes.data(), SIZE);
+        core.BuildBiSequence(SIZE - 1);
+        
+        // 未生成位图时投影全0
+        std::vector<float> expect(SIZE), actual(SIZE, 9.0f);
+        REQUIRE(!core.HasSignalTable());
+        core.ProjectSignal(chan::SignalOutput::BUY, actual.data(), SIZE);
+        REQUIRE(actual == std::vector<float>(SIZE, 0.0f));
+        
+        core.BuildSignalTable(highs.data(), lows.data(), SIZE);
+        REQUIRE(core.HasSignalTable());
+        ASSERT_EQ((int)core.GetSignalTable().size(), SIZE);
+        
+        int nonzero = 0;
+        for (int k = 0; k < (int)chan::SignalOutput::COUNT; ++k) {
+            chan::SignalOutput kind = (chan::SignalOutput)k;
+            OutputSignalDirect(core, kind, expect.data(), SIZE, highs.data(), lows.data());
+            core.ProjectSignal(kind, actual.data(), SIZE);
+            REQUIRE(expect == actual);
+            for (float v : expect) {
+                nonzero += (v != 0.0f);
+            }
+        }
+        REQUIRE(nonzero > 0);
+        
+        // 重建递归序列后位图失效
+        core.BuildBiSequence(SIZE - 1);
+        REQUIRE(!core.HasSignalTable());
+    }
+}
+
+// ----------------------------------------------------------------------------
+// 测试48: 信号位图性能 - 8路信号输出一起调用的开销
+// ----------------------------------------------------------------------------
+TEST_CASE(SignalTable_Performance) {
+    const int SIZE = 100000;
+    RandomWalk walk(48);
+    std::vector<float> highs(SIZE), lows(SIZE), closes(SIZE);
+    for (int i = 0; i < SIZE; ++i) {
+        walk.Bar(highs[i], lows[i]);
+        closes[i] = (highs[i] + lows[i]) / 2;
+    }
+    
+    chan::ChanCore core;
+    core.Analyze(highs.data(), lows.data(), closes.data(), nullptr, SIZE);
+    core.ComputeMAData(closes.data(), SIZE);
+    core.BuildBiSequence(SIZE - 1);
+    
+    std::vector<float> out(SIZE);
+    auto ts = std::chrono::high_resolution_clock::now();
+    core.OutputCombinedBuySignal(out.data(), SIZE, lows.data());
+    auto t0 = std::chrono::high_resolution_clock::now();
+    for (int k = 0; k < (int)chan::SignalOutput::COUNT; ++k) {
+        OutputSignalDirect(core, (chan::SignalOutput)k, out.data(), SIZE, highs.data(), lows.data());
+    }
+    auto t1 = std::chrono::high_resolution_clock::now();
+    core.BuildSignalTable(highs.data(), lows.data(), SIZE);
+    for (int k = 0; k < (int)chan::SignalOutput::COUNT; ++k) {
+        core.ProjectSignal((chan::SignalOutput)k, out.data(), SIZE);
+    }
+    auto t2 = std::chrono::high_resolution_clock::now();
+    
+    auto direct_us = std::chrono::duration_cast<std::chrono::microseconds>(t1 - t0).count();
+    auto table_us = std::chrono::duration_cast<std::chrono::microseconds>(t2 - t1).count();
+    auto single_us = std::chrono::duration_cast<std::chrono::microseconds>(t0 - ts).count();
+    std::cout << "\n  单路BUYX=" << single_us << " us"
+              << ", 8路逐输出判断=" << direct_us << " us"
+              << ", 位图+8路投影=" << table_us << " us";
+    
+    REQUIRE(table_us < direct_us);
+}
+
+// ----------------------------------------------------------------------------
+// 批量分析辅助函数
+// ----------------------------------------------------------------------------
+
+// 变长批次：各标的长度不一（含空标的与不足3根的标的）
+struct RaggedBatch {
+    std::vector<float> highs, lows, closes;
+    std::vector<int> offsets;
+    
+    RaggedBatch(int series, int max_bars, unsigned int seed) {
+        unsigned int len_seed = seed;
+        offsets.push_back(0);
+        for (int s = 0; s < series; ++s) {
+            len_seed = len_seed * 1103515245u + 12345u;
+            int len = (int)((len_seed >> 16) % (unsigned int)(max_bars + 1));
+            if (s % 11 == 3) len = 0;
+            if (s % 11 == 7) len = 2;
+            RandomWalk walk(seed + 17u * (unsigned int)s);
+            for (int i = 0; i < len; ++i) {
+                float h, l;
+                walk.Bar(h, l);
+                highs.push_back(h);
+                lows.push_back(l);
+                closes.push_back((h + l) / 2);
+            }
+            offsets.push_back((int)highs.size());
+        }
+    }
+    
+    chan::BatchInput Input() const {
+        chan::BatchInput in;
+        in.highs = highs.data();
+        in.lows = lows.data();
+        in.closes = closes.data();
+        in.offsets = offsets.data();
+        in.series_count = (int)offsets.size() - 1;
+        return in;
+    }
+};
+
+// 批量输出缓冲（全部输出）
+struct BatchBuffers {
+    std::vector<float> fx, bi, zs_high, zs_low, bc;
+    std::vector<float> signals[(int)chan::SignalOutput::COUNT];
+    std::vector<int> strokes, pivots;
+    
+    BatchBuffers(int bars, int series)
+        : fx(bars, -9.0f), bi(bars, -9.0f), zs_high(bars, -9.0f), zs_low(bars, -9.0f)
+        , bc(bars, -9.0f), strokes(series, -1), pivots(series, -1) {
+        for (auto& sig : signals) sig.assign(bars, -9.0f);
+    }
+    
+    chan::BatchOutput Output() {
+        chan::BatchOutput out;
+        out.fx = fx.data();
+        out.bi = bi.data();
+        out.zs_high = zs_high.data();
+        out.zs_low = zs_low.data();
+        out.bc = bc.data();
+        for (int k = 0; k < (int)chan::SignalOutput::COUNT; ++k) {
+            out.signals[k] = signals[k].data();
+        }
+        out.stroke_counts = strokes.data();
+        out.pivot_counts = pivots.data();
+        return out;
+    }
+    
+    bool operator==(const BatchBuffers& o) const {
+        for (int k = 0; k < (int)chan::SignalOutput::COUNT; ++k) {
+            if (signals[k] != o.signals[k]) return false;
+        }
+        return fx == o.fx && bi == o.bi && zs_high == o.zs_high && zs_low == o.zs_low && bc == o.bc &&
+               strokes == o.strokes && pivots == o.pivots;
+    }
+};
+
+// 逐标的单线程分析（每个标的独立的 ChanCore），作为批量结果的基准
+static void AnalyzeBatchSequential(const RaggedBatch& batch, const chan::ChanConfig& config,
+                                   BatchBuffers& buf) {
+    for (int s = 0; s + 1 < (int)batch.offsets.size(); ++s) {
+        int off = batch.offsets[s];
+        int n = batch.offsets[s + 1] - off;
+        chan::ChanCore core;
+        core.SetConfig(config);
+        if (n > 0) {
+            core.Analyze(&batch.highs[off], &batch.lows[off], &batch.closes[off], nullptr, n);
+        }
+        buf.strokes[s] = (int)core.GetStrokes().size();
+        buf.pivots[s] = (int)core.GetPivots().size();
+        if (n == 0) continue;
+        
+        core.OutputFX(&buf.fx[off], n);
+        core.OutputBI(&buf.bi[off], n);
+        core.OutputZS_H(&buf.zs_high[off], n);
+        core.OutputZS_L(&buf.zs_low[off], n);
+        core.OutputBC(&buf.bc[off], n);
+        core.ComputeMAData(&batch.closes[off], n);
+        core.BuildBiSequence(n - 1);
+        for (int k = 0; k < (int)chan::SignalOutput::COUNT; ++k) {
+            OutputSignalDirect(core, (chan::SignalOutput)k, &buf.signals[k][off], n,
+                               &batch.highs[off], &batch.lows[off]);
+        }
+    }
+}
+
+// ----------------------------------------------------------------------------
+// 测试49: 批量分析 - 变长批次、不同线程数的结果与逐标的分析一致
+// ----------------------------------------------------------------------------
+TEST_CASE(BatchAnalyzer_MatchesSequential) {
+    RaggedBatch batch(61, 3000, 49);
+    int bars = (int)batch.highs.size();
+    int series = (int)batch.offsets.size() - 1;
+    
+    chan::ChanConfig config;
+    config.min_bi_len = 4;
+    BatchBuffers expected(bars, series);
+    AnalyzeBatchSequential(batch, config, expected);
+    
+    const int thread_counts[] = {1, 3, 8};
+    for (int threads : thread_counts) {
+        chan::ChanBatchAnalyzer analyzer(threads);
+        analyzer.SetConfig(config);
+        ASSERT_EQ(analyzer.GetThreadCount(), threads);
+        
+        // 同一分析器连续两批，验证复用的 ChanCore 不残留上一批状态
+        for (int round = 0; round < 2; ++round) {
+            BatchBuffers buf(bars, series);
+            chan::BatchOutput out = buf.Output();
+            ASSERT_EQ(analyzer.Run(batch.Input(), out), series);
+            REQUIRE(buf == expected);
+            
+            const chan::BatchStats& stats = analyzer.GetLastStats();
+            ASSERT_EQ(stats.series, series);
+            ASSERT_EQ(stats.bars, bars);
+            ASSERT_EQ(stats.threads, threads);
+        }
+    }
+    
+    // 只请求部分输出；信号需要收盘价
+    chan::ChanBatchAnalyzer analyzer(2);
+    analyzer.SetConfig(config);
+    std::vector<float> bi(bars, -9.0f);
+    chan::BatchOutput partial;
+    partial.bi = bi.data();
+    chan::BatchInput in = batch.Input();
+    in.closes = nullptr;
+    ASSERT_EQ(analyzer.Run(in, partial), series);
+    REQUIRE(bi == expected.bi);
+    
+    partial.signals[(int)chan::SignalOutput::BUYX] = bi.data();
+    ASSERT_EQ(analyzer.Run(in, partial), -1);
+    
+    chan::BatchInput empty;
+    ASSERT_EQ(analyzer.Run(empty, partial), -1);
+}
+
+// ----------------------------------------------------------------------------
+// 测试50: 批量分析扩展性 - 1到N线程的全市场扫描耗时
+// ----------------------------------------------------------------------------
+TEST_CASE(BatchAnalyzer_Scaling) {
+    // 约相当于 500 只股票 x 1000 根日线
+    RaggedBatch batch(500, 2000, 50);
+    int bars = (int)batch.highs.size();
+    int series = (int)batch.offsets.size() - 1;
+    
+    int hw = (int)std::thread::hardware_concurrency();
+    int max_threads = std::max(4, hw);
+    
+    BatchBuffers reference(bars, series);
+    int64_t single_us = 0;
+    int64_t best_multi_us = 0;
+    std::cout << "\n  " << series << "只标的, " << bars << "根K线, CPU核数=" << hw;
+    for (int threads = 1; threads <= max_threads; threads *= 2) {
+        chan::ChanBatchAnalyzer analyzer(threads);
+        BatchBuffers buf(bars, series);
+        chan::BatchOutput out = buf.Output();
+        analyzer.Run(batch.Input(), out);
+        
+        const chan::BatchStats& stats = analyzer.GetLastStats();
+        std::cout << "\n  线程=" << threads << ": " << stats.elapsed_us << " us"
+                  << ", 窃取=" << stats.steals;
+        if (threads == 1) {
+            reference = buf;
+            single_us = stats.elapsed_us;
+        } else {
+            REQUIRE(buf == reference);
+            if (threads <= hw && (best_multi_us == 0 || stats.elapsed_us < best_multi_us)) {
+                best_multi_us = stats.elapsed_us;
+            }
+        }
+    }
+    
+    // 多核机器上并行须明显快于单线程
+    if (hw >= 4) {
+        REQUIRE(best_multi_us * 2 < single_us);
+    }
+}
+
+// ----------------------------------------------------------------------------
+// 测试51: INI 解析 - 与 GetPrivateProfileInt 语义一致，不依赖平台
+// ----------------------------------------------------------------------------
+TEST_CASE(IniFile_Parse) {
+    chan::IniFile ini;
+    ini.Parse("\xEF\xBB\xBF; 注释\r\n"
+              "[General]\r\n"
+              "MinBiLength = 4\r\n"
+              "StrictBi=false\n"
+              "EnablePreSignal=0\n"
+              "MinBiLength=9\n"
+              "# 另一种注释\n"
+              "[ firstbuy ]\n"
+              "MAPeriod=21 ; 行尾说明\n"
+              "Ratio=0.618\n"
+              "Bad=abc\n");
+    
+    // 节名/键名不区分大小写，重复键取第一个
+    ASSERT_EQ(ini.GetInt("general", "minbilength", 5), 4);
+    ASSERT_TRUE(!ini.GetBool("General", "StrictBi", true));
+    ASSERT_TRUE(!ini.GetBool("General", "EnablePreSignal", true));
+    ASSERT_EQ(ini.GetInt("FirstBuy", "MAPeriod", 13), 21);
+    ASSERT_FLOAT_EQ(ini.GetFloat("FirstBuy", "Ratio", 0.0f), 0.618f);
+    
+    // 缺失或非数字时取默认值
+    ASSERT_EQ(ini.GetInt("FirstBuy", "Bad", 7), 7);
+    ASSERT_EQ(ini.GetInt("SecondBuy", "MAPeriod", 26), 26);
+    ASSERT_TRUE(ini.GetBool("General", "Missing", true));
+    REQUIRE(ini.Find("General", "Missing") == nullptr);
+    
+    // 配置文件不存在时使用默认配置
+    chan::ConfigReader reader;
+    REQUIRE(!reader.LoadConfig("__no_such_dir__/CZSC.ini"));
+    ASSERT_EQ(reader.ToChanConfig().min_bi_len, 5);
+}
+
+// ----------------------------------------------------------------------------
+// 测试52: 通达信数据文件 - 内存映射读取 .day/.lc5，SSE2与标量解码逐位一致
+// ----------------------------------------------------------------------------
+
+// 按通达信格式写一条32字节记录
+static void PackTdxRecord(unsigned char* rec, uint32_t head, const uint32_t prices[4],
+                          float amount, uint32_t volume) {
+    memcpy(rec, &head, 4);
+    memcpy(rec + 4, prices, 16);
+    memcpy(rec + 20, &amount, 4);
+    memcpy(rec + 24, &volume, 4);
+    memset(rec + 28, 0, 4);
+}
+
+static void WriteBytes(const std::string& path, const std::vector<unsigned char>& bytes) {
+    FILE* fp = fopen(path.c_str(), "wb");
+    REQUIRE(fp != nullptr);
+    if (!bytes.empty()) {
+        fwrite(bytes.data(), 1, bytes.size(), fp);
+    }
+    fclose(fp);
+}
+
+static bool SameBits(const std::vector<float>& a, const std::vector<float>& b) {
+    return a.size() == b.size() &&
+           (a.empty() || memcmp(a.data(), b.data(), a.size() * sizeof(float)) == 0);
+}
+
+TEST_CASE(TdxReader_DayAndMinuteFiles) {
+    // 日线：7条（覆盖4条一组与尾部），最后追加不完整的半条记录
+    const int DAYS = 7;
+    std::vector<unsigned char> day(DAYS * chan::TDX_RECORD_SIZE + 10, 0xCD);
+    for (int i = 0; i < DAYS; ++i) {
+        uint32_t prices[4] = {1000u + i, 1100u + i, 950u + i, 1050u + i};
+        uint32_t volume = i == 6 ? 0xFFFFFFFFu : 123456u * (i + 1);
+        PackTdxRecord(&day[i * chan::TDX_RECORD_SIZE], 20240102 + i, prices, 1e7f, volume);
+    }
+    
+    // 5分钟线：5条，2024-03-15 09:35 起
+    const int MINS = 5;
+    std::vector<unsigned char> lc5(MINS * chan::TDX_RECORD_SIZE);
+    uint16_t packed_date = (uint16_t)((2024 - 2004) * 2048 + 3 * 100 + 15);
+    for (int i = 0; i < MINS; ++i) {
+        float p[4] = {10.5f + i, 10.8f + i, 10.2f + i, 10.6f + i};
+        uint32_t prices[4];
+        memcpy(prices, p, sizeof(p));
+        uint32_t head = packed_date | ((uint32_t)(9 * 60 + 35 + 5 * i) << 16);
+        PackTdxRecord(&lc5[i * chan::TDX_RECORD_SIZE], head, prices, 5e5f, 1000u * (i + 1));
+    }
+    
+    const std::string day_path = "test_tdx_reader_sh600000.day";
+    const std::string lc5_path = "test_tdx_reader_sh600000.LC5";
+    WriteBytes(day_path, day);
+    WriteBytes(lc5_path, lc5);
+    
+    ASSERT_TRUE(chan::DetectTdxFileType(day_path) == chan::TdxFileType::DAY);
+    ASSERT_TRUE(chan::DetectTdxFileType(lc5_path) == chan::TdxFileType::LC5);
+    ASSERT_TRUE(chan::DetectTdxFileType("a.lc1") == chan::TdxFileType::LC1);
+    ASSERT_TRUE(chan::DetectTdxFileType("a.csv") == chan::TdxFileType::UNKNOWN);
+    ASSERT_EQ(chan::DecodeTdxMinuteDate(packed_date), 20240315);
+    
+    chan::TdxBars bars;
+    REQUIRE(chan::LoadTdxFile(day_path, bars));
+    ASSERT_EQ(bars.Count(), DAYS);
+    for (int i = 0; i < DAYS; ++i) {
+        ASSERT_EQ(bars.dates[i], 20240102 + i);
+        ASSERT_EQ(bars.times[i], 0);
+        ASSERT_FLOAT_EQ(bars.opens[i], 10.00f + i * 0.01f);
+        ASSERT_FLOAT_EQ(bars.highs[i], 11.00f + i * 0.01f);
+        ASSERT_FLOAT_EQ(bars.lows[i], 9.50f + i * 0.01f);
+        ASSERT_FLOAT_EQ(bars.closes[i], 10.50f + i * 0.01f);
+    }
+    ASSERT_FLOAT_EQ(bars.volumes[0], 123456.0f);
+    ASSERT_TRUE(bars.volumes[6] == 4294967296.0f);   // 无符号成交量不溢出为负
+    
+    // 两个文件一次加载，中间夹一个不存在的文件
+    std::vector<std::string> paths = {day_path, "__no_such__.day", lc5_path};
+    ASSERT_EQ(chan::LoadTdxFiles(paths, bars), 2);
+    ASSERT_EQ((int)bars.offsets.size(), 4);
+    ASSERT_EQ(bars.offsets[1], DAYS);
+    ASSERT_EQ(bars.offsets[2], DAYS);
+    ASSERT_EQ(bars.offsets[3], DAYS + MINS);
+    for (int i = 0; i < MINS; ++i) {
+        int k = DAYS + i;
+        ASSERT_EQ(bars.dates[k], 20240315);
+        ASSERT_EQ(bars.times[k], 9 * 60 + 35 + 5 * i);
+        ASSERT_TRUE(bars.highs[k] == 10.8f + i);
+        ASSERT_TRUE(bars.lows[k] == 10.2f + i);
+        ASSERT_TRUE(bars.closes[k] == 10.6f + i);
+        ASSERT_TRUE(bars.volumes[k] == 1000.0f * (i + 1));
+    }
+    
+    // 读出的列可直接分析
+    chan::ChanCore core;
+    core.Analyze(bars.highs.data(), bars.lows.data(), bars.closes.data(),
+                 bars.volumes.data(), DAYS);
+    
+    // 空文件、不存在的文件
+    WriteBytes(day_path, std::vector<unsigned char>());
+    REQUIRE(chan::LoadTdxFile(day_path, bars));
+    ASSERT_EQ(bars.Count(), 0);
+    REQUIRE(!chan::LoadTdxFile("__no_such__.day", bars));
+    REQUIRE(!chan::LoadTdxFile("__no_such__.txt", bars));
+    remove(day_path.c_str());
+    remove(lc5_path.c_str());
+    
+    // 随机记录：SSE2 与标量路径逐位一致（含各种尾部长度与大成交量）
+    std::mt19937 rng(52);
+    const chan::TdxFileType types[] = {chan::TdxFileType::DAY, chan::TdxFileType::LC1};
+    for (chan::TdxFileType type : types) {
+        for (int count = 0; count <= 37; ++count) {
+            std::vector<unsigned char> rec(count * chan::TDX_RECORD_SIZE + 1);
+            for (auto& b : rec) b = (unsigned char)rng();
+            // 分钟线价格保持为有限浮点数
+            if (type == chan::TdxFileType::LC1) {
+                for (int i = 0; i < count; ++i) {
+                    for (int k = 0; k < 4; ++k) {
+                        float p = (float)(rng() % 100000) / 100.0f;
+                        memcpy(&rec[1 + i * chan::TDX_RECORD_SIZE + 4 + 4 * k], &p, 4);
+                    }
+                }
+            }
+            
+            chan::TdxBars a, b;
+            a.opens.resize(count); a.highs.resize(count); a.lows.resize(count);
+            a.closes.resize(count); a.volumes.resize(count);
+            a.dates.resize(count); a.times.resize(count);
+            b = a;
+            chan::TdxColumns ca, cb;
+            ca.opens = a.opens.data(); ca.highs = a.highs.data(); ca.lows = a.lows.data();
+            ca.closes = a.closes.data(); ca.volumes = a.volumes.data();
+            ca.dates = a.dates.data(); ca.times = a.times.data();
+            cb.opens = b.opens.data(); cb.highs = b.highs.data(); cb.lows = b.lows.data();
+            cb.closes = b.closes.data(); cb.volumes = b.volumes.data();
+            cb.dates = b.dates.data(); cb.times = b.times.data();
+            
+            // 记录地址不对齐
+            chan::DecodeTdxRecords(rec.data() + 1, count, type, 0.001f, ca, true);
+            chan::DecodeTdxRecords(rec.data() + 1, count, type, 0.001f, cb, false);
+            REQUIRE(SameBits(a.opens, b.opens));
+            REQUIRE(SameBits(a.highs, b.highs));
+            REQUIRE(SameBits(a.lows, b.lows));
+            REQUIRE(SameBits(a.closes, b.closes));
+            REQUIRE(SameBits(a.volumes, b.volumes));
+            REQUIRE(a.dates == b.dates);
+            REQUIRE(a.times == b.times);
+            for (int i = 0; i < count; ++i) {
+                uint32_t v;
+                memcpy(&v, &rec[1 + i * chan::TDX_RECORD_SIZE + 24], 4);
+                REQUIRE(a.volumes[i] == (float)v);
+            }
+        }
+    }
+}
+
+// ----------------------------------------------------------------------------
+// 测试53: 通达信数据解码性能 - 百万条日线记录
+// ----------------------------------------------------------------------------
+TEST_CASE(TdxReader_DecodePerformance_1M) {
+    const int SIZE = 1000000;
+    std::vector<unsigned char> rec((size_t)SIZE * chan::TDX_RECORD_SIZE);
+    RandomWalk walk(53);
+    for (int i = 0; i < SIZE; ++i) {
+        float h, l;
+        walk.Bar(h, l);
+        uint32_t prices[4] = {(uint32_t)(l * 100), (uint32_t)(h * 100),
+                              (uint32_t)(l * 100), (uint32_t)(h * 100)};
+        PackTdxRecord(&rec[(size_t)i * chan::TDX_RECORD_SIZE], 20000101 + i % 10000,
+                      prices, 1e8f, (uint32_t)i * 997u);
+    }
+    
+    std::vector<float> highs(SIZE), lows(SIZE), closes(SIZE), volumes(SIZE);
+    std::vector<float> ref_highs(SIZE), ref_lows(SIZE), ref_closes(SIZE), ref_volumes(SIZE);
+    chan::TdxColumns out, ref;
+    out.highs = highs.data(); out.lows = lows.data();
+    out.closes = closes.data(); out.volumes = volumes.data();
+    ref.highs = ref_highs.data(); ref.lows = ref_lows.data();
+    ref.closes = ref_closes.data(); ref.volumes = ref_volumes.data();
+    
+    auto t0 = std::chrono::high_resolution_clock::now();
+    chan::DecodeTdxRecords(rec.data(), SIZE, chan::TdxFileType::DAY, 0.01f, ref, false);
+    auto t1 = std::chrono::high_resolution_clock::now();
+    chan::DecodeTdxRecords(rec.data(), SIZE, chan::TdxFileType::DAY, 0.01f, out, true);
+    auto t2 = std::chrono::high_resolution_clock::now();
+    
+    auto scalar_us = std::chrono::duration_cast<std::chrono::microseconds>(t1 - t0).count();
+    auto simd_us = std::chrono::duration_cast<std::chrono::microseconds>(t2 - t1).count();
+    double mb = (double)rec.size() / (1024.0 * 1024.0);
+    std::cout << "\n  标量=" << scalar_us << " us"
+              << ", SSE2=" << simd_us << " us ("
+              << (int)(mb * 1e6 / std::max<int64_t>(simd_us, 1)) << " MB/s)";
+    
+    REQUIRE(SameBits(highs, ref_highs));
+    REQUIRE(SameBits(lows, ref_lows));
+    REQUIRE(SameBits(closes, ref_closes));
+    REQUIRE(SameBits(volumes, ref_volumes));
+}
+
+// ----------------------------------------------------------------------------
+// 测试54: 延迟直方图 - 桶边界连续、分位数误差不超过一个子桶、并发记录不丢
+// ----------------------------------------------------------------------------
+TEST_CASE(LatencyHistogram_Percentiles) {
+    typedef chan::LatencyHistogram Histogram;
+    
+    // 桶首尾相接，覆盖全部 uint64 取值
+    ASSERT_EQ((int)Histogram::BucketLower(0), 0);
+    for (int i = 1; i < Histogram::BUCKET_COUNT; ++i) {
+        REQUIRE(Histogram::BucketLower(i) == Histogram::BucketUpper(i - 1) + 1);
+    }
+    REQUIRE(Histogram::BucketUpper(Histogram::BUCKET_COUNT - 1) == ~0ull);
+    const uint64_t probes[] = {0, 7, 8, 9, 15, 16, 1000, 123456789, ~0ull};
+    for (uint64_t v : probes) {
+        int b = Histogram::BucketIndex(v);
+        REQUIRE(Histogram::BucketLower(b) <= v && v <= Histogram::BucketUpper(b));
+    }
+    
+    // 1..100000 均匀分布：分位数落在真值的 12.5% 以内
+    Histogram h;
+    ASSERT_EQ((int)h.Percentile(0.5), 0);
+    for (uint64_t v = 1; v <= 100000; ++v) {
+        h.Record(v);
+    }
+    ASSERT_EQ((int)h.Count(), 100000);
+    ASSERT_EQ((int)h.Max(), 100000);
+    REQUIRE(h.Sum() == 100000ull * 100001ull / 2);
+    const double qs[] = {0.5, 0.9, 0.99};
+    for (double q : qs) {
+        double truth = q * 100000;
+        double got = (double)h.Percentile(q);
+        REQUIRE(got >= truth && got <= truth * 1.125);
+    }
+    ASSERT_EQ((int)h.Percentile(1.0), 100000);
+    
+    // 多线程同时记录
+    Histogram shared;
+    const int THREADS = 4, PER_THREAD = 50000;
+    std::vector<std::thread> threads;
+    for (int t = 0; t < THREADS; ++t) {
+        threads.emplace_back([&shared, t] {
+            for (int i = 0; i < PER_THREAD; ++i) {
+                shared.Record((uint64_t)(i % 1000) * (t + 1));
+            }
+        });
+    }
+    for (auto& th : threads) th.join();
+    ASSERT_EQ((int)shared.Count(), THREADS * PER_THREAD);
+    ASSERT_EQ((int)shared.Max(), 999 * THREADS);
+    
+    h.Reset();
+    ASSERT_EQ((int)h.Count(), 0);
+    ASSERT_EQ((int)h.Percentile(0.99), 0);
+}
+
+// ----------------------------------------------------------------------------
+// 测试55: 性能计数注册表 - 命中/冗余统计、快照与报表、记录开销
+// ----------------------------------------------------------------------------
+TEST_CASE(PerfRegistry_CountersAndOverhead) {
+    chan::PerfRegistry perf(1000);
+    int fx = perf.Register("CHAN_FX", chan::PerfKind::EXPORT);
+    int analyze = perf.Register("stage.analyze", chan::PerfKind::STAGE);
+    ASSERT_EQ(fx, 0);
+    ASSERT_EQ(analyze, 1);
+    ASSERT_EQ(perf.Register("CHAN_FX", chan::PerfKind::EXPORT), fx);
+    ASSERT_EQ(perf.Find("stage.analyze"), analyze);
+    ASSERT_EQ(perf.Find("missing"), -1);
+    
+    // 冗余：同一数据键在时间窗内再次出现
+    const uint64_t ms = 1000000ull;
+    REQUIRE(!perf.CheckRedundant(fx, 42, 1 * ms));
+    REQUIRE(perf.CheckRedundant(fx, 42, 500 * ms));
+    REQUIRE(!perf.CheckRedundant(fx, 43, 600 * ms));      // 数据变化
+    REQUIRE(!perf.CheckRedundant(fx, 43, 1700 * ms));     // 超出时间窗
+    perf.RecordCache(fx, false);
+    perf.RecordCache(fx, true);
+    perf.RecordCache(fx, true);
+    perf.RecordLatency(fx, 2000);
+    perf.RecordLatency(fx, 4000);
+    perf.RecordLatency(analyze, 1000000);
+    
+    chan::PerfStat stats[4];
+    ASSERT_EQ(perf.Snapshot(stats, 4), 2);
+    REQUIRE(std::string(stats[0].name) == "CHAN_FX");
+    ASSERT_EQ(stats[0].kind, (int)chan::PerfKind::EXPORT);
+    ASSERT_EQ((int)stats[0].calls, 2);
+    ASSERT_EQ((int)stats[0].cache_hits, 2);
+    ASSERT_EQ((int)stats[0].cache_misses, 1);
+    ASSERT_EQ((int)stats[0].redundant, 1);
+    ASSERT_FLOAT_EQ((float)stats[0].total_us, 6.0f);
+    ASSERT_FLOAT_EQ((float)stats[0].mean_us, 3.0f);
+    ASSERT_FLOAT_EQ((float)stats[0].max_us, 4.0f);
+    ASSERT_EQ(stats[1].kind, (int)chan::PerfKind::STAGE);
+    ASSERT_FLOAT_EQ((float)stats[1].p99_us, 1000.0f);
+    
+    std::string report = perf.Format();
+    REQUIRE(report.find("CHAN_FX") != std::string::npos);
+    REQUIRE(report.find("stage.analyze") != std::string::npos);
+    const std::string path = "test_perf_dump.txt";
+    remove(path.c_str());
+    REQUIRE(perf.DumpToFile(path));
+    FILE* f = fopen(path.c_str(), "r");
+    REQUIRE(f != nullptr);
+    fclose(f);
+    remove(path.c_str());
+    
+    // 关闭后不再记录
+    perf.SetEnabled(false);
+    perf.RecordLatency(fx, 1);
+    REQUIRE(!perf.CheckRedundant(fx, 43, 1701 * ms));
+    {
+        chan::PerfTimer timer(perf, fx);
+        ASSERT_EQ((int)timer.StartNs(), 0);
+    }
+    perf.Snapshot(stats, 4);
+    ASSERT_EQ((int)stats[0].calls, 2);
+    perf.SetEnabled(true);
+    
+    perf.Reset();
+    perf.Snapshot(stats, 4);
+    ASSERT_EQ((int)stats[0].calls, 0);
+    ASSERT_EQ((int)stats[0].redundant, 0);
+    ASSERT_EQ(perf.GetSlotCount(), 2);
+    
+    // 每次调用的计数开销：计时 + 命中 + 冗余检测
+    const int CALLS = 1000000;
+    auto t0 = std::chrono::high_resolution_clock::now();
+    for (int i = 0; i < CALLS; ++i) {
+        chan::PerfTimer timer(perf, fx);
+        perf.RecordCache(fx, true);
+        perf.CheckRedundant(fx, (uint64_t)i, timer.StartNs());
+    }
+    auto ns = std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::high_resolution_clock::now() - t0).count();
+    std::cout << "\n  每次调用计数开销=" << ns / CALLS << " ns";
+    perf.Snapshot(stats, 4);
+    ASSERT_EQ((int)stats[0].calls, CALLS);
+    REQUIRE(ns / CALLS < 2000);
+    
+    // 分析缓存报告最近一次查找是否命中
+    chan::AnalysisCache cache;
+    std::vector<float> highs, lows, closes, volumes;
+    MakeSineKlines(2000, highs, lows, closes, volumes);
+    chan::ChanConfig config;
+    cache.AcquireSession(highs.data(), lows.data(), closes.data(), nullptr, 2000, config);
+    REQUIRE(!cache.LastWasHit());
+    uint64_t key = cache.LastKey();
+    cache.AcquireSession(highs.data(), lows.data(), closes.data(), nullptr, 2000, config);
+    REQUIRE(cache.LastWasHit());
+    REQUIRE(cache.LastKey() == key);
+}
+
+// ----------------------------------------------------------------------------
+// 测试56: 异步日志 - 格式与 printf 一致、级别过滤、多线程不丢失、调用开销
+// ----------------------------------------------------------------------------
+static std::mutex g_LogCaptureMutex;
+static std::vector<std::string> g_LogCapture;
+
+static void CaptureSink(chan::LogLevel, const char* message) {
+    std::lock_guard<std::mutex> lock(g_LogCaptureMutex);
+    g_LogCapture.push_back(message);
+}
+
+static void NullSink(chan::LogLevel, const char*) {}
+
+// 去掉时间与级别前缀及换行
+static std::string LogBody(const std::string& line) {
+    size_t pos = line.find("] [");
+    pos = line.find("] ", pos + 2);
+    std::string body = line.substr(pos + 2);
+    while (!body.empty() && (body.back() == '\n' || body.back() == ' ')) body.pop_back();
+    return body.substr(body.find_first_not_of(' '));
+}
+
+static std::vector<std::string> TakeCapturedLogs() {
+    chan::LogFlush();
+    std::lock_guard<std::mutex> lock(g_LogCaptureMutex);
+    std::vector<std::string> lines;
+    lines.swap(g_LogCapture);
+    return lines;
+}
+
+TEST_CASE(AsyncLogger_FormatLevelsThreads) {
+    chan::LogLevel saved_level = chan::LogGetLevel();
+    chan::LogSetSink(CaptureSink);
+    chan::LogSetLevel(chan::LogLevel::LOG_DEBUG);
+    TakeCapturedLogs();
+    
+    // 延迟格式化结果与 snprintf 一致
+    char expected[256];
+    int stack_value = 7;
+    char name[16] = "600519";
+    snprintf(expected, sizeof(expected), "i=%d u=%u ll=%lld x=%08x f=%.3f g=%g s=%s w=[%5s] 100%% p=%p c=%c",
+             -42, 42u, -1234567890123ll, 0xbeefu, 3.14159, 0.25f, name, "ab", (void*)&stack_value, 'Z');
+    CHAN_LOG_INFO("i=%d u=%u ll=%lld x=%08x f=%.3f g=%g s=%s w=[%5s] 100%% p=%p c=%c",
+                  -42, 42u, -1234567890123ll, 0xbeefu, 3.14159, 0.25f, name, "ab", (void*)&stack_value, 'Z');
+    name[0] = 'X';     // 字符串参数提交时已按值复制
+    
+    // 参数不足时说明符原样输出；非常量格式串走立即格式化接口
+    CHAN_LOG_WARN("missing=%d");
+    chan::LogError("%s-%d", "direct", 5);
+    
+    std::vector<std::string> lines = TakeCapturedLogs();
+    ASSERT_EQ((int)lines.size(), 3);
+    REQUIRE(LogBody(lines[0]) == expected);
+    REQUIRE(lines[0].find("[INFO]") != std::string::npos);
+    REQUIRE(lines[0].compare(0, 6, "[CHAN ") == 0);
+    REQUIRE(LogBody(lines[1]) == "missing=%d");
+    REQUIRE(lines[1].find("[WARN]") != std::string::npos);
+    REQUIRE(LogBody(lines[2]) == "direct-5");
+    
+    // 级别过滤
+    chan::LogSetLevel(chan::LogLevel::LOG_WARN);
+    CHAN_LOG_DEBUG("hidden %d", 1);
+    CHAN_LOG_INFO("hidden %d", 2);
+    CHAN_LOG_ERROR("shown %d", 3);
+    lines = TakeCapturedLogs();
+    ASSERT_EQ((int)lines.size(), 1);
+    REQUIRE(LogBody(lines[0]) == "shown 3");
+    
+    // 多线程：每个线程内顺序保持、全部送达（总数小于缓冲容量）
+    chan::LogSetLevel(chan::LogLevel::LOG_DEBUG);
+    uint64_t dropped_before = chan::LogGetDropped();
+    const int THREADS = 4;
+    const int PER_THREAD = 500;
+    std::vector<std::thread> workers;
+    for (int t = 0; t < THREADS; ++t) {
+        workers.emplace_back([t] {
+            for (int i = 0; i < PER_THREAD; ++i) {
+                CHAN_LOG_DEBUG("t%d #%d", t, i);
+            }
+        });
+    }
+    for (auto& w : workers) w.join();
+    lines = TakeCapturedLogs();
+    ASSERT_EQ((int)(chan::LogGetDropped() - dropped_before), 0);
+    ASSERT_EQ((int)lines.size(), THREADS * PER_THREAD);
+    std::vector<int> next(THREADS, 0);
+    for (const std::string& line : lines) {
+        int t = -1, i = -1;
+        REQUIRE(sscanf(LogBody(line).c_str(), "t%d #%d", &t, &i) == 2);
+        REQUIRE(t >= 0 && t < THREADS);
+        ASSERT_EQ(i, next[t]);
+        next[t]++;
+    }
+    
+    // 调用线程开销：打开 DEBUG 时只写缓冲，关闭时只做级别判断
+    chan::LogSetSink(NullSink);
+    const int CALLS = 2000;
+    auto t0 = std::chrono::high_resolution_clock::now();
+    for (int i = 0; i < CALLS; ++i) {
+        CHAN_LOG_DEBUG("bar=%d high=%.2f low=%.2f code=%s", i, 10.5 + i, 9.5 + i, "600519");
+    }
+    auto enabled_ns = std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::high_resolution_clock::now() - t0).count() / CALLS;
+    chan::LogFlush();
+    
+    chan::LogSetLevel(chan::LogLevel::LOG_ERROR);
+    const int DISABLED_CALLS = 1000000;
+    t0 = std::chrono::high_resolution_clock::now();
+    for (int i = 0; i < DISABLED_CALLS; ++i) {
+        CHAN_LOG_DEBUG("bar=%d high=%.2f", i, 10.5 + i);
+    }
+    auto disabled_ns = std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::high_resolution_clock::now() - t0).count() / DISABLED_CALLS;
+    std::cout << "\n  DEBUG开启每条=" << enabled_ns << " ns, 关闭每条=" << disabled_ns << " ns";
+    REQUIRE(enabled_ns < 20000);
+    REQUIRE(disabled_ns < 50);
+    
+    chan::LogSetSink(nullptr);
+    chan::LogSetLevel(saved_level);
+}
+
+// ----------------------------------------------------------------------------
+// 测试57: 线段识别 - 特征序列分型的两种情况
+// ----------------------------------------------------------------------------
+
+// 按转折点生成折线K线：每段 bars_per_leg 根，单调无包含，每段成一笔
+static void MakeZigzagKlines(const std::vector<float>& points, int bars_per_leg,
+                             std::vector<float>& highs, std::vector<float>& lows) {
+    highs.clear();
+    lows.clear();
+    // 开头两根K线从上方落到第一个转折点，使其成为分型
+    float lead = points[1] > points[0] ? 1.0f : -1.0f;
+    for (int k = 2; k >= 1; --k) {
+        float p = points[0] + lead * k;
+        highs.push_back(p + 0.5f);
+        lows.push_back(p - 0.5f);
+    }
+    for (size_t i = 0; i + 1 < points.size(); ++i) {
+        for (int k = 0; k < bars_per_leg; ++k) {
+            float p = points[i] + (points[i + 1] - points[i]) * k / bars_per_leg;
+            highs.push_back(p + 0.5f);
+            lows.push_back(p - 0.5f);
+        }
+    }
+    // 结尾两根K线离开最后一个转折点
+    float last = points.back();
+    float tail = points[points.size() - 2] > last ? 1.0f : -1.0f;
+    highs.push_back(last + 0.5f);
+    lows.push_back(last - 0.5f);
+    for (int k = 1; k <= 2; ++k) {
+        highs.push_back(last + tail * k + 0.5f);
+        lows.push_back(last + tail * k - 0.5f);
+    }
+}
+
+static chan::ChanCore AnalyzeZigzag(const std::vector<float>& points) {
+    std::vector<float> highs, lows;
+    MakeZigzagKlines(points, 6, highs, lows);
+    chan::ChanCore core;
+    core.Analyze(highs.data(), lows.data(), nullptr, nullptr, (int)highs.size());
+    return core;
+}
+
+TEST_CASE(Segment_FeatureSequenceCases) {
+    // 第一种情况（无缺口）：向上5笔 10->30，向下5笔 30->17，随后向上笔确认底
+    std::vector<float> points = {10, 20, 16, 26, 22, 30, 24, 27, 20, 25, 17, 23, 19, 26};
+    chan::ChanCore core = AnalyzeZigzag(points);
+    ASSERT_EQ((int)core.GetStrokes().size(), (int)points.size() - 1);
+    
+    auto segs = core.GetSegments();
+    ASSERT_EQ((int)segs.size(), 2);
+    REQUIRE(segs[0].direction == chan::Direction::UP);
+    ASSERT_EQ(segs[0].start_stroke_id, 0);
+    ASSERT_EQ(segs[0].end_stroke_id, 4);
+    ASSERT_EQ(segs[0].stroke_count, 5);
+    ASSERT_FLOAT_EQ(segs[0].low, 9.5f);
+    ASSERT_FLOAT_EQ(segs[0].high, 30.5f);
+    REQUIRE(segs[1].direction == chan::Direction::DOWN);
+    ASSERT_EQ(segs[1].start_stroke_id, 5);
+    ASSERT_EQ(segs[1].end_stroke_id, 9);
+    ASSERT_FLOAT_EQ(segs[1].low, 16.5f);
+    ASSERT_EQ(segs[1].start_idx, segs[0].end_idx);
+    ASSERT_EQ(segs[0].start_idx, core.GetStrokes()[0].start_idx);
+    
+    // 输出：端点处为价格
+    int n = core.GetRawCount();
+    std::vector<float> out(n, -1.0f);
+    core.OutputDUAN(out.data(), n);
+    int marks = 0;
+    for (int i = 0; i < n; ++i) {
+        if (out[i] != 0) ++marks;
+    }
+    ASSERT_EQ(marks, 3);
+    ASSERT_FLOAT_EQ(out[segs[0].end_idx], 30.5f);
+    ASSERT_FLOAT_EQ(out[segs[1].end_idx], 16.5f);
+    
+    // 确认底的向上笔出现之前，向下段尚未结束
+    points.resize(points.size() - 2);
+    ASSERT_EQ((int)AnalyzeZigzag(points).GetSegments().size(), 1);
+    
+    // 第二种情况（有缺口）：顶 34 的第一元素 [22,26] 与第二元素 [28,34] 间有缺口，
+    // 顶分型成立后还需新段特征序列（向上笔）出现底分型
+    std::vector<float> gap_points = {10, 20, 16, 26, 22, 34, 28, 31, 25, 29, 27, 32, 30};
+    chan::ChanCore gap_core = AnalyzeZigzag(gap_points);
+    auto gap_segs = gap_core.GetSegments();
+    ASSERT_EQ((int)gap_segs.size(), 2);
+    ASSERT_EQ(gap_segs[0].end_stroke_id, 4);
+    ASSERT_FLOAT_EQ(gap_segs[0].high, 34.5f);
+    std::vector<float> partial(gap_points.begin(), gap_points.begin() + 10);
+    ASSERT_EQ((int)AnalyzeZigzag(partial).GetSegments().size(), 0);
+    
+    // 无缺口时同样走势在第三元素出现时即确认
+    std::vector<float> no_gap = {10, 20, 16, 26, 22, 34, 27, 31, 25, 29};
+    ASSERT_EQ((int)AnalyzeZigzag(no_gap).GetSegments().size(), 1);
+    
+    // 确认前跌破起点：已满3笔的向上段在极值处结束；
+    // 新的向下段不足3笔即被升破起点，则视为上一段延伸（替换末端点）
+    std::vector<float> broken = {10, 20, 16, 26, 22, 30, 24, 27, 20, 25, 17, 23, 19, 26, 12};
+    chan::ChanCore broken_core = AnalyzeZigzag(broken);
+    auto broken_segs = broken_core.GetSegments();
+    ASSERT_EQ((int)broken_segs.size(), 3);
+    ASSERT_EQ(broken_segs[2].end_stroke_id, 12);
+    ASSERT_FLOAT_EQ(broken_segs[2].high, 26.5f);
+    broken.push_back(28);
+    chan::ChanCore extended_core = AnalyzeZigzag(broken);
+    auto extended = extended_core.GetSegments();
+    ASSERT_EQ((int)extended.size(), 3);
+    ASSERT_EQ(extended[2].start_stroke_id, 10);
+    ASSERT_EQ(extended[2].end_stroke_id, 14);
+    ASSERT_FLOAT_EQ(extended[2].high, 28.5f);
+}
+
+// ----------------------------------------------------------------------------
+// 测试58: 线段识别 - 随机走势不变式、流式一致与耗时
+// ----------------------------------------------------------------------------
+TEST_CASE(Segment_InvariantsAndPerformance) {
+    RandomWalk walk(4242u);
+    const int SIZE = 20000;
+    std::vector<float> highs(SIZE), lows(SIZE);
+    for (int i = 0; i < SIZE; ++i) {
+        walk.Bar(highs[i], lows[i]);
+    }
+    chan::ChanConfig config;
+    config.min_bi_len = 3;
+    config.min_fx_distance = 0;
+    chan::ChanCore core(config);
+    core.Analyze(highs.data(), lows.data(), nullptr, nullptr, SIZE);
+    
+    auto strokes = core.GetStrokeSoA();
+    auto segs = core.GetSegments();
+    REQUIRE(segs.size() > 20);
+    for (size_t k = 0; k < segs.size(); ++k) {
+        chan::Segment seg = segs[k];
+        ASSERT_EQ(seg.id, (int)k);
+        REQUIRE(seg.stroke_count >= 3);
+        ASSERT_EQ(seg.stroke_count, seg.end_stroke_id - seg.start_stroke_id + 1);
+        REQUIRE(seg.start_idx < seg.end_idx);
+        if (k > 0) {
+            // 首尾相接、方向交替
+            ASSERT_EQ(seg.start_stroke_id, segs[k - 1].end_stroke_id + 1);
+            ASSERT_EQ(seg.start_idx, segs[k - 1].end_idx);
+            REQUIRE(seg.direction != segs[k - 1].direction);
+        }
+        // 终点为段内极值
+        for (int s = seg.start_stroke_id; s <= seg.end_stroke_id; ++s) {
+            if (seg.direction == chan::Direction::UP) {
+                REQUIRE(strokes.high[s] <= seg.high);
+            } else {
+                REQUIRE(strokes.low[s] >= seg.low);
+            }
+        }
+    }
+    
+    // 单独调用与 Analyze 结果一致
+    chan::ChanCore again(config);
+    again.Analyze(highs.data(), lows.data(), nullptr, nullptr, SIZE);
+    ASSERT_EQ(again.CheckDUAN(), (int)segs.size());
+    REQUIRE(SameAnalysis(core, again));
+    
+    // 流式追加每根K线，线段与完整分析一致（结果比较含线段）
+    REQUIRE(StreamMatchesAnalyze(config, 31337u, 3000));
+    
+    // 线段识别相对笔识别的耗时
+    std::vector<float> big_highs, big_lows, closes, volumes;
+    MakeSineKlines(1000000, big_highs, big_lows, closes, volumes);
+    for (int i = 0; i < 1000000; ++i) {
+        float noise = (float)((i * 7919u) % 13u) * 0.3f;
+        big_highs[i] += noise;
+        big_lows[i] += noise;
+    }
+    chan::ChanCore big(config);
+    big.Analyze(big_highs.data(), big_lows.data(), nullptr, nullptr, 1000000);
+    auto t0 = std::chrono::high_resolution_clock::now();
+    big.CheckBI();
+    auto t1 = std::chrono::high_resolution_clock::now();
+    int seg_count = big.CheckDUAN();
+    auto t2 = std::chrono::high_resolution_clock::now();
+    auto bi_us = std::chrono::duration_cast<std::chrono::microseconds>(t1 - t0).count();
+    auto duan_us = std::chrono::duration_cast<std::chrono::microseconds>(t2 - t1).count();
+    std::cout << "\n  1M K线: 笔=" << big.GetStrokes().size() << " (" << bi_us << " us), 线段="
+              << seg_count << " (" << duan_us << " us)";
+    // O(S)：与笔识别同量级
+    REQUIRE(duan_us <= bi_us * 4 + 5000);
+}
+
+// ----------------------------------------------------------------------------
+// 测试59: 多级别中枢 - 线段中枢与逐级升级、流式一致与耗时
+// ----------------------------------------------------------------------------
+TEST_CASE(PivotLevels_RecursiveUpgrade) {
+    RandomWalk walk(4242u);
+    const int SIZE = 20000;
+    std::vector<float> highs(SIZE), lows(SIZE);
+    for (int i = 0; i < SIZE; ++i) {
+        walk.Bar(highs[i], lows[i]);
+    }
+    chan::ChanConfig config;
+    config.min_bi_len = 3;
+    config.min_fx_distance = 0;
+    chan::ChanCore core(config);
+    core.Analyze(highs.data(), lows.data(), nullptr, nullptr, SIZE);
+    
+    int max_level = core.GetMaxPivotLevel();
+    REQUIRE(max_level >= 2);
+    REQUIRE(&core.GetPivots(0) == &core.GetPivots());
+    REQUIRE(core.GetPivots(max_level + 1).empty());
+    REQUIRE(core.GetPivots(-1).empty());
+    
+    auto segs = core.GetSegments();
+    std::vector<bool> seg_start(core.GetStrokes().size() + 1, false);
+    for (const auto& seg : segs) {
+        seg_start[seg.start_stroke_id] = true;
+    }
+    
+    for (int level = 1; level <= max_level; ++level) {
+        const auto& pivots = core.GetPivots(level);
+        const auto& below = core.GetPivots(level - 1);
+        REQUIRE(!pivots.empty());
+        // 升级中枢至少包含两个下级中枢，逐级减半
+        if (level >= 2) {
+            REQUIRE(pivots.size() * 2 <= below.size());
+        }
+        for (size_t i = 0; i < pivots.size(); ++i) {
+            const chan::Pivot& p = pivots[i];
+            ASSERT_EQ(p.level, level);
+            ASSERT_EQ(p.id, (int)i);
+            REQUIRE(p.ZG > p.ZD && p.GG >= p.ZG && p.DD <= p.ZD);
+            ASSERT_EQ(p.stroke_count, p.end_stroke_id - p.start_stroke_id + 1);
+            REQUIRE(p.start_idx < p.end_idx);
+            if (i > 0) {
+                REQUIRE(p.start_stroke_id > pivots[i - 1].end_stroke_id);
+            }
+            if (level == 1) {
+                // 起止于线段端点
+                REQUIRE(!p.is_upgraded);
+                REQUIRE(seg_start[p.start_stroke_id]);
+                REQUIRE(p.end_stroke_id + 1 == (int)core.GetStrokes().size() ||
+                        seg_start[p.end_stroke_id + 1] ||
+                        p.end_stroke_id == segs.back().end_stroke_id);
+            } else {
+                // 由波动区间重叠的下级中枢组成
+                REQUIRE(p.is_upgraded);
+                int parts = 0;
+                for (const auto& q : below) {
+                    if (q.start_stroke_id >= p.start_stroke_id && q.end_stroke_id <= p.end_stroke_id) {
+                        REQUIRE(q.GG >= p.DD && q.DD <= p.GG);
+                        ++parts;
+                    }
+                }
+                REQUIRE(parts >= 2);
+            }
+        }
+    }
+    
+    // 流式追加与完整分析一致（结果比较含各级中枢）
+    REQUIRE(StreamMatchesAnalyze(config, 4242u, 8000));
+    
+    // 多级别中枢相对完整分析的耗时：全量重建也只占百分之几
+    RandomWalk big_walk(7u);
+    const int BIG = 300000;
+    std::vector<float> big_highs(BIG), big_lows(BIG);
+    for (int i = 0; i < BIG; ++i) {
+        big_walk.Bar(big_highs[i], big_lows[i]);
+    }
+    chan::ChanCore big(config);
+    auto t0 = std::chrono::high_resolution_clock::now();
+    big.Analyze(big_highs.data(), big_lows.data(), nullptr, nullptr, BIG);
+    auto t1 = std::chrono::high_resolution_clock::now();
+    int levels = big.CheckPivotLevels();
+    auto t2 = std::chrono::high_resolution_clock::now();
+    auto analyze_us = std::chrono::duration_cast<std::chrono::microseconds>(t1 - t0).count();
+    auto levels_us = std::chrono::duration_cast<std::chrono::microseconds>(t2 - t1).count();
+    std::cout << "\n  300K K线: 完整分析=" << analyze_us << " us, 多级别中枢=" << levels_us
+              << " us (最高级别 " << levels << ")";
+    REQUIRE(levels_us * 100 <= analyze_us * 3 + 20000);
+}
+
+// ----------------------------------------------------------------------------
+// 测试60: 多周期联立分析 - 时段聚合、流式一致与跨周期定位
+// ----------------------------------------------------------------------------
+// 生成 days 个交易日的1分钟K线（每日240根，时刻为A股交易时段）
+static void MakeMinuteBars(int days, unsigned int seed, std::vector<int>& dates,
+                           std::vector<int>& times, std::vector<float>& highs,
+                           std::vector<float>& lows, std::vector<float>& closes) {
+    RandomWalk walk(seed);
+    for (int d = 0; d < days; ++d) {
+        int date = 20240000 + (d / 28 + 1) * 100 + d % 28 + 1;
+        for (int m = 1; m <= 240; ++m) {
+            float h, l;
+            walk.Bar(h, l);
+            dates.push_back(date);
+            times.push_back(m <= 120 ? 9 * 60 + 30 + m : 13 * 60 + m - 120);
+            highs.push_back(h);
+            lows.push_back(l);
+            closes.push_back((h + l) / 2);
+        }
+    }
+}
+
+TEST_CASE(MultiLevel_SessionAggregationAndLookup) {
+    using chan::Timeframe;
+    ASSERT_EQ(chan::ASessionMinute(9 * 60 + 31), 1);
+    ASSERT_EQ(chan::ASessionMinute(9 * 60 + 25), 1);        // 集合竞价
+    ASSERT_EQ(chan::ASessionMinute(11 * 60 + 30), 120);
+    ASSERT_EQ(chan::ASessionMinute(12 * 60), 120);          // 午间休市
+    ASSERT_EQ(chan::ASessionMinute(13 * 60 + 1), 121);
+    ASSERT_EQ(chan::ASessionMinute(15 * 60), 240);
+    ASSERT_EQ(chan::ASessionMinute(15 * 60 + 5), 240);      // 收盘后
+    
+    const int DAYS = 40;
+    std::vector<int> dates, times;
+    std::vector<float> highs, lows, closes;
+    MakeMinuteBars(DAYS, 2024u, dates, times, highs, lows, closes);
+    const int N = (int)highs.size();
+    
+    chan::ChanConfig config;
+    config.min_bi_len = 3;
+    config.min_fx_distance = 0;
+    chan::MultiLevelAnalyzer bulk(config);
+    ASSERT_EQ(bulk.Analyze(dates.data(), times.data(), highs.data(), lows.data(),
+                           closes.data(), nullptr, N), 0);
+    
+    // 各周期K线数与按时段独立聚合后单独分析的结果一致
+    const Timeframe tfs[] = {Timeframe::M1, Timeframe::M5, Timeframe::M15,
+                             Timeframe::M30, Timeframe::M60, Timeframe::DAY};
+    for (Timeframe tf : tfs) {
+        int period = chan::TimeframeMinutes(tf);
+        int per_day = period > 0 ? 240 / period : 1;
+        std::vector<float> h(DAYS * per_day, -1e30f), l(DAYS * per_day, 1e30f);
+        for (int i = 0; i < N; ++i) {
+            int bar = (i / 240) * per_day + (period > 0 ? (i % 240) / period : 0);
+            h[bar] = std::max(h[bar], highs[i]);
+            l[bar] = std::min(l[bar], lows[i]);
+        }
+        ASSERT_EQ(bulk.GetBarCount(tf), DAYS * per_day);
+        chan::ChanCore ref(config);
+        ref.Analyze(h.data(), l.data(), nullptr, nullptr, (int)h.size());
+        REQUIRE(SameAnalysis(bulk.Core(tf), ref));
+    }
+    REQUIRE(bulk.Core(Timeframe::M5).GetStrokes().size() > 10);
+    REQUIRE(bulk.Core(Timeframe::M60).GetStrokes().size() > 3);
+    
+    // 前半部分批量载入，其余逐根追加（含盘中刷新），结果与一次载入一致
+    chan::MultiLevelAnalyzer stream(config);
+    const int HALF = N / 2 + 17;
+    ASSERT_EQ(stream.Analyze(dates.data(), times.data(), highs.data(), lows.data(),
+                             closes.data(), nullptr, HALF), 0);
+    auto t0 = std::chrono::high_resolution_clock::now();
+    for (int i = HALF; i < N; ++i) {
+        stream.AppendMinuteBar(dates[i], times[i], highs[i] + 0.8f, lows[i] + 0.5f, closes[i], 0);
+        stream.UpdateLastMinuteBar(highs[i], lows[i], closes[i], 0);
+    }
+    auto t1 = std::chrono::high_resolution_clock::now();
+    for (Timeframe tf : tfs) {
+        ASSERT_EQ(stream.GetBarCount(tf), bulk.GetBarCount(tf));
+        REQUIRE(SameAnalysis(stream.Core(tf), bulk.Core(tf)));
+    }
+    ASSERT_EQ(stream.AppendMinuteBar(dates[N - 1], times[N - 1], 1, 1, 1, 0), -1);
+    
+    // 跨周期定位：第3日 10:31 的1分钟K线
+    int minute = 3 * 240 + 60;
+    ASSERT_EQ(bulk.MapBar(Timeframe::M1, minute, Timeframe::M5), 3 * 48 + 12);
+    ASSERT_EQ(bulk.MapBar(Timeframe::M1, minute, Timeframe::M60), 3 * 4 + 1);
+    ASSERT_EQ(bulk.MapBar(Timeframe::M1, minute, Timeframe::DAY), 3);
+    ASSERT_EQ(bulk.MapBar(Timeframe::DAY, 3, Timeframe::M5), 3 * 48);
+    ASSERT_EQ(bulk.MapBar(Timeframe::DAY, DAYS, Timeframe::M5), -1);
+    
+    // 包含低级别K线的高级别笔与逐笔查找一致
+    const Timeframe higher[] = {Timeframe::M5, Timeframe::M30, Timeframe::DAY};
+    for (Timeframe tf : higher) {
+        const auto& strokes = bulk.Core(tf).GetStrokeSoA();
+        for (int i = 0; i < N; i += 7) {
+            int target = bulk.MapBar(Timeframe::M1, i, tf);
+            int expect = -1;
+            for (int k = 0; k < strokes.size(); ++k) {
+                if (strokes.start_idx[k] <= target && target <= strokes.end_idx[k]) {
+                    expect = k;
+                }
+            }
+            ASSERT_EQ(bulk.FindContainingStroke(Timeframe::M1, i, tf), expect);
+        }
+    }
+    
+    auto stream_us = std::chrono::duration_cast<std::chrono::microseconds>(t1 - t0).count();
+    std::cout << "\n  逐根追加 " << (N - HALF) << " 根1分钟K线（6个周期）: " << stream_us << " us";
+    REQUIRE(stream_us < (N - HALF) * 50 + 20000);
+}
+
+// ----------------------------------------------------------------------------
+// 测试61: 背驰判断 - MACD递推与面积、进入/离开段比较、流式一致与耗时
+// ----------------------------------------------------------------------------
+// 逐根区间求和的面积（基准）
+static double NaiveMACDArea(const std::vector<float>& macd, int from, int to, bool red) {
+    double sum = 0.0;
+    for (int k = from; k <= to; ++k) {
+        if (red ? macd[k] > 0 : macd[k] < 0) sum += red ? macd[k] : -macd[k];
+    }
+    return sum;
+}
+
+TEST_CASE(Divergence_MACDArea) {
+    RandomWalk walk(2020u);
+    const int SIZE = 20000;
+    std::vector<float> highs(SIZE), lows(SIZE), closes(SIZE);
+    for (int i = 0; i < SIZE; ++i) {
+        walk.Bar(highs[i], lows[i]);
+        closes[i] = (highs[i] + lows[i]) / 2;
+    }
+    chan::ChanConfig config;
+    config.min_bi_len = 3;
+    config.min_fx_distance = 0;
+    
+    // 无收盘价时不计算MACD，也不输出背驰
+    chan::ChanCore bare(config);
+    bare.Analyze(highs.data(), lows.data(), nullptr, nullptr, SIZE);
+    REQUIRE(!bare.HasMACD());
+    REQUIRE(bare.CheckBC().empty());
+    ASSERT_EQ(bare.GetMACDArea(0, SIZE - 1, chan::Direction::UP), 0.0f);
+    
+    chan::ChanCore core(config);
+    core.Analyze(highs.data(), lows.data(), closes.data(), nullptr, SIZE);
+    const std::vector<float>& macd = core.GetMACD();
+    ASSERT_EQ((int)macd.size(), SIZE);
+    
+    // MACD 与通达信公式逐根计算一致
+    double fast = closes[0], slow = closes[0], dea = 0.0;
+    for (int i = 0; i < SIZE; ++i) {
+        if (i > 0) {
+            fast = (2 * closes[i] + 11 * fast) / 13;
+            slow = (2 * closes[i] + 25 * slow) / 27;
+            dea = (2 * (fast - slow) + 8 * dea) / 10;
+        }
+        REQUIRE(std::fabs(macd[i] - 2 * (fast - slow - dea)) < 1e-3);
+    }
+    
+    // 区间面积：前缀和与逐根求和一致，越界截断
+    RandomWalk pick(7u);
+    for (int t = 0; t < 200; ++t) {
+        int a = (int)(pick.Next() * (SIZE - 1));
+        int b = std::min(SIZE - 1, a + (int)(pick.Next() * 300));
+        REQUIRE(std::fabs(core.GetMACDArea(a, b, chan::Direction::UP) -
+                          NaiveMACDArea(macd, a, b, true)) < 1e-2);
+        REQUIRE(std::fabs(core.GetMACDArea(a, b, chan::Direction::DOWN) -
+                          NaiveMACDArea(macd, a, b, false)) < 1e-2);
+    }
+    ASSERT_EQ(core.GetMACDArea(SIZE - 5, SIZE + 100, chan::Direction::UP),
+              core.GetMACDArea(SIZE - 5, SIZE - 1, chan::Direction::UP));
+    ASSERT_EQ(core.GetMACDArea(10, 9, chan::Direction::DOWN), 0.0f);
+    
+    // 笔力度为笔内同向MACD柱面积
+    auto strokes = core.GetStrokes();
+    REQUIRE(strokes.size() > 100);
+    for (const auto& st : strokes) {
+        ASSERT_EQ(st.power, core.GetMACDArea(st.start_idx, st.end_idx, st.direction));
+    }
+    
+    // 基准：逐中枢线性查找进入/离开段并逐根求面积
+    // (K线, +1顶/-1底, 强度) -> 进入段面积减离开段面积；差值在浮点误差内的两种结果都接受
+    struct Candidate { int index; int dir; int strength; double margin; };
+    std::vector<Candidate> candidates;
+    auto segs = core.GetSegments();
+    for (const auto& p : core.GetPivots()) {
+        int e = p.start_stroke_id - 1, l = p.end_stroke_id;
+        if (e < 0 || strokes[e].direction != strokes[l].direction) continue;
+        bool up = strokes[l].direction == chan::Direction::UP;
+        if (up ? strokes[l].high <= strokes[e].high : strokes[l].low >= strokes[e].low) continue;
+        candidates.push_back({strokes[l].end_idx, up ? 1 : -1, 1,
+                              NaiveMACDArea(macd, strokes[e].start_idx, strokes[e].end_idx, up) -
+                              NaiveMACDArea(macd, strokes[l].start_idx, strokes[l].end_idx, up)});
+    }
+    for (const auto& p : core.GetPivots(1)) {
+        int in = -1, out = -1;
+        for (int k = 0; k < (int)segs.size(); ++k) {
+            if (segs[k].end_stroke_id == p.start_stroke_id - 1) in = k;
+            if (segs[k].end_stroke_id == p.end_stroke_id) out = k;
+        }
+        if (in < 0 || out < 0 || segs[in].direction != segs[out].direction) continue;
+        chan::Segment si = segs[in], so = segs[out];
+        bool up = so.direction == chan::Direction::UP;
+        if (up ? so.high <= si.high : so.low >= si.low) continue;
+        candidates.push_back({so.end_idx, up ? 1 : -1, 2,
+                              NaiveMACDArea(macd, si.start_idx, si.end_idx, up) -
+                              NaiveMACDArea(macd, so.start_idx, so.end_idx, up)});
+    }
+    
+    std::vector<chan::Signal> bc = core.CheckBC();
+    int seg_found = 0;
+    for (size_t i = 0; i < bc.size(); ++i) {
+        const chan::Signal& sig = bc[i];
+        REQUIRE(sig.has_divergence);
+        REQUIRE(sig.type == chan::SignalType::SELL1 || sig.type == chan::SignalType::BUY1);
+        if (sig.strength == 2) ++seg_found;
+        if (i > 0) REQUIRE(bc[i - 1].index <= sig.index);
+    }
+    for (const Candidate& c : candidates) {
+        int matched = 0;
+        for (const auto& sig : bc) {
+            int dir = sig.type == chan::SignalType::SELL1 ? 1 : -1;
+            if (sig.index == c.index && dir == c.dir && sig.strength == c.strength) ++matched;
+        }
+        if (c.margin > 1e-3) ASSERT_EQ(matched, 1);
+        if (c.margin < -1e-3) ASSERT_EQ(matched, 0);
+    }
+    int certain = 0, possible = 0;
+    for (const Candidate& c : candidates) {
+        if (c.margin > 1e-3) ++certain;
+        if (c.margin >= -1e-3) ++possible;
+    }
+    REQUIRE((int)bc.size() >= certain && (int)bc.size() <= possible);
+    REQUIRE(bc.size() > 20);
+    REQUIRE(seg_found > 0);
+    
+    // OutputBC 与信号列表一致
+    std::vector<float> out(SIZE, -9.0f);
+    core.OutputBC(out.data(), SIZE);
+    int marked = 0;
+    for (int i = 0; i < SIZE; ++i) {
+        REQUIRE(out[i] == 0.0f || out[i] == 1.0f || out[i] == -1.0f);
+        if (out[i] != 0.0f) ++marked;
+    }
+    for (const auto& sig : bc) {
+        ASSERT_EQ(out[sig.index], sig.type == chan::SignalType::SELL1 ? 1.0f : -1.0f);
+    }
+    REQUIRE(marked > 0 && marked <= (int)bc.size());
+    
+    // 流式追加（含盘中刷新）的MACD与背驰与完整分析逐位一致
+    chan::ChanCore stream(config);
+    RandomWalk jitter(31u);
+    const int STREAM = 6000;
+    for (int i = 0; i < STREAM; ++i) {
+        stream.AppendBar(highs[i] + 0.7f, lows[i], closes[i] + 0.5f, 0);
+        if (jitter.Next() < 0.5f) {
+            stream.UpdateLastBar(highs[i] - 0.2f, lows[i] - 0.3f, closes[i] - 0.4f, 0);
+        }
+        stream.UpdateLastBar(highs[i], lows[i], closes[i], 0);
+    }
+    chan::ChanCore partial(config);
+    partial.Analyze(highs.data(), lows.data(), closes.data(), nullptr, STREAM);
+    REQUIRE(SameAnalysis(stream, partial));
+    REQUIRE(stream.GetMACD() == partial.GetMACD());
+    std::vector<chan::Signal> bs = stream.CheckBC(), bp = partial.CheckBC();
+    ASSERT_EQ(bs.size(), bp.size());
+    for (size_t i = 0; i < bs.size(); ++i) {
+        REQUIRE(bs[i].index == bp[i].index && bs[i].type == bp[i].type &&
+                bs[i].strength == bp[i].strength);
+    }
+    
+    // 背驰判断只遍历中枢，相对完整分析的耗时可忽略
+    auto t0 = std::chrono::high_resolution_clock::now();
+    std::vector<float> bc_out(SIZE);
+    for (int r = 0; r < 10; ++r) {
+        core.OutputBC(bc_out.data(), SIZE);
+    }
+    auto t1 = std::chrono::high_resolution_clock::now();
+    chan::ChanCore again(config);
+    again.Analyze(highs.data(), lows.data(), closes.data(), nullptr, SIZE);
+    auto t2 = std::chrono::high_resolution_clock::now();
+    auto bc_us = std::chrono::duration_cast<std::chrono::microseconds>(t1 - t0).count() / 10;
+    auto analyze_us = std::chrono::duration_cast<std::chrono::microseconds>(t2 - t1).count();
+    std::cout << "\n  20K K线: 完整分析=" << analyze_us << " us, 背驰输出=" << bc_us
+              << " us (" << bc.size() << " 个背驰)";
+    REQUIRE(bc_us * 2 <= analyze_us + 2000);
+}
+
+// ----------------------------------------------------------------------------
+// 测试62: 稳态零分配 - 重复分析同规模数据时容器容量复用，不再分配堆内存
+// ----------------------------------------------------------------------------
+// 计数分配器：替换全局 operator new，只统计开启计数的线程（日志等后台线程不计入）
+static thread_local bool t_count_allocs = false;
+static thread_local long t_alloc_count = 0;
+
+void* operator new(std::size_t size) {
+    if (t_count_allocs) ++t_alloc_count;
+    void* p = std::malloc(size ? size : 1);
+    if (!p) throw std::bad_alloc();
+    return p;
+}
+void* operator new[](std::size_t size) { return operator new(size); }
+void operator delete(void* p) noexcept { std::free(p); }
+void operator delete[](void* p) noexcept { std::free(p); }
+void operator delete(void* p, std::size_t) noexcept { std::free(p); }
+void operator delete[](void* p, std::size_t) noexcept { std::free(p); }
+
+// 统计 fn 执行期间本线程的堆分配次数
+template <typename Fn>
+static long CountAllocs(Fn fn) {
+    t_alloc_count = 0;
+    t_count_allocs = true;
+    fn();
+    t_count_allocs = false;
+    return t_alloc_count;
+}
+
+TEST_CASE(SteadyState_ZeroAllocations) {
+    REQUIRE(CountAllocs([] { std::vector<int> probe(16); (void)probe; }) == 1);
+    
+    // 两组同规模、不同走势的数据交替分析
+    const int SIZE = 20000;
+    std::vector<float> highs[2], lows[2], closes[2];
+    for (int d = 0; d < 2; ++d) {
+        RandomWalk walk(620u + d);
+        highs[d].resize(SIZE);
+        lows[d].resize(SIZE);
+        closes[d].resize(SIZE);
+        for (int i = 0; i < SIZE; ++i) {
+            walk.Bar(highs[d][i], lows[d][i]);
+            closes[d][i] = (highs[d][i] + lows[d][i]) / 2;
+        }
+    }
+    chan::ChanConfig config;
+    config.min_bi_len = 3;
+    config.min_fx_distance = 0;
+    std::vector<float> out(SIZE);
+    
+    // 直接使用 ChanCore：完整分析、递归引用、信号位图与各输出
+    chan::ChanCore core(config);
+    auto run_core = [&](int d) {
+        core.Analyze(highs[d].data(), lows[d].data(), closes[d].data(), nullptr, SIZE);
+        core.ComputeMAData(closes[d].data(), SIZE);
+        core.BuildBiSequence(SIZE - 1);
+        core.BuildSignalTable(highs[d].data(), lows[d].data(), SIZE);
+        core.OutputBI(out.data(), SIZE);
+        core.OutputDUAN(out.data(), SIZE);
+        core.OutputZS_H(out.data(), SIZE);
+        core.OutputBC(out.data(), SIZE);
+        core.OutputGG(out.data(), SIZE, 1);
+        for (int k = 0; k < (int)chan::SignalOutput::COUNT; ++k) {
+            core.ProjectSignal((chan::SignalOutput)k, out.data(), SIZE);
+        }
+    };
+    for (int r = 0; r < 4; ++r) {
+        run_core(r % 2);
+    }
+    REQUIRE(core.GetMaxPivotLevel() >= 2);
+    long core_allocs = 0;
+    for (int r = 0; r < 4; ++r) {
+        core_allocs += CountAllocs([&] { run_core(r % 2); });
+    }
+    ASSERT_EQ(core_allocs, 0);
+    
+    // 分析缓存：容量只容纳一份数据，每次调用都未命中并淘汰上一份，淘汰的会话被复用
+    chan::AnalysisCache cache(SIZE);
+    auto run_cache = [&](int d) {
+        chan::AnalysisSession* session = cache.AcquireSession(
+            highs[d].data(), lows[d].data(), closes[d].data(), nullptr, SIZE, config);
+        session->GetSignal(chan::SignalOutput::BUYX, highs[d].data(), lows[d].data());
+        session->GetSignal(chan::SignalOutput::SELL, highs[d].data(), lows[d].data());
+        session->Core().OutputBC(out.data(), SIZE);
+    };
+    for (int r = 0; r < 4; ++r) {
+        run_cache(r % 2);
+    }
+    long cache_allocs = 0;
+    for (int r = 0; r < 4; ++r) {
+        cache_allocs += CountAllocs([&] { run_cache(r % 2); });
+    }
+    ASSERT_EQ(cache_allocs, 0);
+    chan::CacheStats stats = cache.GetStats();
+    ASSERT_EQ(stats.entries, 1);
+    ASSERT_EQ((int)stats.hits, 0);
+    REQUIRE(stats.evictions >= 7);
+}
+
+// ----------------------------------------------------------------------------
+// 测试63: 稀疏结果 - 事件列表与稠密输出一致、紧凑、批量逐标的收集
+// ----------------------------------------------------------------------------
+TEST_CASE(SparseEvents_MatchDenseOutputs) {
+    static_assert(std::is_trivially_copyable<chan::ChanEvent>::value, "ChanEvent 应为POD");
+    static_assert(std::is_trivially_copyable<chan::Signal>::value, "Signal 不应持有堆内存");
+    
+    RandomWalk walk(6363u);
+    const int SIZE = 20000;
+    std::vector<float> highs(SIZE), lows(SIZE), closes(SIZE);
+    for (int i = 0; i < SIZE; ++i) {
+        walk.Bar(highs[i], lows[i]);
+        closes[i] = (highs[i] + lows[i]) / 2;
+    }
+    chan::ChanConfig config;
+    config.min_bi_len = 3;
+    config.min_fx_distance = 0;
+    chan::ChanCore core(config);
+    core.Analyze(highs.data(), lows.data(), closes.data(), nullptr, SIZE);
+    core.ComputeMAData(closes.data(), SIZE);
+    core.BuildBiSequence(SIZE - 1);
+    core.BuildSignalTable(highs.data(), lows.data(), SIZE);
+    
+    std::vector<chan::ChanEvent> events(3);     // 追加到已有内容之后
+    int added = core.CollectEvents(chan::ALL_EVENTS, events, highs.data(), lows.data());
+    ASSERT_EQ((int)events.size(), added + 3);
+    events.erase(events.begin(), events.begin() + 3);
+    for (size_t i = 1; i < events.size(); ++i) {
+        REQUIRE(events[i - 1].index < events[i].index ||
+                (events[i - 1].index == events[i].index && events[i - 1].kind <= events[i].kind));
+    }
+    
+    // 由事件还原稠密数组，与 Output* 逐元素比较
+    std::vector<float> fx(SIZE, 0.0f), bi(SIZE, 0.0f), duan(SIZE, 0.0f), bc(SIZE, 0.0f);
+    std::vector<float> buy(SIZE, 0.0f), sell(SIZE, 0.0f);
+    int pivot_starts = 0, pivot_ends = 0, kinds_seen = 0;
+    for (const chan::ChanEvent& ev : events) {
+        REQUIRE(ev.index >= 0 && ev.index < SIZE);
+        kinds_seen |= 1 << (int)ev.kind;
+        switch (ev.kind) {
+            case chan::EventKind::FRACTAL:
+                fx[ev.index] = ev.code;
+                break;
+            case chan::EventKind::STROKE:
+                bi[ev.index] = ev.price;
+                break;
+            case chan::EventKind::SEGMENT:
+                duan[ev.index] = ev.price;
+                break;
+            case chan::EventKind::PIVOT_START: {
+                const chan::Pivot& p = core.GetPivots(ev.code)[ev.ref];
+                REQUIRE(p.start_idx == ev.index && p.ZG == ev.price && p.level == ev.code);
+                ++pivot_starts;
+                break;
+            }
+            case chan::EventKind::PIVOT_END: {
+                const chan::Pivot& p = core.GetPivots(ev.code)[ev.ref];
+                REQUIRE(p.end_idx == ev.index && p.ZD == ev.price);
+                ++pivot_ends;
+                break;
+            }
+            case chan::EventKind::SIGNAL: {
+                // 按 OutputBuySignal 的优先级合成：1-3=一类, 11-13=二类, 21=三类
+                float price = ev.code > 0 ? lows[ev.index] : highs[ev.index];
+                REQUIRE(ev.price == price);
+                std::vector<float>& dense = ev.code > 0 ? buy : sell;
+                float sign = ev.code > 0 ? 1.0f : -1.0f;
+                float value = 0.0f;
+                int type = std::abs(ev.code);
+                if (ev.reason == chan::ReasonCode::FIRST) value = (float)type;
+                else if (ev.reason == chan::ReasonCode::SECOND) value = 10.0f + type;
+                else if (ev.reason == chan::ReasonCode::THIRD) value = 20.0f + type;
+                if (value != 0.0f && (dense[ev.index] == 0.0f || std::fabs(dense[ev.index]) > value)) {
+                    dense[ev.index] = sign * value;
+                }
+                break;
+            }
+            case chan::EventKind::DIVERGENCE:
+                bc[ev.index] = ev.code;
+                break;
+            default:
+                REQUIRE(false);
+        }
+    }
+    ASSERT_EQ(kinds_seen, (int)chan::ALL_EVENTS);
+    
+    std::vector<float> dense(SIZE);
+    core.OutputFX(dense.data(), SIZE);
+    REQUIRE(dense == fx);
+    core.OutputBI(dense.data(), SIZE);
+    REQUIRE(dense == bi);
+    core.OutputDUAN(dense.data(), SIZE);
+    REQUIRE(dense == duan);
+    core.OutputBC(dense.data(), SIZE);
+    REQUIRE(dense == bc);
+    core.ProjectSignal(chan::SignalOutput::BUY, dense.data(), SIZE);
+    REQUIRE(dense == buy);
+    core.ProjectSignal(chan::SignalOutput::SELL, dense.data(), SIZE);
+    REQUIRE(dense == sell);
+    
+    int pivot_total = 0;
+    for (int level = 0; level <= core.GetMaxPivotLevel(); ++level) {
+        pivot_total += (int)core.GetPivots(level).size();
+    }
+    ASSERT_EQ(pivot_starts, pivot_total);
+    ASSERT_EQ(pivot_ends, pivot_total);
+    
+    // 背驰事件与 CheckBC 一致，原因为码而非字符串
+    std::vector<chan::Signal> divergences = core.CheckBC();
+    std::vector<chan::ChanEvent> bc_events;
+    core.CollectEvents(chan::EventBit(chan::EventKind::DIVERGENCE), bc_events);
+    ASSERT_EQ(bc_events.size(), divergences.size());
+    for (size_t i = 0; i < bc_events.size(); ++i) {
+        REQUIRE(bc_events[i].index == divergences[i].index);
+        REQUIRE(bc_events[i].reason == divergences[i].reason);
+        REQUIRE(bc_events[i].ref == divergences[i].pivot_id);
+        ASSERT_EQ((int)bc_events[i].code, divergences[i].type == chan::SignalType::SELL1 ? 1 : -1);
+    }
+    REQUIRE(std::string(chan::ReasonText(chan::ReasonCode::SEGMENT_PIVOT_DIVERGENCE)) == "线段中枢背驰");
+    REQUIRE(std::string(chan::ReasonText(chan::ReasonCode::COUNT)).empty());
+    
+    // 紧凑：各类事件的字节数远小于对应的稠密数组。分型约每3根K线一个；
+    // 信号条件常在相邻K线上持续成立；笔、线段、中枢、背驰则稀疏得多
+    size_t bytes[(int)chan::EventKind::COUNT] = {0};
+    for (const chan::ChanEvent& ev : events) {
+        bytes[(int)ev.kind] += sizeof(chan::ChanEvent);
+    }
+    const size_t column = (size_t)SIZE * sizeof(float);
+    size_t structure = bytes[(int)chan::EventKind::STROKE] + bytes[(int)chan::EventKind::SEGMENT] +
+                       bytes[(int)chan::EventKind::PIVOT_START] +
+                       bytes[(int)chan::EventKind::PIVOT_END] +
+                       bytes[(int)chan::EventKind::DIVERGENCE];
+    size_t event_bytes = events.size() * sizeof(chan::ChanEvent);
+    std::cout << "\n  20K K线: 事件 " << events.size() << " 个 " << event_bytes / 1024
+              << " KB（笔/线段/中枢/背驰 " << structure / 1024 << " KB）, 稠密数组 "
+              << column * 14 / 1024 << " KB";
+    REQUIRE(event_bytes * 3 < column * 14);
+    REQUIRE(structure * 10 < column * 5);
+    REQUIRE(bytes[(int)chan::EventKind::SIGNAL] * 3 < column * 8);
+    
+    // 只收集最近的事件：与全部事件中窗口内的部分一致
+    std::vector<chan::ChanEvent> recent;
+    core.CollectEvents(chan::ALL_EVENTS, recent, highs.data(), lows.data(), SIZE - 500);
+    std::vector<chan::ChanEvent> tail;
+    for (const chan::ChanEvent& ev : events) {
+        if (ev.index >= SIZE - 500) tail.push_back(ev);
+    }
+    ASSERT_EQ(recent.size(), tail.size());
+    REQUIRE(std::memcmp(recent.data(), tail.data(), tail.size() * sizeof(chan::ChanEvent)) == 0);
+    
+    // 批量选股：只收集每个标的最近20根K线的买卖点、中枢与背驰，逐标的结果与单独收集一致
+    RaggedBatch batch(40, 3000, 63);
+    int series = (int)batch.offsets.size() - 1;
+    std::vector<std::vector<chan::ChanEvent>> per_series(series);
+    chan::BatchOutput out;
+    out.events = per_series.data();
+    out.event_kinds = chan::EventBit(chan::EventKind::SIGNAL) |
+                      chan::EventBit(chan::EventKind::PIVOT_START) |
+                      chan::EventBit(chan::EventKind::DIVERGENCE);
+    out.event_window = 20;
+    chan::ChanBatchAnalyzer analyzer(3);
+    analyzer.SetConfig(config);
+    ASSERT_EQ(analyzer.Run(batch.Input(), out), series);
+    size_t batch_bytes = 0;
+    for (int s = 0; s < series; ++s) {
+        int off = batch.offsets[s];
+        int n = batch.offsets[s + 1] - off;
+        std::vector<chan::ChanEvent> expect;
+        if (n > 0) {
+            chan::ChanCore single(config);
+            single.Analyze(&batch.highs[off], &batch.lows[off], &batch.closes[off], nullptr, n);
+            single.ComputeMAData(&batch.closes[off], n);
+            single.BuildBiSequence(n - 1);
+            single.BuildSignalTable(&batch.highs[off], &batch.lows[off], n);
+            single.CollectEvents(out.event_kinds, expect, &batch.highs[off], &batch.lows[off],
+                                 n - 20);
+        }
+        ASSERT_EQ(per_series[s].size(), expect.size());
+        REQUIRE(expect.empty() ||
+                std::memcmp(per_series[s].data(), expect.data(),
+                            expect.size() * sizeof(chan::ChanEvent)) == 0);
+        batch_bytes += per_series[s].size() * sizeof(chan::ChanEvent);
+    }
+    std::cout << ", 批量 " << series << " 个标的最近事件 " << batch_bytes << " 字节";
+    REQUIRE(batch_bytes > 0);
+    REQUIRE(batch_bytes * 10 < batch.highs.size() * sizeof(float));
+}
+
+// ----------------------------------------------------------------------------
+// 测试64: 笔识别 - 与逐起点贪心扫描一致，最坏情形线性
+// ----------------------------------------------------------------------------
+
+// 参照实现：每个起点向后逐个分型检查，找不到终点则跳过该起点（最坏 O(F^2)）
+static std::vector<std::pair<int, int>> ReferenceStrokes(const chan::ChanCore& core,
+                                                         const chan::ChanConfig& config) {
+    auto fx = core.GetFractals();
+    int n = (int)fx.size();
+    auto can_form = [&](int a, int b) {
+        if (fx[a].type == fx[b].type) return false;
+        if (fx[b].index - fx[a].index < config.min_fx_distance + 2) return false;
+        if (fx[b].kline_idx - fx[a].kline_idx < config.min_bi_len) return false;
+        return fx[a].type == chan::FractalType::TOP ? fx[a].price > fx[b].price
+                                                    : fx[a].price < fx[b].price;
+    };
+    std::vector<std::pair<int, int>> strokes;
+    int start = 0;
+    while (start < n - 1) {
+        int end = start + 1;
+        while (end < n && !can_form(start, end)) ++end;
+        if (end < n) {
+            strokes.push_back(std::make_pair(fx[start].kline_idx, fx[end].kline_idx));
+            start = end;
+        } else {
+            ++start;
+        }
+    }
+    return strokes;
+}
+
+static bool SameAsReferenceStrokes(const chan::ChanCore& core, const chan::ChanConfig& config) {
+    std::vector<std::pair<int, int>> ref = ReferenceStrokes(core, config);
+    const chan::StrokeSoA& st = core.GetStrokeSoA();
+    if ((int)ref.size() != st.size()) return false;
+    for (int i = 0; i < st.size(); ++i) {
+        if (st.start_idx[i] != ref[i].first || st.end_idx[i] != ref[i].second) return false;
+    }
+    return true;
+}
+
+// 阶梯上行的细密锯齿：够一笔距离的底都高于顶，每个顶分型都找不到终点
+static void MakeStaircaseKlines(int size, std::vector<float>& highs, std::vector<float>& lows) {
+    const float tooth[4] = {0.0f, 1.0f, 0.0f, -1.0f};
+    highs.resize(size);
+    lows.resize(size);
+    for (int i = 0; i < size; ++i) {
+        highs[i] = 10.0f + 0.005f * (i % 100000) + 0.01f * tooth[i % 4];
+        lows[i] = highs[i] - 0.005f;
+    }
+}
+
+TEST_CASE(Stroke_LinearWorstCase) {
+    chan::ChanConfig configs[3];
+    configs[1].min_bi_len = 3;
+    configs[1].min_fx_distance = 0;
+    configs[2].min_bi_len = 9;
+    configs[2].min_fx_distance = 3;
+    
+    // 随机游走：各参数下与参照实现逐笔一致
+    for (const chan::ChanConfig& config : configs) {
+        for (unsigned int seed : {7u, 2024u, 90210u}) {
+            RandomWalk walk(seed);
+            const int SIZE = 5000;
+            std::vector<float> highs(SIZE), lows(SIZE);
+            for (int i = 0; i < SIZE; ++i) {
+                walk.Bar(highs[i], lows[i]);
+            }
+            chan::ChanCore core(config);
+            core.Analyze(highs.data(), lows.data(), nullptr, nullptr, SIZE);
+            REQUIRE(core.GetStrokes().size() > 50);
+            REQUIRE(SameAsReferenceStrokes(core, config));
+        }
+    }
+    
+    // 阶梯锯齿：大量起点跳过，结果仍一致
+    chan::ChanConfig config;
+    std::vector<float> highs, lows;
+    MakeStaircaseKlines(20000, highs, lows);
+    chan::ChanCore stair(config);
+    stair.Analyze(highs.data(), lows.data(), nullptr, nullptr, 20000);
+    REQUIRE(stair.GetFractals().size() > 9000);
+    REQUIRE(stair.GetStrokes().size() > 2000);
+    REQUIRE(SameAsReferenceStrokes(stair, config));
+    
+    // 流式追加：跳过记录随新分型重新判定，与完整分析一致
+    chan::ChanCore stream(config);
+    chan::ChanCore full(config);
+    for (int i = 0; i < 3000; ++i) {
+        stream.AppendBar(highs[i], lows[i], highs[i], 1000.0f);
+        if (i % 97 == 0 || i == 2999) {
+            full.Analyze(highs.data(), lows.data(), nullptr, nullptr, i + 1);
+            REQUIRE(SameAnalysis(stream, full));
+        }
+    }
+    
+    // 耗时：阶梯锯齿与随机游走同量级（逐起点扫描时为平方级）
+    const int BIG = 200000;
+    MakeStaircaseKlines(BIG, highs, lows);
+    stair.Analyze(highs.data(), lows.data(), nullptr, nullptr, BIG);
+    auto t0 = std::chrono::high_resolution_clock::now();
+    int stair_strokes = stair.CheckBI();
+    auto t1 = std::chrono::high_resolution_clock::now();
+    
+    RandomWalk walk(4242u);
+    for (int i = 0; i < BIG; ++i) {
+        walk.Bar(highs[i], lows[i]);
+    }
+    chan::ChanCore random(config);
+    random.Analyze(highs.data(), lows.data(), nullptr, nullptr, BIG);
+    auto t2 = std::chrono::high_resolution_clock::now();
+    random.CheckBI();
+    auto t3 = std::chrono::high_resolution_clock::now();
+    
+    auto stair_us = std::chrono::duration_cast<std::chrono::microseconds>(t1 - t0).count();
+    auto random_us = std::chrono::duration_cast<std::chrono::microseconds>(t3 - t2).count();
+    std::cout << "\n  200K K线: 阶梯锯齿 分型=" << stair.GetFractals().size() << " 笔=" << stair_strokes
+              << " (" << stair_us << " us), 随机游走 分型=" << random.GetFractals().size()
+              << " (" << random_us << " us)";
+    REQUIRE(stair_us <= random_us * 20 + 10000);
+}
+
+// ----------------------------------------------------------------------------
+// 测试65: 时点状态查询 - 与逐K线递归序列一致，随机访问 O(log S)
+// ----------------------------------------------------------------------------
+
+// 逐字段比较时点状态与 BuildBiSequence 的结果，并按定义核对所处中枢
+static bool StateMatchesSequence(const chan::ChanCore& core, int bar) {
+    chan::ChanState state = core.GetStateAt(bar);
+    if (state.seq.direction != core.GetDirection(bar)) return false;
+    for (int n = 1; n <= 5; ++n) {
+        if (state.seq.GG[n] != core.GetGG(bar, n) || state.seq.DD[n] != core.GetDD(bar, n) ||
+            state.seq.HH[n] != core.GetHH(bar, n) || state.seq.LL[n] != core.GetLL(bar, n)) {
+            return false;
+        }
+    }
+    
+    const chan::StrokeSoA& st = core.GetStrokeSoA();
+    int last = -1;
+    while (last + 1 < st.size() && st.end_idx[last + 1] <= bar) ++last;
+    if (state.stroke != last) return false;
+    
+    const std::vector<chan::Pivot>& pivots = core.GetPivots();
+    int min_count = core.GetConfig().min_zs_bi_count;
+    int pivot = -1;
+    for (size_t p = 0; p < pivots.size(); ++p) {
+        if (last >= 0 && pivots[p].start_stroke_id + min_count - 1 <= last) pivot = (int)p;
+    }
+    if (state.pivot != pivot) return false;
+    return state.in_pivot == (pivot >= 0 && last <= pivots[pivot].end_stroke_id);
+}
+
+TEST_CASE(StateAt_MatchesBiSequence) {
+    chan::ChanConfig configs[2];
+    configs[1].min_bi_len = 3;
+    configs[1].min_fx_distance = 0;
+    
+    for (const chan::ChanConfig& config : configs) {
+        RandomWalk walk(1234u);
+        const int SIZE = 6000;
+        std::vector<float> highs(SIZE), lows(SIZE);
+        for (int i = 0; i < SIZE; ++i) {
+            walk.Bar(highs[i], lows[i]);
+        }
+        chan::ChanCore core(config);
+        core.Analyze(highs.data(), lows.data(), nullptr, nullptr, SIZE);
+        core.BuildBiSequence(SIZE - 1);
+        REQUIRE(core.GetPivots().size() > 10);
+        
+        int in_pivot = 0;
+        for (int bar = 0; bar < SIZE; ++bar) {
+            REQUIRE(StateMatchesSequence(core, bar));
+            if (core.GetStateAt(bar).in_pivot) ++in_pivot;
+        }
+        REQUIRE(in_pivot > 0 && in_pivot < SIZE);
+    }
+    
+    // 阶梯锯齿：跳过起点后出现连续同向笔，GG/DD 仍只取同向笔终点
+    chan::ChanConfig config;
+    std::vector<float> highs, lows;
+    MakeStaircaseKlines(4000, highs, lows);
+    chan::ChanCore stair(config);
+    stair.Analyze(highs.data(), lows.data(), nullptr, nullptr, 4000);
+    stair.BuildBiSequence(3999);
+    const chan::StrokeSoA& st = stair.GetStrokeSoA();
+    int same_direction = 0;
+    for (int k = 1; k < st.size(); ++k) {
+        if (st.direction[k] == st.direction[k - 1]) ++same_direction;
+    }
+    REQUIRE(same_direction > 100);
+    for (int bar = 0; bar < 4000; ++bar) {
+        REQUIRE(StateMatchesSequence(stair, bar));
+    }
+    
+    // 边界：负索引与无笔时为空状态，越过末根K线时笔与端点不变、距离继续增长
+    chan::ChanState none = stair.GetStateAt(-1);
+    ASSERT_EQ(none.stroke, -1);
+    ASSERT_EQ(none.pivot, -1);
+    ASSERT_EQ(none.seq.direction, 0);
+    chan::ChanCore empty(config);
+    ASSERT_EQ(empty.GetStateAt(10).stroke, -1);
+    chan::ChanState tail = stair.GetStateAt(3999);
+    chan::ChanState beyond = stair.GetStateAt(100000);
+    ASSERT_EQ(beyond.stroke, tail.stroke);
+    ASSERT_EQ(beyond.seq.GG[1], tail.seq.GG[1]);
+    ASSERT_EQ(beyond.seq.HH[1], tail.seq.HH[1] + 100000 - 3999);
+    
+    // 耗时：随机访问全部K线与逐K线构建序列同量级
+    const int BIG = 200000;
+    RandomWalk walk(99u);
+    highs.resize(BIG);
+    lows.resize(BIG);
+    for (int i = 0; i < BIG; ++i) {
+        walk.Bar(highs[i], lows[i]);
+    }
+    chan::ChanCore big(config);
+    big.Analyze(highs.data(), lows.data(), nullptr, nullptr, BIG);
+    auto t0 = std::chrono::high_resolution_clock::now();
+    big.BuildBiSequence(BIG - 1);
+    auto t1 = std::chrono::high_resolution_clock::now();
+    long long checksum = 0;
+    unsigned int seed = 7u;
+    for (int i = 0; i < BIG; ++i) {
+        seed = seed * 1103515245u + 12345u;
+        chan::ChanState state = big.GetStateAt((int)(seed % BIG));
+        checksum += state.stroke + state.seq.HH[1];
+    }
+    auto t2 = std::chrono::high_resolution_clock::now();
+    auto build_us = std::chrono::duration_cast<std::chrono::microseconds>(t1 - t0).count();
+    auto query_us = std::chrono::duration_cast<std::chrono::microseconds>(t2 - t1).count();
+    std::cout << "\n  200K K线 笔=" << big.GetStrokes().size() << ": 构建序列 " << build_us
+              << " us, 随机查询200K次 " << query_us << " us";
+    REQUIRE(checksum != 0);
+    REQUIRE(query_us <= build_us * 20 + 20000);
+}
+
+// ----------------------------------------------------------------------------
+// 测试66: 区间极值索引 - 与逐根扫描一致（并列取最早）、流式维护、O(1)查询
+// ----------------------------------------------------------------------------
+
+// 逐根扫描 [first, last] 的最高/最低价K线，并列取最早
+static int ScanArgExtreme(const std::vector<float>& v, int first, int last, bool max) {
+    int best = first;
+    for (int i = first + 1; i <= last; ++i) {
+        if (max ? v[i] > v[best] : v[i] < v[best]) best = i;
+    }
+    return best;
+}
+
+static bool SameAsScan(const chan::RangeExtremeIndex& index, const std::vector<float>& highs,
+                       const std::vector<float>& lows, int first, int last) {
+    return index.ArgMax(first, last) == ScanArgExtreme(highs, first, last, true) &&
+           index.ArgMin(first, last) == ScanArgExtreme(lows, first, last, false);
+}
+
+TEST_CASE(RangeExtreme_MatchesScan) {
+    // 价格取整到0.5，制造大量并列
+    RandomWalk walk(2025u);
+    const int SIZE = 3000;
+    std::vector<float> highs(SIZE), lows(SIZE);
+    for (int i = 0; i < SIZE; ++i) {
+        walk.Bar(highs[i], lows[i]);
+        highs[i] = std::floor(highs[i] * 2) / 2;
+        lows[i] = std::floor(lows[i] * 2) / 2;
+    }
+    
+    // 批量构建：小规模全部区间，整体随机区间（跨块、整块、块边界）
+    chan::RangeExtremeIndex index;
+    index.Build(highs.data(), lows.data(), 200);
+    for (int first = 0; first < 200; ++first) {
+        for (int last = first; last < 200; ++last) {
+            REQUIRE(SameAsScan(index, highs, lows, first, last));
+        }
+    }
+    index.Build(highs.data(), lows.data(), SIZE);
+    ASSERT_EQ(index.Count(), SIZE);
+    RandomWalk pick(7u);
+    for (int q = 0; q < 20000; ++q) {
+        int a = (int)(pick.Next() * (SIZE - 1));
+        int b = (int)(pick.Next() * (SIZE - 1));
+        REQUIRE(SameAsScan(index, highs, lows, std::min(a, b), std::max(a, b)));
+    }
+    for (int b = 0; b + 1 < SIZE / chan::RangeExtremeIndex::BLOCK; ++b) {
+        int edge = (b + 1) * chan::RangeExtremeIndex::BLOCK;
+        REQUIRE(SameAsScan(index, highs, lows, edge - 1, edge));
+        REQUIRE(SameAsScan(index, highs, lows, b * chan::RangeExtremeIndex::BLOCK, edge - 1));
+    }
+    ASSERT_EQ(index.ArgMax(-1, 5), -1);
+    ASSERT_EQ(index.ArgMax(5, 4), -1);
+    ASSERT_EQ(index.ArgMin(0, SIZE), -1);
+    
+    // 逐根追加并反复修改最后一根：每步与扫描一致
+    chan::RangeExtremeIndex stream;
+    std::vector<float> sh, sl;
+    for (int i = 0; i < 700; ++i) {
+        sh.push_back(highs[i] + 3.0f);
+        sl.push_back(lows[i] - 3.0f);
+        stream.Append(sh.back(), sl.back());
+        for (int u = 0; u < 3; ++u) {
+            sh.back() = highs[i] + (float)(u % 2);
+            sl.back() = lows[i] - (float)u;
+            stream.UpdateLast(sh.back(), sl.back());
+            int first = (int)(pick.Next() * i);
+            REQUIRE(SameAsScan(stream, sh, sl, first, i));
+            REQUIRE(SameAsScan(stream, sh, sl, 0, i));
+        }
+    }
+    for (int first = 0; first < 700; first += 13) {
+        for (int last = first; last < 700; last += 17) {
+            REQUIRE(SameAsScan(stream, sh, sl, first, last));
+        }
+    }
+    
+    // ChanCore：启用后随 Analyze 与流式更新维护，未启用返回-1
+    chan::ChanConfig config;
+    chan::ChanCore off(config);
+    off.Analyze(highs.data(), lows.data(), nullptr, nullptr, SIZE);
+    ASSERT_EQ(off.GetRangeHighIndex(0, 10), -1);
+    config.range_index = true;
+    chan::ChanCore core(config);
+    core.Analyze(highs.data(), lows.data(), nullptr, nullptr, SIZE);
+    ASSERT_EQ(core.GetRangeHighIndex(100, 2000), ScanArgExtreme(highs, 100, 2000, true));
+    ASSERT_EQ(core.GetRangeLowIndex(100, 2000), ScanArgExtreme(lows, 100, 2000, false));
+    chan::ChanCore live(config);
+    for (int i = 0; i < 500; ++i) {
+        live.AppendBar(highs[i] + 1.0f, lows[i], highs[i], 0.0f);
+        live.UpdateLastBar(highs[i], lows[i], highs[i], 0.0f);
+    }
+    ASSERT_EQ(live.GetRangeHighIndex(3, 499), ScanArgExtreme(highs, 3, 499, true));
+    ASSERT_EQ(live.GetRangeLowIndex(3, 499), ScanArgExtreme(lows, 3, 499, false));
+    
+    // 重复分析不分配内存
+    core.Analyze(highs.data(), lows.data(), nullptr, nullptr, SIZE);
+    ASSERT_EQ(CountAllocs([&] { core.Analyze(highs.data(), lows.data(), nullptr, nullptr, SIZE); }), 0);
+    
+    // 1M K线：内存 O(N)，随机区间查询耗时
+    const int BIG = 1000000;
+    std::vector<float> big_highs(BIG), big_lows(BIG);
+    for (int i = 0; i < BIG; ++i) {
+        walk.Bar(big_highs[i], big_lows[i]);
+    }
+    auto t0 = std::chrono::high_resolution_clock::now();
+    index.Build(big_highs.data(), big_lows.data(), BIG);
+    auto t1 = std::chrono::high_resolution_clock::now();
+    const int QUERIES = 1000000;
+    long long checksum = 0;
+    unsigned int seed = 11u;
+    for (int q = 0; q < QUERIES; ++q) {
+        seed = seed * 1103515245u + 12345u;
+        int a = (int)(seed % BIG);
+        seed = seed * 1103515245u + 12345u;
+        int b = (int)(seed % BIG);
+        checksum += index.ArgMax(std::min(a, b), std::max(a, b)) +
+                    index.ArgMin(std::min(a, b), std::max(a, b));
+    }
+    auto t2 = std::chrono::high_resolution_clock::now();
+    auto build_us = std::chrono::duration_cast<std::chrono::microseconds>(t1 - t0).count();
+    auto query_us = std::chrono::duration_cast<std::chrono::microseconds>(t2 - t1).count();
+    size_t bytes = index.MemoryBytes();
+    std::cout << "\n  1M K线: 构建 " << build_us << " us, 内存 " << bytes / 1024 << " KB, "
+              << QUERIES << " 次随机区间最高+最低 " << query_us << " us";
+    REQUIRE(checksum > 0);
+    REQUIRE(bytes < (size_t)BIG * 24);  // 高低价副本8 + 位图8 + 块稀疏表
+    REQUIRE(query_us < QUERIES);     // 平均每次（最高+最低）不超过1us
+}
+
 // ============================================================================
 // 主函数
 // ============================================================================
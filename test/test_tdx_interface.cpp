@@ -0,0 +1,303 @@
+// ============================================================================
+// 缠论通达信DLL插件 - 通达信接口测试
+// ============================================================================
+// 直接链接 tdx_interface.cpp，通过 RegisterTdxFunc 取得函数表
+// 按注册的默认参数调用全部导出函数，递归引用类输出须与 ChanCore 直接计算一致
+// ============================================================================
+
+#include "tdx_interface.h"
+#include "chan_core.h"
+#include "config_reader.h"
+#include <iostream>
+#include <cstring>
+#include <cmath>
+#include <vector>
+#include <string>
+#include <stdexcept>
+#include <thread>
+#include <atomic>
+
+// ============================================================================
+// 测试辅助宏
+// ============================================================================
+
+// 测试在 main 中依次运行：导出函数依赖 tdx_interface.cpp 的全局对象，
+// 不能在静态初始化阶段调用
+typedef void (*TestFunc)();
+
+struct TestEntry {
+    const char* name;
+    TestFunc func;
+};
+
+static std::vector<TestEntry>& Tests() {
+    static std::vector<TestEntry> tests;
+    return tests;
+}
+
+#define TEST_CASE(name) \
+    void test_##name(); \
+    struct TestReg_##name { \
+        TestReg_##name() { Tests().push_back(TestEntry{#name, &test_##name}); } \
+    } g_reg_##name; \
+    void test_##name()
+
+#define ASSERT_EQ(a, b) \
+    if ((a) != (b)) { \
+        throw std::runtime_error("ASSERT_EQ failed: " + std::to_string(a) + " != " + std::to_string(b)); \
+    }
+
+#define ASSERT_TRUE(x) \
+    if (!(x)) { \
+        throw std::runtime_error("ASSERT_TRUE failed"); \
+    }
+
+// ============================================================================
+// 辅助函数
+// ============================================================================
+
+// 随机游走K线（固定种子，可复现）
+struct Series {
+    std::vector<float> highs;
+    std::vector<float> lows;
+    std::vector<float> closes;
+    std::vector<float> volumes;
+
+    Series(unsigned int seed, int count) {
+        float price = 100.0f;
+        for (int i = 0; i < count; ++i) {
+            seed = seed * 1103515245u + 12345u;
+            price += ((float)((seed >> 16) & 0x7FFF) / 32767.0f - 0.5f) * 2.0f;
+            seed = seed * 1103515245u + 12345u;
+            float spread = (float)((seed >> 16) & 0x7FFF) / 32767.0f * 1.5f;
+            highs.push_back(price + spread);
+            lows.push_back(price - spread);
+            closes.push_back(price);
+            volumes.push_back(1000.0f + (float)((seed >> 8) & 0xFF));
+        }
+    }
+
+    int Count() const { return (int)highs.size(); }
+};
+
+static std::vector<PluginTCalcFuncInfo> GetFuncs() {
+    PluginTCalcFuncInfo* info = nullptr;
+    int count = 0;
+    RegisterTdxFunc(&info, &count);
+    return std::vector<PluginTCalcFuncInfo>(info, info + count);
+}
+
+// 按函数声明的默认参数调用
+static std::vector<float> CallWithDefaults(const PluginTCalcFuncInfo& info, Series& s) {
+    float params[8];
+    memcpy(params, info.fParamDef, sizeof(params));
+    std::vector<float> out(s.Count(), -12345.0f);
+    info.pCalcFunc(s.Count(), out.data(), s.highs.data(), s.lows.data(), s.closes.data(),
+                   s.volumes.data(), nullptr, params);
+    return out;
+}
+
+// 调用导出函数，参数为 N 与 IDX/TYPE
+static std::vector<float> Call(PluginTCalcFunc func, Series& s, float n, float idx) {
+    float params[8] = { n, idx };
+    std::vector<float> out(s.Count(), -12345.0f);
+    func(s.Count(), out.data(), s.highs.data(), s.lows.data(), s.closes.data(),
+         s.volumes.data(), nullptr, params);
+    return out;
+}
+
+static bool SameBits(const std::vector<float>& a, const std::vector<float>& b) {
+    return a.size() == b.size() &&
+           (a.empty() || memcmp(a.data(), b.data(), a.size() * sizeof(float)) == 0);
+}
+
+// ============================================================================
+// 测试用例
+// ============================================================================
+
+// ----------------------------------------------------------------------------
+// 测试1: 函数表注册
+// ----------------------------------------------------------------------------
+TEST_CASE(Register_FuncInfo) {
+    std::vector<PluginTCalcFuncInfo> funcs = GetFuncs();
+    ASSERT_EQ((int)funcs.size(), 24);
+    for (const PluginTCalcFuncInfo& info : funcs) {
+        ASSERT_TRUE(info.pCalcFunc != nullptr);
+        ASSERT_EQ(info.nFuncMark, 0x0001);
+        ASSERT_TRUE(strncmp(info.sName, "CHAN_", 5) == 0);
+    }
+}
+
+// ----------------------------------------------------------------------------
+// 测试2: 按默认参数调用全部导出函数，输出写满且为有限值
+// ----------------------------------------------------------------------------
+TEST_CASE(AllExports_DefaultParams) {
+    Series s(20260201u, 1500);
+    for (const PluginTCalcFuncInfo& info : GetFuncs()) {
+        std::vector<float> out = CallWithDefaults(info, s);
+        for (float v : out) {
+            if (v == -12345.0f || !std::isfinite(v)) {
+                throw std::runtime_error(std::string("输出未写满: ") + info.sName);
+            }
+        }
+        // 第二次调用命中缓存，结果不变
+        ASSERT_TRUE(SameBits(CallWithDefaults(info, s), out));
+    }
+}
+
+// ----------------------------------------------------------------------------
+// 测试3: 递归引用类导出函数与 ChanCore 直接计算一致
+// ----------------------------------------------------------------------------
+TEST_CASE(BiSequenceExports_MatchCore) {
+    Series s(77u, 2000);
+    const int N = 5;
+    int count = s.Count();
+
+    // 先调用一次导出函数加载配置，基准按相同配置计算
+    Call(CHAN_DIR_Calc, s, (float)N, 0.0f);
+    chan::ChanConfig config = chan::GetGlobalConfigReader().ToChanConfig();
+    config.min_bi_len = N;
+    chan::ChanCore core(config);
+    ASSERT_EQ(core.Analyze(s.highs.data(), s.lows.data(), s.closes.data(), s.volumes.data(), count), 0);
+    core.BuildBiSequence(count - 1);
+
+    std::vector<float> expected(count);
+    core.OutputDirection(expected.data(), count);
+    ASSERT_TRUE(SameBits(Call(CHAN_DIR_Calc, s, (float)N, 0.0f), expected));
+
+    for (int idx = 1; idx <= 5; ++idx) {
+        core.OutputGG(expected.data(), count, idx);
+        ASSERT_TRUE(SameBits(Call(CHAN_GG_Calc, s, (float)N, (float)idx), expected));
+        core.OutputDD(expected.data(), count, idx);
+        ASSERT_TRUE(SameBits(Call(CHAN_DD_Calc, s, (float)N, (float)idx), expected));
+        core.OutputHH(expected.data(), count, idx);
+        ASSERT_TRUE(SameBits(Call(CHAN_HH_Calc, s, (float)N, (float)idx), expected));
+        core.OutputLL(expected.data(), count, idx);
+        ASSERT_TRUE(SameBits(Call(CHAN_LL_Calc, s, (float)N, (float)idx), expected));
+    }
+
+    std::vector<float> amp = Call(CHAN_AMP_Calc, s, (float)N, 1.0f);
+    for (int i = 0; i < count; ++i) {
+        ASSERT_EQ(amp[i], core.CheckFirstBuyKJA(i) ? 1.0f : 0.0f);
+    }
+}
+
+// ----------------------------------------------------------------------------
+// 测试4: 同一公式的全部导出函数（默认参数）共享一次分析
+// ----------------------------------------------------------------------------
+TEST_CASE(OneFormula_SingleAnalysis) {
+    Series s(31337u, 1200);
+    int hits0 = 0, misses0 = 0, entries0 = 0;
+    GetChanCacheStats(&hits0, &misses0, &entries0);
+
+    std::vector<PluginTCalcFuncInfo> funcs = GetFuncs();
+    for (const PluginTCalcFuncInfo& info : funcs) {
+        CallWithDefaults(info, s);
+    }
+
+    int hits = 0, misses = 0, entries = 0;
+    GetChanCacheStats(&hits, &misses, &entries);
+    ASSERT_EQ(misses - misses0, 1);
+    ASSERT_EQ(hits - hits0, (int)funcs.size() - 1);
+}
+
+// ----------------------------------------------------------------------------
+// 测试5: 多线程并发调用（数据多于缓存会话数，持续淘汰）与单线程结果一致
+// ----------------------------------------------------------------------------
+TEST_CASE(ConcurrentExports_MatchSingleThread) {
+    const int THREADS = 8;
+    const int ROUNDS = 3;
+    const int SERIES = 160;         // 多于默认 CacheEntries=128
+    const int BARS = 300;
+
+    struct Export {
+        PluginTCalcFunc func;
+        float idx;
+    };
+    const Export exports[] = {
+        { CHAN_BUYX_Calc, 0.0f }, { CHAN_SELLX_Calc, 0.0f }, { CHAN_BI_Calc, 0.0f },
+        { CHAN_GG_Calc, 2.0f }, { CHAN_ZS_Z_Calc, 0.0f }, { CHAN_PREBUY_Calc, 0.0f }
+    };
+    const int EXPORTS = (int)(sizeof(exports) / sizeof(exports[0]));
+
+    std::vector<Series> series;
+    for (int k = 0; k < SERIES; ++k) {
+        series.emplace_back(5000u + 104729u * (unsigned int)k, BARS);
+    }
+
+    // 单线程基准
+    std::vector<std::vector<float>> expected(SERIES * EXPORTS);
+    for (int k = 0; k < SERIES; ++k) {
+        for (int e = 0; e < EXPORTS; ++e) {
+            expected[k * EXPORTS + e] = Call(exports[e].func, series[k], 4.0f, exports[e].idx);
+        }
+    }
+
+    std::atomic<int> mismatches(0);
+    std::atomic<int> ready(0);
+    std::vector<std::thread> workers;
+    for (int t = 0; t < THREADS; ++t) {
+        workers.emplace_back([&, t]() {
+            ++ready;
+            while (ready.load() < THREADS) {
+                std::this_thread::yield();
+            }
+            // 各线程从不同位置开始遍历，同一数据同时在多个线程上命中、淘汰、重算
+            for (int r = 0; r < ROUNDS; ++r) {
+                for (int j = 0; j < SERIES; ++j) {
+                    int k = (j + t * (SERIES / THREADS)) % SERIES;
+                    for (int e = 0; e < EXPORTS; ++e) {
+                        std::vector<float> out =
+                            Call(exports[e].func, series[k], 4.0f, exports[e].idx);
+                        if (!SameBits(out, expected[k * EXPORTS + e])) {
+                            ++mismatches;
+                        }
+                    }
+                }
+            }
+        });
+    }
+    for (auto& w : workers) {
+        w.join();
+    }
+
+    int hits = 0, misses = 0, entries = 0;
+    GetChanCacheStats(&hits, &misses, &entries);
+    std::cout << "\n  " << THREADS << "线程 x " << ROUNDS << "轮, 缓存会话=" << entries
+              << ", 不一致=" << mismatches.load() << " ";
+    ASSERT_TRUE(entries <= 128);
+    ASSERT_EQ(mismatches.load(), 0);
+}
+
+// ============================================================================
+// 主函数
+// ============================================================================
+
+int main() {
+    std::cout << "\n========================================" << std::endl;
+    std::cout << "通达信接口测试" << std::endl;
+    std::cout << "========================================\n" << std::endl;
+
+    int total = 0;
+    int failed = 0;
+    for (const TestEntry& test : Tests()) {
+        std::cout << "Running test: " << test.name << "... ";
+        try {
+            test.func();
+            std::cout << "PASSED" << std::endl;
+        } catch (const std::exception& e) {
+            std::cout << "FAILED: " << e.what() << std::endl;
+            failed++;
+        }
+        total++;
+    }
+
+    std::cout << "\n========================================" << std::endl;
+    std::cout << "测试完成: " << (total - failed) << "/" << total << " 通过" << std::endl;
+    if (failed > 0) {
+        std::cout << "失败: " << failed << " 个测试" << std::endl;
+    }
+    std::cout << "========================================\n" << std::endl;
+
+    return failed > 0 ? 1 : 0;
+}
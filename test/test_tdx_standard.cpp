@@ -0,0 +1,270 @@
+// ============================================================================
+// 缠论通达信DLL插件 - 标准接口并发测试
+// ============================================================================
+// 直接链接 tdx_standard.cpp，通过 RegisterTdxFunc 取得函数表
+// 多线程在不同数据上同时调用全部导出函数，结果须与单线程调用逐位一致
+// ============================================================================
+
+#include <windows.h>
+#include <iostream>
+#include <cstring>
+#include <cmath>
+#include <vector>
+#include <string>
+#include <thread>
+#include <atomic>
+#include <stdexcept>
+
+#include "perf_counters.h"
+
+// ============================================================================
+// 通达信接口声明（与 tdx_standard.cpp 一致）
+// ============================================================================
+
+typedef void (*pPluginFUNC)(int DataLen, float* pfOUT, float* pfINa, float* pfINb, float* pfINc);
+
+#pragma pack(push, 1)
+typedef struct tagPluginTCalcFuncInfo {
+    unsigned short nFuncMark;
+    pPluginFUNC pCallFunc;
+} PluginTCalcFuncInfo;
+#pragma pack(pop)
+
+extern "C" BOOL RegisterTdxFunc(PluginTCalcFuncInfo** pFun);
+extern "C" int __stdcall GetChanPerfStats(chan::PerfStat* pStats, int nCapacity);
+
+// ============================================================================
+// 测试辅助宏
+// ============================================================================
+
+#define TEST_CASE(name) \
+    void test_##name(); \
+    struct TestReg_##name { \
+        TestReg_##name() { \
+            std::cout << "Running test: " << #name << "... "; \
+            try { \
+                test_##name(); \
+                std::cout << "PASSED" << std::endl; \
+            } catch (const std::exception& e) { \
+                std::cout << "FAILED: " << e.what() << std::endl; \
+                g_failed++; \
+            } \
+            g_total++; \
+        } \
+    } g_reg_##name; \
+    void test_##name()
+
+#define ASSERT_EQ(a, b) \
+    if ((a) != (b)) { \
+        throw std::runtime_error("ASSERT_EQ failed: " + std::to_string(a) + " != " + std::to_string(b)); \
+    }
+
+#define ASSERT_TRUE(x) \
+    if (!(x)) { \
+        throw std::runtime_error("ASSERT_TRUE failed"); \
+    }
+
+// 全局测试统计
+static int g_total = 0;
+static int g_failed = 0;
+
+// ============================================================================
+// 辅助函数
+// ============================================================================
+
+// 随机游走K线（固定种子，可复现）
+struct Series {
+    std::vector<float> highs;
+    std::vector<float> lows;
+    std::vector<float> closes;
+
+    Series(unsigned int seed, int count) {
+        float price = 100.0f;
+        for (int i = 0; i < count; ++i) {
+            seed = seed * 1103515245u + 12345u;
+            price += ((float)((seed >> 16) & 0x7FFF) / 32767.0f - 0.5f) * 2.0f;
+            seed = seed * 1103515245u + 12345u;
+            float spread = (float)((seed >> 16) & 0x7FFF) / 32767.0f * 1.5f;
+            highs.push_back(price + spread);
+            lows.push_back(price - spread);
+            closes.push_back(price);
+        }
+    }
+};
+
+static PluginTCalcFuncInfo* GetFuncSets() {
+    PluginTCalcFuncInfo* funcs = NULL;
+    RegisterTdxFunc(&funcs);
+    return funcs;
+}
+
+static int CountFuncs(const PluginTCalcFuncInfo* funcs) {
+    int n = 0;
+    while (funcs[n].pCallFunc) {
+        ++n;
+    }
+    return n;
+}
+
+// 依次调用全部导出函数（每个前缀长度都算一遍，覆盖增量路径），输出拼接
+static std::vector<float> RunAll(const PluginTCalcFuncInfo* funcs, Series& s,
+                                 const std::vector<int>& lengths) {
+    std::vector<float> result;
+    std::vector<float> out;
+    for (int len : lengths) {
+        out.assign(len, 0.0f);
+        for (int f = 0; funcs[f].pCallFunc; ++f) {
+            funcs[f].pCallFunc(len, out.data(), s.highs.data(), s.lows.data(), s.closes.data());
+            result.insert(result.end(), out.begin(), out.end());
+        }
+    }
+    return result;
+}
+
+static bool SameBits(const std::vector<float>& a, const std::vector<float>& b) {
+    return a.size() == b.size() &&
+           (a.empty() || memcmp(a.data(), b.data(), a.size() * sizeof(float)) == 0);
+}
+
+// ============================================================================
+// 测试用例
+// ============================================================================
+
+// ----------------------------------------------------------------------------
+// 测试1: 函数表注册
+// ----------------------------------------------------------------------------
+TEST_CASE(Register_FuncSets) {
+    PluginTCalcFuncInfo* funcs = GetFuncSets();
+    ASSERT_TRUE(funcs != NULL);
+    ASSERT_EQ(CountFuncs(funcs), 21);
+
+    // 已注册时不覆盖
+    PluginTCalcFuncInfo* other = funcs;
+    ASSERT_TRUE(!RegisterTdxFunc(&other));
+    ASSERT_TRUE(!RegisterTdxFunc(NULL));
+}
+
+// ----------------------------------------------------------------------------
+// 测试2: 多线程并发调用与单线程结果一致
+// ----------------------------------------------------------------------------
+TEST_CASE(ConcurrentExports_MatchSingleThread) {
+    const int THREADS = 8;
+    const int ROUNDS = 8;
+    const int BARS = 600;
+    PluginTCalcFuncInfo* funcs = GetFuncSets();
+
+    // 每个线程两组数据：交替调用触发全量重算，逐根增长触发增量重算
+    std::vector<Series> series;
+    std::vector<std::vector<int>> lengths(THREADS * 2);
+    for (int t = 0; t < THREADS * 2; ++t) {
+        series.emplace_back(1000u + 7919u * (unsigned int)t, BARS);
+        for (int len = BARS - 12 - t; len <= BARS; len += 1 + t % 3) {
+            lengths[t].push_back(len);
+        }
+    }
+
+    // 单线程基准
+    std::vector<std::vector<float>> expected;
+    for (int t = 0; t < THREADS * 2; ++t) {
+        expected.push_back(RunAll(funcs, series[t], lengths[t]));
+    }
+
+    std::atomic<int> mismatches(0);
+    std::atomic<int> ready(0);
+    std::vector<std::thread> workers;
+    for (int t = 0; t < THREADS; ++t) {
+        workers.emplace_back([&, t]() {
+            ++ready;
+            while (ready.load() < THREADS) {
+                std::this_thread::yield();
+            }
+            for (int r = 0; r < ROUNDS; ++r) {
+                int k = t * 2 + (r & 1);
+                if (!SameBits(RunAll(funcs, series[k], lengths[k]), expected[k])) {
+                    ++mismatches;
+                }
+            }
+        });
+    }
+    for (auto& w : workers) {
+        w.join();
+    }
+
+    std::cout << "\n  " << THREADS << "线程 x " << ROUNDS << "轮, 不一致=" << mismatches.load();
+    ASSERT_EQ(mismatches.load(), 0);
+}
+
+// ----------------------------------------------------------------------------
+// 测试3: 其它线程的调用不影响本线程的缓存结果
+// ----------------------------------------------------------------------------
+TEST_CASE(ThreadContext_Isolated) {
+    PluginTCalcFuncInfo* funcs = GetFuncSets();
+    Series a(42u, 800);
+    Series b(4242u, 600);
+    std::vector<int> len_a(1, 800);
+    std::vector<int> len_b(1, 600);
+
+    std::vector<float> first = RunAll(funcs, a, len_a);
+
+    // 另一线程分析不同数据
+    std::thread other([&]() { RunAll(funcs, b, len_b); });
+    other.join();
+
+    // 本线程再次调用同一数据（走缓存），结果不变
+    ASSERT_TRUE(SameBits(RunAll(funcs, a, len_a), first));
+}
+
+// ----------------------------------------------------------------------------
+// 测试4: 性能计数 - 每个 TDXDLL1 函数一项，记录调用与数据未变的命中
+// ----------------------------------------------------------------------------
+static std::vector<chan::PerfStat> PerfSnapshot() {
+    std::vector<chan::PerfStat> stats(GetChanPerfStats(NULL, 0));
+    GetChanPerfStats(stats.data(), (int)stats.size());
+    return stats;
+}
+
+TEST_CASE(PerfCounters_EveryExport) {
+    PluginTCalcFuncInfo* funcs = GetFuncSets();
+    int count = CountFuncs(funcs);
+    std::vector<chan::PerfStat> before = PerfSnapshot();
+    ASSERT_TRUE((int)before.size() >= count);
+
+    // 新数据调用两轮：第一个函数重新分析，其余调用数据未变
+    Series s(9091u, 700);
+    std::vector<int> lengths(1, 700);
+    RunAll(funcs, s, lengths);
+    RunAll(funcs, s, lengths);
+
+    std::vector<chan::PerfStat> after = PerfSnapshot();
+    uint64_t hits = 0, misses = 0;
+    for (int f = 0; f < count; ++f) {
+        ASSERT_EQ((int)after[f].kind, (int)chan::PerfKind::EXPORT);
+        ASSERT_EQ((int)(after[f].calls - before[f].calls), 2);
+        hits += after[f].cache_hits - before[f].cache_hits;
+        misses += after[f].cache_misses - before[f].cache_misses;
+    }
+    // TestFunc 不分析数据，其余 20 个函数各两次
+    ASSERT_EQ((int)misses, 1);
+    ASSERT_EQ((int)hits, 2 * (count - 1) - 1);
+}
+
+// ============================================================================
+// 主函数
+// ============================================================================
+
+int main() {
+    std::cout << "\n========================================" << std::endl;
+    std::cout << "标准接口并发测试" << std::endl;
+    std::cout << "========================================\n" << std::endl;
+
+    // 测试已经在静态初始化时运行
+
+    std::cout << "\n========================================" << std::endl;
+    std::cout << "测试完成: " << (g_total - g_failed) << "/" << g_total << " 通过" << std::endl;
+    if (g_failed > 0) {
+        std::cout << "失败: " << g_failed << " 个测试" << std::endl;
+    }
+    std::cout << "========================================\n" << std::endl;
+
+    return g_failed > 0 ? 1 : 0;
+}
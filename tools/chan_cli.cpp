@@ -0,0 +1,428 @@
+// ============================================================================
+// 缠论通达信DLL插件 - 命令行分析工具
+// ============================================================================
+// 脱离通达信在任意平台运行 ChanCore：
+//   chan_cli [选项] <K线文件>...
+// 输入：
+//   CSV    - 表头可选；有表头时按列名取 high/low/close/volume（也识别 最高/最低/收盘/成交量），
+//            无表头时各列依次为 [日期,] open, high, low, close [, volume]
+//   二进制 - 每根K线 5 个小端 float32：open, high, low, close, volume
+//   通达信 - vipdoc 下的 .day/.lc1/.lc5 文件，内存映射读取
+// 输出：
+//   每个文件一行汇总到标准输出；指定 -o 时另写
+//   <前缀><文件名>.fractals.csv / .strokes.csv / .pivots.csv / .signals.csv
+// ============================================================================
+
+#include "chan_core.h"
+#include "config_reader.h"
+#include "logger.h"
+#include "tdx_data_reader.h"
+#include <algorithm>
+#include <cctype>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+namespace {
+
+// ============================================================================
+// K线数据读取
+// ============================================================================
+
+struct BarData {
+    std::vector<float> highs;
+    std::vector<float> lows;
+    std::vector<float> closes;
+    std::vector<float> volumes;
+
+    int Count() const { return (int)highs.size(); }
+};
+
+bool ReadFile(const std::string& path, std::string& content) {
+    std::ifstream file(path, std::ios::binary);
+    if (!file.good()) {
+        return false;
+    }
+    std::stringstream buffer;
+    buffer << file.rdbuf();
+    content = buffer.str();
+    return true;
+}
+
+std::vector<std::string> SplitFields(const std::string& line) {
+    std::vector<std::string> fields;
+    std::string field;
+    for (char c : line) {
+        if (c == ',' || c == ';' || c == '\t') {
+            fields.push_back(field);
+            field.clear();
+        } else if (c != '\r' && c != '"') {
+            field += c;
+        }
+    }
+    fields.push_back(field);
+    return fields;
+}
+
+bool ParseFloat(const std::string& text, float& value) {
+    const char* begin = text.c_str();
+    while (isspace((unsigned char)*begin)) ++begin;
+    char* end = nullptr;
+    value = strtof(begin, &end);
+    if (end == begin) {
+        return false;
+    }
+    while (isspace((unsigned char)*end)) ++end;
+    return *end == '\0';
+}
+
+std::string Lower(std::string text) {
+    for (char& c : text) {
+        c = (char)tolower((unsigned char)c);
+    }
+    while (!text.empty() && isspace((unsigned char)text.back())) text.pop_back();
+    while (!text.empty() && isspace((unsigned char)text.front())) text.erase(0, 1);
+    return text;
+}
+
+int FindColumn(const std::vector<std::string>& header, const char* const* names) {
+    for (size_t i = 0; i < header.size(); ++i) {
+        std::string col = Lower(header[i]);
+        for (const char* const* n = names; *n; ++n) {
+            if (col == *n) return (int)i;
+        }
+    }
+    return -1;
+}
+
+bool LoadCsv(const std::string& path, BarData& data, std::string& error) {
+    std::string content;
+    if (!ReadFile(path, content)) {
+        error = "无法打开文件";
+        return false;
+    }
+    if (content.compare(0, 3, "\xEF\xBB\xBF") == 0) {
+        content.erase(0, 3);
+    }
+
+    static const char* const kHigh[] = {"high", "h", "最高", "最高价", nullptr};
+    static const char* const kLow[] = {"low", "l", "最低", "最低价", nullptr};
+    static const char* const kClose[] = {"close", "c", "收盘", "收盘价", nullptr};
+    static const char* const kVolume[] = {"volume", "vol", "v", "成交量", nullptr};
+
+    int col_high = -1, col_low = -1, col_close = -1, col_volume = -1;
+    bool columns_known = false;
+
+    std::istringstream stream(content);
+    std::string line;
+    int line_no = 0;
+    while (std::getline(stream, line)) {
+        ++line_no;
+        std::vector<std::string> fields = SplitFields(line);
+        if (fields.size() == 1 && Lower(fields[0]).empty()) {
+            continue;
+        }
+
+        if (!columns_known) {
+            columns_known = true;
+            col_high = FindColumn(fields, kHigh);
+            col_low = FindColumn(fields, kLow);
+            if (col_high >= 0 && col_low >= 0) {
+                // 表头行
+                col_close = FindColumn(fields, kClose);
+                col_volume = FindColumn(fields, kVolume);
+                continue;
+            }
+            // 无表头：首列不是数字时视为日期列
+            float probe;
+            int base = ParseFloat(fields[0], probe) ? 0 : 1;
+            if ((int)fields.size() < base + 4) {
+                error = "第1行列数不足（需要 open,high,low,close）";
+                return false;
+            }
+            col_high = base + 1;
+            col_low = base + 2;
+            col_close = base + 3;
+            col_volume = (int)fields.size() > base + 4 ? base + 4 : -1;
+        }
+
+        float high, low, close = 0.0f, volume = 0.0f;
+        bool ok = col_high < (int)fields.size() && col_low < (int)fields.size() &&
+                  ParseFloat(fields[col_high], high) && ParseFloat(fields[col_low], low);
+        if (ok && col_close >= 0) {
+            ok = col_close < (int)fields.size() && ParseFloat(fields[col_close], close);
+        }
+        if (ok && col_volume >= 0 && col_volume < (int)fields.size()) {
+            ParseFloat(fields[col_volume], volume);
+        }
+        if (!ok) {
+            error = "第" + std::to_string(line_no) + "行无法解析";
+            return false;
+        }
+        if (col_close < 0) {
+            close = (high + low) / 2;
+        }
+
+        data.highs.push_back(high);
+        data.lows.push_back(low);
+        data.closes.push_back(close);
+        data.volumes.push_back(volume);
+    }
+    return true;
+}
+
+bool LoadBinary(const std::string& path, BarData& data, std::string& error) {
+    std::string content;
+    if (!ReadFile(path, content)) {
+        error = "无法打开文件";
+        return false;
+    }
+    const size_t record = 5 * sizeof(float);
+    if (content.size() % record != 0) {
+        error = "文件长度不是 20 字节的整数倍";
+        return false;
+    }
+
+    int count = (int)(content.size() / record);
+    data.highs.resize(count);
+    data.lows.resize(count);
+    data.closes.resize(count);
+    data.volumes.resize(count);
+    for (int i = 0; i < count; ++i) {
+        float bar[5];
+        memcpy(bar, content.data() + i * record, record);
+        data.highs[i] = bar[1];
+        data.lows[i] = bar[2];
+        data.closes[i] = bar[3];
+        data.volumes[i] = bar[4];
+    }
+    return true;
+}
+
+bool LoadTdx(const std::string& path, float price_scale, BarData& data, std::string& error) {
+    chan::TdxBars bars;
+    if (!chan::LoadTdxFile(path, bars, price_scale)) {
+        error = "无法打开通达信数据文件";
+        return false;
+    }
+    data.highs.swap(bars.highs);
+    data.lows.swap(bars.lows);
+    data.closes.swap(bars.closes);
+    data.volumes.swap(bars.volumes);
+    return true;
+}
+
+// ============================================================================
+// 结果输出
+// ============================================================================
+
+std::string BaseName(const std::string& path) {
+    size_t slash = path.find_last_of("\\/");
+    std::string name = slash == std::string::npos ? path : path.substr(slash + 1);
+    size_t dot = name.find_last_of('.');
+    return dot == std::string::npos || dot == 0 ? name : name.substr(0, dot);
+}
+
+bool WriteResults(const std::string& prefix, const chan::ChanCore& core,
+                  const std::vector<std::vector<float>>& signals, int count) {
+    static const char* const kSignalNames[] = {
+        "BUY", "SELL", "BUYX", "SELLX", "PREBUY", "PRESELL", "LIKE2B", "LIKE2S"
+    };
+
+    FILE* f = fopen((prefix + ".fractals.csv").c_str(), "w");
+    if (!f) return false;
+    const chan::FractalSoA& fx = core.GetFractalSoA();
+    fprintf(f, "bar,merged_index,type,price\n");
+    for (int i = 0; i < fx.size(); ++i) {
+        fprintf(f, "%d,%d,%s,%.4f\n", fx.kline_idx[i], fx.index[i],
+                fx.type[i] == chan::FractalType::TOP ? "top" : "bottom", fx.price[i]);
+    }
+    fclose(f);
+
+    f = fopen((prefix + ".strokes.csv").c_str(), "w");
+    if (!f) return false;
+    const chan::StrokeSoA& st = core.GetStrokeSoA();
+    fprintf(f, "start_bar,end_bar,direction,high,low\n");
+    for (int i = 0; i < st.size(); ++i) {
+        fprintf(f, "%d,%d,%s,%.4f,%.4f\n", st.start_idx[i], st.end_idx[i],
+                st.direction[i] == chan::Direction::UP ? "up" : "down", st.high[i], st.low[i]);
+    }
+    fclose(f);
+
+    f = fopen((prefix + ".pivots.csv").c_str(), "w");
+    if (!f) return false;
+    fprintf(f, "id,start_bar,end_bar,start_stroke,end_stroke,zg,zd,gg,dd,direction\n");
+    for (const chan::Pivot& p : core.GetPivots()) {
+        fprintf(f, "%d,%d,%d,%d,%d,%.4f,%.4f,%.4f,%.4f,%s\n", p.id, p.start_idx, p.end_idx,
+                p.start_stroke_id, p.end_stroke_id, p.ZG, p.ZD, p.GG, p.DD,
+                p.direction == chan::Direction::UP ? "up" : "down");
+    }
+    fclose(f);
+
+    f = fopen((prefix + ".signals.csv").c_str(), "w");
+    if (!f) return false;
+    fprintf(f, "bar");
+    for (const char* name : kSignalNames) fprintf(f, ",%s", name);
+    fprintf(f, "\n");
+    for (int i = 0; i < count; ++i) {
+        bool any = false;
+        for (const auto& sig : signals) any = any || sig[i] != 0.0f;
+        if (!any) continue;
+        fprintf(f, "%d", i);
+        for (const auto& sig : signals) fprintf(f, ",%g", sig[i] + 0.0f);  // -0 输出为 0
+        fprintf(f, "\n");
+    }
+    fclose(f);
+    return true;
+}
+
+// ============================================================================
+// 命令行
+// ============================================================================
+
+void PrintUsage() {
+    fprintf(stderr,
+            "用法: chan_cli [选项] <K线文件>...\n"
+            "  -f, --format csv|bin|tdx\n"
+            "                         输入格式（默认按扩展名：.csv 为 CSV，.day/.lc1/.lc5 为通达信，\n"
+            "                         其余为二进制）\n"
+            "  -s, --price-scale <k>  通达信日线整数价格的换算系数（默认 0.01，基金/债券用 0.001）\n"
+            "  -c, --config <ini>     读取 CZSC.ini 格式的参数\n"
+            "  -o, --output <前缀>    写出分型/笔/中枢/信号 CSV（前缀可为目录，以 / 结尾）\n"
+            "  -r, --repeat <N>       重复分析 N 次并报告平均耗时（性能剖析用）\n"
+            "  -v, --verbose          输出调试日志\n"
+            "  -h, --help             显示帮助\n");
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    std::string format;
+    std::string config_path;
+    std::string output_prefix;
+    int repeat = 1;
+    float price_scale = 0.01f;
+    std::vector<std::string> inputs;
+
+    chan::LogSetLevel(chan::LogLevel::LOG_WARN);
+
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        bool has_value = i + 1 < argc;
+        if ((arg == "-f" || arg == "--format") && has_value) {
+            format = argv[++i];
+        } else if ((arg == "-c" || arg == "--config") && has_value) {
+            config_path = argv[++i];
+        } else if ((arg == "-o" || arg == "--output") && has_value) {
+            output_prefix = argv[++i];
+        } else if ((arg == "-s" || arg == "--price-scale") && has_value) {
+            price_scale = (float)atof(argv[++i]);
+        } else if ((arg == "-r" || arg == "--repeat") && has_value) {
+            repeat = std::max(1, atoi(argv[++i]));
+        } else if (arg == "-v" || arg == "--verbose") {
+            chan::LogSetLevel(chan::LogLevel::LOG_DEBUG);
+        } else if (arg == "-h" || arg == "--help") {
+            PrintUsage();
+            return 0;
+        } else if (!arg.empty() && arg[0] == '-') {
+            fprintf(stderr, "未知选项: %s\n", arg.c_str());
+            PrintUsage();
+            return 2;
+        } else {
+            inputs.push_back(arg);
+        }
+    }
+    if (inputs.empty() || (!format.empty() && format != "csv" && format != "bin" && format != "tdx") ||
+        price_scale <= 0.0f) {
+        PrintUsage();
+        return 2;
+    }
+
+    chan::ChanConfig config;
+    if (!config_path.empty()) {
+        chan::ConfigReader reader;
+        if (!reader.LoadConfig(config_path)) {
+            fprintf(stderr, "无法读取配置文件: %s\n", config_path.c_str());
+            return 1;
+        }
+        config = reader.ToChanConfig();
+    }
+
+    int failed = 0;
+    chan::ChanCore core;
+    core.SetConfig(config);
+    printf("file,bars,merged,fractals,strokes,pivots,signal_bars,analyze_us\n");
+
+    for (const std::string& path : inputs) {
+        std::string fmt = format;
+        if (fmt.empty()) {
+            std::string lower = Lower(path);
+            if (chan::DetectTdxFileType(path) != chan::TdxFileType::UNKNOWN) {
+                fmt = "tdx";
+            } else {
+                fmt = lower.size() >= 4 && lower.compare(lower.size() - 4, 4, ".csv") == 0 ? "csv" : "bin";
+            }
+        }
+
+        BarData data;
+        std::string error;
+        bool loaded;
+        if (fmt == "csv") {
+            loaded = LoadCsv(path, data, error);
+        } else if (fmt == "tdx") {
+            loaded = LoadTdx(path, price_scale, data, error);
+        } else {
+            loaded = LoadBinary(path, data, error);
+        }
+        if (!loaded || data.Count() == 0) {
+            fprintf(stderr, "%s: %s\n", path.c_str(), loaded ? "没有K线数据" : error.c_str());
+            ++failed;
+            continue;
+        }
+
+        int count = data.Count();
+        std::vector<std::vector<float>> signals((int)chan::SignalOutput::COUNT,
+                                                std::vector<float>(count));
+        auto t0 = std::chrono::steady_clock::now();
+        for (int r = 0; r < repeat; ++r) {
+            core.Analyze(data.highs.data(), data.lows.data(), data.closes.data(),
+                         data.volumes.data(), count);
+            core.ComputeMAData(data.closes.data(), count);
+            core.BuildBiSequence(count - 1);
+            core.BuildSignalTable(data.highs.data(), data.lows.data(), count);
+            for (int k = 0; k < (int)chan::SignalOutput::COUNT; ++k) {
+                core.ProjectSignal((chan::SignalOutput)k, signals[k].data(), count);
+            }
+        }
+        auto elapsed_us = std::chrono::duration_cast<std::chrono::microseconds>(
+            std::chrono::steady_clock::now() - t0).count() / repeat;
+
+        int signal_bars = 0;
+        for (int i = 0; i < count; ++i) {
+            for (const auto& sig : signals) {
+                if (sig[i] != 0.0f) {
+                    ++signal_bars;
+                    break;
+                }
+            }
+        }
+
+        printf("%s,%d,%d,%d,%d,%d,%d,%lld\n", path.c_str(), count,
+               (int)core.GetMergedKLines().size(), (int)core.GetFractals().size(),
+               (int)core.GetStrokes().size(), (int)core.GetPivots().size(),
+               signal_bars, (long long)elapsed_us);
+
+        if (!output_prefix.empty() &&
+            !WriteResults(output_prefix + BaseName(path), core, signals, count)) {
+            fprintf(stderr, "%s: 无法写出结果到 %s\n", path.c_str(), output_prefix.c_str());
+            ++failed;
+        }
+    }
+
+    return failed > 0 ? 1 : 0;
+}